@@ -9,9 +9,16 @@
 
 #pragma once
 
+#include <span>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cassert>
 
 #include <wt/wt_context.hpp>
 #include <wt/scene/element/info.hpp>
+#include <wt/mesh/mesh.hpp>
 
 #include <wt/math/shapes/ball.hpp>
 #include <wt/math/range.hpp>
@@ -19,6 +26,8 @@
 
 #include "common.hpp"
 #include "intersection_record.hpp"
+#include "intersection_scratch.hpp"
+#include "ray_traversal_state.hpp"
 
 namespace wt::ads {
 
@@ -32,6 +41,8 @@ public:
         bool accumulate_edges;
         bool accumulate_triangles;
         f_t z_search_range_scale;
+        /** @brief Wavelength of the beam, for level-of-detail ADSs: details smaller than a fraction of the wavelength are not resolved. */
+        length_t lod_wavelength = 0*u::m;
 
         static constexpr inline intersect_opts_t defaults() noexcept {
             return {
@@ -39,38 +50,211 @@ public:
                 .accumulate_edges = false,
                 .accumulate_triangles = false,
                 .z_search_range_scale = 1,
+                .lod_wavelength = 0*u::m,
             };
         }
     };
 
+    struct shadow_opts_t {
+        /** @brief Test the triangles that most recently occluded shadow queries on this thread first (see ``occluder_cache_t``). */
+        bool occluder_cache;
+
+        static constexpr inline shadow_opts_t defaults() noexcept {
+            return {
+                .occluder_cache = true,
+            };
+        }
+    };
+
+    /**
+     * @brief A ray segment for batched ray queries.
+     */
+    struct ray_query_t {
+        ray_t ray;
+        pqrange_t<> range;
+    };
+    using shadow_query_t = ray_query_t;
+
 protected:
     std::vector<edge_t> edges;
     std::vector<tri_t> tris;
 
+    /**
+     * @brief Meshes of the shapes the ADS was built from, indexed by ``tri_t::shape_idx``. Triangle vertices are read from the meshes' vertex stores, which must outlive the ADS.
+     */
+    std::vector<const mesh::mesh_t*> meshes;
+
+    /**
+     * @brief Maps each triangle to its first copy, for ADSs that reference a triangle from more than a single leaf (e.g., spatial-split BVHs).
+     *        Empty when triangles are unique.
+     */
+    std::vector<idx_t> tri_canonical;
+
+    /**
+     * @brief Simplified proxy triangles of level-of-detail ADSs, which stand in for the triangles of a subtree. Proxies are addressed by the tuids that follow the triangles' tuids, and have no edges.
+     *        Proxies are only returned by cone queries, and are accessed via ``proxy()``.
+     */
+    std::vector<proxy_tri_t> proxy_tris;
+
+private:
+    static inline std::atomic<std::uint64_t> next_generation = 1;
+    std::uint64_t gen = new_generation_id();
+
+    [[nodiscard]] static inline std::uint64_t new_generation_id() noexcept {
+        return next_generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+protected:
+    /**
+     * @brief Assigns a new generation to the ADS. Must be called when the ADS's data is modified in place (e.g., by refits), invalidating state that was bound to the ADS.
+     */
+    inline void new_generation() noexcept { gen = new_generation_id(); }
+
 public:
     ads_t() noexcept = default;
-    ads_t(std::vector<tri_t> tris) noexcept : tris(std::move(tris)) {}
-    ads_t(ads_t&&) = default;
+    ads_t(std::vector<tri_t> tris,
+          std::vector<const mesh::mesh_t*> meshes,
+          std::vector<idx_t> tri_canonical = {}) noexcept
+        : tris(std::move(tris)), meshes(std::move(meshes)), tri_canonical(std::move(tri_canonical))
+    {
+        assert(this->tri_canonical.empty() || this->tri_canonical.size()==this->tris.size());
+    }
+    ads_t(ads_t&& o) noexcept
+        : edges(std::move(o.edges)),
+          tris(std::move(o.tris)),
+          meshes(std::move(o.meshes)),
+          tri_canonical(std::move(o.tri_canonical)),
+          proxy_tris(std::move(o.proxy_tris))
+    {}
     virtual ~ads_t() noexcept = default;
+
+    /**
+     * @brief Unique identifier of the ADS and the data it was built with: distinct ADSs (including an ADS constructed at the address of a destroyed one) never share a generation, and in-place updates assign a new generation.
+     *        Per-thread state that refers to an ADS's triangles or nodes (``occluder_cache_t``, ``ray_traversal_state_t``) is bound by generation.
+     */
+    [[nodiscard]] inline std::uint64_t generation() const noexcept { return gen; }
     
+    /**
+     * @brief A (non-proxy) triangle.
+     */
     [[nodiscard]] inline const tri_t& tri(tuid_t tuid) const noexcept {
+        assert(!is_proxy(tuid));
         return tris[tuid];
     }
+    /**
+     * @brief True if a triangle is a level-of-detail proxy. Only cone queries return proxies.
+     */
+    [[nodiscard]] inline bool is_proxy(tuid_t tuid) const noexcept {
+        return tuid>=tris.size();
+    }
+    /**
+     * @brief A level-of-detail proxy triangle (``is_proxy(tuid)`` must hold).
+     */
+    [[nodiscard]] inline const proxy_tri_t& proxy(tuid_t tuid) const noexcept {
+        assert(is_proxy(tuid));
+        return proxy_tris[tuid-tris.size()];
+    }
+    /**
+     * @brief Vertices of a (non-proxy) triangle, read from its shape's mesh.
+     */
+    [[nodiscard]] inline std::array<pqvec3_t,3> tri_vertices(tuid_t tuid) const noexcept {
+        return tri_vertices(tris[tuid]);
+    }
+    /**
+     * @brief Vertices of a (non-proxy) triangle of this ADS, read from its shape's mesh.
+     */
+    [[nodiscard]] inline std::array<pqvec3_t,3> tri_vertices(const tri_t& tri) const noexcept {
+        return meshes[tri.shape_idx]->triangle_vertices(tri.shape_tri_idx);
+    }
+    /**
+     * @brief Vertices and face normal of a (non-proxy) triangle.
+     */
+    [[nodiscard]] inline tri_geometry_t tri_geometry(tuid_t tuid) const noexcept {
+        const auto p = tri_vertices(tuid);
+        return tri_geometry_t{
+            .a = p[0], .b = p[1], .c = p[2],
+            // degenerate triangles are discarded at mesh construction
+            .n = util::tri_face_normal(p[0],p[1],p[2]).value_or(dir3_t{ 0,0,1 }),
+        };
+    }
     [[nodiscard]] inline const edge_t& edge(std::uint32_t euid) const noexcept {
         return edges[euid];
     }
 
+    /**
+     * @brief Returns the first copy of a triangle. Copies of a triangle are identical, but only the first copy is ever returned by queries.
+     */
+    [[nodiscard]] inline tuid_t canonical_tuid(tuid_t tuid) const noexcept {
+        return tuid>=tri_canonical.size() ? tuid : tuid_t{ tri_canonical[tuid] };
+    }
+    /**
+     * @brief True if some triangles are referenced by the ADS more than once.
+     */
+    [[nodiscard]] inline bool has_duplicate_triangles() const noexcept { return !tri_canonical.empty(); }
+
     [[nodiscard]] inline auto triangles_count() const noexcept { return tris.size(); }
     [[nodiscard]] virtual std::size_t nodes_count() const noexcept = 0;
 
+    /**
+     * @brief Resident memory used by the ADS, in bytes. Excludes the meshes, which the ADS shares with shading.
+     */
+    [[nodiscard]] virtual std::size_t memory_bytes() const noexcept {
+        return tris.capacity()*sizeof(tri_t) + edges.capacity()*sizeof(edge_t) +
+               meshes.capacity()*sizeof(const mesh::mesh_t*) +
+               tri_canonical.capacity()*sizeof(idx_t) +
+               proxy_tris.capacity()*sizeof(proxy_tri_t);
+    }
+
     [[nodiscard]] virtual const aabb_t& V() const noexcept = 0;
 
+    /**
+     * @brief Thread-local scratch used by queries that are not passed an explicit scratch.
+     */
+    [[nodiscard]] static inline intersection_scratch_t& default_scratch() noexcept {
+        static thread_local intersection_scratch_t scratch;
+        return scratch;
+    }
+
     /**
      * @brief Intersects the ADS with ball, returning the intersection record and contained primitives.
+     *        The returned record references storage in ``scratch``.
      */
     [[nodiscard]] virtual intersection_record_t intersect(
             const ball_t &ball,
+            intersection_scratch_t& scratch,
             const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept = 0;
+    /**
+     * @brief Intersects the ADS with ball, returning the intersection record and contained primitives.
+     *        Uses the thread-local default scratch: the record is valid until the next query on this thread that uses the default scratch.
+     */
+    [[nodiscard]] inline intersection_record_t intersect(
+            const ball_t &ball,
+            const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept {
+        return intersect(ball, default_scratch(), opts);
+    }
+
+    /**
+     * @brief Tests the ADS against a ball. Returns TRUE once any triangle that intersects the ball is found.
+     */
+    [[nodiscard]] virtual bool test(const ball_t &ball) const noexcept = 0;
+
+    /**
+     * @brief Finds the (up to) ``k`` edges that are nearest to the ball's centre, out of the edges that intersect the ball. Edges are ordered by distance.
+     *        The returned span references storage in ``scratch``.
+     */
+    [[nodiscard]] virtual std::span<const nearest_edge_t> nearest_edges(
+            const ball_t &ball,
+            std::size_t k,
+            intersection_scratch_t& scratch) const noexcept = 0;
+    /**
+     * @brief Finds the (up to) ``k`` edges that are nearest to the ball's centre, out of the edges that intersect the ball. Edges are ordered by distance.
+     *        Uses the thread-local default scratch.
+     */
+    [[nodiscard]] inline std::span<const nearest_edge_t> nearest_edges(
+            const ball_t &ball,
+            std::size_t k) const noexcept {
+        return nearest_edges(ball, k, default_scratch());
+    }
 
     /**
      * @brief Intersects the ADS with a ray, returning the intersection record with the intersected  primitive.
@@ -82,17 +266,69 @@ public:
             const ray_t &ray,
             const pqrange_t<> range = { 0*u::m, limits<length_t>::infinity() }) const noexcept = 0;
 
+    /**
+     * @brief Batched ray queries: sets ``records[i]`` to the intersection record of ``queries[i]``.
+     *        Implementations may reorder the queries for coherent traversal. The default implementation issues the queries one at a time.
+     */
+    virtual void intersect(
+            std::span<const ray_query_t> queries,
+            std::span<intersection_record_t> records) const noexcept {
+        assert(records.size()>=queries.size());
+        for (std::size_t i=0; i<queries.size(); ++i)
+            records[i] = intersect(queries[i].ray, queries[i].range);
+    }
+
+    /**
+     * @brief Intersects the ADS with a ray, resuming the traversal suspended in ``state`` by previous queries with the same ray. Successive queries must use non-decreasing range minima.
+     *        Used to extend a ray segment without revisiting the nodes that previous segments already traversed. The default implementation traverses from the root.
+     *
+     * @param range traversal bounds
+     * @param state suspended traversal, updated by the query
+     */
+    [[nodiscard]] virtual intersection_record_t intersect(
+            const ray_t &ray,
+            const pqrange_t<> range,
+            ray_traversal_state_t& state) const noexcept {
+        return intersect(ray, range);
+    }
+
     /**
      * @brief Intersects the ADS with an elliptic cone, returning the intersection record and contained primitives.
      *        Once the closest intersection is found, looks for triangles within a z distance from the closest point. This distance is computed as the cone major axis length time 'z_search_range_scale'.
+     *        The returned record references storage in ``scratch``.
      *
      * @param range traversal bounds
      * @param z_search_range_scale scaler for z-axis search range
      */
     [[nodiscard]] virtual intersection_record_t intersect(
             const elliptic_cone_t &cone,
+            intersection_scratch_t& scratch,
             const pqrange_t<> range = { 0*u::m, limits<length_t>::infinity() },
             const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept = 0;
+    /**
+     * @brief Intersects the ADS with an elliptic cone, returning the intersection record and contained primitives.
+     *        Uses the thread-local default scratch: the record is valid until the next query on this thread that uses the default scratch.
+     *
+     * @param range traversal bounds
+     */
+    [[nodiscard]] inline intersection_record_t intersect(
+            const elliptic_cone_t &cone,
+            const pqrange_t<> range = { 0*u::m, limits<length_t>::infinity() },
+            const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept {
+        return intersect(cone, default_scratch(), range, opts);
+    }
+
+    /**
+     * @brief Gathers the edges intersected by an elliptic cone, without gathering triangles.
+     *        Edges are written into ``scratch.edges`` (sorted and deduplicated), appending to existing edges if ``opts.accumulate_edges`` is set. Triangles in the scratch are left untouched, so an intersection record previously returned with the same scratch observes the gathered edges.
+     *
+     * @param range traversal bounds
+     */
+    virtual const intersection_record_t::edges_container_t& intersect_edges(
+            const elliptic_cone_t &cone,
+            intersection_scratch_t& scratch,
+            const pqrange_t<> range,
+            const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept = 0;
 
     /**
      * @brief Intersects the ADS with a ray. Returns TRUE if a hit was found.
@@ -101,7 +337,21 @@ public:
      */
     [[nodiscard]] virtual bool shadow(
             const ray_t &ray,
-            const pqrange_t<> range) const noexcept = 0;
+            const pqrange_t<> range,
+            const shadow_opts_t& opts = shadow_opts_t::defaults()) const noexcept = 0;
+
+    /**
+     * @brief Batched ray shadow queries: sets ``occluded[i]`` to TRUE if a hit was found for ``queries[i]``.
+     *        Implementations may reorder the queries for coherent traversal. The default implementation issues the queries one at a time.
+     */
+    virtual void shadow(
+            std::span<const shadow_query_t> queries,
+            std::span<bool> occluded,
+            const shadow_opts_t& opts = shadow_opts_t::defaults()) const noexcept {
+        assert(occluded.size()>=queries.size());
+        for (std::size_t i=0; i<queries.size(); ++i)
+            occluded[i] = shadow(queries[i].ray, queries[i].range, opts);
+    }
 
     /**
      * @brief Intersects the ADS with an elliptical cone. Returns TRUE if a hit was found.
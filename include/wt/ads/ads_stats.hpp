@@ -14,6 +14,7 @@
 
 #include <wt/math/intersect/ray.hpp>
 #include <wt/math/intersect/cone.hpp>
+#include <wt/math/intersect/ball.hpp>
 
 #include <wt/util/statistics_collector/stat_collector_registry.hpp>
 #include <wt/util/statistics_collector/stat_counter.hpp>
@@ -44,6 +45,11 @@ struct ads_stat_counters_t {
             "(ADS) casts cone",
             std::array<std::string,4>{ "1 hit", ">1 hit", "miss", "esc" }
         );
+    stat_counter_event_t<2>* ball_query_event_counter = 
+        stat_collector_registry_t::instance().make_collector<stat_counter_event_t<2>>(
+            "(ADS) ball queries",
+            std::array<std::string,2>{ "hit", "miss" }
+        );
 
     stat_timings_t* ray_cast_timings = additional_ads_counters ?
         stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings ray") :
@@ -52,6 +58,20 @@ struct ads_stat_counters_t {
         stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings cone") :
         nullptr;
 
+    stat_timings_t* cone_edges_timings = additional_ads_counters ?
+        stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings cone edges") :
+        nullptr;
+
+    stat_timings_t* ball_timings = additional_ads_counters ?
+        stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings ball") :
+        nullptr;
+    stat_timings_t* ball_any_hit_timings = additional_ads_counters ?
+        stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings ball any-hit") :
+        nullptr;
+    stat_timings_t* ball_nearest_edges_timings = additional_ads_counters ?
+        stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings ball nearest edges") :
+        nullptr;
+
     stat_timings_t* shadow_ray_cast_timings = additional_ads_counters ?
         stat_collector_registry_t::instance().make_collector<stat_timings_t>("(ADS) timings shadow ray") :
         nullptr;
@@ -61,11 +81,13 @@ struct ads_stat_counters_t {
 
     stat_histogram_t<256>* tris_returned_per_query = 
         stat_collector_registry_t::instance().make_collector<stat_histogram_t<256>>("(ADS) tris per cone", 1);
+    stat_histogram_t<256>* edges_returned_per_query = 
+        stat_collector_registry_t::instance().make_collector<stat_histogram_t<256>>("(ADS) edges per cone", 1);
 
-    stat_counter_event_t<6>* intersection_tests_counter = additional_ads_counters ?
-        stat_collector_registry_t::instance().make_collector<stat_counter_event_t<6>>(
+    stat_counter_event_t<7>* intersection_tests_counter = additional_ads_counters ?
+        stat_collector_registry_t::instance().make_collector<stat_counter_event_t<7>>(
             "(ADS) tests intersection",
-            std::array<std::string,6>{ "8×ray-tri", "8×ray-box", "cone-box", "cone-tri" }
+            std::array<std::string,7>{ "8×ray-tri", "8×ray-box", "cone-box", "cone-tri", "cone-edge", "8×ball-box", "8×ball-tri" }
         ) :
         nullptr;
     stat_counter_event_t<2>* shadow_tests_counter = additional_ads_counters ?
@@ -75,6 +97,13 @@ struct ads_stat_counters_t {
         ) :
         nullptr;
 
+    stat_counter_event_t<2>* occluder_cache_counter = additional_ads_counters ?
+        stat_collector_registry_t::instance().make_collector<stat_counter_event_t<2>>(
+            "(ADS) shadow occluder cache",
+            std::array<std::string,2>{ "hit", "miss" }
+        ) :
+        nullptr;
+
     stat_histogram_t<127>* ray_nodes_visited = additional_ads_counters ?
         stat_collector_registry_t::instance().make_collector<stat_histogram_t<127>>("(ADS) nodes visited (ray)", 1) :
         nullptr;
@@ -133,6 +162,32 @@ inline void on_shadow_cone_cast_event(bool hit, bool escaped,
     }
 }
 
+inline void on_cone_edges_event(std::size_t edges,
+                                std::chrono::high_resolution_clock::time_point start,
+                                int nodes_visited) noexcept {
+    ads_stats_counters.edges_returned_per_query->increment_count_of(edges);
+    if constexpr (additional_ads_counters) {
+        (*ads_stats_counters.cone_edges_timings).record(std::chrono::high_resolution_clock::now() - start);
+        ads_stats_counters.cone_nodes_visited->increment_count_of(nodes_visited);
+    }
+}
+
+/**
+ * @brief Records a ball query.
+ * @param any_hit an early-out (any hit) query
+ */
+inline void on_ball_query_event(bool hit, bool any_hit,
+                                std::chrono::high_resolution_clock::time_point start) noexcept {
+    ads_stats_counters.ball_query_event_counter->record(hit ? 0 : 1);
+    if constexpr (additional_ads_counters)
+        (*(any_hit ? ads_stats_counters.ball_any_hit_timings : ads_stats_counters.ball_timings))
+            .record(std::chrono::high_resolution_clock::now() - start);
+}
+inline void on_ball_nearest_edges_event(std::chrono::high_resolution_clock::time_point start) noexcept {
+    if constexpr (additional_ads_counters)
+        (*ads_stats_counters.ball_nearest_edges_timings).record(std::chrono::high_resolution_clock::now() - start);
+}
+
 inline void log_cone_query_termina(bool hit, bool escaped, std::size_t tris,
                                std::chrono::high_resolution_clock::time_point start,
                                int nodes_visited) noexcept {
@@ -145,11 +200,21 @@ inline void log_cone_query_termina(bool hit, bool escaped, std::size_t tris,
     }
 }
 
+inline void on_occluder_cache_event(bool hit) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.occluder_cache_counter->record(hit ? 0 : 1);
+}
+
 inline void on_ray_aabb_8w_test() noexcept {
     if constexpr (additional_ads_counters)
         ads_stats_counters.intersection_tests_counter->record(1);
 }
 
+inline void on_ray_aabb_16w_test() noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.intersection_tests_counter->record(1);
+}
+
 /**
  * @brief Wrapper around intersect_ray_tri that collects performance stats.
  */
@@ -160,6 +225,26 @@ inline auto intersect_ray_tri_8w(Ts&&... ts) noexcept {
     return intersect::intersect_ray_tri(std::forward<Ts>(ts)...);
 }
 
+/**
+ * @brief Wrapper around intersect_ray_tri_edges that collects performance stats.
+ */
+template <typename... Ts>
+inline auto intersect_ray_tri_edges_8w(Ts&&... ts) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.intersection_tests_counter->record(0);
+    return intersect::intersect_ray_tri_edges(std::forward<Ts>(ts)...);
+}
+
+/**
+ * @brief Wrapper around test_ray_tri that collects performance stats.
+ */
+template <typename... Ts>
+inline bool test_ray_tri(Ts&&... ts) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.shadow_tests_counter->record(0);
+    return intersect::test_ray_tri(std::forward<Ts>(ts)...);
+}
+
 /**
  * @brief Wrapper around test_ray_tri that collects performance stats.
  */
@@ -170,6 +255,16 @@ inline auto test_ray_tri_8w(Ts&&... ts) noexcept {
     return intersect::test_ray_tri(std::forward<Ts>(ts)...);
 }
 
+/**
+ * @brief Wrapper around test_ray_tri_edges that collects performance stats.
+ */
+template <typename... Ts>
+inline auto test_ray_tri_edges_8w(Ts&&... ts) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.shadow_tests_counter->record(0);
+    return intersect::test_ray_tri_edges(std::forward<Ts>(ts)...);
+}
+
 /**
  * @brief Wrapper around test_cone_aabb that collects performance stats.
  */
@@ -200,4 +295,34 @@ inline bool test_cone_tri(Ts&&... ts) noexcept {
     return intersect::test_cone_tri(std::forward<Ts>(ts)...);
 }
 
+/**
+ * @brief Wrapper around test_cone_edge that collects performance stats.
+ */
+template <typename... Ts>
+inline bool test_cone_edge(Ts&&... ts) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.intersection_tests_counter->record(4);
+    return intersect::test_cone_edge(std::forward<Ts>(ts)...);
+}
+
+/**
+ * @brief Wrapper around test_ball_aabb that collects performance stats.
+ */
+template <typename... Ts>
+inline auto test_ball_aabb_8w(Ts&&... ts) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.intersection_tests_counter->record(5);
+    return intersect::test_ball_aabb(std::forward<Ts>(ts)...);
+}
+
+/**
+ * @brief Wrapper around test_ball_tri that collects performance stats.
+ */
+template <typename... Ts>
+inline auto test_ball_tri_8w(Ts&&... ts) noexcept {
+    if constexpr (additional_ads_counters)
+        ads_stats_counters.intersection_tests_counter->record(6);
+    return intersect::test_ball_tri(std::forward<Ts>(ts)...);
+}
+
 }  // namespace wt::ads_stats
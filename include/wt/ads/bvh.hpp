@@ -38,13 +38,17 @@ public:
 private:
     std::vector<node_cluster_t> clusters;
     std::vector<tri_t> tree_tris;
+    // first copy of each triangle, when spatial splits duplicated triangle references (empty otherwise)
+    std::vector<idx_t> tri_canonical;
 
     f_t sah_cost;
 
 public:
-    bvh_t(std::vector<node_cluster_t> clusters, std::vector<tri_t> tris, f_t sah_cost)
+    bvh_t(std::vector<node_cluster_t> clusters, std::vector<tri_t> tris, f_t sah_cost,
+          std::vector<idx_t> tri_canonical = {})
         : clusters(std::move(clusters)),
           tree_tris(std::move(tris)),
+          tri_canonical(std::move(tri_canonical)),
           sah_cost(sah_cost) {}
 
     [[nodiscard]] constexpr inline auto root_node_id() const noexcept {
@@ -54,6 +58,7 @@ public:
     [[nodiscard]] inline const auto& node_clusters() const noexcept { return clusters; }
     [[nodiscard]] inline const auto& triangles() const noexcept { return tree_tris; }
     [[nodiscard]] inline auto& triangles() noexcept { return tree_tris; }
+    [[nodiscard]] inline const auto& canonical_triangles() const noexcept { return tri_canonical; }
 
     [[nodiscard]] inline const auto& node_at(idx_t i) const noexcept {
         return node_clusters()[i / 2].nodes[i % 2];
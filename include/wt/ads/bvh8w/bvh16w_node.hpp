@@ -0,0 +1,78 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include <wt/math/common.hpp>
+#include <wt/math/shapes/ray.hpp>
+#include <wt/math/shapes/elliptic_cone.hpp>
+#include <wt/ads/common.hpp>
+#include <wt/ads/bvh8w/node16_kernels.hpp>
+
+namespace wt::ads::bvh8w {
+
+static_assert(std::is_same_v<node16_real_t, f_t>);
+
+/**
+ * @brief Per-ray data for ray-node16 tests (see ``node16_kernels_t::intersect_ray``).
+ */
+[[nodiscard]] inline ray_node16_data_t ray_node16_data(const ray_t& ray) noexcept {
+    ray_node16_data_t ret;
+    for (auto a=0; a<3; ++a) {
+        ret.o[a] = (f_t)u::to_m(ray.o[a]);
+        ret.invd[a] = ray.invd[a];
+        ret.negative_d[a] = ray.invd[a]<0;
+    }
+    return ret;
+}
+
+/**
+ * @brief Per-cone data for cone-node16 tests (see ``node16_kernels_t::intersect_cone``).
+ */
+[[nodiscard]] inline cone_node16_data_t cone_node16_data(const elliptic_cone_t& cone) noexcept {
+    cone_node16_data_t ret;
+    ret.tan_alpha = cone.get_tan_alpha();
+    ret.x0 = (f_t)u::to_m(cone.x0());
+
+    const auto cd = vec3_t{ cone.d() };
+    for (auto a=0; a<3; ++a) {
+        ret.o[a] = (f_t)u::to_m(cone.o()[a]);
+        ret.d[a] = cd[a];
+        ret.invd[a] = cone.ray().invd[a];
+        ret.negative_d[a] = ret.invd[a]<0;
+    }
+    return ret;
+}
+
+/**
+ * @brief Ray vs. 16 AABBs (slab test, ignores NaNs), using the node kernels ``kernels``. Returns entry distances (in metres) and the mask of intersected children.
+ */
+[[nodiscard]] inline node16_intersect_t intersect_ray_node16(
+        const node16_kernels_t& kernels,
+        const node16_t& n,
+        const ray_node16_data_t& ray,
+        const pqrange_t<>& range) noexcept {
+    return kernels.intersect_ray(n, ray, (f_t)u::to_m(range.min), (f_t)u::to_m(range.max));
+}
+
+/**
+ * @brief Conservative cone vs. 16 AABBs test, using the node kernels ``kernels``. Returns entry distances (in metres) and the mask of intersected children.
+ */
+[[nodiscard]] inline node16_intersect_t intersect_cone_node16(
+        const node16_kernels_t& kernels,
+        const node16_t& n,
+        const cone_node16_data_t& cone,
+        const pqrange_t<>& range) noexcept {
+    return kernels.intersect_cone(n, cone, (f_t)u::to_m(range.min), (f_t)u::to_m(range.max));
+}
+
+}
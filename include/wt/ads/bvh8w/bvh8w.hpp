@@ -16,61 +16,133 @@
 
 #include <wt/ads/ads.hpp>
 #include "bvh8w_node.hpp"
+#include "bvh16w_node.hpp"
+#include "mixed_precision.hpp"
 
 namespace wt::ads {
 
 namespace construction {
 class bvh8w_constructor_t;
+class bvh8w_cache_t;
+class bvh8w_refit_t;
 }
 
 class bvh8w_t final : public ads_t {
     friend class construction::bvh8w_constructor_t;
+    friend class construction::bvh8w_cache_t;
+    friend class construction::bvh8w_refit_t;
 
 public:
     using node_t = bvh8w::node_t;
     using leaf_node_t = bvh8w::leaf_node_t;
 
-    struct tris_vectorized_data_t {
-        std::vector<length_t> ax, ay, az;
-        std::vector<length_t> bx, by, bz;
-        std::vector<length_t> cx, cy, cz;
-        std::vector<f_t> nx, ny, nz;
+    /**
+     * @brief 8-wide BVH over the diffracting edges (see ``edge_classification``), used to gather edges directly for free-space diffraction.
+     *        Nodes' ``tris_start``/``tris_count`` and leaves' ``tris_ptr``/``count`` index into ``edge_ids``.
+     */
+    struct edge_tree_t {
+        std::vector<node_t> nodes;
+        std::vector<leaf_node_t> leaf_nodes;
+        /** @brief Edge ids, in tree order. */
+        std::vector<std::uint32_t> edge_ids;
+
+        [[nodiscard]] inline bool empty() const noexcept { return edge_ids.empty(); }
+    };
+
+    /**
+     * @brief Level-of-detail data of a node (see ``wt_context_t::ads_lod_footprint_fraction``).
+     */
+    struct lod_node_t {
+        /** @brief First of the node's two proxy triangles (indexes ``proxy_tris``), or ``invalid_idx`` if the node has no proxy. */
+        idx_t proxy = invalid_idx;
+        /** @brief Diagonal length of the node's bounds. */
+        length_t extent;
     };
 
 private:
-    const std::vector<node_t> nodes;
+    // nodes bounds and world bounds are updated in place by refits (see ``bvh8w_refit_t``)
+    std::vector<node_t> nodes;
     const std::vector<leaf_node_t> leaf_nodes;
-    const tris_vectorized_data_t vectorized_data;
 
-    const aabb_t world;
+    // built without edges, for ray tracing only
+    bool ray_only;
+
+#ifdef _MIXED_PRECISION_ADS
+    // single-precision copies of the nodes, for ray traversal
+    std::vector<bvh8w::node_f32_t> nodes_f32;
+#endif
+
+    // built after edge classification
+    edge_tree_t edge_tree;
+
+    aabb_t world;
+
+    // level of detail: per node, empty when disabled
+    std::vector<lod_node_t> lod_nodes;
+    f_t lod_footprint_fraction = 0;
+
+    // 16-wide nodes collapsed from the tree, for ray and beam traversal: empty when disabled
+    std::vector<bvh8w::node16_t> nodes16;
+    // kernels for the 16-wide nodes, selected for the CPU's instruction-set level when the ADS is created
+    const bvh8w::node16_kernels_t* kernels16 = &bvh8w::node16_kernels();
 
     // some stats
     const f_t sah_cost, occupancy;
     const std::size_t max_depth;
 
+    // regenerates the single-precision copies of the nodes after node bounds changed
+    inline void update_mixed_precision_nodes() noexcept {
+#ifdef _MIXED_PRECISION_ADS
+        nodes_f32.resize(nodes.size());
+        for (std::size_t i=0; i<nodes.size(); ++i)
+            nodes_f32[i] = bvh8w::to_node_f32(nodes[i]);
+#endif
+    }
+
 public:
     bvh8w_t(std::vector<node_t> nodes,
             std::vector<leaf_node_t> leaf_nodes,
-            tris_vectorized_data_t vectorized_data,
             std::vector<tri_t> tris,
+            std::vector<const mesh::mesh_t*> meshes,
+            bool ray_only,
             const aabb_t& world,
             f_t sah_cost,
             f_t occupancy,
-            std::size_t max_depth) noexcept
-        : ads_t(std::move(tris)),
+            std::size_t max_depth,
+            std::vector<idx_t> tri_canonical = {}) noexcept
+        : ads_t(std::move(tris), std::move(meshes), std::move(tri_canonical)),
           nodes(std::move(nodes)),
           leaf_nodes(std::move(leaf_nodes)),
-          vectorized_data(std::move(vectorized_data)),
+          ray_only(ray_only),
           world(world),
           sah_cost(sah_cost),
           occupancy(occupancy),
           max_depth(max_depth)
-    {}
+    {
+        update_mixed_precision_nodes();
+    }
 
     [[nodiscard]] std::size_t nodes_count() const noexcept override { return nodes.size(); }
 
-    [[nodiscard]] inline const auto& vectorized_tri_data() const noexcept {
-        return vectorized_data;
+    [[nodiscard]] std::size_t memory_bytes() const noexcept override {
+        return ads_t::memory_bytes() +
+               nodes.capacity()*sizeof(node_t) + leaf_nodes.capacity()*sizeof(leaf_node_t) +
+               edge_tree.nodes.capacity()*sizeof(node_t) + edge_tree.leaf_nodes.capacity()*sizeof(leaf_node_t) +
+               edge_tree.edge_ids.capacity()*sizeof(std::uint32_t) +
+               lod_nodes.capacity()*sizeof(lod_node_t) +
+               nodes16.capacity()*sizeof(bvh8w::node16_t)
+#ifdef _MIXED_PRECISION_ADS
+               + nodes_f32.capacity()*sizeof(bvh8w::node_f32_t)
+#endif
+               ;
+    }
+
+    /**
+     * @brief A ray-only ADS was built for rendering that only traces rays (see ``wt_context_t::renderer_force_ray_tracing``): it carries no edges.
+     *        Ball and beam queries remain supported, but never return edges.
+     */
+    [[nodiscard]] inline bool is_ray_only() const noexcept {
+        return ray_only;
     }
 
     [[nodiscard]] inline const std::int32_t root_ptr() const noexcept {
@@ -79,21 +151,78 @@ public:
     [[nodiscard]] inline const node_t& node(idx_t nidx) const noexcept {
         return nodes[nidx];
     }
+#ifdef _MIXED_PRECISION_ADS
+    [[nodiscard]] inline const bvh8w::node_f32_t& node_f32(idx_t nidx) const noexcept {
+        return nodes_f32[nidx];
+    }
+#endif
     [[nodiscard]] inline const leaf_node_t& leaf_node(idx_t nidx) const noexcept {
         return leaf_nodes[nidx];
     }
 
+    [[nodiscard]] inline const auto& edges_tree() const noexcept {
+        return edge_tree;
+    }
+
+    /**
+     * @brief (Re)builds the level-of-detail proxies of the nodes from the current triangles. Nodes whose triangles belong to a single shape and are nearly coplanar get a proxy: a rectangle (two triangles) spanning the triangles' projection on their area-weighted mean plane.
+     *        Beam traversal returns a node's proxy instead of descending once the node's extent is below ``footprint_fraction`` of the beam footprint or wavelength. Level of detail is disabled when ``footprint_fraction`` is 0.
+     */
+    void build_lod(f_t footprint_fraction);
+
+    [[nodiscard]] inline bool has_lod() const noexcept { return !lod_nodes.empty(); }
+    [[nodiscard]] inline f_t lod_fraction() const noexcept { return lod_footprint_fraction; }
+    [[nodiscard]] inline const lod_node_t& lod_node(idx_t nidx) const noexcept {
+        return lod_nodes[nidx];
+    }
+
+    /**
+     * @brief (Re)builds the 16-wide nodes from the current tree, by collapsing each node with its largest internal children until it holds (up to) 16 children. Ray and beam traversal then use the 16-wide nodes (see ``wt_context_t::ads_node_width``); triangles are still tested in the 8-wide clusters of the tree.
+     *        Frees the 16-wide nodes when ``width`` is 8.
+     */
+    void build_wide_nodes(std::size_t width);
+
+    [[nodiscard]] inline bool has_wide_nodes() const noexcept { return !nodes16.empty(); }
+    [[nodiscard]] inline std::size_t node_width() const noexcept {
+        return has_wide_nodes() ? bvh8w::aabbs_per_node16 : bvh8w::aabbs_per_node;
+    }
+    [[nodiscard]] inline const bvh8w::node16_t& node16(idx_t nidx) const noexcept {
+        return nodes16[nidx];
+    }
+    /**
+     * @brief Kernels used to test the 16-wide nodes: compiled for the highest instruction-set level that the CPU supports (see ``bvh8w::node16_kernels()``).
+     */
+    [[nodiscard]] inline const bvh8w::node16_kernels_t& node16_kernels() const noexcept {
+        return *kernels16;
+    }
+
     [[nodiscard]] const aabb_t& V() const noexcept override {
         return world;
     }
 
+    using ads_t::intersect;
+
     /**
      * @brief Intersects the ADS with ball, returning the intersection record and contained primitives.
      */
     [[nodiscard]] intersection_record_t intersect(
         const ball_t &ball,
+        intersection_scratch_t& scratch,
         const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept override;
 
+    /**
+     * @brief Tests the ADS against a ball. Returns TRUE once any triangle that intersects the ball is found.
+     */
+    [[nodiscard]] bool test(const ball_t &ball) const noexcept override;
+
+    /**
+     * @brief Finds the (up to) ``k`` edges that are nearest to the ball's centre, out of the edges that intersect the ball, by traversing the edge tree. Edges are ordered by distance.
+     */
+    [[nodiscard]] std::span<const nearest_edge_t> nearest_edges(
+        const ball_t &ball,
+        std::size_t k,
+        intersection_scratch_t& scratch) const noexcept override;
+
     /**
      * @brief Intersects the ADS with a ray, returning the intersection record
      * with the intersected  primitive.
@@ -105,6 +234,39 @@ public:
         const ray_t &ray,
         const pqrange_t<> range = { 0 * u::m, limits<length_t>::infinity() }) const noexcept override;
 
+    /**
+     * @brief Batched ray queries: sets ``records[i]`` to the intersection record of ``queries[i]``.
+     *        Queries are issued grouped by direction octant and ordered along a Morton curve over their origins (as batched shadow queries are), so that consecutive traversals visit the same nodes and triangles.
+     */
+    void intersect(
+        std::span<const ray_query_t> queries,
+        std::span<intersection_record_t> records) const noexcept override;
+
+#ifdef _MIXED_PRECISION_ADS
+    /**
+     * @brief Intersects the ADS with a ray, traversing the full-precision (double) nodes of the 8-wide tree instead of their single-precision copies.
+     *        Serves as the reference for validating mixed-precision ray traversal.
+     *
+     * @param range traversal bounds
+     */
+    [[nodiscard]] intersection_record_t intersect_full_precision(
+        const ray_t &ray,
+        const pqrange_t<> range = { 0 * u::m, limits<length_t>::infinity() }) const noexcept;
+#endif
+
+    /**
+     * @brief Intersects the ADS with a ray, resuming the traversal suspended in ``state``.
+     * Nodes that the ray enters past the range, and leaves that extend past it,
+     * are suspended into the state instead of being culled.
+     *
+     * @param range traversal bounds
+     * @param state suspended traversal, updated by the query
+     */
+    [[nodiscard]] intersection_record_t intersect(
+        const ray_t &ray,
+        const pqrange_t<> range,
+        ray_traversal_state_t& state) const noexcept override;
+
     /**
      * @brief Intersects the ADS with a cone, returning the intersection record
      * and contained primitives. Once the closest intersection is found, looks
@@ -116,9 +278,21 @@ public:
      */
     [[nodiscard]] intersection_record_t intersect(
         const elliptic_cone_t &cone,
+        intersection_scratch_t& scratch,
         const pqrange_t<> range = { 0 * u::m, limits<length_t>::infinity() },
         const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept override;
 
+    /**
+     * @brief Gathers the edges intersected by a cone, by traversing the edge tree.
+     *
+     * @param range traversal bounds
+     */
+    const intersection_record_t::edges_container_t& intersect_edges(
+        const elliptic_cone_t &cone,
+        intersection_scratch_t& scratch,
+        const pqrange_t<> range,
+        const intersect_opts_t& opts = intersect_opts_t::defaults()) const noexcept override;
+
     /**
      * @brief Intersects the ADS with a ray. Returns TRUE if a hit was found.
      *
@@ -126,7 +300,17 @@ public:
      * @param range traversal bounds
      */
     [[nodiscard]] bool shadow(
-        const ray_t &ray, const pqrange_t<> range) const noexcept override;
+        const ray_t &ray, const pqrange_t<> range,
+        const shadow_opts_t& opts = shadow_opts_t::defaults()) const noexcept override;
+
+    /**
+     * @brief Batched ray shadow queries: sets ``occluded[i]`` to TRUE if a hit was found for ``queries[i]``.
+     *        Queries that the occluder cache does not resolve are grouped by direction octant and ordered along a Morton curve over their origins, and consecutive queries are traversed as packets of up to 8 rays: each 8-wide node is fetched once for all rays of the packet that entered it. Packets always traverse the 8-wide nodes.
+     */
+    void shadow(
+        std::span<const shadow_query_t> queries,
+        std::span<bool> occluded,
+        const shadow_opts_t& opts = shadow_opts_t::defaults()) const noexcept override;
 
     /**
      * @brief Intersects the ADS with a cone. Returns TRUE if a hit was found.
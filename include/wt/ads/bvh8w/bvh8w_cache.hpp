@@ -0,0 +1,60 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+#include <wt/scene/shape.hpp>
+#include <wt/wt_context.hpp>
+
+#include "bvh8w.hpp"
+
+namespace wt::ads::construction {
+
+/**
+ * @brief On-disk cache of built 8-wide BVHs: nodes, triangles (with their triangle→shape maps and, for spatial-split builds, the map of triangle copies), classified edges and the edge tree.
+ *        A cache file is keyed by a hash of the scene triangle geometry and of the build parameters, and is validated by a checksum on load.
+ *        The file is a flat, versioned binary image with 64-byte aligned sections: loading does no parsing, only bulk copies out of a memory-mapped file.
+ */
+class bvh8w_cache_t {
+public:
+    static constexpr std::uint32_t format_version = 5;
+
+    /**
+     * @brief Computes the cache key for a list of shapes.
+     */
+    [[nodiscard]] static std::uint64_t cache_key(const std::vector<std::shared_ptr<shape_t>>& objs,
+                                                 const wt::wt_context_t& ctx);
+
+    /**
+     * @brief Path of the cache file for a key.
+     */
+    [[nodiscard]] static std::filesystem::path cache_file(const std::filesystem::path& cache_dir,
+                                                          std::uint64_t key);
+
+    /**
+     * @brief Loads a cached BVH. Returns `nullptr` when no valid cache file exists.
+     * @param meshes meshes of the shapes the BVH was built from (see ``cache_key()``), which the triangles read their vertices from
+     */
+    [[nodiscard]] static std::unique_ptr<bvh8w_t> load(const std::filesystem::path& cache_dir,
+                                                       std::uint64_t key,
+                                                       const std::vector<const mesh::mesh_t*>& meshes) noexcept;
+
+    /**
+     * @brief Writes a BVH to the cache. Failures are logged and otherwise ignored.
+     */
+    static void store(const std::filesystem::path& cache_dir,
+                      std::uint64_t key,
+                      const bvh8w_t& bvh) noexcept;
+};
+
+}
@@ -37,6 +37,11 @@ public:
         return std::move(bvh8w);
     }
 
+    /**
+     * @brief Builds an 8-wide BVH over the edges.
+     */
+    static bvh8w_t::edge_tree_t build_edge_tree(const std::vector<edge_t>& edges, const wt::wt_context_t& ctx);
+
 private:
     std::unique_ptr<bvh8w_t> bvh8w;
     progress_track_t pt;
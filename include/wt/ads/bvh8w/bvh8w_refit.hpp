@@ -0,0 +1,86 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <span>
+#include <chrono>
+
+#include <wt/scene/shape.hpp>
+#include <wt/wt_context.hpp>
+
+#include "bvh8w.hpp"
+
+namespace wt::ads::construction {
+
+/**
+ * @brief Keeps an 8-wide BVH up to date with moving geometry.
+ *        After the meshes of some shapes were (rigidly) transformed, the bounds of the subtrees that hold the triangles of these shapes are refitted in place, bottom-up, from the meshes' vertices. Tree topology is unchanged.
+ *        Refitting degrades tree quality as geometry moves away from where the tree was built: once the SAH cost of the refitted tree exceeds the cost of the tree when it was built by more than a threshold, the tree is rebuilt instead.
+ *        Edges of the changed shapes are re-classified against the moved triangles. Adjacency across shapes that was broken by the motion is split into a boundary edge for each triangle, and boundary edges of moved triangles that now coincide with a boundary edge of another triangle are joined into a shared edge. The edge tree is refitted, or rebuilt when edges were split or joined.
+ */
+class bvh8w_refit_t {
+public:
+    struct opts_t {
+        /** @brief Rebuild once the refitted SAH cost exceeds the built SAH cost by this factor. */
+        f_t rebuild_sah_ratio = 1.5;
+    };
+
+    struct result_t {
+        bool rebuilt = false;
+
+        std::size_t triangles_updated = 0;
+        std::size_t nodes_refitted = 0;
+        std::size_t edges_updated = 0;
+        std::size_t edges_detached = 0;
+        std::size_t edges_joined = 0;
+
+        /** @brief SAH cost of the refitted tree relative to the tree when it was built. */
+        f_t sah_ratio = 1;
+
+        std::chrono::high_resolution_clock::duration elapsed{};
+    };
+
+private:
+    const wt::wt_context_t& ctx;
+    opts_t opts;
+
+    // SAH cost of the tree when it was (last) built
+    const bvh8w_t* built_tree = nullptr;
+    f_t built_sah_cost = 0;
+
+    static result_t refit(bvh8w_t& bvh,
+                          const std::vector<std::shared_ptr<shape_t>>& shapes,
+                          std::span<const std::uint32_t> changed_shapes,
+                          const wt::wt_context_t& ctx);
+
+public:
+    bvh8w_refit_t(const wt::wt_context_t& ctx, opts_t opts = {}) noexcept
+        : ctx(ctx), opts(opts)
+    {}
+
+    /**
+     * @brief Updates an 8-wide BVH after the meshes of shapes ``changed_shapes`` have changed. Refits in place, or rebuilds (replacing ``ads``) when tree quality has degraded.
+     *        Must not run concurrently with queries on ``ads``.
+     * @param shapes the shapes the tree was built from, in the same order
+     * @param changed_shapes indices (into ``shapes``) of the shapes whose meshes changed; meshes must keep their triangle count and order
+     */
+    result_t update(std::unique_ptr<ads_t>& ads,
+                    const std::vector<std::shared_ptr<shape_t>>& shapes,
+                    std::span<const std::uint32_t> changed_shapes);
+
+    /**
+     * @brief SAH cost of an 8-wide BVH, normalized by the surface area of the root.
+     */
+    [[nodiscard]] static f_t sah_cost(const bvh8w_t& bvh) noexcept;
+};
+
+}
@@ -0,0 +1,178 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#pragma once
+
+#ifdef _MIXED_PRECISION_ADS
+
+#include <cstdint>
+#include <bitset>
+#include <cmath>
+
+#include <wt/math/common.hpp>
+#include <wt/math/simd/wide_vector.hpp>
+#include <wt/math/shapes/aabb.hpp>
+#include <wt/ads/common.hpp>
+
+#include "bvh8w_node.hpp"
+
+namespace wt::ads::bvh8w {
+
+#ifdef SIMD_AVX
+using f32_w8_native_t = simd::simd_avx_t<float,8>;
+#else
+using f32_w8_native_t = simd::simd_emulated_t<float,8>;
+#endif
+
+/**
+ * @brief Single-precision copy of a node, used for mixed-precision ray traversal of double-precision builds.
+ *        Children bounds are stored relative to a double-precision node origin, and are rounded outwards: the f32 boxes always contain the f64 boxes.
+ *        Child pointers and triangle ranges are identical to the ``node_t`` with the same index.
+ */
+struct alignas(32) node_f32_t {
+    // relative to origin, in metres
+    float min[3][aabbs_per_node];
+    float max[3][aabbs_per_node];
+
+    std::int32_t child_ptrs[aabbs_per_node];
+    std::uint32_t tris_start, tris_count;
+
+    pqvec3_t origin;
+    /** @brief Largest magnitude of any relative bound, in metres. */
+    float extent;
+};
+
+/**
+ * @brief Rounds a node's bounds to single precision, relative to the centre of the node.
+ */
+[[nodiscard]] inline node_f32_t to_node_f32(const node_t& n) noexcept {
+    node_f32_t ret;
+    ret.tris_start = n.tris_start;
+    ret.tris_count = n.tris_count;
+
+    auto bounds = aabb_t::null();
+    for (auto c=0ul; c<aabbs_per_node; ++c) {
+        ret.child_ptrs[c] = n.child_ptrs[c];
+        if (n.child_ptrs[c]!=0)
+            bounds |= aabb_t{ n.min.read(c), n.max.read(c) };
+    }
+    ret.origin = bounds.empty() ? pqvec3_t{ 0*u::m,0*u::m,0*u::m } : bounds.centre();
+
+    constexpr auto inf = std::numeric_limits<float>::infinity();
+    float extent = 0;
+    for (auto c=0ul; c<aabbs_per_node; ++c) {
+        for (auto a=0; a<3; ++a) {
+            if (n.child_ptrs[c]==0) {
+                // empty: never intersected
+                ret.min[a][c] = +inf;
+                ret.max[a][c] = -inf;
+                continue;
+            }
+
+            const auto dmin = (double)u::to_m(n.min.read(c)[a] - ret.origin[a]);
+            const auto dmax = (double)u::to_m(n.max.read(c)[a] - ret.origin[a]);
+            auto fmin = (float)dmin;
+            auto fmax = (float)dmax;
+            if ((double)fmin>dmin) fmin = std::nextafter(fmin, -inf);
+            if ((double)fmax<dmax) fmax = std::nextafter(fmax, +inf);
+
+            ret.min[a][c] = fmin;
+            ret.max[a][c] = fmax;
+            extent = m::max(extent, m::max(m::abs(fmin), m::abs(fmax)));
+        }
+    }
+    ret.extent = extent;
+
+    return ret;
+}
+
+/**
+ * @brief Per-ray data for mixed-precision ray-node tests.
+ */
+struct ray_f32_data_t {
+    pqvec3_t o;
+    f32_w8_native_t invd[3];
+    bool negative_d[3];
+
+    explicit ray_f32_data_t(const pqvec3_t& o, const vec3_t& invd) noexcept
+        : o(o)
+    {
+        for (auto a=0; a<3; ++a) {
+            simd::set1(this->invd[a], (float)invd[a]);
+            negative_d[a] = invd[a]<0;
+        }
+    }
+};
+
+struct ray_node_f32_intersect_t {
+    float tmins[aabbs_per_node];
+    float tmaxs[aabbs_per_node];
+    std::bitset<aabbs_per_node> mask;
+};
+
+/**
+ * @brief Conservative single-precision ray vs. 8 AABBs test: never reports a miss for a child box that the ray intersects within ``range`` (in exact arithmetic), and never reports entry (exit) distances larger (smaller) than the exact ones.
+ *        The ray origin is moved into the node's frame in double precision. All rounding errors (of the relative origin, the reciprocal direction and the slab arithmetic) are absorbed by padding the boxes by a few ulps of the magnitudes involved and widening the resulting ranges.
+ */
+[[nodiscard]] inline ray_node_f32_intersect_t intersect_ray_node_f32(
+        const node_f32_t& n,
+        const ray_f32_data_t& ray,
+        const pqrange_t<>& range) noexcept {
+    // relative error budget: a few single-precision ulps
+    constexpr double eps = 1.0 / double(1<<20);
+    constexpr auto inf = std::numeric_limits<float>::infinity();
+
+    f32_w8_native_t t1s[3], t2s[3];
+    for (auto a=0; a<3; ++a) {
+        const auto orel = (double)u::to_m(ray.o[a] - n.origin[a]);
+        const auto pad  = (float)(eps * (m::abs(orel) + (double)n.extent)) + std::numeric_limits<float>::denorm_min();
+
+        f32_w8_native_t lo, hi, o, p;
+        simd::load(lo, ray.negative_d[a] ? n.max[a] : n.min[a]);
+        simd::load(hi, ray.negative_d[a] ? n.min[a] : n.max[a]);
+        simd::set1(o, (float)orel);
+        simd::set1(p, ray.negative_d[a] ? -pad : pad);
+
+        // near plane moved towards the ray, far plane away from it
+        t1s[a] = simd::mul(simd::sub(simd::sub(lo, p), o), ray.invd[a]);
+        t2s[a] = simd::mul(simd::sub(simd::add(hi, p), o), ray.invd[a]);
+    }
+
+    // widen by the relative error of the products, and round the range outwards
+    auto rmin_clamp = (float)u::to_m(range.min);
+    auto rmax_clamp = (float)u::to_m(range.max);
+    if ((double)rmin_clamp>(double)u::to_m(range.min))
+        rmin_clamp = std::nextafter(rmin_clamp, -inf);
+    if ((double)rmax_clamp<(double)u::to_m(range.max))
+        rmax_clamp = std::nextafter(rmax_clamp, +inf);
+
+    f32_w8_native_t rmin, rmax, lscale, uscale, cmin, cmax;
+    simd::set1(lscale, float(1-eps));
+    simd::set1(uscale, float(1+eps));
+    simd::set1(cmin, rmin_clamp);
+    simd::set1(cmax, rmax_clamp);
+    rmin = simd::max(simd::max(t1s[0], t1s[1]), t1s[2]);
+    rmax = simd::min(simd::min(t2s[0], t2s[1]), t2s[2]);
+    rmin = simd::max(simd::mul(rmin, lscale), cmin);
+    rmax = simd::min(simd::mul(rmax, uscale), cmax);
+
+    const auto mask = simd::le(rmin, rmax);
+
+    ray_node_f32_intersect_t ret;
+    for (auto c=0ul; c<aabbs_per_node; ++c) {
+        ret.tmins[c] = rmin.extract(c);
+        ret.tmaxs[c] = rmax.extract(c);
+        ret.mask.set(c, m::signbit(mask.extract(c)));
+    }
+    return ret;
+}
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 16-wide node layout and the per-ISA node kernels.
+// This header is self-contained (it must not include other wave tracer headers): it is included by the per-ISA kernel translation units, which are compiled for different instruction-set levels than the rest of the binary, and must not instantiate inline or template functions that other translation units also instantiate (the linker keeps a single copy of those).
+
+namespace wt::ads::bvh8w {
+
+/**
+ * @brief Floating-point type of the node kernels: ``wt::f_t``.
+ */
+using node16_real_t = _FLOAT_TYPE;
+
+static constexpr std::size_t aabbs_per_node16 = 16;
+
+/**
+ * @brief 16-wide node, collapsed from the 8-wide tree for traversal on targets with 16-wide (AVX-512) single-precision SIMD.
+ *        Children bounds are stored in metres, SoA. Child pointers use the same encoding as ``node_t``, where positive pointers index the 16-wide nodes, and negative pointers index the leaves of the 8-wide tree.
+ *        ``tris_start``/``tris_count`` are those of the 8-wide node ``node8`` that the node was collapsed from.
+ */
+struct alignas(64) node16_t {
+    node16_real_t min[3][aabbs_per_node16];
+    node16_real_t max[3][aabbs_per_node16];
+
+    std::int32_t child_ptrs[aabbs_per_node16];
+    std::uint32_t tris_start, tris_count;
+    std::uint32_t node8;
+};
+
+struct node16_intersect_t {
+    alignas(64) node16_real_t tmins[aabbs_per_node16];
+    std::uint32_t mask;
+};
+
+/**
+ * @brief Per-ray data for ray-node16 tests, in metres (see ``ray_node16_data()``).
+ */
+struct ray_node16_data_t {
+    node16_real_t o[3], invd[3];
+    bool negative_d[3];
+};
+
+/**
+ * @brief Per-cone data for cone-node16 tests, in metres (see ``cone_node16_data()``).
+ */
+struct cone_node16_data_t {
+    node16_real_t o[3], d[3], invd[3];
+    bool negative_d[3];
+    node16_real_t tan_alpha, x0;
+};
+
+/**
+ * @brief Node kernels compiled for an instruction-set level. Tables are constant initialized.
+ *        Ranges (``rmin``, ``rmax``) are in metres.
+ */
+struct node16_kernels_t {
+    /**
+     * @brief Ray vs. 16 AABBs (slab test, ignores NaNs). Returns entry distances (in metres) and the mask of intersected children.
+     */
+    node16_intersect_t (*intersect_ray)(const node16_t& n,
+                                        const ray_node16_data_t& ray,
+                                        node16_real_t rmin, node16_real_t rmax) noexcept;
+    /**
+     * @brief Conservative cone vs. 16 AABBs test: each box is enlarged by the cone's cross section at the farthest point of the box along the cone axis, and tested against the cone's axis. Returns entry distances (in metres) and the mask of intersected children.
+     */
+    node16_intersect_t (*intersect_cone)(const node16_t& n,
+                                         const cone_node16_data_t& cone,
+                                         node16_real_t rmin, node16_real_t rmax) noexcept;
+
+    /** @brief Instruction-set level the kernels were compiled for. */
+    const char* isa;
+};
+
+/**
+ * @brief Kernels compiled for the binary's target ISA (``TARGET_ARCH``).
+ */
+extern const node16_kernels_t node16_kernels_target;
+/**
+ * @brief Kernels compiled for x86-64-v3 (AVX2), or nullptr if not compiled in.
+ *        Per-ISA tables are exported as (constant-initialized) data: no code compiled for their ISA runs before they are selected.
+ */
+extern const node16_kernels_t* const node16_kernels_x86_64_v3;
+/**
+ * @brief Kernels compiled for x86-64-v4 (AVX-512), or nullptr if not compiled in.
+ */
+extern const node16_kernels_t* const node16_kernels_x86_64_v4;
+
+/**
+ * @brief The node kernels used for traversal: the kernels of the highest instruction-set level that the CPU supports, out of the target ISA's and the per-ISA kernels that are compiled in.
+ *        Selected once, from ``cpu_features_t::detect()``, on first use.
+ */
+const node16_kernels_t& node16_kernels() noexcept;
+
+}
@@ -0,0 +1,127 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#pragma once
+
+// Implementation of the 16-wide node kernels (see ``node16_kernels_t``), included only by the per-ISA kernel translation units (src/ads/bvh8w_node16_kernels*.cpp).
+// All functions have internal linkage, and use built-in operators and compiler intrinsics only: each translation unit compiles its own copy for its instruction-set level.
+
+#include <limits>
+
+#include <wt/ads/bvh8w/node16_kernels.hpp>
+
+#if defined(__AVX512F__) && !defined(_DBL_SUPPORT)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace wt::ads::bvh8w;
+using real_t = node16_real_t;
+
+// (constant evaluated: no out-of-line copy is instantiated)
+constexpr auto inf = std::numeric_limits<real_t>::infinity();
+
+// (same NaN handling as glm::min/glm::max: the NaN second operand is ignored)
+[[nodiscard]] inline real_t kmin(real_t a, real_t b) noexcept { return b<a ? b : a; }
+[[nodiscard]] inline real_t kmax(real_t a, real_t b) noexcept { return a<b ? b : a; }
+
+node16_intersect_t intersect_ray_node16(
+        const node16_t& n,
+        const ray_node16_data_t& ray,
+        const real_t rmin, const real_t rmax) noexcept {
+    node16_intersect_t ret;
+
+#if defined(__AVX512F__) && !defined(_DBL_SUPPORT)
+    auto tmin = _mm512_set1_ps(rmin);
+    auto tmax = _mm512_set1_ps(rmax);
+    for (auto a=0; a<3; ++a) {
+        const auto lo = _mm512_load_ps(ray.negative_d[a] ? n.max[a] : n.min[a]);
+        const auto hi = _mm512_load_ps(ray.negative_d[a] ? n.min[a] : n.max[a]);
+        const auto o  = _mm512_set1_ps(ray.o[a]);
+        const auto id = _mm512_set1_ps(ray.invd[a]);
+        tmin = _mm512_max_ps(tmin, _mm512_mul_ps(_mm512_sub_ps(lo, o), id));
+        tmax = _mm512_min_ps(tmax, _mm512_mul_ps(_mm512_sub_ps(hi, o), id));
+    }
+    ret.mask = _mm512_cmp_ps_mask(tmin, tmax, _CMP_LE_OQ);
+    _mm512_store_ps(ret.tmins, tmin);
+#else
+    real_t tmaxs[aabbs_per_node16];
+    for (auto c=0ul; c<aabbs_per_node16; ++c) {
+        ret.tmins[c] = rmin;
+        tmaxs[c] = rmax;
+    }
+    for (auto a=0; a<3; ++a) {
+        const auto* lo = ray.negative_d[a] ? n.max[a] : n.min[a];
+        const auto* hi = ray.negative_d[a] ? n.min[a] : n.max[a];
+        for (auto c=0ul; c<aabbs_per_node16; ++c) {
+            ret.tmins[c] = kmax(ret.tmins[c], (lo[c]-ray.o[a]) * ray.invd[a]);
+            tmaxs[c] = kmin(tmaxs[c], (hi[c]-ray.o[a]) * ray.invd[a]);
+        }
+    }
+    ret.mask = 0;
+    for (auto c=0ul; c<aabbs_per_node16; ++c)
+        ret.mask |= std::uint32_t(ret.tmins[c]<=tmaxs[c]) << c;
+#endif
+
+    return ret;
+}
+
+// same test as the 8-wide cone traversal, written as a loop over lanes for the compiler to vectorize
+node16_intersect_t intersect_cone_node16(
+        const node16_t& n,
+        const cone_node16_data_t& cone,
+        const real_t rmin, const real_t rmax) noexcept {
+    node16_intersect_t ret;
+    real_t tmaxs[aabbs_per_node16];
+    real_t maxz[aabbs_per_node16];
+
+    // farthest z distance from cone origin
+    for (auto c=0ul; c<aabbs_per_node16; ++c)
+        maxz[c] = 0;
+    for (auto a=0; a<3; ++a) {
+        const auto* farthest = cone.negative_d[a] ? n.min[a] : n.max[a];
+        for (auto c=0ul; c<aabbs_per_node16; ++c)
+            maxz[c] += (farthest[c]-cone.o[a]) * cone.d[a];
+    }
+
+    for (auto c=0ul; c<aabbs_per_node16; ++c) {
+        ret.tmins[c] = 0;
+        tmaxs[c] = inf;
+    }
+    for (auto a=0; a<3; ++a) {
+        const auto* lo = cone.negative_d[a] ? n.max[a] : n.min[a];
+        const auto* hi = cone.negative_d[a] ? n.min[a] : n.max[a];
+        // enlarged boxes: near plane moved towards the axis, far plane away from it
+        const auto s = cone.negative_d[a] ? real_t(-1) : real_t(1);
+        for (auto c=0ul; c<aabbs_per_node16; ++c) {
+            const auto enlr = kmin(kmax(maxz[c], real_t(0)), rmax) * cone.tan_alpha + cone.x0;
+            ret.tmins[c] = kmax(ret.tmins[c], (lo[c] - s*enlr - cone.o[a]) * cone.invd[a]);
+            tmaxs[c] = kmin(tmaxs[c], (hi[c] + s*enlr - cone.o[a]) * cone.invd[a]);
+        }
+    }
+
+    ret.mask = 0;
+    for (auto c=0ul; c<aabbs_per_node16; ++c) {
+        const bool hit = ret.tmins[c]<=tmaxs[c] && tmaxs[c]>=rmin && ret.tmins[c]<=rmax;
+        ret.mask |= std::uint32_t(hit) << c;
+    }
+
+    return ret;
+}
+
+constexpr node16_kernels_t make_node16_kernels(const char* isa) noexcept {
+    return {
+        .intersect_ray = &intersect_ray_node16,
+        .intersect_cone = &intersect_cone_node16,
+        .isa = isa,
+    };
+}
+
+}
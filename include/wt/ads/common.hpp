@@ -32,18 +32,43 @@ struct tuid_t {
 
 
 /**
- * @brief Triangle data
+ * @brief Triangle data.
+ *        Triangles reference their shape's mesh, which holds the vertices: geometry is fetched on demand (see ``ads_t::tri_geometry()``).
  */
 struct tri_t {
-    pqvec3_t a,b,c;
-    dir3_t n;
-
     // shape
     std::uint32_t shape_idx;
     std::uint32_t shape_tri_idx;
 
     // edges
     tuid_t edge_ab{}, edge_bc{}, edge_ca{};
+
+    /** @brief Sentinel ``shape_tri_idx`` of level-of-detail proxies, which are not part of their shape's mesh. */
+    static constexpr std::uint32_t proxy_shape_tri_idx = limits<std::uint32_t>::max();
+
+    /**
+     * @brief True for level-of-detail proxies (see ``proxy_tri_t``): the triangle has no mesh triangle, and must be shaded with the proxy's geometry.
+     */
+    [[nodiscard]] inline bool is_proxy() const noexcept { return shape_tri_idx==proxy_shape_tri_idx; }
+};
+
+/**
+ * @brief Triangle vertices and face normal
+ */
+struct tri_geometry_t {
+    pqvec3_t a,b,c;
+    dir3_t n;
+};
+
+/**
+ * @brief A level-of-detail proxy triangle, which stands in for the (single-shape, nearly coplanar) triangles of a subtree.
+ *        ``tri`` references the triangles' shape, with the ``tri_t::proxy_shape_tri_idx`` sentinel in place of a mesh triangle. ``geometry.n`` is the triangles' area-weighted mean normal.
+ */
+struct proxy_tri_t {
+    tri_t tri;
+    tri_geometry_t geometry;
+    /** @brief Fraction of the proxy's area that is covered by the triangles it stands for. */
+    f_t coverage;
 };
 
 
@@ -11,7 +11,7 @@
 
 #include <vector>
 #include <optional>
-#include <mutex>
+#include <algorithm>
 #include <future>
 
 #include <wt/math/common.hpp>
@@ -28,13 +28,19 @@
 
 namespace wt::ads::construction {
 
+/**
+ * @brief Classifies the edge ``a``-``b`` of triangle ``tri1`` (with face normal ``tri1_n``), shared with triangle ``tri2`` (with face normal ``tri2_n``), if any.
+ * @param c1 opposite vertex of the edge on the first triangle
+ * @param c2 opposite vertex of the edge on the second triangle, ``nullptr`` when the edge has no second triangle
+ */
 inline std::optional<edge_t> edge_for(
         const tri_t* tri1, const tri_t* tri2,
         const tuid_t tuid1, const tuid_t tuid2,
         const pqvec3_t& a, const pqvec3_t& b, const pqvec3_t& c1, const pqvec3_t* c2,
+        const dir3_t& tri1_n, const dir3_t& tri2_n,
         std::atomic<bool>& inconsistent_normals) noexcept {
-    auto n1 = tri1->n;
-    auto n2 = tri2 ? (tri2->n) : -n1;
+    auto n1 = tri1_n;
+    auto n2 = tri2 ? tri2_n : -n1;
 
     const auto e = m::normalize(b-a);
     const auto m = (a+b)/2;
@@ -85,54 +91,59 @@ inline std::optional<edge_t> edge_for(
     };
 }
 
+/**
+ * @brief An edge discovered by a worker, with the triangles' edge-id slots that reference it.
+ *        Edge ids are only assigned once all workers are done, avoiding any synchronization.
+ */
+struct pending_edge_t {
+    edge_t edge;
+    tuid_t* eidx1;
+    tuid_t* eidx2;
+};
+
 template <std::derived_from<ads_t> Ads>
 void find_edges(const Ads* tree, tri_t* tri, const tuid_t tuid,
                 std::vector<tri_t>& tris,
-                std::vector<edge_t>& edges,
-                std::mutex& edges_mutex,
+                std::vector<pending_edge_t>& edges,
                 std::atomic<bool>& found_multiple_adjacent_tris,
                 std::atomic<bool>& found_duplicate_tris,
                 std::atomic<bool>& inconsistent_normals) noexcept {
+    const auto g = tree->tri_geometry(tuid);
+
     // find adjacent triangles
-    const auto grow_len = m::max(m::length(tri->c-tri->a),m::length(tri->b-tri->a))/128;
-    const auto ball = ball_t::from_points(tri->a,tri->b,tri->c).grow(grow_len);
-    assert(ball.contains(tri->a) && ball.contains(tri->b) && ball.contains(tri->c));
+    const auto grow_len = m::max(m::length(g.c-g.a),m::length(g.b-g.a))/128;
+    const auto ball = ball_t::from_points(g.a,g.b,g.c).grow(grow_len);
+    assert(ball.contains(g.a) && ball.contains(g.b) && ball.contains(g.c));
 
     bool found_ab_neighbour = false, found_bc_neighbour = false, found_ca_neighbour = false;
 
     const auto insert_edge = [&](const std::optional<edge_t>& e, tuid_t* eidx1, tuid_t* eidx2) {
         if (!e) return;
-
-        std::unique_lock l(edges_mutex);
-
-        const auto eid = (std::uint32_t)edges.size();
-        *eidx1 = tuid_t{ .uid=eid };
-        if (eidx2) *eidx2 = tuid_t{ .uid=eid };
-
-        edges.emplace_back(*e);
+        edges.emplace_back(pending_edge_t{ .edge=*e, .eidx1=eidx1, .eidx2=eidx2 });
     };
 
     const auto record = tree->intersect(ball, { .detect_edges = false });
     for (const auto& t : record.triangles()) {
         if (t==tuid) continue;
         auto& other = tris[t];
+        const auto og = tree->tri_geometry(t);
 
         // find neighbours
-        const bool found_a = tri->a==other.a || tri->a==other.b || tri->a==other.c;
-        const bool found_b = tri->b==other.a || tri->b==other.b || tri->b==other.c;
-        const bool found_c = tri->c==other.a || tri->c==other.b || tri->c==other.c;
+        const bool found_a = g.a==og.a || g.a==og.b || g.a==og.c;
+        const bool found_b = g.b==og.a || g.b==og.b || g.b==og.c;
+        const bool found_c = g.c==og.a || g.c==og.b || g.c==og.c;
         if (found_a && found_b && found_c)
             found_duplicate_tris = true;
 
-        const bool shared_a = other.a==tri->a || other.a==tri->b || other.a==tri->c;
-        const bool shared_b = other.b==tri->a || other.b==tri->b || other.b==tri->c;
-        const bool shared_c = other.c==tri->a || other.c==tri->b || other.c==tri->c;
+        const bool shared_a = og.a==g.a || og.a==g.b || og.a==g.c;
+        const bool shared_b = og.b==g.a || og.b==g.b || og.b==g.c;
+        const bool shared_c = og.c==g.a || og.c==g.b || og.c==g.c;
         assert(int(found_a) + int(found_b) + int(found_c) == int(shared_a) + int(shared_b) + int(shared_c));
 
         auto* tedge_idx2 = shared_a&&shared_b ? &other.edge_ab :
                            shared_b&&shared_c ? &other.edge_bc : &other.edge_ca;
-        const auto& c2 = shared_a&&shared_b ? other.c :
-                         shared_b&&shared_c ? other.a : other.b;
+        const auto& c2 = shared_a&&shared_b ? og.c :
+                         shared_b&&shared_c ? og.a : og.b;
 
         if (found_a && found_b) {
             if (found_ab_neighbour) { found_multiple_adjacent_tris = true; continue; }
@@ -140,7 +151,7 @@ void find_edges(const Ads* tree, tri_t* tri, const tuid_t tuid,
  
             if (t<=tuid) continue;     // the least tuid updates mutual edges
             insert_edge(edge_for(tri, &other, tuid, t,
-                                 tri->a, tri->b, tri->c, &c2, inconsistent_normals),
+                                 g.a, g.b, g.c, &c2, g.n, og.n, inconsistent_normals),
                         &tri->edge_ab, tedge_idx2);
         }
         if (found_b && found_c) { 
@@ -149,7 +160,7 @@ void find_edges(const Ads* tree, tri_t* tri, const tuid_t tuid,
 
             if (t<=tuid) continue;     // the least tuid updates mutual edges
             insert_edge(edge_for(tri, &other, tuid, t,
-                                 tri->b, tri->c, tri->a, &c2, inconsistent_normals),
+                                 g.b, g.c, g.a, &c2, g.n, og.n, inconsistent_normals),
                         &tri->edge_bc, tedge_idx2);
         }
         if (found_c && found_a) {
@@ -158,7 +169,7 @@ void find_edges(const Ads* tree, tri_t* tri, const tuid_t tuid,
 
             if (t<=tuid) continue;     // the least tuid updates mutual edges
             insert_edge(edge_for(tri, &other, tuid, t,
-                                 tri->c, tri->a, tri->b, &c2, inconsistent_normals),
+                                 g.c, g.a, g.b, &c2, g.n, og.n, inconsistent_normals),
                         &tri->edge_ca, tedge_idx2);
         }
     }
@@ -166,23 +177,39 @@ void find_edges(const Ads* tree, tri_t* tri, const tuid_t tuid,
     // neighbourless edges
     if (!found_ab_neighbour) {
         insert_edge(edge_for(tri, nullptr, tuid, {},
-                             tri->a, tri->b, tri->c, nullptr, inconsistent_normals),
+                             g.a, g.b, g.c, nullptr, g.n, g.n, inconsistent_normals),
                     &tri->edge_ab, nullptr);
     }
     if (!found_bc_neighbour) {
         insert_edge(edge_for(tri, nullptr, tuid, {},
-                             tri->b, tri->c, tri->a, nullptr, inconsistent_normals),
+                             g.b, g.c, g.a, nullptr, g.n, g.n, inconsistent_normals),
                     &tri->edge_bc, nullptr);
     }
     if (!found_ca_neighbour) {
         insert_edge(edge_for(tri, nullptr, tuid, {},
-                             tri->c, tri->a, tri->b, nullptr, inconsistent_normals),
+                             g.c, g.a, g.b, nullptr, g.n, g.n, inconsistent_normals),
                     &tri->edge_ca, nullptr);
     }
 }
 
+/**
+ * @brief Copies the edge ids of the first copy of each triangle to its other copies.
+ *        Edges are only classified over the first copies, and reference them.
+ */
+template <std::derived_from<ads_t> Ads>
+void propagate_edges_to_copies(const Ads* tree, std::vector<tri_t>& tris) noexcept {
+    for (auto t=0ul; t<tris.size(); ++t) {
+        const auto c = tree->canonical_tuid(tuid_t{ idx_t(t) });
+        if (c==t) continue;
+        tris[t].edge_ab = tris[c].edge_ab;
+        tris[t].edge_bc = tris[c].edge_bc;
+        tris[t].edge_ca = tris[c].edge_ca;
+    }
+}
+
 /**
  * @brief Finds edges for the triangles.
+ *        Adjacency and classification run lock free on the thread pool: each chunk of triangles collects its edges locally, edges are then concatenated and edge ids written back in parallel.
  * @param tris list of triangles to update and search
  */
 template <std::derived_from<ads_t> Ads>
@@ -192,48 +219,75 @@ auto find_edges(
         const wt::wt_context_t& ctx,
         progress_track_t& pt)
 {
-    std::mutex edges_mutex;
-    std::vector<edge_t> edges;
-    edges.reserve(tris.size());
-
-    constexpr std::size_t chunk = 64;
+    constexpr std::size_t chunk = 1024;
 
-    std::vector<std::future<void>> workers;
+    std::vector<std::future<std::vector<pending_edge_t>>> workers;
     std::atomic<bool> found_multiple_adjacent_tris = false;
     std::atomic<bool> found_duplicate_tris = false;
     std::atomic<bool> inconsistent_normals = false;
     for (auto idx=0ul; idx<tris.size(); idx+=chunk) {
         workers.emplace_back(ctx.threadpool->enqueue([&, tree, idx]() {
+            std::vector<pending_edge_t> chunk_edges;
+            chunk_edges.reserve(chunk*3/2);
             for (auto i=0ul; i<chunk && i+idx<tris.size(); ++i) {
                 const auto tuid = tuid_t{idx_t(i + idx)};
+                // copies of a triangle share the edges of the first copy
+                if (tree->canonical_tuid(tuid)!=tuid)
+                    continue;
                 auto* t = &tris[tuid.uid];
                 find_edges(tree, t, tuid, tris,
-                           edges, edges_mutex,
+                           chunk_edges,
                            found_multiple_adjacent_tris, found_duplicate_tris, inconsistent_normals);
             }
+            return chunk_edges;
         }));
     }
 
+    // collect
     const auto total = (std::uint32_t)workers.size();
-    std::uint32_t completed=0;
-    while (!workers.empty()) {
-        for (auto it=workers.begin(); it!=workers.end();) {
-            using namespace std::chrono_literals;
-            if (it->wait_for(10us) == std::future_status::ready) {
-                it = workers.erase(it);
-                pt.set_progress((++completed)/f_t(total));
-            } else {
-                ++it;
-            }
+    std::vector<std::vector<pending_edge_t>> chunks_edges;
+    chunks_edges.reserve(total);
+    for (auto& w : workers) {
+        chunks_edges.emplace_back(std::move(w).get());
+        pt.set_progress(chunks_edges.size()/f_t(total));
+    }
+
+    // assign edge ids and write edges
+    std::vector<std::size_t> offsets(chunks_edges.size()+1, 0);
+    for (auto c=0ul; c<chunks_edges.size(); ++c)
+        offsets[c+1] = offsets[c] + chunks_edges[c].size();
+
+    std::vector<edge_t> edges;
+    if (offsets.back()>0) {
+        if (offsets.back()>limits<std::uint32_t>::max())
+            throw std::runtime_error("(ads) too many edges");
+
+        const auto& first = *std::ranges::find_if(chunks_edges, [](const auto& e) { return !e.empty(); });
+        edges.resize(offsets.back(), first.front().edge);
+
+        std::vector<std::future<void>> writers;
+        for (auto c=0ul; c<chunks_edges.size(); ++c) {
+            writers.emplace_back(ctx.threadpool->enqueue([&, c]() {
+                auto eid = offsets[c];
+                for (const auto& pe : chunks_edges[c]) {
+                    *pe.eidx1 = tuid_t{ .uid=(std::uint32_t)eid };
+                    if (pe.eidx2) *pe.eidx2 = tuid_t{ .uid=(std::uint32_t)eid };
+                    edges[eid++] = pe.edge;
+                }
+            }));
         }
+        for (auto& w : writers)
+            w.get();
     }
 
+    if (tree->has_duplicate_triangles())
+        propagate_edges_to_copies(tree, tris);
+
     if (found_duplicate_tris)
         wt::logger::cwarn(verbosity_e::info) << "(ads) found duplicate triangles." << '\n';
     if (inconsistent_normals)
         wt::logger::cerr(verbosity_e::info) << "(ads) found normal inconsistency (mix of adjacent front and back faces)." << '\n';
 
-    edges.shrink_to_fit();
     return edges;
 }
 
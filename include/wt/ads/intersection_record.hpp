@@ -10,7 +10,6 @@
 #pragma once
 
 #include <vector>
-#include <set>
 #include <cmath>
 
 #include <wt/math/common.hpp>
@@ -28,7 +27,8 @@ namespace wt::ads {
 struct intersection_record_t {
 public:
     using triangles_container_t = std::vector<tuid_t>;
-    using edges_container_t = std::set<tuid_t>;
+    /** @brief Sorted and deduplicated list of edges. */
+    using edges_container_t = std::vector<tuid_t>;
 
     struct rt_record_t {
         intersect::intersect_ray_tri_ret_t raytracing_intersection_record;
@@ -119,7 +119,7 @@ public:
 
     /**
      * @brief Returns accessor for intersected triangles.
-     *        The underlying storage might use thread_local vectors; a user should finish accessing the intersection record before calling adds::intersect on the same ads again.
+     *        The underlying storage is the intersection scratch used for the query; it remains valid until that scratch is reused.
      */
     [[nodiscard]] inline auto triangles() const noexcept {
         if (has_rt_record)
@@ -130,8 +130,8 @@ public:
     }
 
     /**
-     * @brief Returns container of intersected edges.
-     *        The underlying storage might use thread_local vectors; a user should finish accessing the intersection record before calling adds::intersect on the same ads again.
+     * @brief Returns container of intersected edges (sorted and deduplicated).
+     *        The underlying storage is the intersection scratch used for the query; it remains valid until that scratch is reused.
      */
     [[nodiscard]] inline const auto& edges() const noexcept {
         static const edges_container_t dummy;
@@ -0,0 +1,155 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <wt/math/common.hpp>
+#include <wt/util/thread_pool/tpool_worker_arena.hpp>
+
+#include "intersection_record.hpp"
+#include "common.hpp"
+
+namespace wt::ads {
+
+struct intersection_work_tri_t {
+    tuid_t tuid;
+    length_t dist;
+
+    inline bool operator<(const intersection_work_tri_t& o) const noexcept {
+        return tuid<o.tuid;
+    }
+    inline explicit operator tuid_t() const noexcept {
+        return tuid;
+    }
+};
+
+/**
+ * @brief An edge returned by a nearest-edges query.
+ */
+struct nearest_edge_t {
+    std::uint32_t euid;
+    /** @brief Distance from the query point. */
+    length_t dist;
+};
+
+/**
+ * @brief Storage for a single ADS intersection query.
+ *        An intersection record returned by a query references the storage of the scratch passed to the query, and remains valid until that scratch is reused or destroyed.
+ *        Containers retain their capacity, so a reused scratch does not allocate in steady state.
+ */
+struct intersection_scratch_t {
+    /** @brief Intersected triangles. */
+    intersection_record_t::triangles_container_t triangles;
+    /** @brief Intersected edges: flat, sorted and deduplicated. */
+    intersection_record_t::edges_container_t edges;
+
+    /** @brief Nearest edges, ordered by distance. */
+    std::vector<nearest_edge_t> nearest_edges;
+
+    /** @brief Traversal working set. */
+    std::vector<intersection_work_tri_t> work_triangles;
+
+    /**
+     * @brief Prepares the scratch for a new query.
+     */
+    inline void prepare(bool accumulate_triangles, bool accumulate_edges) noexcept {
+        if (!accumulate_triangles)
+            triangles.clear();
+        if (!accumulate_edges)
+            edges.clear();
+    }
+
+    /**
+     * @brief Sorts and deduplicates edges that were appended after the first `sorted_count` edges.
+     */
+    inline void finalize_edges(std::size_t sorted_count) noexcept {
+        if (edges.size()==sorted_count)
+            return;
+
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    }
+};
+
+/**
+ * @brief A pool of intersection scratch objects, meant to be held per thread pool worker (see `intersection_scratch_arena_t`).
+ *        Scratches are handed out as RAII handles that return the scratch to the pool on destruction. Nested or concurrent queries (e.g., a connection query issued while a path's intersection record is still live) simply acquire additional scratches.
+ *        The pool grows to the maximal nesting depth, and does not allocate afterwards.
+ */
+class intersection_scratch_pool_t {
+private:
+    std::vector<std::unique_ptr<intersection_scratch_t>> free_list;
+
+public:
+    class handle_t {
+        friend class intersection_scratch_pool_t;
+
+    private:
+        intersection_scratch_pool_t* pool = nullptr;
+        std::unique_ptr<intersection_scratch_t> scratch;
+
+        handle_t(intersection_scratch_pool_t* pool, std::unique_ptr<intersection_scratch_t> scratch) noexcept
+            : pool(pool), scratch(std::move(scratch)) {}
+
+    public:
+        handle_t(handle_t&&) noexcept = default;
+        handle_t& operator=(handle_t&&) noexcept = default;
+        handle_t(const handle_t&) = delete;
+        handle_t& operator=(const handle_t&) = delete;
+
+        ~handle_t() noexcept {
+            release();
+        }
+
+        /**
+         * @brief Returns the scratch to the pool before the handle is destroyed. The handle is empty afterwards.
+         */
+        inline void release() noexcept {
+            if (pool && scratch)
+                pool->free_list.emplace_back(std::move(scratch));
+            pool = nullptr;
+        }
+
+        [[nodiscard]] inline auto& operator*() noexcept { return *scratch; }
+        [[nodiscard]] inline auto* operator->() noexcept { return scratch.get(); }
+        [[nodiscard]] inline auto& get() noexcept { return *scratch; }
+    };
+
+    intersection_scratch_pool_t() = default;
+    intersection_scratch_pool_t(intersection_scratch_pool_t&&) noexcept = default;
+    intersection_scratch_pool_t& operator=(intersection_scratch_pool_t&&) noexcept = default;
+
+    [[nodiscard]] inline handle_t acquire() {
+        if (free_list.empty())
+            return { this, std::make_unique<intersection_scratch_t>() };
+
+        auto s = std::move(free_list.back());
+        free_list.pop_back();
+        return { this, std::move(s) };
+    }
+};
+
+using intersection_scratch_arena_t = thread_pool::tpool_worker_arena_t<intersection_scratch_pool_t>;
+
+/**
+ * @brief Acquires an intersection scratch from this worker's pool in `arena`. When called from a thread that is not a thread pool worker, or when `arena` is null, a thread-local pool is used instead.
+ */
+[[nodiscard]] inline auto acquire_intersection_scratch(intersection_scratch_arena_t* arena) {
+    if (arena && thread_pool::is_this_thread_tpool_worker())
+        return arena->get().acquire();
+
+    static thread_local intersection_scratch_pool_t pool;
+    return pool.acquire();
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <cstdint>
+
+#include "common.hpp"
+
+namespace wt::ads {
+
+/**
+ * @brief Small most-recently-used list of triangles that occluded recent shadow queries, meant to be held per thread.
+ *        Shadow queries issued in succession (e.g., connections from a path's vertices to the same emitter, or BDPT connections that share an endpoint) are often blocked by the same triangle: testing the cached triangles first resolves such queries without traversal.
+ *        The cache is bound to a single ADS (by its generation, see ``ads_t::generation()``), and is cleared when used with another or after the ADS was updated.
+ */
+class occluder_cache_t {
+public:
+    static constexpr std::size_t capacity = 4;
+
+private:
+    std::uint64_t owner = 0;
+    std::array<tuid_t, capacity> tuids{};
+    std::uint32_t count = 0;
+
+public:
+    /**
+     * @brief Binds the cache to an ADS generation, clearing it if it was used with another.
+     */
+    inline void bind(std::uint64_t ads_generation) noexcept {
+        if (owner!=ads_generation) {
+            owner = ads_generation;
+            count = 0;
+        }
+    }
+
+    /**
+     * @brief Records an occluder as the most recently used, evicting the least recently used if full.
+     */
+    inline void record(tuid_t tuid) noexcept {
+        std::uint32_t i = 0;
+        while (i<count && tuids[i]!=tuid) ++i;
+        if (i==count) {
+            if (count<capacity) ++count;
+            i = count-1;
+        }
+        for (; i>0; --i)
+            tuids[i] = tuids[i-1];
+        tuids[0] = tuid;
+    }
+
+    /**
+     * @brief Cached occluders, most recently used first.
+     */
+    [[nodiscard]] inline std::span<const tuid_t> occluders() const noexcept {
+        return { tuids.data(), count };
+    }
+};
+
+}
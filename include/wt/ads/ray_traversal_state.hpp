@@ -0,0 +1,47 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <wt/math/common.hpp>
+
+namespace wt::ads {
+
+/**
+ * @brief Suspended ray traversal, resumed by successive ray queries over increasing ranges of the same ray (see ``ads_t::intersect(ray, range, state)``).
+ *        Holds the candidate set of the traversal: the nodes that were reached by previous queries but that the ray enters past their ranges, and the leaves that extend past their ranges, together with the ray's entry and exit distances. A resumed query continues from these nodes, instead of restarting from the root.
+ *        The state is bound to a single ADS (by its generation, see ``ads_t::generation()``), and is reset when used with another or after the ADS was updated. Once a query finds a hit, the state is reset: a later query restarts from the root. A state must be reset before it is used with a different ray.
+ */
+struct ray_traversal_state_t {
+    static constexpr std::size_t capacity = 64;
+
+    struct node_t {
+        length_t min_range, max_range;
+        std::int32_t ptr;
+    };
+
+    /** @brief Generation of the ADS that the state is bound to, 0 if unbound. */
+    std::uint64_t owner = 0;
+    /** @brief Suspended nodes, ordered by descending entry distance. */
+    std::array<node_t, capacity> nodes;
+    std::uint32_t count = 0;
+    /** @brief Set when the candidate set overflows: queries then restart from the root. */
+    bool overflown = false;
+
+    inline void reset() noexcept {
+        owner = 0;
+        count = 0;
+        overflown = false;
+    }
+};
+
+}
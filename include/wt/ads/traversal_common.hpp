@@ -10,27 +10,17 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 
 #include <wt/math/common.hpp>
 #include <wt/math/shapes/elliptic_cone.hpp>
 
 #include "ads.hpp"
 #include "intersection_record.hpp"
+#include "intersection_scratch.hpp"
 #include "common.hpp"
 
 namespace wt::ads {
-
-struct intersection_work_tri_t {
-    tuid_t tuid;
-    length_t dist;
-
-    inline bool operator<(const intersection_work_tri_t& o) const noexcept {
-        return tuid<o.tuid;
-    }
-    inline explicit operator tuid_t() const noexcept {
-        return tuid;
-    }
-};
 struct intersection_ray_work_tri_t {
     tuid_t tuid;
     length_t dist;
@@ -59,7 +49,8 @@ struct intersection_record_ray_work_t {
 
 template <typename TriangleContainer>
 struct intersection_record_work_t {
-    static thread_local TriangleContainer triangles;
+    /** @brief Working set, owned by the query's scratch. */
+    TriangleContainer& triangles;
     
     length_t intr_dist = limits<length_t>::infinity();
     f_t z_search_range_scale;
@@ -67,9 +58,11 @@ struct intersection_record_work_t {
 
     const pqrange_t<> searchrange = { 0*u::m, limits<length_t>::infinity() };
 
-    intersection_record_work_t(const pqrange_t<> range={},
+    intersection_record_work_t(TriangleContainer& triangles,
+                               const pqrange_t<> range={},
                                const f_t z_search_range_scale=1) noexcept
-        : z_search_range_scale(z_search_range_scale),
+        : triangles(triangles),
+          z_search_range_scale(z_search_range_scale),
           searchrange(range)
     {
         triangles.clear();
@@ -84,9 +77,16 @@ struct intersection_record_work_t {
     }
 };
 
-template <typename TriangleContainer>
-thread_local TriangleContainer intersection_record_work_t<TriangleContainer>::triangles;
 
+/**
+ * @brief Removes repeated triangles that were appended after the first `first` triangles.
+ *        Only needed for ADSs that reference a triangle from multiple leaves: a query may then find more than a single copy of a triangle (canonicalized to the same ``tuid_t``).
+ */
+inline void deduplicate_triangles(intersection_record_t::triangles_container_t& triangles,
+                                  std::size_t first) noexcept {
+    std::sort(triangles.begin()+first, triangles.end());
+    triangles.erase(std::unique(triangles.begin()+first, triangles.end()), triangles.end());
+}
 
 /**
  * @brief Helper to convert intersection_record_ray_work_t to intersection_record_t
@@ -101,7 +101,7 @@ template <std::derived_from<ads_t> Ads>
     
     assert(traversal_range.contains(work.triangle.dist));
 
-    const auto tuid = static_cast<tuid_t>(work.triangle);
+    const auto tuid = ads.canonical_tuid(static_cast<tuid_t>(work.triangle));
     return {
         work.intersection,
         work.triangle.front_face,
@@ -116,34 +116,36 @@ template <std::derived_from<ads_t> Ads>
 template <typename TriangleContainer, std::derived_from<ads_t> Ads>
 [[nodiscard]] inline intersection_record_t cone_work_to_intersection_record(
         const Ads& ads,
-        intersection_record_work_t<TriangleContainer> work,
+        const intersection_record_work_t<TriangleContainer>& work,
         const elliptic_cone_t &cone,
-        const ads_t::intersect_opts_t& opts) noexcept {
+        const ads_t::intersect_opts_t& opts,
+        intersection_scratch_t& scratch) noexcept {
     const auto range = work.search_range(cone);
-    
-    static thread_local std::vector<tuid_t> triangles;
-    static thread_local std::set<tuid_t> edges;
 
-    // clear static structures, if we are not accumulating
-    if (!opts.accumulate_triangles)
-        triangles.clear();
-    if (!opts.accumulate_edges)
-        edges.clear();
+    // clear scratch, if we are not accumulating
+    scratch.prepare(opts.accumulate_triangles, opts.accumulate_edges);
+    auto& triangles = scratch.triangles;
+    auto& edges = scratch.edges;
+    const auto sorted_edges = edges.size();
+    const auto first_triangle = triangles.size();
 
     for (const auto& wt : work.triangles) {
         // remove too far-away triangles
         if (wt.dist>range.max) continue;
 
-        triangles.push_back(static_cast<tuid_t>(wt));
+        triangles.push_back(ads.canonical_tuid(static_cast<tuid_t>(wt)));
         
-        // find edges
-        if (opts.detect_edges) {
+        // find edges (level-of-detail proxies have none)
+        if (opts.detect_edges && !ads.is_proxy(wt.tuid)) {
             const auto& tri = ads.tri(wt.tuid);
-            if (tri.edge_ab) edges.insert(tri.edge_ab);
-            if (tri.edge_bc) edges.insert(tri.edge_bc);
-            if (tri.edge_ca) edges.insert(tri.edge_ca);
+            if (tri.edge_ab) edges.push_back(tri.edge_ab);
+            if (tri.edge_bc) edges.push_back(tri.edge_bc);
+            if (tri.edge_ca) edges.push_back(tri.edge_ca);
         }
     }
+    scratch.finalize_edges(sorted_edges);
+    if (ads.has_duplicate_triangles())
+        deduplicate_triangles(triangles, first_triangle);
 
     return { work.intr_dist, work.front_face, &triangles, &edges };
 }
@@ -154,28 +156,30 @@ template <typename TriangleContainer, std::derived_from<ads_t> Ads>
 template <typename TriangleContainer, std::derived_from<ads_t> Ads>
 [[nodiscard]] inline intersection_record_t ball_work_to_intersection_record(
         const Ads& ads,
-        intersection_record_work_t<TriangleContainer> work,
-        const ads_t::intersect_opts_t& opts) noexcept {
-    static thread_local std::vector<tuid_t> triangles;
-    static thread_local std::set<tuid_t> edges;
-
-    // clear static structures, if we are not accumulating
-    if (!opts.accumulate_triangles)
-        triangles.clear();
-    if (!opts.accumulate_edges)
-        edges.clear();
+        const intersection_record_work_t<TriangleContainer>& work,
+        const ads_t::intersect_opts_t& opts,
+        intersection_scratch_t& scratch) noexcept {
+    // clear scratch, if we are not accumulating
+    scratch.prepare(opts.accumulate_triangles, opts.accumulate_edges);
+    auto& triangles = scratch.triangles;
+    auto& edges = scratch.edges;
+    const auto sorted_edges = edges.size();
+    const auto first_triangle = triangles.size();
 
     for (const auto& wt : work.triangles) {
-        triangles.push_back(static_cast<tuid_t>(wt));
+        triangles.push_back(ads.canonical_tuid(static_cast<tuid_t>(wt)));
 
         // find edges
         if (opts.detect_edges) {
             const auto& tri = ads.tri(wt.tuid);
-            if (tri.edge_ab) edges.insert(tri.edge_ab);
-            if (tri.edge_bc) edges.insert(tri.edge_bc);
-            if (tri.edge_ca) edges.insert(tri.edge_ca);
+            if (tri.edge_ab) edges.push_back(tri.edge_ab);
+            if (tri.edge_bc) edges.push_back(tri.edge_bc);
+            if (tri.edge_ca) edges.push_back(tri.edge_ca);
         }
     }
+    scratch.finalize_edges(sorted_edges);
+    if (ads.has_duplicate_triangles())
+        deduplicate_triangles(triangles, first_triangle);
 
     return { 0*u::m, false, &triangles, &edges };
 }
@@ -0,0 +1,287 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+#include <wt/ads/common.hpp>
+#include <wt/beam/gaussian_wavefront.hpp>
+#include <wt/math/common.hpp>
+#include <wt/math/frame.hpp>
+#include <wt/math/range.hpp>
+#include <wt/math/shapes/elliptic_cone.hpp>
+#include <wt/math/intersect/clip.hpp>
+
+namespace wt::beam {
+
+/**
+ * @brief Integrates the intensity of a Gaussian beam over the footprints of triangles: the parts of the triangles that lie in the interaction region (a range of depths along the beam), projected upon the beam's cross section.
+ *        Triangles are queued and processed ``width`` at a time, stored SoA. Clipping, projection and integration are written as loops over lanes for the compiler to vectorize.
+ *
+ *        In canonical space, the integral over a polygon is a sum, over its edges, of the (signed) integrals over the triangles spanned by the mean and an edge. Each is a 1D integral along the edge of a smooth integrand, evaluated with 8-point Gauss-Legendre quadrature within ``cull_radius`` of the mean, and analytically beyond it (where the radial mass is taken to be 1).
+ *        Absolute error is below ~1e-4 (typically ~1e-6), compared to ~1e-3 of ``gaussian2d_t::integrate_triangle()``.
+ *        Triangles whose footprint does not overlap the square of half-size ``cull_radius`` about the mean contribute less than ~3e-5, and are culled.
+ */
+class triangle_footprint_integrator_t {
+public:
+    static constexpr std::size_t width = 8;
+    // radius about the mean, in canonical space, of quadrature window and culling
+    static constexpr f_t cull_radius = 4;
+
+private:
+    // triangle is clipped into a polygon with (at most) 6 edges
+    static constexpr std::size_t chain_size = 6;
+
+    const frame_t& frame;
+    const pqvec3_t origin;
+    const beam::gaussian_wavefront_t& wavefront;
+    const elliptic_cone_t& envelope;
+    const pqrange_t<> z_range;
+    const length_t csz;
+
+    // interaction region and projection upon the cross section at csz, in metres
+    const f_t zmin, zmax;
+    const f_t tan_alpha, x0, proj_num;
+    const bool project;
+    // canonical transform
+    const vec2_t mu, ex, ey, recp_sigma;
+    const bool dirac;
+
+    // queued triangles, in local beam frame, in metres, and their weights
+    f_t vx[3][width], vy[3][width], vz[3][width];
+    f_t weight[width];
+    std::size_t queued = 0;
+
+    f_t flux = 0;
+
+    /**
+     * @brief Signed integral of the standard 2D normal distribution over the triangle spanned by the origin and the edge p-q (positive for counter-clockwise winding).
+     */
+    [[nodiscard]] static inline f_t canonical_edge_integral(f_t px, f_t py, f_t qx, f_t qy) noexcept {
+        static constexpr f_t gl_x[8] = {
+            -0.9602898564975363, -0.7966664774136267, -0.5255324099163290, -0.1834346424956498,
+             0.1834346424956498,  0.5255324099163290,  0.7966664774136267,  0.9602898564975363,
+        };
+        static constexpr f_t gl_w[8] = {
+            0.1012285362903763, 0.2223810344533745, 0.3137066458778873, 0.3626837833783620,
+            0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763,
+        };
+        static constexpr f_t R = cull_radius;
+
+        const auto dx = qx-px, dy = qy-py;
+        const auto l2 = dx*dx + dy*dy;
+        const auto cross = px*qy - py*qx;
+        // degenerate edges, or edges collinear with the origin, contribute nothing
+        const bool degenerate = !(l2>0) || cross==0;
+
+        const auto recp_l = degenerate ? f_t(1) : 1/m::sqrt(l2);
+        // distance of the edge's line from origin (kept positive for degenerate edges)
+        const auto h = degenerate ? f_t(1) : m::abs(cross)*recp_l;
+        // edge's end points, parametrized by the signed distance along the line from the foot of the perpendicular
+        const auto sa = (px*dx + py*dy)*recp_l;
+        const auto sb = sa + l2*recp_l;
+
+        // quadrature window: the part of the line within radius R
+        const auto w = m::sqrt(m::max<f_t>(0, R*R-h*h));
+        const auto a = m::clamp(sa,-w,w);
+        const auto b = m::clamp(sb,-w,w);
+
+        // beyond the window: angle subtended by the edge's remainders
+        const auto tails = u::to_rad(m::atan(h*(sb-b)/(h*h+sb*b))) +
+                           u::to_rad(m::atan(h*(a-sa)/(h*h+a*sa)));
+        // within the window: integrate h/(h^2+s^2) * (1-exp(-(h^2+s^2)/2)) ds
+        const auto c = (a+b)/2, hw = (b-a)/2;
+        f_t q = 0;
+        for (int k=0; k<8; ++k) {
+            const auto s = c + hw*gl_x[k];
+            const auto rho2 = h*h + s*s;
+            q += gl_w[k] * (1-m::exp(-rho2/2)) / rho2;
+        }
+
+        const auto I = (tails + h*hw*q) * m::inv_two_pi;
+        return degenerate ? f_t(0) : cross>0 ? I : -I;
+    }
+
+    // scalar path, for dirac wavefronts
+    inline void integrate_dirac(const ads::tri_geometry_t& tri, const f_t w) noexcept {
+        const auto clipped_tris = intersect::clip_triangle_z(frame.to_local(tri.a-origin),
+                                                             frame.to_local(tri.b-origin),
+                                                             frame.to_local(tri.c-origin),
+                                                             z_range);
+        [[assume(0<=clipped_tris.tris && clipped_tris.tris<=3)]];
+        for (int t=0;t<clipped_tris.tris;++t) {
+            const auto ctri = clipped_tris.triangle(t);
+            flux += w * wavefront.integrate_triangle(envelope.project_local(ctri[0], csz),
+                                                     envelope.project_local(ctri[1], csz),
+                                                     envelope.project_local(ctri[2], csz));
+        }
+    }
+
+    inline void flush() noexcept {
+        const auto n = queued;
+        queued = 0;
+        if (n==0) return;
+        // pad unused lanes
+        for (std::size_t l=n; l<width; ++l) {
+            for (std::size_t v=0; v<3; ++v)
+                vx[v][l] = vy[v][l] = vz[v][l] = 0;
+            weight[l] = 0;
+        }
+
+        // clipped polygons, as a closed chain of (up to) 6 vertices per lane:
+        // each triangle edge contributes the end points of its part within [zmin,zmax]
+        f_t px[chain_size][width], py[chain_size][width], pz[chain_size][width];
+        bool valid[3][width];
+        for (std::size_t e=0; e<3; ++e) {
+            const auto i = e, j = (e+1)%3;
+            for (std::size_t l=0; l<width; ++l) {
+                const auto zi = vz[i][l], dz = vz[j][l]-zi;
+                const auto rdz = dz!=0 ? 1/dz : f_t(0);
+                const auto tl = (zmin-zi)*rdz, th = (zmax-zi)*rdz;
+                const bool inside = zi>=zmin && zi<=zmax;
+                const auto t0 = dz!=0 ? m::max<f_t>(0, m::min(tl,th)) : (inside ? f_t(0) : f_t(1));
+                const auto t1 = dz!=0 ? m::min<f_t>(1, m::max(tl,th)) : (inside ? f_t(1) : f_t(0));
+                valid[e][l] = t0<=t1;
+
+                const auto dx = vx[j][l]-vx[i][l], dy = vy[j][l]-vy[i][l];
+                px[2*e][l]   = vx[i][l] + dx*t0;
+                py[2*e][l]   = vy[i][l] + dy*t0;
+                pz[2*e][l]   = zi + dz*t0;
+                px[2*e+1][l] = vx[i][l] + dx*t1;
+                py[2*e+1][l] = vy[i][l] + dy*t1;
+                pz[2*e+1][l] = zi + dz*t1;
+            }
+        }
+        // an edge that lies outside the region collapses onto the last point of the previous edge:
+        // the chain then runs back and forth along the clip line, which cancels out.
+        // at most a single edge of a triangle that is not culled lies outside the region.
+        for (std::size_t e=0; e<3; ++e) {
+            const auto p = (2*e+5)%chain_size;
+            for (std::size_t l=0; l<width; ++l) {
+                const bool v = valid[e][l];
+                for (const auto k : { 2*e, 2*e+1 }) {
+                    px[k][l] = v ? px[k][l] : px[p][l];
+                    py[k][l] = v ? py[k][l] : py[p][l];
+                    pz[k][l] = v ? pz[k][l] : pz[p][l];
+                }
+            }
+        }
+
+        // project upon cross section and transform to canonical space
+        f_t cmin[2][width], cmax[2][width];
+        for (std::size_t l=0; l<width; ++l) {
+            cmin[0][l] = cmin[1][l] =  limits<f_t>::infinity();
+            cmax[0][l] = cmax[1][l] = -limits<f_t>::infinity();
+        }
+        for (std::size_t k=0; k<chain_size; ++k) {
+            for (std::size_t l=0; l<width; ++l) {
+                const auto s = project ? proj_num / m::abs(tan_alpha*pz[k][l] + x0) : f_t(1);
+                const auto x = px[k][l]*s - mu.x, y = py[k][l]*s - mu.y;
+                const auto cx = (ex.x*x + ex.y*y) * recp_sigma.x;
+                const auto cy = (ey.x*x + ey.y*y) * recp_sigma.y;
+                px[k][l] = cx;
+                py[k][l] = cy;
+                cmin[0][l] = m::min(cmin[0][l], cx);
+                cmin[1][l] = m::min(cmin[1][l], cy);
+                cmax[0][l] = m::max(cmax[0][l], cx);
+                cmax[1][l] = m::max(cmax[1][l], cy);
+            }
+        }
+
+        // cull: padding lanes, triangles outside the region, and footprints away from the mean
+        bool live[width];
+        for (std::size_t l=0; l<width; ++l) {
+            live[l] = l<n && (valid[0][l] || valid[1][l] || valid[2][l]) &&
+                      cmin[0][l]<cull_radius && cmax[0][l]>-cull_radius &&
+                      cmin[1][l]<cull_radius && cmax[1][l]>-cull_radius;
+        }
+
+        // integrate
+        f_t I[width];
+        for (std::size_t l=0; l<width; ++l)
+            I[l] = 0;
+        for (std::size_t k=0; k<chain_size; ++k) {
+            const auto k1 = (k+1)%chain_size;
+            for (std::size_t l=0; l<width; ++l)
+                I[l] += canonical_edge_integral(px[k][l], py[k][l], px[k1][l], py[k1][l]);
+        }
+        for (std::size_t l=0; l<width; ++l)
+            flux += live[l] ? weight[l] * m::min<f_t>(1, m::abs(I[l])) : f_t(0);
+    }
+
+public:
+    /**
+     * @brief Constructs an integrator for a beam.
+     * @param frame beam's local frame
+     * @param envelope beam's envelope
+     * @param wavefront beam's wavefront on the cross section at the centre of the interaction region
+     * @param z_range interaction region: range of depths along the beam
+     */
+    triangle_footprint_integrator_t(const frame_t& frame,
+                                    const elliptic_cone_t& envelope,
+                                    const beam::gaussian_wavefront_t& wavefront,
+                                    const pqrange_t<>& z_range) noexcept
+        : frame(frame),
+          origin(envelope.o()),
+          wavefront(wavefront),
+          envelope(envelope),
+          z_range(z_range),
+          csz(z_range.centre()),
+          zmin((f_t)u::to_m(z_range.min)),
+          zmax((f_t)u::to_m(z_range.max)),
+          tan_alpha(envelope.get_tan_alpha()),
+          x0((f_t)u::to_m(envelope.x0())),
+          proj_num(tan_alpha*(f_t)u::to_m(csz) + x0),
+          project(x0!=0 || tan_alpha!=0),
+          mu(wavefront.intensity_distribution().mean()),
+          ex(wavefront.intensity_distribution().frame_mat()[0]),
+          ey(wavefront.intensity_distribution().frame_mat()[1]),
+          recp_sigma(wavefront.intensity_distribution().recp_std_dev()),
+          dirac(wavefront.intensity_distribution().is_dirac())
+    {}
+
+    triangle_footprint_integrator_t(const triangle_footprint_integrator_t&) = delete;
+    triangle_footprint_integrator_t& operator=(const triangle_footprint_integrator_t&) = delete;
+
+    /**
+     * @brief Queues a triangle for integration.
+     * @param w weight of the triangle's integrated intensity
+     */
+    inline void add(const ads::tri_geometry_t& tri, const f_t w = 1) noexcept {
+        if (dirac) {
+            integrate_dirac(tri, w);
+            return;
+        }
+
+        const auto a = u::to_m(frame.to_local(tri.a-origin));
+        const auto b = u::to_m(frame.to_local(tri.b-origin));
+        const auto c = u::to_m(frame.to_local(tri.c-origin));
+        const auto l = queued;
+        vx[0][l] = (f_t)a.x; vy[0][l] = (f_t)a.y; vz[0][l] = (f_t)a.z;
+        vx[1][l] = (f_t)b.x; vy[1][l] = (f_t)b.y; vz[1][l] = (f_t)b.z;
+        vx[2][l] = (f_t)c.x; vy[2][l] = (f_t)c.y; vz[2][l] = (f_t)c.z;
+        weight[l] = w;
+
+        if (++queued==width)
+            flush();
+    }
+
+    /**
+     * @brief Integrates the queued triangles, and returns the integrated intensity over all triangles added.
+     */
+    [[nodiscard]] inline f_t integrate() noexcept {
+        flush();
+        assert(flux>=0);
+        return flux;
+    }
+};
+
+}
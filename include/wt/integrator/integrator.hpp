@@ -22,6 +22,8 @@
 #include <wt/sensor/sensor_sample.hpp>
 #include <wt/sensor/sensor_flags.hpp>
 
+#include <wt/util/for_range.hpp>
+
 namespace wt::integrator {
 
 struct integrator_context_t;
@@ -56,6 +58,21 @@ public:
                            const vec3u32_t& sensor_element,
                            std::uint32_t samples_per_element) const noexcept = 0;
 
+    /**
+     * @brief Integrates light transport for all elements of a sensor block.
+     *        The default implementation calls ``integrate()`` for each element of the block. Integrators that batch work across the elements of a block (e.g., wavefront integrators) override this.
+     * 
+     * @param block block to write samples to
+     * @param samples_per_element sample count to use for each element
+     */
+    virtual void integrate_block(const integrator_context_t& ctx,
+                                 const sensor::block_handle_t& block,
+                                 std::uint32_t samples_per_element) const noexcept {
+        for_range(vec3u32_t{ 0 }, block.size, [&](auto pos_in_block) {
+            integrate(ctx, block, pos_in_block+block.position, samples_per_element);
+        });
+    }
+
 public:
     static std::shared_ptr<integrator_t> load(
             const std::string& id, 
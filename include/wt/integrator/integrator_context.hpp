@@ -14,6 +14,10 @@
 #include <wt/sensor/sensor.hpp>
 
 #include <wt/math/common.hpp>
+#include <wt/ads/intersection_scratch.hpp>
+
+#include <wt/util/bump_arena.hpp>
+#include <wt/util/thread_pool/tpool_worker_arena.hpp>
 
 namespace wt {
 
@@ -23,6 +27,8 @@ namespace ads { class ads_t; }
 
 namespace integrator {
 
+using sample_arena_t = thread_pool::tpool_worker_arena_t<bump_arena_t>;
+
 struct integrator_context_t {
     const wt_context_t* wtcontext;
     const scene_t* scene;
@@ -30,6 +36,31 @@ struct integrator_context_t {
 
     const sensor::sensor_t* sensor;
     sensor::film_storage_handle_t* film_surface;
+
+    /** @brief Per-worker pools of ADS intersection scratch storage. */
+    ads::intersection_scratch_arena_t* ads_scratch = nullptr;
+
+    /**
+     * @brief Acquires ADS intersection scratch storage for a query. Intersection records of that query remain valid for the lifetime of the returned handle.
+     */
+    [[nodiscard]] inline auto acquire_ads_scratch() const {
+        return ads::acquire_intersection_scratch(ads_scratch);
+    }
+
+    /** @brief Per-worker bump arenas for per-sample temporaries (BSDFs constructed at path vertices, and their scratch). */
+    sample_arena_t* sample_arenas = nullptr;
+
+    /**
+     * @brief This worker's bump arena for per-sample temporaries. Integrators reset it at the beginning of each sample: allocations from it are valid until then.
+     *        When called from a thread that is not a thread pool worker, or when ``sample_arenas`` is null, a thread-local arena is used instead.
+     */
+    [[nodiscard]] inline bump_arena_t& acquire_sample_arena() const {
+        if (sample_arenas && thread_pool::is_this_thread_tpool_worker())
+            return sample_arenas->get();
+
+        static thread_local bump_arena_t arena;
+        return arena;
+    }
 };
 
 }
@@ -11,9 +11,11 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <wt/integrator/integrator.hpp>
 #include <wt/bsdf/common.hpp>
+#include <wt/interaction/polarimetric/stokes.hpp>
 
 #include <wt/wt_context.hpp>
 
@@ -35,6 +37,15 @@ public:
 
         bool sensor_direct = true;
         bool emitter_direct = true;
+
+        // light-subpath reuse: count of emitter subpaths traced per pass (a pass is that many samples of a sensor element), each sensor subpath connects to all of them
+        std::uint16_t light_subpaths = 1;
+    };
+
+    // a contribution of a sample to a sensor element
+    struct splat_t {
+        sensor::sensor_element_sample_t element;
+        radiant_flux_stokes_t flux;
     };
 
 private:
@@ -59,9 +70,33 @@ public:
                    const vec3u32_t& sensor_element,
                    std::uint32_t samples_per_element) const noexcept override;
 
+    /**
+     * @brief Integrates a single sample of a sensor element, drawing all random numbers from the provided samplers, without light-subpath reuse. Used by integrators that drive BDPT from primary sample space (see ``pssmlt_t``).
+     *        Contributions are appended to ``splats`` instead of being written to the sensor. Direct-to-sensor connections may contribute to any sensor element.
+     * @param sensor_sampler sampler for the sensor sample and the sensor subpath
+     * @param emitter_sampler sampler for the emitter and spectral sample and the emitter subpath
+     * @param connection_sampler sampler for the connection strategies
+     * @return sampled wavenumber
+     */
+    wavenumber_t integrate_sample(const integrator_context_t& ctx,
+                                  const vec3u32_t& sensor_element,
+                                  sampler::sampler_t& sensor_sampler,
+                                  sampler::sampler_t& emitter_sampler,
+                                  sampler::sampler_t& connection_sampler,
+                                  std::vector<splat_t>& splats) const noexcept;
+
     [[nodiscard]] scene::element::info_t description() const override;
 
 public:
+    /**
+     * @brief Creates an integrator with the given options, and enqueues loading of its resources.
+     */
+    static std::shared_ptr<plt_bdpt_t> create(
+            const std::string& id,
+            scene::loader::loader_t* loader, 
+            const options_t& opts,
+            const wt::wt_context_t &context);
+
     static std::shared_ptr<integrator_t> load(
             const std::string& id,
             scene::loader::loader_t* loader, 
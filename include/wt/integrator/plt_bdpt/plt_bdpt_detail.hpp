@@ -9,9 +9,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <optional>
 #include <memory>
 #include <vector>
+#include <span>
 
 #include <wt/integrator/plt_bdpt/vertex.hpp>
 #include <wt/integrator/plt_bdpt/plt_bdpt.hpp>
@@ -30,6 +32,7 @@
 #include <wt/sensor/sensor/virtual_sensor.hpp>
 
 #include <wt/beam/beam.hpp>
+#include <wt/beam/footprint_integrator.hpp>
 
 #include <wt/sampler/sampler.hpp>
 #include <wt/sampler/measure.hpp>
@@ -37,7 +40,6 @@
 #include <wt/math/barycentric.hpp>
 #include <wt/math/intersect/cone_intersection_tolerance.hpp>
 #include <wt/math/intersect/ray.hpp>
-#include <wt/math/intersect/clip.hpp>
 
 #include <wt/integrator/common.hpp>
 #include <wt/integrator/integrator_context.hpp>
@@ -50,20 +52,98 @@
 namespace wt::integrator::plt_bdpt {
 
 
-struct vertex_pdfs_t {
-    area_density_t pdf, pdf_rev;
-    bool delta;
+/**
+ * @brief Sampling densities of the vertices of a subpath, as structure of arrays: area densities (in 1/m²) of sampling each vertex in the subpath's transport direction (``pdf``) and in the reverse direction (``pdf_rev``), and delta flags.
+ */
+struct subpath_pdfs_t {
+    std::vector<f_t> pdf, pdf_rev;
+    std::vector<std::uint8_t> delta;
+
+    inline void resize(std::size_t n) {
+        pdf.resize(n);
+        pdf_rev.resize(n);
+        delta.resize(n);
+    }
+
+    /**
+     * @brief Fills from the subpath's vertices.
+     */
+    inline void assign(const std::vector<vertex_t>& vertices, transport_e transport) {
+        const auto n = vertices.size();
+        resize(n);
+        for (std::size_t i=0; i<n; ++i) {
+            const auto& v = vertices[i];
+            pdf[i]     = u::to_inv_m2(transport==transport_e::forward ? v.pdf_fwd : v.pdf_bwd);
+            pdf_rev[i] = u::to_inv_m2(transport==transport_e::forward ? v.pdf_bwd : v.pdf_fwd);
+            delta[i]   = v.delta;
+        }
+    }
+
+    /**
+     * @brief Copies the first ``n`` vertices of ``o``.
+     */
+    inline void assign_prefix(const subpath_pdfs_t& o, std::size_t n) {
+        assert(n<=o.pdf.size());
+        resize(n);
+        std::copy_n(o.pdf.begin(), n, pdf.begin());
+        std::copy_n(o.pdf_rev.begin(), n, pdf_rev.begin());
+        std::copy_n(o.delta.begin(), n, delta.begin());
+    }
 };
 
-using fraunhofer_fsd_bsdfs_arena_t = std::vector<std::unique_ptr<fraunhofer::free_space_diffraction_t>>;
 struct arena_t {
     std::vector<vertex_t> sensor_vertices;
     std::vector<vertex_t> emitter_vertices;
-    std::vector<vertex_pdfs_t> sensor_pdfs;
-    std::vector<vertex_pdfs_t> emitter_pdfs;
 
-    // used for free-space diffractions
-    fraunhofer_fsd_bsdfs_arena_t fraunhofer_fsd_bsdfs;
+    // sampling densities of the subpaths' vertices, filled once per subpath
+    subpath_pdfs_t sensor_pdfs;
+    subpath_pdfs_t emitter_pdfs;
+
+    // light-subpath reuse: emitter subpaths (and their sampling densities) shared by the sensor subpaths of a pass
+    std::vector<std::vector<vertex_t>> emitter_subpaths_pool;
+    std::vector<subpath_pdfs_t> emitter_pdfs_pool;
+    // per connection strategy copies, with the densities of the connected vertices updated
+    subpath_pdfs_t sensor_mis_pdfs;
+    subpath_pdfs_t emitter_mis_pdfs;
+    // MIS scratch
+    std::vector<f_t> mis_ratios;
+    std::vector<f_t> mis_mask;
+    std::vector<f_t> mis_counts;
+
+    // batched connections between inner vertices (see ``batch_connection_shadow_queries``)
+    struct connection_t {
+        // beam arriving to the emitter vertex, transformed towards the sensor vertex
+        spectral_radiant_flux_beam_t eb;
+        // beam arriving to the sensor vertex, transformed towards the emitter vertex
+        importance_flux_beam_t db;
+    };
+    std::vector<connection_t> connections;
+    // shadow queries of the batched connections
+    std::vector<ads::ads_t::shadow_query_t> connection_queries;
+    // per (s,t) pair: index into connections, or one of the following
+    static constexpr std::int32_t connection_not_batched = -1;
+    static constexpr std::int32_t connection_rejected = -2;
+    std::vector<std::int32_t> connection_query_idx;
+    std::unique_ptr<bool[]> connection_occluded;
+    std::size_t connection_occluded_capacity = 0;
+
+    /**
+     * @brief Index of the batched connection (s,t) into ``connections``, or ``connection_not_batched``, or ``connection_rejected`` when the batch found that the connection does not contribute.
+     */
+    [[nodiscard]] inline std::int32_t connection_idx_for(int s, int t) const noexcept {
+        const auto pair = (std::size_t)t*(emitter_vertices.size()+1) + (std::size_t)s;
+        if (pair>=connection_query_idx.size())
+            return connection_not_batched;
+        return connection_query_idx[pair];
+    }
+
+    /**
+     * @brief Swaps the ``j``-th pooled emitter subpath with the current emitter subpath (``emitter_vertices`` and ``emitter_pdfs``). Swapping again with the same index returns it to the pool.
+     */
+    inline void swap_pooled_emitter_subpath(std::size_t j) noexcept {
+        std::swap(emitter_vertices, emitter_subpaths_pool[j]);
+        std::swap(emitter_pdfs, emitter_pdfs_pool[j]);
+    }
 };
 
 
@@ -83,7 +163,8 @@ struct bdpt_walk_data_t {
 
     // path vertices
     std::vector<vertex_t>& vertices;
-    fraunhofer_fsd_bsdfs_arena_t* fraunhofer_fsd_bsdfs_arena;
+    // per-sample arena: free-space diffraction BSDFs are constructed in place
+    bump_arena_t* sample_arena;
     const fraunhofer::fsd_sampler::fsd_sampler_t* fraunhofer_fsd_sampler;
 
     // context (scene, sensor, accelerating data structure) and sampler
@@ -192,6 +273,8 @@ struct bdpt_walk_data_t {
 template <beam::Beam BeamType>
 inline bool sample_surface_interaction(bdpt_walk_data_t<BeamType>& data,
                                        const ads::tri_t& tri,
+                                       const dir3_t& tri_n,
+                                       const ads::proxy_tri_t* proxy,
                                        const barycentric_t& bary_centre,
                                        const shape_t* shape,
                                        const pqvec3_t& sampled_tri_wp,
@@ -200,9 +283,13 @@ inline bool sample_surface_interaction(bdpt_walk_data_t<BeamType>& data,
     const auto& bsdf = shape->get_bsdf();
 
     // intersection footprint between beam and surface
-    auto intersection = intersection_surface_t{ shape, tri.n,
-                                                tri.shape_tri_idx, 
-                                                bary_centre, sampled_tri_wp };
+    // (level-of-detail proxies are shaded with their aggregated normal)
+    assert(!tri.is_proxy() || proxy);
+    auto intersection = tri.is_proxy() ?
+        intersection_surface_t{ shape, *proxy, sampled_tri_wp } :
+        intersection_surface_t{ shape, tri_n,
+                                tri.shape_tri_idx, 
+                                bary_centre, sampled_tri_wp };
     // TODO: accurate footprint
     intersection.footprint = data.beam.surface_footprint_static(intersection, beam_dist);
     // BSDF query and intersection record
@@ -299,24 +386,22 @@ inline bool sample_fraunhofer_fsd_interaction(
 
     const auto k = data.beam.k();
 
-    // construct fsd bsdf
-    auto fsd_bsdf = std::make_unique<fraunhofer::free_space_diffraction_t>(
+    // construct fsd bsdf in the sample arena (released when the next sample begins)
+    const auto fsd_bsdf_ptr = data.sample_arena->template make<fraunhofer::free_space_diffraction_t>(
             data.ctx.ads,
             data.fraunhofer_fsd_sampler,
             data.beam.frame(), 
             k, aperture_power,
             data.beam.get_envelope(),
             edges, 
-            beam_wavefront);
-    const auto fsd_bsdf_ptr = fsd_bsdf.get();
+            beam_wavefront,
+            data.sample_arena);
     if (fsd_bsdf_ptr->empty()) {
         data.beam.transform_restart(interaction_wp, beam_dist);
         do_RR = false;
         return true;
     }
 
-    data.fraunhofer_fsd_bsdfs_arena->emplace_back(std::move(fsd_bsdf));
-
     // sample
     const auto fsd_sample = fsd_bsdf_ptr->sample(data.sampler);
     if (fsd_sample.dpd.density_or_zero()==zero || fsd_sample.weight==zero)
@@ -353,6 +438,10 @@ inline bool sample_fraunhofer_fsd_interaction(
 struct wavefront_intersection_t {
     // the primary triangle -- the triangle under the sampled interaction point
     const ads::tri_t* primary = nullptr;
+    // face normal of the primary triangle
+    dir3_t primary_n = dir3_t{ 0,0,1 };
+    // the level-of-detail proxy, when the primary triangle is a proxy (see ``ads::tri_t::is_proxy()``)
+    const ads::proxy_tri_t* primary_proxy = nullptr;
     // intersection record for primary
     intersect::intersect_ray_tri_ret_t primary_intersection_record = { .dist = limits<length_t>::infinity() };
 
@@ -371,7 +460,9 @@ inline auto find_closest_triangle(const ads::intersection_record_t::triangles_ac
     wavefront_intersection_t id;
 
     for (const auto& tuid : tris) {
-        const auto& tri = ads.tri(tuid);
+        // level-of-detail proxies are only returned by cone queries
+        const auto* proxy = ads.is_proxy(tuid) ? &ads.proxy(tuid) : nullptr;
+        const auto tri = proxy ? proxy->geometry : ads.tri_geometry(tuid);
 
         // numeric tolerance for tests when looking for triangle under sampled interaction point
         const auto fptol = intersect::cone_intersection_tolerance(origin, aabb_t::from_points(tri.a,tri.b,tri.c));
@@ -380,7 +471,9 @@ inline auto find_closest_triangle(const ads::intersection_record_t::triangles_ac
                                                        tri.a, tri.b, tri.c,
                                                        interaction_z_range.grow(fptol));
         if (intr && intr->dist<id.primary_intersection_record.dist) {
-            id.primary = &tri;
+            id.primary = proxy ? &proxy->tri : &ads.tri(tuid);
+            id.primary_n = tri.n;
+            id.primary_proxy = proxy;
             id.primary_intersection_record = *intr;
         }
     }
@@ -388,32 +481,20 @@ inline auto find_closest_triangle(const ads::intersection_record_t::triangles_ac
     if (!integrate_tris || id.primary)
         return id;
 
+    // clip each triangle to the interaction region, project upon cross section and integrate beam intensity over its footprint
+    auto footprint = beam::triangle_footprint_integrator_t{ beam_frame, envelope, beam_wavefront, interaction_z_range };
     for (const auto& tuid : tris) {
-        const auto& tri = ads.tri(tuid);
+        // proxies stand in for the triangles that cover part of their area
+        const auto* proxy = ads.is_proxy(tuid) ? &ads.proxy(tuid) : nullptr;
+        const auto tri = proxy ? proxy->geometry : ads.tri_geometry(tuid);
 
         const bool front_face = m::dot(tri.n,-beam_dir)>0;
         if (front_face != integrate_front_facing)
             continue;
 
-        // clip
-        const auto clipped_tris = intersect::clip_triangle_z(beam_frame.to_local(tri.a-envelope.o()),
-                                                            beam_frame.to_local(tri.b-envelope.o()),
-                                                            beam_frame.to_local(tri.c-envelope.o()),
-                                                            interaction_z_range);
-        [[assume(0<=clipped_tris.tris && clipped_tris.tris<=3)]];
-        // for each clipped triangle project upon cross section and integrate beam intensity and amplitude over triangle
-        const auto csz = interaction_z_range.centre();
-        for (int t=0;t<clipped_tris.tris;++t) {
-            const auto ctri = clipped_tris.triangle(t);
-            const auto pa = envelope.project_local(ctri[0], csz), 
-                       pb = envelope.project_local(ctri[1], csz), 
-                       pc = envelope.project_local(ctri[2], csz);
-
-            // TODO: this is slow and not very accurate
-            id.integrated_radiant_flux += beam_wavefront.integrate_triangle(pa, pb, pc);
-            assert(id.integrated_radiant_flux>=0);
-        }
+        footprint.add(tri, proxy ? proxy->coverage : f_t(1));
     }
+    id.integrated_radiant_flux = footprint.integrate();
 
     return id;
 }
@@ -426,7 +507,9 @@ inline void random_walk(bdpt_walk_data_t<BeamType>& data) noexcept {
         .force_ray_tracing = data.ctx.sensor->ray_trace_only(),
         .detect_edges = data.opts.FSD
     };
-    const auto intersection = traverse(*data.ctx.ads,
+    // scratch storage for this step's intersection records
+    auto scratch = data.ctx.acquire_ads_scratch();
+    const auto intersection = traverse(*data.ctx.ads, *scratch,
                                        beam.get_envelope(),
                                        data.vertices.back().geo,
                                        wavenum_to_wavelen(beam.k()),
@@ -467,6 +550,7 @@ inline void random_walk(bdpt_walk_data_t<BeamType>& data) noexcept {
         assert(intersection.record.has_raytracing_intersection_record());
 
         closest_triangle.primary = &data.ctx.ads->tri(*tris.begin());
+        closest_triangle.primary_n = data.ctx.ads->tri_geometry(*tris.begin()).n;
         closest_triangle.primary_intersection_record = intersection.record.get_raytracing_intersection_record();
     }
     else {
@@ -497,7 +581,8 @@ inline void random_walk(bdpt_walk_data_t<BeamType>& data) noexcept {
         const auto& sampled_tri_wp = origin_wp + envelope.d() * closest_triangle.primary_intersection_record.dist;
 
         // sample surface interaction
-        if (!sample_surface_interaction(data, tri, closest_triangle.primary_intersection_record.bary, shape,  
+        if (!sample_surface_interaction(data, tri, closest_triangle.primary_n, closest_triangle.primary_proxy,
+                                        closest_triangle.primary_intersection_record.bary, shape,  
                                         sampled_tri_wp, beam_dist))
             return;
     } else if (!edges->empty()) {  // sampled free-space, do free-space diffraction
@@ -527,7 +612,7 @@ inline void random_walk(bdpt_walk_data_t<BeamType>& data) noexcept {
 
 inline void generate_sensor_subpath(
         std::vector<vertex_t>& vertices,
-        fraunhofer_fsd_bsdfs_arena_t* fsd_bsdfs_arena,
+        bump_arena_t* sample_arena,
         const fraunhofer::fsd_sampler::fsd_sampler_t* fsd_sampler,
         const plt_bdpt_t::options_t& opts,
         const sensor_sample_t& sensor_sample,
@@ -549,14 +634,14 @@ inline void generate_sensor_subpath(
         .ctx = ctx,
         .sampler = sampler,
     };
-    data.fraunhofer_fsd_bsdfs_arena = fsd_bsdfs_arena;
+    data.sample_arena = sample_arena;
     data.fraunhofer_fsd_sampler = fsd_sampler;
     random_walk(data);
 }
 
 inline void generate_emitter_subpath(
         std::vector<vertex_t>& vertices,
-        fraunhofer_fsd_bsdfs_arena_t* fsd_bsdfs_arena,
+        bump_arena_t* sample_arena,
         const fraunhofer::fsd_sampler::fsd_sampler_t* fsd_sampler,
         const plt_bdpt_t::options_t& opts,
         const emitter_beam_wavenumber_sample_t& em,
@@ -575,25 +660,99 @@ inline void generate_emitter_subpath(
         .ctx = ctx,
         .sampler = sampler,
     };
-    data.fraunhofer_fsd_bsdfs_arena = fsd_bsdfs_arena;
+    data.sample_arena = sample_arena;
     data.fraunhofer_fsd_sampler = fsd_sampler;
     random_walk(data);
 }
 
-inline void bdpt_populate_subpaths_pdfs(const std::vector<vertex_t>& vertices,
-                                        std::vector<vertex_pdfs_t>& pdfs,
-                                        std::size_t n,
-                                        transport_e transport) noexcept {
-    pdfs.resize(n);
-    for (int i=0; i<n; ++i) {
-        pdfs[i] = vertex_pdfs_t{ 
-            .pdf     = transport==transport_e::forward ? vertices[i].pdf_fwd : vertices[i].pdf_bwd,
-            .pdf_rev = transport==transport_e::forward ? vertices[i].pdf_bwd : vertices[i].pdf_fwd,
-            .delta   = vertices[i].delta,
+/**
+ * @brief Generates the pass' pool of ``count`` emitter subpaths, and populates their sampling densities (light-subpath reuse).
+ *        All subpaths share the sampled emitter and wavenumber ``ew``, and source independent beams from the emitter (drawn with ``source_sampler``).
+ */
+inline void generate_emitter_subpaths_pool(
+        arena_t* arena,
+        const std::size_t count,
+        bump_arena_t* sample_arena,
+        const fraunhofer::fsd_sampler::fsd_sampler_t* fsd_sampler,
+        const plt_bdpt_t::options_t& opts,
+        const emitter_wavenumber_sample_t& ew,
+        const integrator_context_t& ctx,
+        sampler::sampler_t& source_sampler,
+        sampler::sampler_t& sampler) noexcept {
+    arena->emitter_subpaths_pool.resize(count);
+    arena->emitter_pdfs_pool.resize(count);
+
+    for (std::size_t j=0; j<count; ++j) {
+        const auto em = emitter_beam_wavenumber_sample_t{
+            .emitter = ew.emitter,
+            .emitter_pdf = ew.emitter_pdf,
+            .emitter_sample = ew.emitter->sample(source_sampler, ew.wavenumber.k),
+            .wavenumber = ew.wavenumber,
         };
+        assert(m::isfinite(em.emitter_sample.beam.intensity()));
+
+        auto& vertices = arena->emitter_subpaths_pool[j];
+        vertices.clear();
+        generate_emitter_subpath(vertices,
+                                 sample_arena, fsd_sampler,
+                                 opts, em,
+                                 ctx, sampler);
+        arena->emitter_pdfs_pool[j].assign(vertices, transport_e::forward);
     }
 }
 
+/**
+ * @brief Sums the ratios of the densities of the alternative strategies to the density of the current strategy over a subpath: ``sum_i prod_{j>=i} pdf_rev[j]/pdf[j]``, over vertices ``i`` such that neither ``i`` nor ``i-1`` is a delta vertex.
+ *        Ratios and masks are computed in passes over the arrays, that the compiler vectorizes; only the suffix product is sequential.
+ * @param delta_endpoint delta flag of the (virtual) vertex preceding vertex 0
+ * @param counts if not null, the ratio of the sample count of each alternative strategy to the sample count of the current strategy (scales the ``i``-th term)
+ */
+inline f_t bdpt_mis_sum_ratios(const subpath_pdfs_t& pdfs,
+                               const std::size_t n,
+                               const bool delta_endpoint,
+                               std::vector<f_t>& ratios,
+                               std::vector<f_t>& mask,
+                               const f_t* counts = nullptr) noexcept {
+    if (n==0)
+        return 0;
+
+    ratios.resize(n);
+    mask.resize(n);
+    const auto* pdf     = pdfs.pdf.data();
+    const auto* pdf_rev = pdfs.pdf_rev.data();
+    const auto* delta   = pdfs.delta.data();
+    auto* q = ratios.data();
+    auto* w = mask.data();
+
+    // degenerate densities are replaced by 1
+    const auto eps = u::to_inv_m2(limits<area_density_t>::epsilon());
+    const auto inf = limits<f_t>::infinity();
+    for (std::size_t i=0; i<n; ++i) {
+        assert(pdf[i]>=0 && pdf_rev[i]>=0);
+        const auto fwd = pdf[i]>eps && pdf[i]<inf ? pdf[i] : f_t(1);
+        const auto rev = pdf_rev[i]>eps && pdf_rev[i]<inf ? pdf_rev[i] : f_t(1);
+        q[i] = rev / fwd;
+    }
+
+    w[0] = !delta[0] && !delta_endpoint ? 1 : 0;
+    for (std::size_t i=1; i<n; ++i)
+        w[i] = !delta[i] && !delta[i-1] ? 1 : 0;
+    if (counts) {
+        for (std::size_t i=0; i<n; ++i)
+            w[i] *= counts[i];
+    }
+
+    f_t sum_Ri = 0;
+    f_t ri = 1;
+    for (auto i=(std::ptrdiff_t)n-1; i>=0; --i) {
+        ri *= q[i];
+        assert(!m::isnan(ri));
+        sum_Ri += w[i]>0 ? w[i]*ri : 0;
+    }
+
+    return sum_Ri;
+}
+
 struct bdpt_connect_ret_t {
     vertex_t temporary_vert;    // used for direct sampling strategies, as well as connections to virtual sensors.
     std::optional<sensor::sensor_element_sample_t> sensor_element_sample;
@@ -601,11 +760,16 @@ struct bdpt_connect_ret_t {
     spectral_radiant_flux_stokes_t L{};
 };
 
+/**
+ * @brief Balance-heuristic MIS weight of the connection strategy (s,t).
+ * @param light_subpaths count of emitter subpaths that each sensor subpath connects to (light-subpath reuse): strategies that connect inner vertices of both subpaths (s>1, t>1) are sampled that many times per sensor subpath, all other strategies once.
+ */
 inline f_t bdpt_compute_mis_weight(arena_t* arena,
                                    const integrator_context_t& ctx,
                                    const plt_bdpt_t::options_t& opts,
                                    const int s, const int t,
-                                   const bdpt_connect_ret_t& connect_ret) noexcept {
+                                   const bdpt_connect_ret_t& connect_ret,
+                                   const std::size_t light_subpaths = 1) noexcept {
     if (s+t<=2)
         return 1;
 
@@ -614,10 +778,10 @@ inline f_t bdpt_compute_mis_weight(arena_t* arena,
 
     const auto& sensor_verts  = arena->sensor_vertices;
     const auto& emitter_verts = arena->emitter_vertices;
-    bdpt_populate_subpaths_pdfs(sensor_verts,  arena->sensor_pdfs,  t, bsdf::transport_e::backward);
-    bdpt_populate_subpaths_pdfs(emitter_verts, arena->emitter_pdfs, s, bsdf::transport_e::forward);
-    auto* snsr_pdfs = arena->sensor_pdfs.data();
-    auto* emtr_pdfs = arena->emitter_pdfs.data();
+    auto& snsr_pdfs = arena->sensor_mis_pdfs;
+    auto& emtr_pdfs = arena->emitter_mis_pdfs;
+    snsr_pdfs.assign_prefix(arena->sensor_pdfs,  t);
+    emtr_pdfs.assign_prefix(arena->emitter_pdfs, s);
 
     const auto& temporary_vert = connect_ret.temporary_vert;
 
@@ -629,8 +793,8 @@ inline f_t bdpt_compute_mis_weight(arena_t* arena,
         const auto& prev = sensor_verts[t-2];
 
         assert(last.is_on_surface() && last.on_emitter());
-        snsr_pdfs[t-1].pdf_rev = last.pdf_emitter(*ctx.scene, *ctx.sensor);
-        snsr_pdfs[t-2].pdf_rev = last.pdf_next_from_emitter(prev);
+        snsr_pdfs.pdf_rev[t-1] = u::to_inv_m2(last.pdf_emitter(*ctx.scene, *ctx.sensor));
+        snsr_pdfs.pdf_rev[t-2] = u::to_inv_m2(last.pdf_next_from_emitter(prev));
     }
     else if (t==0) {
         // forward only path
@@ -642,81 +806,74 @@ inline f_t bdpt_compute_mis_weight(arena_t* arena,
         const auto& prev = emitter_verts[s-2];
 
         assert(last.on_sensor());
-        emtr_pdfs[s-1].pdf_rev = last.pdf_sensor();
-        emtr_pdfs[s-2].pdf_rev = last.pdf_next_from_sensor(prev);
+        emtr_pdfs.pdf_rev[s-1] = u::to_inv_m2(last.pdf_sensor());
+        emtr_pdfs.pdf_rev[s-2] = u::to_inv_m2(last.pdf_next_from_sensor(prev));
     }
     else if (s==1) {
         // direct connection to an emitter
         const auto& last = sensor_verts[t-1];
 
-        snsr_pdfs[t-1].pdf_rev = temporary_vert.pdf_next_from_emitter(last);
+        snsr_pdfs.pdf_rev[t-1] = u::to_inv_m2(temporary_vert.pdf_next_from_emitter(last));
         // sampling PDF of direct connection to emitter
-        emtr_pdfs[0].pdf_rev   = last.pdf(&sensor_verts[t-2], temporary_vert, transport_e::backward);
+        emtr_pdfs.pdf_rev[0]   = u::to_inv_m2(last.pdf(&sensor_verts[t-2], temporary_vert, transport_e::backward));
         // probability of forward sampling this emitter and position
-        emtr_pdfs[0].pdf       = temporary_vert.pdf_emitter(*ctx.scene, *ctx.sensor);
+        emtr_pdfs.pdf[0]       = u::to_inv_m2(temporary_vert.pdf_emitter(*ctx.scene, *ctx.sensor));
     }
     else if (t==1) {
         // direct connection to the sensor
         const auto& last = emitter_verts[s-1];
 
-        emtr_pdfs[s-1].pdf_rev = temporary_vert.pdf_next_from_sensor(last);
+        emtr_pdfs.pdf_rev[s-1] = u::to_inv_m2(temporary_vert.pdf_next_from_sensor(last));
         // sampling PDF of direct connection to sensor
-        snsr_pdfs[0].pdf_rev   = last.pdf(&emitter_verts[s-2], temporary_vert, transport_e::forward);
+        snsr_pdfs.pdf_rev[0]   = u::to_inv_m2(last.pdf(&emitter_verts[s-2], temporary_vert, transport_e::forward));
         // probability of backward sampling this sensor and position
-        snsr_pdfs[0].pdf       = temporary_vert.pdf_sensor();
+        snsr_pdfs.pdf[0]       = u::to_inv_m2(temporary_vert.pdf_sensor());
     }
     else {
-        const auto& ev = emitter_verts[s-1];      auto& ev_pdfs = emtr_pdfs[s-1];
-        const auto& sv = sensor_verts[t-1];       auto& sv_pdfs = snsr_pdfs[t-1];
-        const auto& ev_prev = emitter_verts[s-2]; auto& ev_prev_pdfs = emtr_pdfs[s-2];
-        const auto& sv_prev = sensor_verts[t-2];  auto& sv_prev_pdfs = snsr_pdfs[t-2];
+        const auto& ev = emitter_verts[s-1];
+        const auto& sv = sensor_verts[t-1];
+        const auto& ev_prev = emitter_verts[s-2];
+        const auto& sv_prev = sensor_verts[t-2];
 
-        ev_pdfs.pdf_rev      = sv.pdf(&sv_prev, ev, transport_e::backward);
-        ev_prev_pdfs.pdf_rev = ev.pdf(&sv, ev_prev, transport_e::backward);
-        sv_pdfs.pdf_rev      = ev.pdf(&ev_prev, sv, transport_e::forward);
-        sv_prev_pdfs.pdf_rev = sv.pdf(&ev, sv_prev, transport_e::forward);
+        emtr_pdfs.pdf_rev[s-1] = u::to_inv_m2(sv.pdf(&sv_prev, ev, transport_e::backward));
+        emtr_pdfs.pdf_rev[s-2] = u::to_inv_m2(ev.pdf(&sv, ev_prev, transport_e::backward));
+        snsr_pdfs.pdf_rev[t-1] = u::to_inv_m2(ev.pdf(&ev_prev, sv, transport_e::forward));
+        snsr_pdfs.pdf_rev[t-2] = u::to_inv_m2(sv.pdf(&ev, sv_prev, transport_e::forward));
     }
     // update delta flags for connected vertices
-    if (t>0) snsr_pdfs[t-1].delta = false;
-    if (s>0) emtr_pdfs[s-1].delta = false;
+    if (t>0) snsr_pdfs.delta[t-1] = false;
+    if (s>0) emtr_pdfs.delta[s-1] = false;
 
     const bool delta_emitter =
         s==1 ? temporary_vert.is_delta_emitter() : s>1 ? emitter_verts[0].is_delta_emitter() : true;
     const bool delta_sensor =
         t==1 ? temporary_vert.is_delta_sensor() :  t>1 ? sensor_verts[0].is_delta_sensor() : true;
 
-    constexpr auto area_density_or_one = [](auto p) { 
-        assert(p>=zero);
-        return m::isfinite(p) && p>limits<area_density_t>::epsilon() ? 
-               p : area_density_t{ 1 / square(u::m) };
-    };
-
-    f_t sum_Ri = 0;
-    f_t ri = 1;
-    for (int i=t-1; i>=0; --i) {
-        const auto fwd = area_density_or_one(snsr_pdfs[i].pdf);
-        const auto rev = area_density_or_one(snsr_pdfs[i].pdf_rev);
-        ri *= f_t(rev / fwd);
-        assert(rev>zero && fwd>zero && !m::isnan(ri));
-
-        if (!snsr_pdfs[i].delta && 
-            !(i>0 ? snsr_pdfs[i-1].delta : delta_sensor))
-            sum_Ri += ri;
-    }
-
-    ri = 1;
-    for (int i=s-1; i>=0; --i) {
-        const auto fwd = area_density_or_one(emtr_pdfs[i].pdf);
-        const auto rev = area_density_or_one(emtr_pdfs[i].pdf_rev);
-        ri *= f_t(rev / fwd);
-        assert(rev>zero && fwd>zero && !m::isnan(ri));
-
-        if (!emtr_pdfs[i].delta && 
-            !(i>0 ? emtr_pdfs[i-1].delta : delta_emitter))
-            sum_Ri += ri;
+    if (light_subpaths<=1) {
+        const auto sum_Ri =
+            bdpt_mis_sum_ratios(snsr_pdfs, t, delta_sensor,  arena->mis_ratios, arena->mis_mask) +
+            bdpt_mis_sum_ratios(emtr_pdfs, s, delta_emitter, arena->mis_ratios, arena->mis_mask);
+        return 1/(1 + sum_Ri);
     }
 
-    return 1/(1 + sum_Ri);
+    // relative sample counts of the alternative strategies: the i-th term of the sensor (emitter) subpath sum is the strategy with i sensor (emitter) vertices
+    const auto strategy_count = [&](int ss, int tt) -> f_t {
+        return ss>1 && tt>1 ? f_t(light_subpaths) : f_t(1);
+    };
+    const auto recp_count = 1/strategy_count(s,t);
+    auto& counts = arena->mis_counts;
+    counts.resize(std::max(s,t));
+
+    for (int i=0; i<t; ++i)
+        counts[i] = strategy_count(s+t-i, i) * recp_count;
+    const auto sum_Ri_sensor =
+        bdpt_mis_sum_ratios(snsr_pdfs, t, delta_sensor,  arena->mis_ratios, arena->mis_mask, counts.data());
+    for (int i=0; i<s; ++i)
+        counts[i] = strategy_count(i, s+t-i) * recp_count;
+    const auto sum_Ri_emitter =
+        bdpt_mis_sum_ratios(emtr_pdfs, s, delta_emitter, arena->mis_ratios, arena->mis_mask, counts.data());
+
+    return 1/(1 + sum_Ri_sensor + sum_Ri_emitter);
 }
 
 /**
@@ -727,7 +884,8 @@ inline spectral_radiant_flux_stokes_t connect_and_integrate(
         const beam::Beam auto& db,
         const vertex_geo_variant_t& dintrs,
         const beam::Beam auto& eb,
-        const vertex_geo_variant_t& eintrs) noexcept {
+        const vertex_geo_variant_t& eintrs,
+        const std::optional<bool> occluded = std::nullopt) noexcept {
     assert(eb.isfinite() && 
            db.isfinite() && 
            eb.intensity()>=zero && 
@@ -737,13 +895,68 @@ inline spectral_radiant_flux_stokes_t connect_and_integrate(
     if (db.intensity()==zero || eb.intensity()==zero)
         return {};
 
-    // do a ray shadow query first
-    if (shadow(ads, dintrs, eintrs))
+    // do a ray shadow query first, unless it was done already in a batch
+    if (occluded ? *occluded : shadow(ads, dintrs, eintrs))
         return {};
 
     return beam::integrate_beams(db, eb);
 }
 
+/**
+ * @brief Issues the shadow queries of all connections between inner vertices (s>1, t>1) of the subpaths as a single batch. Results, and the connected beams, are read by ``connect_subpaths`` via ``arena_t::connection_idx_for``.
+ *        Connections that ``connect_subpaths`` would reject (no beam towards the other vertex, or a zero beam) are not queried. The ADS reorders the queries for coherent traversal (see ``ads_t::shadow``).
+ */
+inline void batch_connection_shadow_queries(arena_t* arena,
+                                            const integrator_context_t& ctx,
+                                            const plt_bdpt_t::options_t& opts) noexcept {
+    const auto& sensor_verts  = arena->sensor_vertices;
+    const auto& emitter_verts = arena->emitter_vertices;
+
+    const auto pairs = (sensor_verts.size()+1)*(emitter_verts.size()+1);
+    arena->connections.clear();
+    arena->connection_queries.clear();
+    arena->connection_query_idx.assign(pairs, arena_t::connection_not_batched);
+
+    for (int t=2; t<=sensor_verts.size(); ++t)
+    for (int s=2; s<=emitter_verts.size(); ++s) {
+        if (t+s-2>opts.max_depth) break;
+
+        const auto& ev = emitter_verts[s-1];
+        const auto& sv = sensor_verts[t-1];
+        if (sv.is_infinite() || ev.is_infinite() ||
+            !ev.is_connectible() || !sv.is_connectible())
+            continue;
+        const auto dl = ev.wp() - sv.wp();
+        if (dl==dl.zero())
+            continue;
+
+        const auto pair = (std::size_t)t*(emitter_verts.size()+1) + (std::size_t)s;
+
+        // beams arriving to ev (sv) transformed towards sv (ev): connections without a (non-zero) beam are not queried
+        auto eb = ev.interact<spectral_radiant_flux_beam_t>(*ctx.ads, sensor_verts[t-2], sv, true);
+        auto db = sv.interact<importance_flux_beam_t>(*ctx.ads, emitter_verts[s-2], ev, true);
+        if (!eb || !db || eb->intensity()==zero || db->intensity()==zero) {
+            arena->connection_query_idx[pair] = arena_t::connection_rejected;
+            continue;
+        }
+
+        arena->connection_query_idx[pair] = (std::int32_t)arena->connections.size();
+        arena->connections.emplace_back(arena_t::connection_t{ .eb = std::move(*eb), .db = std::move(*db) });
+        arena->connection_queries.emplace_back(shadow_query(sv.geo, ev.geo));
+    }
+
+    const auto count = arena->connection_queries.size();
+    if (count==0)
+        return;
+    if (arena->connection_occluded_capacity<count) {
+        arena->connection_occluded = std::make_unique<bool[]>(count);
+        arena->connection_occluded_capacity = count;
+    }
+
+    ctx.ads->shadow(arena->connection_queries,
+                    std::span<bool>{ arena->connection_occluded.get(), count });
+}
+
 inline bdpt_connect_ret_t connect_subpaths(const arena_t* arena,
                                            const integrator_context_t& ctx,
                                            const plt_bdpt_t::options_t& opts,
@@ -892,9 +1105,20 @@ inline bdpt_connect_ret_t connect_subpaths(const arena_t* arena,
         const auto& sv = sensor_verts[t-1];
         const auto dl = ev.wp() - sv.wp();
 
-        if (ev.is_connectible() && sv.is_connectible() && dl!=dl.zero()) {
-            const auto& eb = ev.interact<spectral_radiant_flux_beam_t>(*ctx.ads, spv, sv, true);  // beam arriving to ev transformed towards sv
-            const auto& db = sv.interact<importance_flux_beam_t>(*ctx.ads, epv, ev, true);        // beam arriving to sv transformed towards ev
+        // connections are batched, unless the batch was skipped
+        const auto cidx = arena->connection_idx_for(s,t);
+        const bool batched = cidx>=0;
+
+        if (ev.is_connectible() && sv.is_connectible() && dl!=dl.zero() &&
+            cidx!=arena_t::connection_rejected) {
+            std::optional<spectral_radiant_flux_beam_t> eb_unbatched;
+            std::optional<importance_flux_beam_t> db_unbatched;
+            if (!batched) {
+                eb_unbatched = ev.interact<spectral_radiant_flux_beam_t>(*ctx.ads, spv, sv, true);  // beam arriving to ev transformed towards sv
+                db_unbatched = sv.interact<importance_flux_beam_t>(*ctx.ads, epv, ev, true);        // beam arriving to sv transformed towards ev
+            }
+            const auto* eb = batched ? &arena->connections[cidx].eb : eb_unbatched ? &*eb_unbatched : nullptr;
+            const auto* db = batched ? &arena->connections[cidx].db : db_unbatched ? &*db_unbatched : nullptr;
 
             if (eb && db) {
                 const auto recp_d2 = 1 / (area_t)m::length2(dl);
@@ -909,7 +1133,8 @@ inline bdpt_connect_ret_t connect_subpaths(const arena_t* arena,
 
                 ret.L = connect_and_integrate(*ctx.ads,
                                               (importance_beam_t)(*db * wsv), sv.geo,
-                                              *eb * wev, ev.geo);
+                                              *eb * wev, ev.geo,
+                                              batched ? std::optional<bool>{ arena->connection_occluded[cidx] } : std::nullopt);
             }
         }
     }
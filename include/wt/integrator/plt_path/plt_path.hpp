@@ -22,6 +22,7 @@ namespace wt::integrator {
 /**
  * @brief PLT uni-directional path tracer.
  *        Supports tracing either from a sensor or an emitter.
+ *        In wavefront mode, paths are traced in waves over a whole sensor block (see ``plt_path_wavefront.hpp``).
  */
 class plt_path_t final : public integrator_t {
 public:
@@ -31,6 +32,10 @@ public:
         bool RR = true;
         bool FSD = true;
 
+        // wavefront mode: each worker advances waves of paths stage by stage, over all elements of a block
+        bool wavefront = false;
+        std::uint32_t wavefront_size = 4096;
+
         bsdf::transport_e transport_direction;
     };
 
@@ -53,6 +58,9 @@ public:
                    const sensor::block_handle_t& block,
                    const vec3u32_t& sensor_element,
                    std::uint32_t samples_per_element) const noexcept override;
+    void integrate_block(const integrator_context_t& ctx,
+                         const sensor::block_handle_t& block,
+                         std::uint32_t samples_per_element) const noexcept override;
 
     [[nodiscard]] scene::element::info_t description() const override;
 
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include <wt/integrator/integrator_context.hpp>
 #include <wt/integrator/plt_path/plt_path.hpp>
 #include <wt/integrator/traversal.hpp>
@@ -47,8 +49,8 @@ struct path_walk_data_t {
     // directional pdf and measure from previous interaction (for MIS)
     solid_angle_sampling_pd_t from_previous_dpd = solid_angle_sampling_pd_t::discrete(0);
 
-    // fsd BSDF for last interaction
-    std::unique_ptr<free_space_diffraction_t> fsd_bsdf;
+    // fsd BSDF for last interaction (constructed in the sample arena)
+    const free_space_diffraction_t* fsd_bsdf = nullptr;
 
     // for RR
     f_t throughput = 1;
@@ -115,8 +117,8 @@ struct path_walk_data_t {
         throughput *= weight;
     }
 
-    inline void set_fsd_bsdf(std::unique_ptr<free_space_diffraction_t> fsd_bsdf_ptr) noexcept {
-        fsd_bsdf = std::move(fsd_bsdf_ptr);
+    inline void set_fsd_bsdf(const free_space_diffraction_t* fsd_bsdf_ptr) noexcept {
+        fsd_bsdf = fsd_bsdf_ptr;
     }
 
     // walk step (do RR if requested)
@@ -244,6 +246,10 @@ inline bool sample_fsd_interaction(
 struct wavefront_intersection_t {
     // the primary triangle -- the triangle under the sampled interaction point
     const ads::tri_t* primary = nullptr;
+    // face normal of the primary triangle
+    dir3_t primary_n = dir3_t{ 0,0,1 };
+    // the level-of-detail proxy, when the primary triangle is a proxy (see ``ads::tri_t::is_proxy()``)
+    const ads::proxy_tri_t* primary_proxy = nullptr;
     std::optional<intersection_surface_t> intersection;
 
     // intersection record for primary
@@ -258,7 +264,9 @@ inline auto find_closest_triangle(const ads::intersection_record_t::triangles_ac
     wavefront_intersection_t id;
 
     for (const auto& tuid : tris) {
-        const auto& tri = ads.tri(tuid);
+        // level-of-detail proxies are only returned by cone queries
+        const auto* proxy = ads.is_proxy(tuid) ? &ads.proxy(tuid) : nullptr;
+        const auto tri = proxy ? proxy->geometry : ads.tri_geometry(tuid);
 
         // numeric tolerance for tests when looking for triangle under sampled interaction point
         const auto fptol = intersect::cone_intersection_tolerance(origin, aabb_t::from_points(tri.a,tri.b,tri.c));
@@ -267,7 +275,9 @@ inline auto find_closest_triangle(const ads::intersection_record_t::triangles_ac
                                                        tri.a, tri.b, tri.c,
                                                        interaction_z_range.grow(fptol));
         if (intr && intr->dist<id.primary_intersection_record.dist) {
-            id.primary = &tri;
+            id.primary = proxy ? &proxy->tri : &ads.tri(tuid);
+            id.primary_n = tri.n;
+            id.primary_proxy = proxy;
             id.primary_intersection_record = *intr;
         }
     }
@@ -321,7 +331,7 @@ inline auto do_fsd(const ads::ads_t& ads,
     c_t ts = {}, th = {};
     for (const auto& f : fsd) {
         const auto &e = ads.edge(f.edge_idx);
-        const auto eintr = intersection_edge_t{ e, f.p };
+        const auto eintr = intersection_edge_t{ ads, e, f.p };
         if (shadow(ads, eintr, src_geo) ||
             shadow(ads, eintr, dst_geo))
             continue;
@@ -345,82 +355,127 @@ inline auto do_fsd(const ads::ads_t& ads,
     return std::make_pair(ts,th);
 }
 
-// next-event estimation (backward transport)
+// a sampled next-event estimation connection (backward transport), pending its shadow query
+struct nee_backward_sample_t {
+    emitter_direct_sample_t direct_sample;
+    dir3_t woworld;
+    dir3_t wi, wo;
+    bsdf::bsdf_result_t f;
+
+    ads::ads_t::shadow_query_t shadow;
+};
+
+// samples a next-event estimation connection (backward transport), without tracing its shadow query. Returns nothing when no connection is made.
 template <beam::Beam BeamType>
-inline spectral_radiant_flux_stokes_t nee_backward(
+inline std::optional<nee_backward_sample_t> nee_backward_sample(
         path_walk_data_t<BeamType>& data,
-        const wavefront_intersection_t& wf_intersection,
-        const int depth) noexcept {
+        const wavefront_intersection_t& wf_intersection) noexcept {
     auto& beam = data.beam;
     const auto& k = beam.k();
 
     // NEE from surface
-    if (wf_intersection.intersection) {
-        const auto& intersection = *wf_intersection.intersection;
-        const auto& bsdf = intersection.shape->get_bsdf();
-        // ignore delta BSDFs
-        if (bsdf.is_delta_only(k))
-            return {};
-
-        // sample a direct connection
-        const auto direct_sample =
-            data.ctx.scene->sample_emitter_direct(data.sampler, data.ctx.sensor, intersection.wp, k);
-        const auto sampled_emitter_pm = direct_sample.emitter_pdf;
-        assert(sampled_emitter_pm>0);
-        if (direct_sample.beam.intensity()==zero)
-            return {};
-
-        const auto wiworld = -beam.dir();
-        const auto woworld = -direct_sample.beam.dir();
-        const auto& ng = intersection.ng();
-        const auto wi  = intersection.shading.to_local(wiworld);
-        const auto wo  = intersection.shading.to_local(woworld);
-        const auto wig = m::dot(wiworld, ng);
-        const auto wog = m::dot(woworld, ng);
-        if (wi.z*wig<=0 || wo.z*wog<=0)
-            return {};
-
-        // eval BSDF
+    if (!wf_intersection.intersection)
+        return std::nullopt;
+
+    const auto& intersection = *wf_intersection.intersection;
+    const auto& bsdf = intersection.shape->get_bsdf();
+    // ignore delta BSDFs
+    if (bsdf.is_delta_only(k))
+        return std::nullopt;
+
+    // sample a direct connection
+    auto direct_sample =
+        data.ctx.scene->sample_emitter_direct(data.sampler, data.ctx.sensor, intersection.wp, k);
+    assert(direct_sample.emitter_pdf>0);
+    if (direct_sample.beam.intensity()==zero)
+        return std::nullopt;
+
+    const auto wiworld = -beam.dir();
+    const auto woworld = -direct_sample.beam.dir();
+    const auto& ng = intersection.ng();
+    const auto wi  = intersection.shading.to_local(wiworld);
+    const auto wo  = intersection.shading.to_local(woworld);
+    const auto wig = m::dot(wiworld, ng);
+    const auto wog = m::dot(woworld, ng);
+    if (wi.z*wig<=0 || wo.z*wog<=0)
+        return std::nullopt;
+
+    // eval BSDF
+    const auto bsdf_query = bsdf::bsdf_query_t{ 
+        .intersection = intersection,
+        .k = k,
+        .transport = BeamType::transport,
+    };
+    auto f = bsdf.f(wi, wo, bsdf_query);
+    if (f.mean_intensity()==zero)
+        return std::nullopt;
+
+    // shadow
+    // TODO: proper conic shadow queries
+    const auto emitter_geo = direct_sample.surface ? 
+        vertex_geo_variant_t{ *direct_sample.surface } : vertex_geo_variant_t{ direct_sample.beam.origin() };
+    const auto shadow = shadow_query(intersection, emitter_geo);
+
+    return nee_backward_sample_t{
+        .direct_sample = std::move(direct_sample),
+        .woworld = woworld,
+        .wi = wi,
+        .wo = wo,
+        .f = std::move(f),
+        .shadow = shadow,
+    };
+}
+
+// completes an unoccluded next-event estimation connection (backward transport)
+template <beam::Beam BeamType>
+inline spectral_radiant_flux_stokes_t nee_backward_connect(
+        path_walk_data_t<BeamType>& data,
+        const wavefront_intersection_t& wf_intersection,
+        const nee_backward_sample_t& sample,
+        const int depth) noexcept {
+    const auto& beam = data.beam;
+    const auto& intersection = *wf_intersection.intersection;
+    const auto& bsdf = intersection.shape->get_bsdf();
+    const auto& direct_sample = sample.direct_sample;
+
+    // transform beam
+    auto nee_beam = beam;
+    nee_beam.transform_surface_interaction(intersection, sample.woworld, sample.f, 1);
+
+    const auto sL = beam::integrate_beams(nee_beam, direct_sample.beam);
+    assert(sL.intensity()>=zero);
+
+    // MIS
+    f_t mis = 1;
+    const auto& pd_nee = direct_sample.dpd;
+    if (!pd_nee.is_discrete()) {
         const auto bsdf_query = bsdf::bsdf_query_t{ 
             .intersection = intersection,
-            .k = k,
+            .k = beam.k(),
             .transport = BeamType::transport,
         };
-        const auto f = bsdf.f(wi, wo, bsdf_query);
-        if (f.mean_intensity()==zero)
-            return {};
-
-        // shadow
-        // TODO: proper conic shadow queries
-        const auto emitter_geo = direct_sample.surface ? 
-            vertex_geo_variant_t{ *direct_sample.surface } : vertex_geo_variant_t{ direct_sample.beam.origin() };
-        if (shadow(*data.ctx.ads, intersection, emitter_geo))
-            return {};
-
-        // transform beam
-        auto nee_beam = beam;
-        nee_beam.transform_surface_interaction(intersection, woworld, f, 1);
-
-        const auto sL = beam::integrate_beams(nee_beam, direct_sample.beam);
-        assert(sL.intensity()>=zero);
-
-        // MIS
-        f_t mis = 1;
-        const auto& pd_nee = direct_sample.dpd;
-        if (!pd_nee.is_discrete()) {
-            const auto pd_brdf = bsdf.pdf(wi, wo, bsdf_query);
-            const auto pd_direct = pd_nee.density() * sampled_emitter_pm;
-            mis = MIS(pd_direct, pd_brdf);
-        }
-        assert(mis>zero);
+        const auto pd_brdf = bsdf.pdf(sample.wi, sample.wo, bsdf_query);
+        const auto pd_direct = pd_nee.density() * direct_sample.emitter_pdf;
+        mis = MIS(pd_direct, pd_brdf);
+    }
+    assert(mis>zero);
 
-        // update stats
-        stats::record_connected_path(depth);
+    // update stats
+    stats::record_connected_path(depth);
 
-        return sL * mis;
-    }
+    return sL * mis;
+}
 
-    return {};
+// next-event estimation (backward transport)
+template <beam::Beam BeamType>
+inline spectral_radiant_flux_stokes_t nee_backward(
+        path_walk_data_t<BeamType>& data,
+        const wavefront_intersection_t& wf_intersection,
+        const int depth) noexcept {
+    const auto sample = nee_backward_sample(data, wf_intersection);
+    if (!sample || data.ctx.ads->shadow(sample->shadow.ray, sample->shadow.range))
+        return {};
+    return nee_backward_connect(data, wf_intersection, *sample, depth);
 }
 
 // handle emissive surfaces (backward transport only)
@@ -539,36 +594,107 @@ inline void sensing(
     }
 }
 
-template <beam::Beam BeamType>
-inline spectral_radiant_flux_stokes_t random_walk(
-        path_walk_data_t<BeamType>& data,
-        const QuantityOf<inverse(isq::length)> auto& recp_spectral_pd,
-        const int depth=1) noexcept {
-    spectral_radiant_flux_stokes_t L = {};
+/**
+ * @brief A single step of a random walk: the beam's traversal result and its interaction region.
+ *        The intersection record references storage in ``scratch``, which is held until the step is released, or until ``release_scratch()`` is called.
+ */
+struct walk_step_t {
+    ads::intersection_scratch_pool_t::handle_t scratch;
+    traversal_result_t intersection;
 
-    //
-    // trace and intersect beam
+    // ballistic propagation?
+    bool is_ballistic;
+    // beam travel distance to first intersection
+    length_t dist_to_interaction;
+    // beam source world position
+    pqvec3_t origin_wp;
+    // world position of (centre of) interaction region start
+    pqvec3_t interaction_wp;
 
-    auto& beam = data.beam;
-    const auto traversal_opts = traversal_opts_t{
+    // the triangle under the interaction point, if any, and the surface intersection
+    wavefront_intersection_t wf_intersection = {};
+    // distance to interaction region end, or triangle intersection
+    length_t interaction_region_end = 0*u::m;
+
+    /**
+     * @brief Returns the intersection scratch to its pool, and clears the intersection record that references it.
+     *        Once the step was intersected (see ``walk_intersect()``), connections and interactions only use the step's interaction data, and the scratch is no longer needed.
+     */
+    inline void release_scratch() noexcept {
+        intersection.record = {};
+        scratch.release();
+    }
+};
+
+template <beam::Beam BeamType>
+inline auto walk_traversal_opts(const path_walk_data_t<BeamType>& data) noexcept {
+    return traversal_opts_t{
         .force_ray_tracing = data.ctx.sensor->ray_trace_only(),
         .detect_edges = data.opts.FSD
     };
-    const auto intersection = traverse(*data.ctx.ads,
-                                       beam.get_envelope(),
-                                       data.prev_vert_geo,
-                                       wavenum_to_wavelen(beam.k()),
-                                       traversal_opts);
+}
+
+// the ray query of the beam's traversal, when the beam is traversed in pure ray tracing mode (see ``ray_traversal_query()``)
+template <beam::Beam BeamType>
+inline auto walk_ray_query(const path_walk_data_t<BeamType>& data) noexcept {
+    return ray_traversal_query(data.beam.get_envelope(),
+                               data.prev_vert_geo,
+                               limits<length_t>::infinity(),
+                               walk_traversal_opts(data));
+}
+
+// constructs a walk step from the beam's traversal result
+template <beam::Beam BeamType>
+inline std::optional<walk_step_t> walk_step(const path_walk_data_t<BeamType>& data,
+                                            ads::intersection_scratch_pool_t::handle_t scratch,
+                                            traversal_result_t intersection) noexcept {
+    const auto& beam = data.beam;
     if (intersection.record.empty()) {
         // no intersection found
         // TODO: infinite emitters, and MIS with infinite emitters
-        return L;
+        return std::nullopt;
     }
 
-    // beam travel distance to first intersection
     const auto dist_to_interaction = intersection.record.distance();
-    // ballistic propagation?
     const bool is_ballistic = intersection.ballistic || beam.is_ray();
+    const auto origin_wp = intersection.origin;
+
+    return walk_step_t{
+        .scratch = std::move(scratch),
+        .intersection = std::move(intersection),
+        .is_ballistic = is_ballistic,
+        .dist_to_interaction = dist_to_interaction,
+        .origin_wp = origin_wp,
+        .interaction_wp = origin_wp + dist_to_interaction * beam.dir(),
+    };
+}
+
+// trace and intersect beam
+template <beam::Beam BeamType>
+inline std::optional<walk_step_t> walk_traverse(path_walk_data_t<BeamType>& data) noexcept {
+    const auto& beam = data.beam;
+    // scratch storage for this step's intersection records
+    auto scratch = data.ctx.acquire_ads_scratch();
+    auto intersection = traverse(*data.ctx.ads, *scratch,
+                                 beam.get_envelope(),
+                                 data.prev_vert_geo,
+                                 wavenum_to_wavelen(beam.k()),
+                                 walk_traversal_opts(data));
+    return walk_step(data, std::move(scratch), std::move(intersection));
+}
+
+// evaluates the fsd from the previous interaction, finds the surface intersection and constructs the fsd BSDF at the interaction region
+template <beam::Beam BeamType>
+inline void walk_intersect(path_walk_data_t<BeamType>& data,
+                           walk_step_t& step) noexcept {
+    auto& beam = data.beam;
+    const auto traversal_opts = walk_traversal_opts(data);
+
+    const auto& intersection = step.intersection;
+    const auto& dist_to_interaction = step.dist_to_interaction;
+    const auto& origin_wp = step.origin_wp;
+    const auto& interaction_wp = step.interaction_wp;
+    const bool is_ballistic = step.is_ballistic;
 
     const auto& beam_frame = beam.frame();
     const auto& envelope = beam.get_envelope();
@@ -579,11 +705,6 @@ inline spectral_radiant_flux_stokes_t random_walk(
     assert(!tris.empty());
     assert(!is_ballistic || (tris.size()==1 && edges->empty()));
 
-    // beam source world position
-    const auto origin_wp = intersection.origin;
-    // world position of (centre of) interaction region start
-    const auto interaction_wp = origin_wp + dist_to_interaction * beam.dir();
-
 
     //
     // evaluate fsd from previous interaction
@@ -596,7 +717,7 @@ inline spectral_radiant_flux_stokes_t random_walk(
                 *data.ctx.ads,
                 prev_cone, data.prev_vert_geo, interaction_wp,
                 *data.fsd_bsdf, beam.k());
-        data.fsd_bsdf = {};
+        data.fsd_bsdf = nullptr;
 
         const auto f = (std::norm(fsd.first) + std::norm(fsd.second)) / 2;
         assert(m::isfinite(f) && f>=0);
@@ -613,11 +734,12 @@ inline spectral_radiant_flux_stokes_t random_walk(
     //
     // check which triangle falls under the intersection point, if any,
 
-    wavefront_intersection_t wf_intersection;
+    auto& wf_intersection = step.wf_intersection;
     if (is_ballistic) {
         assert(intersection.record.has_raytracing_intersection_record());
 
         wf_intersection.primary = &data.ctx.ads->tri(*tris.begin());
+        wf_intersection.primary_n = data.ctx.ads->tri_geometry(*tris.begin()).n;
         wf_intersection.primary_intersection_record = intersection.record.get_raytracing_intersection_record();
     }
     else {
@@ -631,7 +753,7 @@ inline spectral_radiant_flux_stokes_t random_walk(
     }
 
     // distance to interaction region end, or triangle intersection
-    const auto& interaction_region_end = wf_intersection.primary ?
+    step.interaction_region_end = wf_intersection.primary ?
         wf_intersection.primary_intersection_record.dist : dist_to_interaction;
 
     // create surface intersection
@@ -640,11 +762,19 @@ inline spectral_radiant_flux_stokes_t random_walk(
         const auto* shape = data.ctx.scene->shapes()[tri.shape_idx].get();
         const auto& sampled_tri_wp = origin_wp + wf_intersection.primary_intersection_record.dist * beam.dir();
 
-        wf_intersection.intersection = intersection_surface_t{
-            shape, tri.n,
-            tri.shape_tri_idx, 
-            wf_intersection.primary_intersection_record.bary, sampled_tri_wp
-        };
+        // level-of-detail proxies are shaded with their aggregated normal
+        if (tri.is_proxy()) {
+            assert(wf_intersection.primary_proxy);
+            wf_intersection.intersection = intersection_surface_t{
+                shape, *wf_intersection.primary_proxy, sampled_tri_wp
+            };
+        } else {
+            wf_intersection.intersection = intersection_surface_t{
+                shape, wf_intersection.primary_n,
+                tri.shape_tri_idx, 
+                wf_intersection.primary_intersection_record.bary, sampled_tri_wp
+            };
+        }
         // intersection footprint between beam and surface
         // TODO: accurate footprint
         wf_intersection.intersection->footprint =
@@ -653,10 +783,10 @@ inline spectral_radiant_flux_stokes_t random_walk(
 
 
     // for ballistic: find edges around intersection
-    if (is_ballistic && !beam.is_ray() && !traversal_opts.force_ray_tracing) {
+    if (is_ballistic && traversal_opts.detect_edges && !beam.is_ray() && !traversal_opts.force_ray_tracing) {
         const auto zdist = envelope.axes(dist_to_interaction).x * beam::beam_generic_t::major_axis_to_z_scale();
-        const auto eintr = data.ctx.ads->intersect(envelope, pqrange_t<>{ dist_to_interaction - zdist/2, dist_to_interaction + zdist/2 });
-        edges = &eintr.edges();
+        // (ballistic records do not reference the scratch: reuse it)
+        edges = &data.ctx.ads->intersect_edges(envelope, *step.scratch, pqrange_t<>{ dist_to_interaction - zdist/2, dist_to_interaction + zdist/2 });
     }
 
     // if we have edges, construct fsd BSDF
@@ -667,12 +797,14 @@ inline spectral_radiant_flux_stokes_t random_walk(
 
         // create fsd aperture
         const auto footprint = beam.footprint(dist_to_interaction);
-        auto fsd_bsdf_ptr = std::make_unique<free_space_diffraction_t>(
+        auto& sample_arena = data.ctx.acquire_sample_arena();
+        const auto fsd_bsdf_ptr = sample_arena.template make<free_space_diffraction_t>(
                         data.ctx.ads,
                         interaction_wp, beam_frame, footprint,
-                        -data.beam.dir(), beam.k(), *edges);
+                        -data.beam.dir(), beam.k(), *edges,
+                        &sample_arena);
         if (!fsd_bsdf_ptr->empty())
-            data.fsd_bsdf = std::move(fsd_bsdf_ptr);
+            data.fsd_bsdf = fsd_bsdf_ptr;
 
         // record stat
         stats::record_fsd_interaction(fsd_start_timepoint);
@@ -683,7 +815,44 @@ inline spectral_radiant_flux_stokes_t random_walk(
         const auto size = beam.wavefront(dist_to_interaction).cross_section_area();
         stats::record_interaction_region(size);
     }
+}
+
+// organic connections: emission (backward transport) or sensing (forward transport)
+template <beam::Beam BeamType>
+inline spectral_radiant_flux_stokes_t walk_connect_organic(
+        path_walk_data_t<BeamType>& data,
+        const walk_step_t& step,
+        const QuantityOf<inverse(isq::length)> auto& recp_spectral_pd,
+        const int depth) noexcept {
+    spectral_radiant_flux_stokes_t L = {};
+    const auto& wf_intersection = step.wf_intersection;
 
+    // emission (backward transport)
+    if constexpr (BeamType::transport == transport_e::backward)
+    if (wf_intersection.intersection) {
+        L += emission(data,
+                      *wf_intersection.intersection,
+                      depth);
+    }
+
+    // sensing (forward transport)
+    if constexpr (BeamType::transport == transport_e::forward)
+        sensing(data, step.origin_wp,
+                step.interaction_region_end,
+                recp_spectral_pd, depth);
+
+    return L;
+}
+
+// NEE and organic connections (emission or sensing)
+template <beam::Beam BeamType>
+inline spectral_radiant_flux_stokes_t walk_connect(
+        path_walk_data_t<BeamType>& data,
+        const walk_step_t& step,
+        const QuantityOf<inverse(isq::length)> auto& recp_spectral_pd,
+        const int depth) noexcept {
+    spectral_radiant_flux_stokes_t L = {};
+    const auto& wf_intersection = step.wf_intersection;
 
     //
     // NEE
@@ -699,8 +868,8 @@ inline spectral_radiant_flux_stokes_t random_walk(
     if (depth<data.opts.max_depth)
         nee_forward(
                 data,
-                interaction_wp,
-                dist_to_interaction,
+                step.interaction_wp,
+                step.dist_to_interaction,
                 recp_spectral_pd,
                 depth+1);
 
@@ -708,44 +877,39 @@ inline spectral_radiant_flux_stokes_t random_walk(
     //
     // organic connections
 
-    // emission (backward transport)
-    if constexpr (BeamType::transport == transport_e::backward)
-    if (wf_intersection.intersection) {
-        L += emission(data,
-                      *wf_intersection.intersection,
-                      depth);
-    }
-
-    // sensing (forward transport)
-    if constexpr (BeamType::transport == transport_e::forward)
-        sensing(data, origin_wp,
-                interaction_region_end,
-                recp_spectral_pd, depth);
+    L += walk_connect_organic(data, step, recp_spectral_pd, depth);
 
+    return L;
+}
 
-    //
-    // do interactions
+// samples an interaction and decides whether to continue the walk. Returns the depth of the next step, or nothing when the walk terminates.
+template <beam::Beam BeamType>
+inline std::optional<int> walk_interact(
+        path_walk_data_t<BeamType>& data,
+        const walk_step_t& step,
+        const int depth) noexcept {
+    const auto& wf_intersection = step.wf_intersection;
 
     bool sampled_null = false;
     if (wf_intersection.intersection) {
         // sampled a surface interaction
         if (!sample_surface_interaction(data, *wf_intersection.intersection))
-            return L;
+            return std::nullopt;
     } else if (data.fsd_bsdf) {
         // sampled free-space diffraction
-        assert(!is_ballistic && data.opts.FSD);
+        assert(!step.is_ballistic && data.opts.FSD);
 
         // sample fsd
-        if (!sample_fsd_interaction(data, interaction_wp, dist_to_interaction))
-            return L;
+        if (!sample_fsd_interaction(data, step.interaction_wp, step.dist_to_interaction))
+            return std::nullopt;
     } else {
         // no edges, continue propagation
-        assert(!is_ballistic);
+        assert(!step.is_ballistic);
 
         // do null
         sampled_null = true;
-        if (!sample_null_interaction(data, interaction_wp, dist_to_interaction))
-            return L;
+        if (!sample_null_interaction(data, step.interaction_wp, step.dist_to_interaction))
+            return std::nullopt;
     }
 
 
@@ -753,21 +917,55 @@ inline spectral_radiant_flux_stokes_t random_walk(
     // continue walk
 
     const bool do_RR = !sampled_null;
-    if (data.continue_walk(depth, do_RR))
-        L += random_walk(data, recp_spectral_pd, sampled_null ? depth : depth+1);
+    if (!data.continue_walk(depth, do_RR))
+        return std::nullopt;
+    return sampled_null ? depth : depth+1;
+}
+
+template <beam::Beam BeamType>
+inline spectral_radiant_flux_stokes_t random_walk(
+        path_walk_data_t<BeamType>& data,
+        const QuantityOf<inverse(isq::length)> auto& recp_spectral_pd) noexcept {
+    spectral_radiant_flux_stokes_t L = {};
+
+    for (int depth=1;;) {
+        auto step = walk_traverse(data);
+        if (!step)
+            break;
+
+        walk_intersect(data, *step);
+        L += walk_connect(data, *step, recp_spectral_pd, depth);
+
+        const auto next_depth = walk_interact(data, *step, depth);
+        if (!next_depth)
+            break;
+        depth = *next_depth;
+    }
 
     if constexpr (BeamType::transport == transport_e::backward)
         return L;
     return {};
 }
 
-inline void integrate_backward(
+/**
+ * @brief A generated path: the walk data of the path's first beam, and the path's spectral sample.
+ */
+template <beam::Beam BeamType>
+struct path_sample_t {
+    path_walk_data_t<BeamType> data;
+
+    wavenumber_t k;
+    // spectral (importance) sampling weight
+    wavenumber_t recp_spectral_pd;
+    // sensor element to splat to (backward transport)
+    sensor::sensor_element_sample_t element = {};
+};
+
+// draws the spectral sample and the sensor sample of a backward (sensor to emitter) path
+inline auto generate_backward_path(
         const integrator_context_t& ctx,
-        const sensor::block_handle_t& block,
         const vec3u32_t& sensor_element,
         const plt_path_t::options_t& opts) noexcept {
-    if (opts.max_depth==0) return;
-
     // draw spectral sample
     const auto emitter_wavenumber = ctx.scene->sample_emitter_and_spectrum(ctx.sensor);
     const auto& k = emitter_wavenumber.wavenumber.k;
@@ -781,23 +979,64 @@ inline void integrate_backward(
 
     // draw sensor sample
     const auto sensor_sample = ctx.sensor->sample(ctx.scene->sampler(), sensor_element, k);
-    
-    // path trace
-    auto data = path_walk_data_t{
-        .beam = sensor_sample.beam,
-        .prev_vert_geo  = sensor_sample.beam.origin(),
-        .opts = opts,
-        .ctx = ctx
+
+    using beam_t = importance_flux_beam_t;
+    return path_sample_t<beam_t>{
+        .data = path_walk_data_t<beam_t>{
+            .beam = sensor_sample.beam,
+            .prev_vert_geo  = sensor_sample.beam.origin(),
+            .opts = opts,
+            .ctx = ctx
+        },
+        .k = k,
+        .recp_spectral_pd = recp_spectral_pd,
+        .element = sensor_sample.element,
+    };
+}
+
+// draws the spectral sample and the emitter sample of a forward (emitter to sensor) path
+inline auto generate_forward_path(
+        const integrator_context_t& ctx,
+        const plt_path_t::options_t& opts) noexcept {
+    // draw spectral sample and emitter sample
+    const auto emitter_wavenumber = ctx.scene->sample_emitter_and_spectrum_and_source_beam(ctx.sensor);
+    const auto& emitter_sample    = emitter_wavenumber.emitter_sample;
+
+    const auto& k = emitter_wavenumber.wavenumber.k;
+    const wavenumber_t recp_spectral_pd = f_t(1) / ctx.scene->sum_spectral_pdf_for_all_emitters(ctx.sensor, k);
+
+    using beam_t = spectral_radiant_flux_beam_t;
+    return path_sample_t<beam_t>{
+        .data = path_walk_data_t<beam_t>{
+            .beam = emitter_sample.beam,
+            .prev_vert_geo  = emitter_sample.beam.origin(),
+            .opts = opts,
+            .ctx = ctx
+        },
+        .k = k,
+        .recp_spectral_pd = recp_spectral_pd,
     };
+}
+
+inline void integrate_backward(
+        const integrator_context_t& ctx,
+        const sensor::block_handle_t& block,
+        const vec3u32_t& sensor_element,
+        const plt_path_t::options_t& opts) noexcept {
+    if (opts.max_depth==0) return;
+
+    auto path = generate_backward_path(ctx, sensor_element, opts);
+
+    // path trace
     const auto L = random_walk(
-        data,
-        recp_spectral_pd
+        path.data,
+        path.recp_spectral_pd
     );
 
     assert(L.intensity()>=zero && L.isfinite());
 
-    splat_backward(data.ctx, block, sensor_sample.element,
-                   L * recp_spectral_pd, k);
+    splat_backward(ctx, block, path.element,
+                   L * path.recp_spectral_pd, path.k);
 }
 
 
@@ -807,23 +1046,12 @@ inline void integrate_forward(
         const plt_path_t::options_t& opts) noexcept {
     if (opts.max_depth==0) return;
 
-    // draw spectral sample and emitter sample
-    const auto emitter_wavenumber = ctx.scene->sample_emitter_and_spectrum_and_source_beam(ctx.sensor);
-    const auto& emitter_sample    = emitter_wavenumber.emitter_sample;
-
-    const auto& k = emitter_wavenumber.wavenumber.k;
-    const auto recp_spectral_pd = f_t(1) / ctx.scene->sum_spectral_pdf_for_all_emitters(ctx.sensor, k);
+    auto path = generate_forward_path(ctx, opts);
 
     // path trace
-    auto data = path_walk_data_t{
-        .beam = emitter_sample.beam,
-        .prev_vert_geo  = emitter_sample.beam.origin(),
-        .opts = opts,
-        .ctx = ctx
-    };
     random_walk(
-        data,
-        recp_spectral_pd
+        path.data,
+        path.recp_spectral_pd
     );
 }
 
@@ -0,0 +1,261 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <wt/integrator/plt_path/plt_path_detail.hpp>
+
+// Wavefront (stream) mode of the PLT path tracer.
+// A worker advances a wave of many paths together, one stage at a time: generate, traverse and intersect, connect (NEE, emission or sensing) and shade (sample an interaction and continue or terminate).
+// Each stage processes the paths of the wave in a coherent order: traversal queries are issued grouped by query type (ray or beam) and direction octant, and shading is grouped by the intersected shape (and thus BSDF).
+// The ray queries of a stage are issued to the ADS as a single batch: the traversal queries of paths traversed in pure ray tracing mode (via the batched ``ads::ads_t::intersect()``), and the shadow queries of backward NEE (via the batched ``ads::ads_t::shadow()``). Beam (cone) traversal, and the cone shadow queries of forward NEE (free-space diffraction), are issued per path.
+// Paths use the same walk steps as the scalar integrator (see ``random_walk()``), only interleaved: the result is identical in expectation, but not sample-for-sample, as all paths draw from the same (shared) samplers in a different order.
+// A path holds its intersection scratch only while it is traversed and intersected, hence a worker holds a single live scratch (plus nested queries) regardless of the wave size.
+
+namespace wt::integrator::plt_path::wavefront {
+
+template <beam::Beam BeamType>
+struct path_state_t : path_sample_t<BeamType> {
+    // current step, held between the traversal and shading stages (without its intersection scratch)
+    std::optional<walk_step_t> step = {};
+    int depth = 1;
+
+    // accumulated contributions (backward transport)
+    spectral_radiant_flux_stokes_t L = {};
+};
+
+// traversal key: query type (ray or beam) and direction octant
+template <beam::Beam BeamType>
+inline std::uint32_t traversal_key(const path_state_t<BeamType>& path) noexcept {
+    const auto& beam = path.data.beam;
+    const auto d = beam.dir();
+    return (std::uint32_t(!beam.is_ray()) << 3) |
+           (std::uint32_t(d.x<0) << 2) | (std::uint32_t(d.y<0) << 1) | std::uint32_t(d.z<0);
+}
+
+// shading key: intersected shape, paths without a surface interaction (free-space diffraction or null) first
+template <beam::Beam BeamType>
+inline std::uint32_t shading_key(const path_state_t<BeamType>& path) noexcept {
+    const auto* tri = path.step->wf_intersection.primary;
+    return tri ? tri->shape_idx+1 : 0;
+}
+
+// (stable) sorts the active queue by a key over the paths
+inline void sort_queue(std::vector<std::uint32_t>& queue,
+                       std::vector<std::uint32_t>& keys,
+                       auto&& key) noexcept {
+    for (const auto i : queue)
+        keys[i] = key(i);
+    std::ranges::stable_sort(queue, {}, [&](auto i) { return keys[i]; });
+}
+
+/**
+ * @brief Runs ``count`` paths in waves of (at most) ``opts.wavefront_size`` paths.
+ *        ``generate(idx)`` constructs the path state of the ``idx``-th path, and ``terminate(path)`` is invoked once a path's walk terminates.
+ *        The sample arena is reset at the start of each wave: allocations made by a path's walk remain valid until its wave completes.
+ */
+template <beam::Beam BeamType>
+inline void run(const integrator_context_t& ctx,
+                const plt_path_t::options_t& opts,
+                const std::size_t count,
+                auto&& generate,
+                auto&& terminate) noexcept {
+    const auto wave_size = std::min<std::size_t>(count, opts.wavefront_size);
+
+    std::vector<path_state_t<BeamType>> paths;
+    std::vector<std::uint32_t> queue, keys;
+    paths.reserve(wave_size);
+    queue.reserve(wave_size);
+    keys.resize(wave_size);
+
+    // batched ADS queries of a stage, and the index of each path's query in the batch
+    constexpr auto not_batched = ~std::uint32_t(0);
+    std::vector<std::uint32_t> batch_idx(wave_size);
+    std::vector<ads::ads_t::ray_query_t> ray_queries;
+    std::vector<ads::intersection_record_t> ray_records;
+    std::vector<nee_backward_sample_t> nee_samples;
+    const auto occluded = std::make_unique<bool[]>(wave_size);
+    ray_queries.reserve(wave_size);
+    ray_records.reserve(wave_size);
+    nee_samples.reserve(wave_size);
+
+    auto& sample_arena = ctx.acquire_sample_arena();
+
+    for (std::size_t wave_start=0; wave_start<count; wave_start+=wave_size) {
+        const auto wave_end = std::min(count, wave_start+wave_size);
+
+        // the previous wave's paths hold no arena allocations
+        paths.clear();
+        sample_arena.reset();
+
+        //
+        // generate
+
+        queue.clear();
+        for (auto idx=wave_start; idx<wave_end; ++idx) {
+            queue.emplace_back((std::uint32_t)paths.size());
+            paths.emplace_back(generate(idx));
+        }
+
+        while (!queue.empty()) {
+            //
+            // traverse and intersect
+            // (the step's scratch is released once intersected, so that the paths of the wave do not hold live scratches)
+
+            sort_queue(queue, keys, [&](auto i) { return traversal_key(paths[i]); });
+
+            // the queries of paths traversed in pure ray tracing mode are traced as a single batch
+            ray_queries.clear();
+            for (const auto i : queue) {
+                const auto query = walk_ray_query(paths[i].data);
+                batch_idx[i] = query ? (std::uint32_t)ray_queries.size() : not_batched;
+                if (query)
+                    ray_queries.emplace_back(*query);
+            }
+            ray_records.resize(ray_queries.size());
+            ctx.ads->intersect(std::span<const ads::ads_t::ray_query_t>{ ray_queries },
+                               std::span<ads::intersection_record_t>{ ray_records });
+
+            std::erase_if(queue, [&](auto i) {
+                auto& path = paths[i];
+                if (batch_idx[i]!=not_batched) {
+                    const auto& query = ray_queries[batch_idx[i]];
+                    path.step = walk_step(path.data, ctx.acquire_ads_scratch(), traversal_result_t{
+                        .origin = query.ray.o,
+                        .record = ray_records[batch_idx[i]],
+                        .ballistic = true,
+                    });
+                } else {
+                    path.step = walk_traverse(path.data);
+                }
+                if (!path.step) {
+                    terminate(path);
+                    return true;
+                }
+
+                walk_intersect(path.data, *path.step);
+                path.step->release_scratch();
+                return false;
+            });
+
+            //
+            // connect
+
+            sort_queue(queue, keys, [&](auto i) { return shading_key(paths[i]); });
+            if constexpr (BeamType::transport == transport_e::backward) {
+                // sample NEE connections, and trace their shadow queries as a single batch
+                nee_samples.clear();
+                ray_queries.clear();
+                for (const auto i : queue) {
+                    auto& path = paths[i];
+                    batch_idx[i] = not_batched;
+                    if (path.depth>=path.data.opts.max_depth)
+                        continue;
+                    if (auto sample = nee_backward_sample(path.data, path.step->wf_intersection); sample) {
+                        batch_idx[i] = (std::uint32_t)nee_samples.size();
+                        ray_queries.emplace_back(sample->shadow);
+                        nee_samples.emplace_back(std::move(*sample));
+                    }
+                }
+                ctx.ads->shadow(std::span<const ads::ads_t::shadow_query_t>{ ray_queries },
+                                std::span<bool>{ occluded.get(), ray_queries.size() });
+
+                for (const auto i : queue) {
+                    auto& path = paths[i];
+                    if (batch_idx[i]!=not_batched && !occluded[batch_idx[i]])
+                        path.L += nee_backward_connect(path.data, path.step->wf_intersection,
+                                                       nee_samples[batch_idx[i]], path.depth+1);
+                    path.L += walk_connect_organic(path.data, *path.step, path.recp_spectral_pd, path.depth);
+                }
+            } else {
+                for (const auto i : queue) {
+                    auto& path = paths[i];
+                    path.L += walk_connect(path.data, *path.step, path.recp_spectral_pd, path.depth);
+                }
+            }
+
+            //
+            // shade
+
+            std::erase_if(queue, [&](auto i) {
+                auto& path = paths[i];
+                const auto next_depth = walk_interact(path.data, *path.step, path.depth);
+                path.step.reset();
+
+                if (next_depth) {
+                    path.depth = *next_depth;
+                    return false;
+                }
+                terminate(path);
+                return true;
+            });
+        }
+    }
+}
+
+/**
+ * @brief Backward (sensor to emitter) wavefront integration of all elements of a block.
+ */
+inline void integrate_backward(
+        const integrator_context_t& ctx,
+        const sensor::block_handle_t& block,
+        const std::uint32_t samples_per_element,
+        const plt_path_t::options_t& opts) noexcept {
+    if (opts.max_depth==0) return;
+
+    const auto& size = block.size;
+    const auto elements = (std::size_t)size.x * size.y * size.z;
+
+    using beam_t = importance_flux_beam_t;
+    run<beam_t>(
+        ctx, opts, elements*samples_per_element,
+        [&](std::size_t idx) {
+            const auto e = (std::uint32_t)(idx / samples_per_element);
+            const auto sensor_element = block.position + vec3u32_t{ e%size.x, (e/size.x)%size.y, e/(size.x*size.y) };
+
+            return path_state_t<beam_t>{ generate_backward_path(ctx, sensor_element, opts) };
+        },
+        [&](const path_state_t<beam_t>& path) {
+            assert(path.L.intensity()>=zero && path.L.isfinite());
+            splat_backward(ctx, block, path.element,
+                           path.L * path.recp_spectral_pd, path.k);
+        });
+}
+
+/**
+ * @brief Forward (emitter to sensor) wavefront integration: traces as many emitter paths as the elements of a block, each with ``samples_per_element`` samples.
+ */
+inline void integrate_forward(
+        const integrator_context_t& ctx,
+        const sensor::block_handle_t& block,
+        const std::uint32_t samples_per_element,
+        const plt_path_t::options_t& opts) noexcept {
+    if (opts.max_depth==0) return;
+
+    const auto& size = block.size;
+    const auto elements = (std::size_t)size.x * size.y * size.z;
+
+    using beam_t = spectral_radiant_flux_beam_t;
+    run<beam_t>(
+        ctx, opts, elements*samples_per_element,
+        [&](std::size_t) {
+            return path_state_t<beam_t>{ generate_forward_path(ctx, opts) };
+        },
+        // forward paths splat directly to the sensor as they go
+        [](const path_state_t<beam_t>&) {});
+}
+
+}
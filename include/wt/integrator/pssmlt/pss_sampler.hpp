@@ -0,0 +1,196 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <random>
+
+#include <wt/sampler/sampler.hpp>
+#include <wt/scene/element/info.hpp>
+
+#include <wt/math/common.hpp>
+
+namespace wt::integrator::pssmlt {
+
+/**
+ * @brief Primary sample space sampler: the samples it draws are the coordinates of a point in primary sample space (the unit hypercube), which is mutated by a Metropolis-Hastings chain.
+ *        Coordinates are mutated lazily, when drawn during an iteration: a small step perturbs a coordinate by a normally-distributed offset (wrapped around to [0,1)), and a large step redraws it uniformly. Coordinates that were not drawn since the last accepted large step are redrawn on access.
+ *        The sampler is replayable: a sampler constructed (or reset) with a given seed reproduces the same states, given the same sequence of accepted and rejected mutations.
+ *
+ *        Coordinates are interleaved between streams (sensor, emitter and connections), so that the coordinates drawn from a stream do not shift when another stream draws a different count of samples.
+ *        Each stream is exposed as a ``sampler_t``.
+ */
+class pss_sampler_t {
+public:
+    enum class stream_e : std::uint8_t {
+        sensor,
+        emitter,
+        connection,
+    };
+    static constexpr std::size_t stream_count = 3;
+
+    class stream_t final : public sampler::sampler_t {
+        friend class pss_sampler_t;
+
+    private:
+        pss_sampler_t* pss;
+        std::size_t idx;
+
+        stream_t(pss_sampler_t* pss, std::size_t idx) noexcept
+            : sampler_t("pss_stream"),
+              pss(pss),
+              idx(idx)
+        {}
+
+    public:
+        [[nodiscard]] inline f_t r() noexcept override {
+            return pss->next(idx);
+        }
+        [[nodiscard]] inline vec2_t r2() noexcept override {
+            const auto x = r();
+            return { x, r() };
+        }
+        [[nodiscard]] inline vec3_t r3() noexcept override {
+            const auto x = r();
+            const auto y = r();
+            return { x, y, r() };
+        }
+        [[nodiscard]] inline vec4_t r4() noexcept override {
+            const auto x = r();
+            const auto y = r();
+            const auto z = r();
+            return { x, y, z, r() };
+        }
+
+        [[nodiscard]] scene::element::info_t description() const override {
+            return scene::element::info_for_scene_element(*this, "pss_stream");
+        }
+    };
+
+private:
+    struct primary_sample_t {
+        f_t value = 0;
+        // iteration of last modification
+        std::uint64_t last_modification = 0;
+
+        // restored on rejection
+        f_t value_backup = 0;
+        std::uint64_t last_modification_backup = 0;
+    };
+
+    std::vector<primary_sample_t> X;
+    std::mt19937_64 rng;
+
+    f_t sigma, large_step_probability;
+
+    std::uint64_t iteration = 0;
+    std::uint64_t last_large_step_iteration = 0;
+    bool large_step = true;
+
+    std::size_t stream_samples[stream_count] = {};
+    stream_t streams[stream_count];
+
+    [[nodiscard]] inline f_t uniform() noexcept {
+        return std::uniform_real_distribution<f_t>{}(rng);
+    }
+
+    [[nodiscard]] inline f_t next(const std::size_t stream) noexcept {
+        const auto idx = stream + stream_count*stream_samples[stream]++;
+        if (idx>=X.size())
+            X.resize(idx+1);
+        auto& x = X[idx];
+
+        // redraw a coordinate that was not drawn since the last large step
+        if (x.last_modification < last_large_step_iteration) {
+            x.value = uniform();
+            x.last_modification = last_large_step_iteration;
+        }
+
+        x.value_backup = x.value;
+        x.last_modification_backup = x.last_modification;
+
+        if (large_step)
+            x.value = uniform();
+        else {
+            // small step: perturb by the accumulated small steps since last modification
+            const auto n = iteration - x.last_modification;
+            const auto s = sigma * m::sqrt((f_t)n);
+            x.value += std::normal_distribution<f_t>{}(rng) * s;
+            x.value -= m::floor(x.value);
+            if (x.value>=1) x.value = 0;
+        }
+        x.last_modification = iteration;
+
+        return x.value;
+    }
+
+public:
+    /**
+     * @param seed seed of the sampler's random number generator
+     * @param sigma standard deviation of small-step mutations
+     * @param large_step_probability probability of a large-step mutation
+     */
+    pss_sampler_t(std::uint64_t seed, f_t sigma, f_t large_step_probability) noexcept
+        : rng(seed),
+          sigma(sigma),
+          large_step_probability(large_step_probability),
+          streams{ stream_t{ this,0 }, stream_t{ this,1 }, stream_t{ this,2 } }
+    {}
+    pss_sampler_t(const pss_sampler_t&) = delete;
+    pss_sampler_t& operator=(const pss_sampler_t&) = delete;
+
+    /**
+     * @brief Resets the sampler to its initial state with a new seed. The first iteration (before ``start_iteration()`` is called) is a large step.
+     */
+    inline void reset(std::uint64_t seed) noexcept {
+        rng.seed(seed);
+        X.clear();
+        iteration = last_large_step_iteration = 0;
+        large_step = true;
+        for (auto& s : stream_samples) s = 0;
+    }
+
+    [[nodiscard]] inline auto& stream(stream_e s) noexcept { return streams[(std::size_t)s]; }
+
+    [[nodiscard]] inline bool is_large_step() const noexcept { return large_step; }
+
+    /**
+     * @brief Starts a new mutation.
+     */
+    inline void start_iteration() noexcept {
+        ++iteration;
+        large_step = uniform() < large_step_probability;
+        for (auto& s : stream_samples) s = 0;
+    }
+
+    /**
+     * @brief Accepts the current mutation.
+     */
+    inline void accept() noexcept {
+        if (large_step)
+            last_large_step_iteration = iteration;
+    }
+
+    /**
+     * @brief Rejects the current mutation, restoring the coordinates to the previous state.
+     */
+    inline void reject() noexcept {
+        for (auto& x : X) {
+            if (x.last_modification == iteration) {
+                x.value = x.value_backup;
+                x.last_modification = x.last_modification_backup;
+            }
+        }
+        --iteration;
+    }
+};
+
+}
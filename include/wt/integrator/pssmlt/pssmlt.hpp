@@ -0,0 +1,83 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <string>
+#include <memory>
+
+#include <wt/integrator/integrator.hpp>
+#include <wt/integrator/plt_bdpt/plt_bdpt.hpp>
+
+#include <wt/wt_context.hpp>
+
+namespace wt::integrator {
+
+/**
+ * @brief Primary-sample-space Metropolis light transport (PSSMLT) over the PLT bi-directional path tracer.
+ *        A sample of the BDPT integrator, of a sensor element drawn uniformly over the sensor, is a deterministic function of the primary samples it consumes (see ``pssmlt::pss_sampler_t``). Markov chains mutate the primary samples with small-step and large-step mutations, and are distributed proportionally to the samples' (scalar) contributions.
+ *
+ *        Each render job (a block of sensor elements) runs an independent chain, with as many mutations as BDPT samples the job would integrate. A chain is normalized by its own bootstrap pass: the mean contribution of independent samples, from which the chain's initial state is also resampled (which makes the chain unbiased, without start-up bias).
+ *        All contributions are splatted directly to the sensor.
+ */
+class pssmlt_t final : public integrator_t {
+public:
+    struct options_t {
+        plt_bdpt_t::options_t bdpt = {};
+
+        // count of bootstrap samples per chain
+        std::uint32_t bootstrap_samples = 256;
+        // standard deviation of small-step mutations
+        f_t sigma = .01;
+        // probability of a large-step mutation
+        f_t large_step_probability = .3;
+    };
+
+private:
+    options_t options;
+
+    std::shared_ptr<plt_bdpt_t> bdpt;
+
+    void run_chain(const integrator_context_t& ctx,
+                   std::size_t mutations) const noexcept;
+
+public:
+    pssmlt_t(std::string id,
+             options_t opts,
+             std::shared_ptr<plt_bdpt_t> bdpt) noexcept;
+
+    [[nodiscard]] sensor::sensor_write_flags_e sensor_write_flags() const noexcept override {
+        return sensor::sensor_write_flags_e::writes_direct_splats;
+    }
+
+    /**
+     * @brief Runs a chain of ``samples_per_element`` mutations. Contributions are not restricted to ``sensor_element``.
+     */
+    void integrate(const integrator_context_t& ctx,
+                   const sensor::block_handle_t& block,
+                   const vec3u32_t& sensor_element,
+                   std::uint32_t samples_per_element) const noexcept override;
+    /**
+     * @brief Runs a chain of as many mutations as the samples of all elements of the block. Contributions are not restricted to the block.
+     */
+    void integrate_block(const integrator_context_t& ctx,
+                         const sensor::block_handle_t& block,
+                         std::uint32_t samples_per_element) const noexcept override;
+
+    [[nodiscard]] scene::element::info_t description() const override;
+
+public:
+    static std::shared_ptr<integrator_t> load(
+            const std::string& id,
+            scene::loader::loader_t* loader,
+            const scene::loader::node_t& node,
+            const wt::wt_context_t &context);
+};
+
+}
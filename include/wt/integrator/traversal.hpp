@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cassert>
+#include <optional>
 #include <variant>
 
 #include <wt/util/unreachable.hpp>
@@ -90,9 +91,11 @@ struct shadow_result_t {
  * @brief Traverses the ADS with a cone.
  *        Starts with doing short ballistic (coherent photons) segments, propagated as rays,
  *        after each segment attempt to restart diffusive (beam) propagation.
+ *        The returned intersection record references storage in ``scratch``.
  */
 [[nodiscard]] inline traversal_result_t traverse(
         const ads::ads_t& ads,
+        ads::intersection_scratch_t& scratch,
         const elliptic_cone_t& envelope,
         const length_t lambda,
         const length_t distance,
@@ -117,10 +120,14 @@ struct shadow_result_t {
 
     const auto& z_search_range = beam::beam_generic_t::major_axis_to_z_scale();
 
+    // ballistic segments extend the same ray: each segment resumes the traversal of the previous one
+    ads::ray_traversal_state_t ballistic_traversal;
+
     length_t dist = 0*u::m;
     for (std::uint32_t seg=0;;++seg) {
         const auto ballistic_dist = max_ballistic_distance(lambda, seg, min_ballistic_distance);
-        auto bl_intr = ads.intersect(ray, { dist, m::min(distance, dist + ballistic_dist*ballistic_scale) });
+        auto bl_intr = ads.intersect(ray, { dist, m::min(distance, dist + ballistic_dist*ballistic_scale) },
+                                     ballistic_traversal);
         if (!bl_intr.empty()) {
             assert(bl_intr.distance()>=dist);
             return {
@@ -143,14 +150,17 @@ struct shadow_result_t {
         assert(envelope.contains(ray.propagate(dist)));
 
         // attempt diffusive propagation
+        // (triangles only: edges are gathered once the diffusive segment is accepted)
         const auto min_df_prog = envelope.axes(dist).x / f_t(2);
         auto df_intr = ads.intersect(
                 envelope,
+                scratch,
                 { dist, distance },
                 { 
-                    .detect_edges = opts.detect_edges,
+                    .detect_edges = false,
                     .accumulate_edges = opts.accumulate_edges,
-                    .z_search_range_scale = z_search_range
+                    .z_search_range_scale = z_search_range,
+                    .lod_wavelength = lambda,
                 });
 
         // successful diffusive propagation?
@@ -158,6 +168,17 @@ struct shadow_result_t {
             const length_t depth = df_intr.empty() ?
                 0*u::m :
                 z_search_range * envelope.axes(df_intr.distance()).x;
+
+            // edges within the intersection region: written into the scratch referenced by the record
+            if (opts.detect_edges && !df_intr.empty()) {
+                const auto edges_range = pqrange_t<>{ dist, m::min(distance, df_intr.distance()+depth) };
+                ads.intersect_edges(envelope, scratch, edges_range,
+                                    { .detect_edges = true,
+                                      .accumulate_edges = true,
+                                      .accumulate_triangles = true,
+                                      .z_search_range_scale = z_search_range });
+            }
+
             return {
                 .origin = envelope.o(),
                 .record = df_intr,
@@ -272,9 +293,11 @@ using vertex_geo_variant_t = std::variant<std::monostate, pqvec3_t, intersection
  * @brief Traverses the ADS with a cone.
  *        Starts with doing short ballistic (coherent photons) segments, propagated as rays,
  *        after each segment attempt to restart diffusive (beam) propagation.
+ *        The returned intersection record references storage in ``scratch``.
  */
 [[nodiscard]] inline traversal_result_t traverse(
         const ads::ads_t& ads,
+        ads::intersection_scratch_t& scratch,
         const elliptic_cone_t &cone,
         const vertex_geo_variant_t& intrs,
         const length_t lambda,
@@ -282,20 +305,42 @@ using vertex_geo_variant_t = std::variant<std::monostate, pqvec3_t, intersection
         const traversal_opts_t& opts = {}) noexcept {
     auto envelope = cone;
     envelope.set_o(offseted_ray_origin(intrs, cone.ray()));
-    return traverse(ads, envelope, lambda, distance, opts);
+    return traverse(ads, scratch, envelope, lambda, distance, opts);
 }
 /**
  * @brief Traverses the ADS with a cone.
  *        Starts with doing short ballistic (coherent photons) segments, propagated as rays,
  *        after each segment attempt to restart diffusive (beam) propagation.
+ *        The returned intersection record references storage in ``scratch``.
  */
 [[nodiscard]] inline traversal_result_t traverse(
         const ads::ads_t& ads,
+        ads::intersection_scratch_t& scratch,
         const elliptic_cone_t &cone,
         const vertex_geo_variant_t& intrs,
         const length_t lambda,
         const traversal_opts_t& opts = {}) noexcept {
-    return traverse(ads, cone, intrs, lambda, limits<length_t>::infinity(), opts);
+    return traverse(ads, scratch, cone, intrs, lambda, limits<length_t>::infinity(), opts);
+}
+
+/**
+ * @brief The ray query that ``traverse()`` issues for a cone that is traversed in pure ray tracing mode (a ray envelope, or ``opts.force_ray_tracing``), or nothing for cones that are traversed as beams.
+ *        Ray queries of many paths can be issued together via the batched ``ads::ads_t::intersect()``; the record of the query is traversed ballistically from the query ray's origin.
+ */
+[[nodiscard]] inline std::optional<ads::ads_t::ray_query_t> ray_traversal_query(
+        const elliptic_cone_t &cone,
+        const vertex_geo_variant_t& intrs,
+        const length_t distance,
+        const traversal_opts_t& opts = {}) noexcept {
+    if (!opts.force_ray_tracing && !cone.is_ray())
+        return std::nullopt;
+
+    auto envelope = cone;
+    envelope.set_o(offseted_ray_origin(intrs, cone.ray()));
+    return ads::ads_t::ray_query_t{
+        .ray = envelope.ray(),
+        .range = { 0*u::m, distance },
+    };
 }
 
 /**
@@ -314,10 +359,9 @@ using vertex_geo_variant_t = std::variant<std::monostate, pqvec3_t, intersection
 }
 
 /**
- * @brief Ray shadow query between two intersections.
+ * @brief Ray segment between two intersections, for (batched) shadow queries.
  */
-[[nodiscard]] inline bool shadow(
-        const ads::ads_t& ads,
+[[nodiscard]] inline ads::ads_t::shadow_query_t shadow_query(
         const auto& intrs_start,
         const auto& intrs_end) noexcept {
     const auto& start_wp = intersection_position(intrs_start);
@@ -329,7 +373,21 @@ using vertex_geo_variant_t = std::variant<std::monostate, pqvec3_t, intersection
     const auto dist = m::length(t-o);
     const auto d = dir3_t{ (t-o)/dist };
 
-    return ads.shadow(ray_t{ o,d }, pqrange_t<>{ 0*u::m,dist });
+    return {
+        .ray = ray_t{ o,d },
+        .range = pqrange_t<>{ 0*u::m,dist },
+    };
+}
+
+/**
+ * @brief Ray shadow query between two intersections.
+ */
+[[nodiscard]] inline bool shadow(
+        const ads::ads_t& ads,
+        const auto& intrs_start,
+        const auto& intrs_end) noexcept {
+    const auto q = shadow_query(intrs_start, intrs_end);
+    return ads.shadow(q.ray, q.range);
 }
 
 }
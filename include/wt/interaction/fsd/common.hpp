@@ -10,6 +10,7 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
 #include <optional>
 
 #include <wt/ads/common.hpp>
@@ -33,6 +34,24 @@ struct UTD_ret_t {
     dir3_t so,ho;
 };
 
+/**
+ * @brief Scalar arguments of the UTD diffraction coefficients of a single wedge, for batched evaluation (see ``UTD_coefficients()``).
+ */
+struct UTD_args_t {
+    /** @brief Wedge exterior angle parameter, ``n = 2-alpha/pi``.
+     */
+    f_t n;
+    /** @brief Incident and exitant angles (in radians), relative to the front face.
+     */
+    f_t phii, phio;
+    /** @brief Wavenumber times the distance parameter, ``k*ro*sin(beta)^2``.
+     */
+    f_t kL;
+    /** @brief Magnitude of the diffraction coefficients' common factor, ``1/(2n*sqrt(2*pi*k*ro)*sin(beta))``.
+     */
+    f_t scale;
+};
+
 /**
  * @brief Wedge edge
  */
@@ -87,15 +106,33 @@ struct wedge_edge_t {
                                 const dir3_t& wi,
                                 const dir3_t& wo,
                                 const length_t ro) const noexcept;
+
+    /**
+    * @brief Arguments of the UTD diffraction coefficients, for batched evaluation with ``UTD_coefficients()``.
+    */
+    [[nodiscard]] UTD_args_t UTD_args(const Wavenumber auto k,
+                                      const dir3_t& wi,
+                                      const dir3_t& wo,
+                                      const length_t ro) const noexcept;
+    /**
+    * @brief The SH incident and scattering frames of the UTD wedge diffraction function. Diffraction coefficients are left zero.
+    */
+    [[nodiscard]] UTD_ret_t UTD_frames(const dir3_t& wi,
+                                       const dir3_t& wo) const noexcept;
 };
 
 /**
- * @brief An FSD aperture
+ * @brief An FSD aperture. Its storage is allocated from ``mem``.
  */
 struct fsd_aperture_t {
-    std::vector<wedge_edge_t> edges;  // wedges composing the aperture
+    std::pmr::vector<wedge_edge_t> edges;  // wedges composing the aperture
     wavenumber_t k;
 
+    fsd_aperture_t(wavenumber_t k, std::pmr::memory_resource* mem) noexcept
+        : edges(mem), k(k)
+    {}
+    fsd_aperture_t(fsd_aperture_t&&) noexcept = default;
+
     [[nodiscard]] inline bool single_edge() const noexcept { return edges.size()==1; }
 };
 
@@ -60,6 +60,7 @@ public:
      * @param edges edges accessor
      * @param wave_function wave function Gaussian
      * @param interaction_point interaction point within the beam
+     * @param mem memory resource for the aperture, and for the scratch used when sampling (e.g., a per-sample ``bump_arena_t``)
      */
     free_space_diffraction_t(const ads::ads_t* ads,
                              const fsd_sampler::fsd_sampler_t *fsd_sampler,
@@ -67,7 +68,8 @@ public:
                              wavenumber_t k, f_t totalPower,
                              const elliptic_cone_t& beam,
                              const ads::intersection_record_t::edges_container_t& edges,
-                             const beam::gaussian_wavefront_t& wave_function) noexcept;
+                             const beam::gaussian_wavefront_t& wave_function,
+                             std::pmr::memory_resource* mem = std::pmr::get_default_resource()) noexcept;
     free_space_diffraction_t(free_space_diffraction_t&&) noexcept = default;
 
     /**
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
 #include <wt/math/common.hpp>
 
 namespace wt::fraunhofer::fsd {
@@ -34,18 +35,27 @@ struct edge_t {
 };
 
 /**
- * @brief An FSD aperture
+ * @brief An FSD aperture. Its storage, and the scratch used for sampling it, are allocated from ``memory_resource()``.
  */
 struct fsd_aperture_t {
-    std::vector<edge_t> edges;  // aperture edges
+    std::pmr::vector<edge_t> edges;  // aperture edges
 
-    std::vector<f_t> edge_pdfs; // edge selection pdfs for sampling
+    std::pmr::vector<f_t> edge_pdfs; // edge selection pdfs for sampling
     f_t P0;
     f_t P0_pdf;                 // PDF of selecting 0-th order lobe
 
     f_t psi02;                  // complex magnitude squared of integrated field amplitude (over the aperture opening)
     f_t recp_I;                 // reciprocal of total incident beam intensity (over the aperture opening)
 
+    explicit fsd_aperture_t(std::pmr::memory_resource* mem = std::pmr::get_default_resource()) noexcept
+        : edges(mem), edge_pdfs(mem)
+    {}
+    fsd_aperture_t(fsd_aperture_t&&) noexcept = default;
+
+    [[nodiscard]] inline auto* memory_resource() const noexcept {
+        return edges.get_allocator().resource();
+    }
+
     inline void reserve(std::size_t n) noexcept {
         edges.reserve(n);
         edge_pdfs.reserve(n);
@@ -9,12 +9,17 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <filesystem>
 
 #include <wt/math/common.hpp>
 #include <wt/wt_context.hpp>
 
 #include <wt/util/array.hpp>
+#include <wt/util/mmap_file.hpp>
 
 namespace wt {
 
@@ -30,7 +35,24 @@ private:
         wt::array_t<f_t, Nsamples> iCDFtheta1, iCDFtheta2;
         wt::array_t<f_t, Msamples,Msamples> iCDF1, iCDF2;
     };
-    std::unique_ptr<data_t> data;
+    // LUTs, either owned (loaded from the fp64 tables) or memory mapped from the LUT cache
+    const data_t* data = nullptr;
+    std::unique_ptr<data_t> owned_data;
+    std::unique_ptr<mmap_file_t> mapped_data;
+
+    /**
+     * @brief Size and modification time of the fp64 tables that a LUT cache was generated from.
+     */
+    struct source_stamp_t {
+        std::uint64_t size;
+        std::int64_t mtime;
+    };
+    using source_stamps_t = std::array<source_stamp_t, 4>;
+
+    bool load_cache(const std::filesystem::path& path,
+                    const std::optional<source_stamps_t>& sources);
+    void store_cache(const std::filesystem::path& path,
+                     const source_stamps_t& sources) const noexcept;
 
     // linear interpolation of LUTs
     template <std::size_t S>
@@ -69,6 +91,10 @@ private:
     }
 
 public:
+    /**
+     * @brief Loads the LUTs. The LUTs are memory mapped from a pre-converted cache (``data/fsd/fsd_lut.f32.wtlut``, or ``.f64`` with double-precision builds), when one exists and is up to date with the fp64 tables: no conversion is done on startup, and concurrent processes share the mapped pages.
+     *        Otherwise, the fp64 tables are loaded and converted, and the cache is (re)generated next to them.
+     */
     fsd_lut_t(const wt_context_t &context);
 
     /**
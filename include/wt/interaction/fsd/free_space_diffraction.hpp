@@ -10,6 +10,7 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
 #include <optional>
 
 #include <wt/ads/ads.hpp>
@@ -54,7 +55,8 @@ public:
         dir3_t wi,wo;
         length_t ri, ro;
     };
-    using eval_ret_t = std::vector<diffracting_edge_t>;
+    // allocated from the aperture's memory resource
+    using eval_ret_t = std::pmr::vector<diffracting_edge_t>;
 
 public:
     /**
@@ -62,6 +64,7 @@ public:
      * 
      * @param k wavenumber
      * @param edges edges accessor
+     * @param mem memory resource for the aperture and for evaluation results (e.g., a per-sample ``bump_arena_t``)
      */
     free_space_diffraction_t(
             const ads::ads_t* ads,
@@ -70,7 +73,8 @@ public:
             const pqvec3_t& interaction_region_size,
             const dir3_t& wi,
             wavenumber_t k,
-            const ads::intersection_record_t::edges_container_t& edges) noexcept;
+            const ads::intersection_record_t::edges_container_t& edges,
+            std::pmr::memory_resource* mem = std::pmr::get_default_resource()) noexcept;
     free_space_diffraction_t(free_space_diffraction_t&&) noexcept = default;
 
     /**
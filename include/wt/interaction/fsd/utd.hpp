@@ -9,7 +9,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <span>
+
 #include <wt/math/common.hpp>
+#include <wt/math/simd/wide_vector.hpp>
 #include "common.hpp"
 
 #define CERF_AS_CPP
@@ -18,22 +23,39 @@
 namespace wt::utd {
 
 static constexpr f_t utd_min_sin_beta = 1e-3;
+/**
+ * @brief Lanes per block in ``UTD_coefficients()``.
+ */
+static constexpr std::size_t UTD_batch_width = 8;
 
 /**
  * @brief The UTD `a±` function
+ * @param phi angle (in radians)
  */
 template <int sgn>
-inline constexpr f_t UTDa(const Angle auto phi, f_t n) noexcept {
+inline f_t UTDa(f_t phi, f_t n) noexcept {
     static_assert(sgn==+1 || sgn==-1);
 
-    const auto N = m::round((f_t)(sgn * m::pi + phi/u::ang::rad) * m::inv_two_pi / n);
-    return 2 * m::sqr(m::cos(m::pi*n*N * u::ang::rad - phi/2));
+    const auto N = m::round((sgn * m::pi + phi) * m::inv_two_pi / n);
+    return 2 * m::sqr(m::cos((m::pi*n*N - phi/2) * u::ang::rad));
 }
 
 /**
- * @brief The UTD `F` transition function
+ * @brief The UTD `F` transition function, asymptotic expansion for large arguments (|x|>=6).
  */
-inline constexpr c_t UTDF(f_t x) noexcept {
+inline c_t UTDF_asymptotic(f_t absx) noexcept {
+    const auto r = 1/(2*absx);
+    const auto r2 = r*r;
+    const auto r3 = r2*r;
+    const auto r4 = r2*r2;
+    return f_t(1) + c_t{ 0,1 }*r - 3*r2 - c_t{ 0,15 }*r3 + 75*r4;
+}
+
+/**
+ * @brief The UTD `F` transition function, evaluated via the complex complementary error function.
+ *        Reference implementation: use ``UTDF()``.
+ */
+inline c_t UTDF_exact(f_t x) noexcept {
     const auto absx = m::abs(x);
 
     c_t result;
@@ -46,16 +68,209 @@ inline constexpr c_t UTDF(f_t x) noexcept {
                  cerf;
     } else {
         // fast approximation for large values
-        const auto r = 1/(2*absx);
-        const auto r2 = r*r;
-        const auto r3 = r2*r;
-        const auto r4 = r2*r2;
-        result = f_t(1) + c_t{ 0,1 }*r - 3*r2 - c_t{ 0,15 }*r3 + 75*r4;
+        result = UTDF_asymptotic(absx);
     }
 
     return x<0 ? std::conj(result) : result;
 }
 
+/**
+ * @brief Tabulated UTD `F` transition function for |x|<6, where ``UTDF_exact()`` evaluates a complex ``cerfc``. Larger arguments use the asymptotic expansion.
+ *        `F(x)` behaves like `sqrt(x)` near 0, but is smooth in `s=sqrt(|x|)`: the table is uniform in `s`, and linearly interpolated.
+ *        The interpolation error against ``UTDF_exact()`` is below ``error_bound``: it is asserted when the table is built (debug builds only), and measured by ``validation::check_utd()``.
+ */
+class UTDF_table_t {
+public:
+    static constexpr std::size_t samples = 1024;
+    static constexpr f_t xmax = 6;
+    /** @brief Bound on the absolute error (|F|<=1.3 over the tabulated range).
+     */
+    static constexpr f_t error_bound = 1e-5;
+
+private:
+    alignas(64) f_t re[samples];
+    alignas(64) f_t im[samples];
+    f_t inv_ds;
+
+public:
+    UTDF_table_t() noexcept {
+        const auto smax = m::sqrt(xmax);
+        const auto ds = smax / f_t(samples-1);
+        inv_ds = 1/ds;
+
+        // (the last sample is taken just below xmax: in single precision sqr(smax) may round up to xmax, where UTDF_exact() switches to the asymptotic expansion)
+        const auto below_xmax = std::nextafter(xmax, f_t(0));
+        for (std::size_t i=0; i<samples; ++i) {
+            const auto F = UTDF_exact(m::min(m::sqr(i*ds), below_xmax));
+            re[i] = F.real();
+            im[i] = F.imag();
+        }
+
+#ifndef NDEBUG
+        // validate: the interpolation error peaks between samples
+        f_t max_err = 0;
+        for (std::size_t i=0; i+1<samples; ++i) {
+            for (const auto t : { f_t(.25), f_t(.5), f_t(.75) }) {
+                const auto x = m::sqr((i+t)*ds);
+                if (x>=xmax) continue;
+                max_err = m::max(max_err, std::abs((*this)(x) - UTDF_exact(x)));
+            }
+        }
+        assert(max_err<error_bound);
+#endif
+    }
+
+    /**
+     * @brief Evaluates `F(x)`, writes real and imaginary parts. Branchless.
+     */
+    inline void lookup(f_t x, f_t& Fre, f_t& Fim) const noexcept {
+        const auto absx = m::abs(x);
+
+        // table
+        const auto s = m::min(m::sqrt(absx) * inv_ds, f_t(samples-1));
+        const auto i = std::min((std::size_t)s, samples-2);
+        const auto f = s - f_t(i);
+        const auto tre = re[i] + f*(re[i+1]-re[i]);
+        const auto tim = im[i] + f*(im[i+1]-im[i]);
+
+        // asymptotic expansion
+        const auto r  = 1/(2*m::max(absx, xmax));
+        const auto r2 = r*r;
+        const auto are = 1 - 3*r2 + 75*r2*r2;
+        const auto aim = r - 15*r2*r;
+
+        const bool tabulated = absx<xmax;
+        Fre = tabulated ? tre : are;
+        Fim = tabulated ? tim : aim;
+        Fim = x<0 ? -Fim : Fim;
+    }
+
+    /**
+     * @brief Evaluates `F(x)` for each element of the wide vector `x`, writes real and imaginary parts. Same arithmetic as the scalar ``lookup()``: the table reads are per element, all else is wide.
+     */
+    template <std::size_t W>
+    inline void lookup(const f_w_t<W>& x, f_w_t<W>& Fre, f_w_t<W>& Fim) const noexcept {
+        using fw_t = f_w_t<W>;
+        const auto absx = m::abs(x);
+
+        // table
+        const auto s = m::min(m::sqrt(absx) * inv_ds, fw_t::from_scalar(f_t(samples-1)));
+        const auto i = m::min(m::floor(s), fw_t::from_scalar(f_t(samples-2)));
+        const auto f = s - i;
+        f_t re0[W], re1[W], im0[W], im1[W];
+        for (std::size_t l=0; l<W; ++l) {
+            const auto j = (std::size_t)i.read(l);
+            re0[l] = re[j];  re1[l] = re[j+1];
+            im0[l] = im[j];  im1[l] = im[j+1];
+        }
+        const auto tre0 = fw_t{ re0, simd::unaligned_data };
+        const auto tim0 = fw_t{ im0, simd::unaligned_data };
+        const auto tre = m::fma(f, fw_t{ re1, simd::unaligned_data } - tre0, tre0);
+        const auto tim = m::fma(f, fw_t{ im1, simd::unaligned_data } - tim0, tim0);
+
+        // asymptotic expansion
+        const auto r  = fw_t::one() / (m::max(absx, fw_t::from_scalar(xmax)) * f_t(2));
+        const auto r2 = r*r;
+        const auto are = fw_t::one() - r2*f_t(3) + r2*r2*f_t(75);
+        const auto aim = r - r2*r*f_t(15);
+
+        const auto tabulated = absx < fw_t::from_scalar(xmax);
+        Fre = m::selectv(are, tre, tabulated);
+        Fim = m::selectv(aim, tim, tabulated);
+        Fim = m::selectv(Fim, -Fim, x < fw_t::zero());
+    }
+
+    [[nodiscard]] inline c_t operator()(f_t x) const noexcept {
+        f_t Fre, Fim;
+        lookup(x, Fre, Fim);
+        return { Fre, Fim };
+    }
+};
+
+/**
+ * @brief The (process wide) table used by ``UTDF()``. Built on first use.
+ */
+inline const UTDF_table_t& UTDF_table() noexcept {
+    static const UTDF_table_t table;
+    return table;
+}
+
+/**
+ * @brief The UTD `F` transition function
+ */
+inline c_t UTDF(f_t x) noexcept {
+    return UTDF_table()(x);
+}
+
+/**
+ * @brief Evaluates the UTD diffraction coefficients of a batch of wedges (e.g., all candidate edges of an interaction). Does NOT account for the phase term exp(-i*k*ro).
+ *        Wedges are processed in blocks of ``UTD_batch_width``, as wide vectors (``f_w_t``): the transition functions (table interpolation and asymptotic expansion) and the coefficient sums use the SIMD engine.
+ *        The transition function arguments (``UTDa()``), the cotangent weights and the zero test call libm (round, cos, tan, fmod), which the SIMD engine does not provide, and are evaluated per wedge, as are the table reads.
+ * @param args per-wedge arguments (see ``wedge_edge_t::UTD_args()``)
+ * @param Ds output soft diffraction coefficients, same size as ``args``
+ * @param Dh output hard diffraction coefficients, same size as ``args``
+ */
+inline void UTD_coefficients(
+        std::span<const UTD_args_t> args,
+        std::span<c_t> Ds,
+        std::span<c_t> Dh) noexcept {
+    static constexpr std::size_t W = UTD_batch_width;
+    using fw_t = f_w_t<W>;
+    assert(args.size()==Ds.size() && args.size()==Dh.size());
+
+    const auto& table = UTDF_table();
+    const auto phase = std::exp(c_t{ 0,-m::pi_4 });
+
+    for (std::size_t b=0; b<args.size(); b+=W) {
+        const auto lanes = std::min(W, args.size()-b);
+
+        // transition function arguments, cotangent weights and scale (zero on the excluded angles), per wedge
+        // (padding with the last wedge)
+        f_t x[4][W], c[4][W], scale[W];
+        for (std::size_t l=0; l<W; ++l) {
+            const auto& a = args[b + std::min(l, lanes-1)];
+            const auto phim = a.phii - a.phio;
+            const auto phip = a.phii + a.phio;
+
+            x[0][l] = a.kL * UTDa<+1>(phim, a.n);
+            x[1][l] = a.kL * UTDa<-1>(phim, a.n);
+            x[2][l] = a.kL * UTDa<+1>(phip, a.n);
+            x[3][l] = a.kL * UTDa<-1>(phip, a.n);
+
+            const auto inv_2n = 1 / (2*a.n);
+            c[0][l] = m::cot((m::pi + phim) * inv_2n * u::ang::rad);
+            c[1][l] = m::cot((m::pi - phim) * inv_2n * u::ang::rad);
+            c[2][l] = m::cot((m::pi + phip) * inv_2n * u::ang::rad);
+            c[3][l] = m::cot((m::pi - phip) * inv_2n * u::ang::rad);
+
+            const auto t1 = m::mod(phip, m::pi_2);
+            const auto t2 = m::mod(phim, m::pi_2);
+            const bool zero = m::abs(t1)<f_t(1e-5) || m::abs(t2)<f_t(1e-5);
+            scale[l] = zero ? f_t(0) : a.scale;
+        }
+
+        // transition functions, and D1+D2 -/+ (D3+D4), where Dj = -cot_j * Fj
+        fw_t Fre[4], Fim[4], cw[4];
+        for (int j=0; j<4; ++j) {
+            table.lookup(fw_t{ x[j], simd::unaligned_data }, Fre[j], Fim[j]);
+            cw[j] = fw_t{ c[j], simd::unaligned_data };
+        }
+        const auto s = fw_t{ scale, simd::unaligned_data };
+        const auto d12re = s * m::fma(cw[0], Fre[0], cw[1]*Fre[1]);
+        const auto d12im = s * m::fma(cw[0], Fim[0], cw[1]*Fim[1]);
+        const auto d34re = s * m::fma(cw[2], Fre[2], cw[3]*Fre[3]);
+        const auto d34im = s * m::fma(cw[2], Fim[2], cw[3]*Fim[3]);
+        const auto dsre = d12re - d34re, dsim = d12im - d34im;
+        const auto dhre = d12re + d34re, dhim = d12im + d34im;
+
+        for (std::size_t l=0; l<lanes; ++l) {
+            Ds[b+l] = phase * c_t{ dsre.read(l), dsim.read(l) };
+            Dh[b+l] = phase * c_t{ dhre.read(l), dhim.read(l) };
+            assert(m::isfinite(Ds[b+l]) && m::isfinite(Dh[b+l]));
+        }
+    }
+}
+
 /**
 * @brief Returns point on wedge that satisfies Fermat's principle, if such a point exists.
 */
@@ -107,9 +322,9 @@ inline constexpr c_t UTDF(f_t x) noexcept {
 }
 
 /**
-* @brief The UTD wedge diffraction function. Does NOT account for the phase term exp(-i*k*ro).
+* @brief Arguments of the UTD diffraction coefficients, for batched evaluation with ``UTD_coefficients()``.
 */
-[[nodiscard]] inline UTD_ret_t wedge_edge_t::UTD(
+[[nodiscard]] inline UTD_args_t wedge_edge_t::UTD_args(
         const Wavenumber auto k,
         const dir3_t& wi,
         const dir3_t& wo,
@@ -119,51 +334,43 @@ inline constexpr c_t UTDF(f_t x) noexcept {
     const auto& e = this->e();
     const auto n = 2 - (f_t)(alpha/u::ang::rad)*m::inv_pi;
 
-    // build in/out transverse frames
-    const auto& ti = -m::normalize(m::cross(e, -wi));
-    const auto& bi =  m::normalize(m::cross(ti,-wi));
-    const auto& to = -m::normalize(m::cross(e,  wo));
-    const auto& bo =  m::normalize(m::cross(to, wo));
-
     // angles
     const auto sin_beta2 = m::max<f_t>(0, 1-m::sqr(m::dot(wi,e)));
     const auto sin_beta = m::sqrt(sin_beta2);
     const auto phii = m::atan2(m::dot(nff,wi), m::dot(tff,wi));
     const auto phio = m::atan2(m::dot(nff,wo), m::dot(tff,wo));
 
-    // distance parameters
+    // distance parameter (Li = Lrn = Lro)
     const auto Li = ro * sin_beta2;
-    const auto Lrn = Li, Lro = Li;
-
-    // diffraction coefficients
-    const auto a1 = UTDa<+1>(phii-phio, n);
-    const auto a2 = UTDa<-1>(phii-phio, n);
-    const auto a3 = UTDa<+1>(phii+phio, n);
-    const auto a4 = UTDa<-1>(phii+phio, n);
-    const auto F1 = UTDF(u::to_num(k * Li ) * a1);
-    const auto F2 = UTDF(u::to_num(k * Li ) * a2);
-    const auto F3 = UTDF(u::to_num(k * Lrn) * a3);
-    const auto F4 = UTDF(u::to_num(k * Lro) * a4);
-    const auto D1 = -m::cot((m::pi*u::ang::rad + (phii-phio)) / (2*n)) * F1;
-    const auto D2 = -m::cot((m::pi*u::ang::rad - (phii-phio)) / (2*n)) * F2;
-    const auto D3 = -m::cot((m::pi*u::ang::rad + (phii+phio)) / (2*n)) * F3;
-    const auto D4 = -m::cot((m::pi*u::ang::rad - (phii+phio)) / (2*n)) * F4;
 
     const auto kro = u::to_num(k*ro);
-    const auto D =
-        1/(2*n*m::sqrt(kro)*sin_beta) * m::inv_sqrt_two_pi *
-        std::exp(c_t{ 0,-m::pi_4 });
 
-    const auto t1 = (f_t)(m::mod(phii+phio, m::pi_2) / u::ang::rad);
-    const auto t2 = (f_t)(m::mod(phii-phio, m::pi_2) / u::ang::rad);
-    const auto Ds = m::abs(t1)<f_t(1e-5) || m::abs(t2)<f_t(1e-5) ? 0 : D1+D2-(D3+D4);
-    const auto Dh = m::abs(t1)<f_t(1e-5) || m::abs(t2)<f_t(1e-5) ? 0 : D1+D2+(D3+D4);
+    return UTD_args_t{
+        .n = n,
+        .phii = (f_t)(phii/u::ang::rad),
+        .phio = (f_t)(phio/u::ang::rad),
+        .kL = (f_t)u::to_num(k * Li),
+        .scale = 1/(2*n*m::sqrt(kro)*sin_beta) * m::inv_sqrt_two_pi,
+    };
+}
 
-    assert(m::isfinite(Dh) && m::isfinite(Ds));
+/**
+* @brief The SH incident and scattering frames of the UTD wedge diffraction function. Diffraction coefficients are left zero.
+*/
+[[nodiscard]] inline UTD_ret_t wedge_edge_t::UTD_frames(
+        const dir3_t& wi,
+        const dir3_t& wo) const noexcept {
+    const auto& e = this->e();
+
+    // build in/out transverse frames
+    const auto& ti = -m::normalize(m::cross(e, -wi));
+    const auto& bi =  m::normalize(m::cross(ti,-wi));
+    const auto& to = -m::normalize(m::cross(e,  wo));
+    const auto& bo =  m::normalize(m::cross(to, wo));
 
     return UTD_ret_t{
-        .Ds = -D*Ds,
-        .Dh = -D*Dh,
+        .Ds = 0,
+        .Dh = 0,
         .si = ti,
         .hi = bi,
         .so = to,
@@ -171,4 +378,21 @@ inline constexpr c_t UTDF(f_t x) noexcept {
     };
 }
 
+/**
+* @brief The UTD wedge diffraction function. Does NOT account for the phase term exp(-i*k*ro).
+*        To evaluate many wedges, prefer ``UTD_args()`` and ``UTD_coefficients()``.
+*/
+[[nodiscard]] inline UTD_ret_t wedge_edge_t::UTD(
+        const Wavenumber auto k,
+        const dir3_t& wi,
+        const dir3_t& wo,
+        const length_t ro) const noexcept {
+    const auto args = UTD_args(k, wi, wo, ro);
+
+    auto ret = UTD_frames(wi, wo);
+    UTD_coefficients(std::span{ &args,1 }, std::span{ &ret.Ds,1 }, std::span{ &ret.Dh,1 });
+
+    return ret;
+}
+
 }
@@ -90,14 +90,22 @@ public:
 
     inline intersection_surface_t(const shape_t* shape,
                                   const ads::tri_t& ads_tri,
+                                  const dir3_t& geo_n,
                                   const ray_t& ray,
                                   const intersect::intersect_ray_tri_ret_t& ray_intersection_record) noexcept
-        : intersection_surface_t(shape, ads_tri.n,
+        : intersection_surface_t(shape, geo_n,
                                  ads_tri.shape_tri_idx, 
                                  ray_intersection_record.bary, 
                                  ray.propagate(ray_intersection_record.dist))
     {}
 
+    /**
+     * @brief Intersection with a level-of-detail proxy (see ``ads::proxy_tri_t``), which has no mesh triangle: shaded with the proxy's aggregated normal (as both geometric and shading normal), and without texture coordinates.
+     */
+    intersection_surface_t(const shape_t* shape,
+                           const ads::proxy_tri_t& proxy,
+                           const pqvec3_t& beam_intersection_centre) noexcept;
+
     // dummy surface (no associated shape -- like a virtual coverage sensor) intersection
     inline intersection_surface_t(const dir3_t& geo_n,
                                   const pqvec3_t& beam_intersection_centre) noexcept
@@ -109,10 +117,15 @@ public:
     intersection_surface_t(const intersection_surface_t&) noexcept = default;
 
 
+    /**
+     * @brief TRUE for intersections with a level-of-detail proxy, which references no mesh triangle.
+     */
+    [[nodiscard]] inline bool is_proxy() const noexcept { return mesh_tri_idx==ads::tri_t::proxy_shape_tri_idx; }
+
     [[nodiscard]] inline const auto& ng() const noexcept { return geo.n; }
     [[nodiscard]] inline const auto& ns() const noexcept { return shading.n; }
 
-    [[nodiscard]] const mesh::surface_differentials_t& tangent_frame() const noexcept;
+    [[nodiscard]] mesh::surface_differentials_t tangent_frame() const noexcept;
 
     /**
      * @brief Returns the s-polarization direction in world coordinates (normal to incidence plane).
@@ -165,14 +178,17 @@ public:
  * @brief Describes a beam-edge intersection geometry.
  */
 struct intersection_edge_t {
+    // ADS that holds the edge, and its triangles
+    const ads::ads_t* ads;
     // intersected edge
     const ads::edge_t* edge;
 
     // point of edge intersection
     pqvec3_t wp;
 
-    inline intersection_edge_t(const ads::edge_t& edge, const pqvec3_t& wp) noexcept
-        : edge(&edge),
+    inline intersection_edge_t(const ads::ads_t& ads, const ads::edge_t& edge, const pqvec3_t& wp) noexcept
+        : ads(&ads),
+          edge(&edge),
           wp(wp)
     {}
 
@@ -9,6 +9,10 @@
 
 #pragma once
 
+#include <cassert>
+#include <span>
+#include <type_traits>
+
 #include <wt/math/common.hpp>
 #include <wt/math/rotation.hpp>
 #include <wt/math/frame.hpp>
@@ -16,6 +20,7 @@
 
 #include <wt/interaction/fresnel.hpp>
 #include <wt/interaction/polarimetric/stokes.hpp>
+#include <wt/interaction/polarimetric/mueller_kernels.hpp>
 
 namespace wt {
 
@@ -92,7 +97,7 @@ public:
     [[nodiscard]] friend inline auto operator*(
             const mueller_operator_t& M1,
             const mueller_operator_t& M2) noexcept {
-        return mueller_operator_t{ M1.matrix() * M2.matrix() };
+        return mueller_operator_t{ mueller_kernels::mul(M1.matrix(), M2.matrix()) };
     }
 
     /**
@@ -130,15 +135,41 @@ public:
     [[nodiscard]] friend inline auto operator*(
             const mueller_operator_t& M,
             const stokes_parameters_t<Q>& S) noexcept {
-        const auto& Mt = m::transpose(M.matrix());
-        return stokes_parameters_t<Q>{
-            .S = {
-                m::dot(Mt[0],S.S),
-                m::dot(Mt[1],S.S),
-                m::dot(Mt[2],S.S),
-                m::dot(Mt[3],S.S)
-            },
-        };
+        if constexpr (std::is_same_v<typename Q::rep, f_t>) {
+            const auto v = mueller_kernels::apply(M.matrix(), S.S.numerical_value_in(Q::unit));
+            return stokes_parameters_t<Q>{ .S = qvec4<Q>{ v * Q::unit } };
+        } else {
+            const auto& Mt = m::transpose(M.matrix());
+            return stokes_parameters_t<Q>{
+                .S = {
+                    m::dot(Mt[0],S.S),
+                    m::dot(Mt[1],S.S),
+                    m::dot(Mt[2],S.S),
+                    m::dot(Mt[3],S.S)
+                },
+            };
+        }
+    }
+
+    /**
+     * @brief Transformation of a batch of Stokes parameters vectors (e.g., the wavelengths of a spectral batch) via the Mueller matrix: ``out[i] = M*in[i]``.
+     *        Frames are assumed to match. ``in`` and ``out`` must be of the same size, and may alias.
+     */
+    template <Quantity Q>
+    inline void apply(
+            std::span<const stokes_parameters_t<Q>> in,
+            std::span<stokes_parameters_t<Q>> out) const noexcept {
+        assert(in.size()==out.size());
+
+        const auto op = mueller_kernels::loaded_matrix_t{ M };
+        for (std::size_t i=0; i<in.size(); ++i) {
+            if constexpr (std::is_same_v<typename Q::rep, f_t>) {
+                const auto v = op(in[i].S.numerical_value_in(Q::unit));
+                out[i] = stokes_parameters_t<Q>{ .S = qvec4<Q>{ v * Q::unit } };
+            } else {
+                out[i] = *this * in[i];
+            }
+        }
     }
 
     /**
@@ -187,12 +218,14 @@ public:
         assert_iszero(1-m::dot(old_frame.n, new_frame.n));
 
         const auto t = dir2_t{ vec2_t{ old_frame.to_local(new_frame.t) } };
-        auto R = mueller_operator_t::rotation(t, dir2_t{ 1,0 });
-        // flip handness if needed
-        if (old_frame.handness() != new_frame.handness())
-            R *= mueller_operator_t::handness_flip();
+        auto R = mueller_operator_t::rotation_block(t, dir2_t{ 1,0 });
+        // flip handness if needed: R * handness_flip() negates the last 2 columns
+        if (old_frame.handness() != new_frame.handness()) {
+            R.B[1] = -R.B[1];
+            R.d = -1;
+        }
         
-        return *this * R;
+        return mueller_operator_t{ mueller_kernels::mul_rotation_right(M, R) };
     }
 
     /**
@@ -204,12 +237,14 @@ public:
         assert_iszero(1-m::dot(old_frame.n, new_frame.n));
 
         const auto t = dir2_t{ vec2_t{ old_frame.to_local(new_frame.t) } };
-        auto R = mueller_operator_t::rotation(t, dir2_t{ 1,0 });
-        // flip handness if needed
-        if (old_frame.handness() != new_frame.handness())
-            R *= mueller_operator_t::handness_flip();
+        auto R = mueller_operator_t::rotation_block(t, dir2_t{ 1,0 });
+        // flip handness if needed: R * handness_flip() negates the last 2 columns
+        if (old_frame.handness() != new_frame.handness()) {
+            R.B[1] = -R.B[1];
+            R.d = -1;
+        }
         
-        return R * *this;
+        return mueller_operator_t{ mueller_kernels::mul_rotation_left(R, M) };
     }
 
  
@@ -237,6 +272,17 @@ public:
         };
     }
 
+    /**
+     * @brief Rotation block of the Mueller rotation operator that rotates from tangent ``t1`` to tangent ``t2``.
+     *        See ``mueller_kernels::mul_rotation_left()`` and ``mueller_kernels::mul_rotation_right()``.
+     */
+    static inline mueller_kernels::rotation_block_t rotation_block(
+            const dir2_t& t1,
+            const dir2_t& t2) noexcept {
+        const auto R = util::rotation_matrix(t1,t2);
+        return { .B = m::transpose(R*R), .d = 1 };
+    }
+
     /**
      * @brief Constructs a Mueller rotation operator.
      *        Rotates from tangent ``t1`` to tangent ``t2``.
@@ -244,17 +290,7 @@ public:
     static inline mueller_operator_t rotation(
             const dir2_t& t1,
             const dir2_t& t2) noexcept {
-        auto R = util::rotation_matrix(t1,t2);
-        R = R*R;
-
-        auto T = matrix_type{ 0 };
-        T[0][0] = T[3][3] = 1;
-        T[1][1] = R[0][0];
-        T[2][1] = R[1][0];
-        T[1][2] = R[0][1];
-        T[2][2] = R[1][1];
-
-        return mueller_operator_t{ m::transpose(T) };
+        return mueller_operator_t{ mueller_kernels::rotation_matrix(rotation_block(t1,t2)) };
     }
 
     /**
@@ -406,12 +442,18 @@ public:
         const frame_t& M2out) noexcept {
     assert_iszero(1-m::dot(M1in.n, M2out.n));
     const auto to = dir2_t{ vec2_t{ M1in.to_local(M2out.t) } };
-    auto R = mueller_operator_t::rotation(to, dir2_t{ 1,0 });
+    auto R = mueller_operator_t::rotation_block(to, dir2_t{ 1,0 });
 
-    if (M1in.handness() != M2out.handness())
-        R = mueller_operator_t::handness_flip() * R;
+    // handness_flip() * R negates the last 2 rows
+    if (M1in.handness() != M2out.handness()) {
+        R.B[0][1] = -R.B[0][1];
+        R.B[1][1] = -R.B[1][1];
+        R.d = -1;
+    }
 
-    return M1 * R * M2;
+    return mueller_operator_t{
+        mueller_kernels::mul(mueller_kernels::mul_rotation_right(M1.matrix(), R), M2.matrix())
+    };
 }
 
 
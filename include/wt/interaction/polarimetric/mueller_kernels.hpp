@@ -0,0 +1,221 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include <wt/math/common.hpp>
+
+#if defined(SIMD_AVX) && defined(__AVX2__)
+#include <immintrin.h>
+#define WT_MUELLER_KERNELS_SIMD
+#endif
+
+// 4x4 Mueller-matrix kernels: compose, apply and frame rotation.
+// With SIMD_AVX, a matrix column is a single SIMD register (4 x f_t): products are computed as sums of scaled columns, which avoids the transposes and horizontal reductions of the scalar (dot product) formulation.
+
+namespace wt::mueller_kernels {
+
+/**
+ * @brief The non-trivial part of a Mueller rotation operator (see ``mueller_operator_t::rotation()``), optionally with a handness flip:
+ *        the matrix is ``{ 1,0,0,0 | 0,B,0 | 0,0,0,d }``, where ``B`` is the 2x2 rotation block acting on S1 and S2, and ``d`` is 1 or -1 (handness flip).
+ */
+struct rotation_block_t {
+    mat2_t B;
+    f_t d;
+};
+
+/**
+ * @brief The full 4x4 rotation operator described by ``blk``.
+ */
+[[nodiscard]] inline mat4_t rotation_matrix(const rotation_block_t& blk) noexcept {
+    auto T = mat4_t{ 0 };
+    T[0][0] = 1;
+    T[1][1] = blk.B[0][0];
+    T[1][2] = blk.B[0][1];
+    T[2][1] = blk.B[1][0];
+    T[2][2] = blk.B[1][1];
+    T[3][3] = blk.d;
+    return T;
+}
+
+#ifdef WT_MUELLER_KERNELS_SIMD
+
+namespace detail {
+
+#ifndef _DBL_SUPPORT
+using col_t = __m128;
+inline col_t load(const f_t* p) noexcept  { return _mm_loadu_ps(p); }
+inline void  store(f_t* p, col_t v) noexcept { _mm_storeu_ps(p, v); }
+inline col_t set1(f_t x) noexcept { return _mm_set1_ps(x); }
+inline col_t set(f_t x, f_t y, f_t z, f_t w) noexcept { return _mm_setr_ps(x,y,z,w); }
+inline col_t mul(col_t a, col_t b) noexcept { return _mm_mul_ps(a,b); }
+inline col_t madd(col_t a, col_t b, col_t c) noexcept {
+#ifdef __FMA__
+    return _mm_fmadd_ps(a,b,c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a,b),c);
+#endif
+}
+// (x,y,z,w) -> (x,z,y,w)
+inline col_t swap12(col_t v) noexcept { return _mm_shuffle_ps(v,v, _MM_SHUFFLE(3,1,2,0)); }
+#else
+using col_t = __m256d;
+inline col_t load(const f_t* p) noexcept  { return _mm256_loadu_pd(p); }
+inline void  store(f_t* p, col_t v) noexcept { _mm256_storeu_pd(p, v); }
+inline col_t set1(f_t x) noexcept { return _mm256_set1_pd(x); }
+inline col_t set(f_t x, f_t y, f_t z, f_t w) noexcept { return _mm256_setr_pd(x,y,z,w); }
+inline col_t mul(col_t a, col_t b) noexcept { return _mm256_mul_pd(a,b); }
+inline col_t madd(col_t a, col_t b, col_t c) noexcept {
+#ifdef __FMA__
+    return _mm256_fmadd_pd(a,b,c);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(a,b),c);
+#endif
+}
+// (x,y,z,w) -> (x,z,y,w)
+inline col_t swap12(col_t v) noexcept { return _mm256_permute4x64_pd(v, _MM_SHUFFLE(3,1,2,0)); }
+#endif
+
+struct cols_t {
+    col_t c[4];
+
+    explicit cols_t(const mat4_t& M) noexcept {
+        for (int i=0; i<4; ++i)
+            c[i] = load(&M[i][0]);
+    }
+
+    // M * (x,y,z,w)
+    [[nodiscard]] inline col_t apply(const f_t* v) const noexcept {
+        auto r = mul(c[0], set1(v[0]));
+        r = madd(c[1], set1(v[1]), r);
+        r = madd(c[2], set1(v[2]), r);
+        r = madd(c[3], set1(v[3]), r);
+        return r;
+    }
+};
+
+}
+
+#endif
+
+
+/**
+ * @brief Matrix product ``A*B``.
+ */
+[[nodiscard]] inline mat4_t mul(const mat4_t& A, const mat4_t& B) noexcept {
+#ifdef WT_MUELLER_KERNELS_SIMD
+    const auto a = detail::cols_t{ A };
+    mat4_t ret;
+    for (int j=0; j<4; ++j)
+        detail::store(&ret[j][0], a.apply(&B[j][0]));
+    return ret;
+#else
+    return A*B;
+#endif
+}
+
+/**
+ * @brief Matrix-vector product ``M*v``.
+ */
+[[nodiscard]] inline vec4_t apply(const mat4_t& M, const vec4_t& v) noexcept {
+#ifdef WT_MUELLER_KERNELS_SIMD
+    vec4_t ret;
+    detail::store(&ret[0], detail::cols_t{ M }.apply(&v[0]));
+    return ret;
+#else
+    return M*v;
+#endif
+}
+
+/**
+ * @brief A matrix held in registers, for applying a single operator to many vectors (e.g., the Stokes vectors of a spectral batch).
+ */
+class loaded_matrix_t {
+private:
+#ifdef WT_MUELLER_KERNELS_SIMD
+    detail::cols_t m;
+#else
+    mat4_t m;
+#endif
+
+public:
+    explicit loaded_matrix_t(const mat4_t& M) noexcept : m(M) {}
+
+    [[nodiscard]] inline vec4_t operator()(const vec4_t& v) const noexcept {
+#ifdef WT_MUELLER_KERNELS_SIMD
+        vec4_t ret;
+        detail::store(&ret[0], m.apply(&v[0]));
+        return ret;
+#else
+        return m*v;
+#endif
+    }
+};
+
+/**
+ * @brief Applies a single matrix to ``count`` vectors: ``out[i] = M*in[i]``. The matrix is loaded once.
+ *        ``in`` and ``out`` may alias.
+ */
+inline void apply(const mat4_t& M, const vec4_t* in, vec4_t* out, std::size_t count) noexcept {
+    const auto m = loaded_matrix_t{ M };
+    for (std::size_t i=0; i<count; ++i)
+        out[i] = m(in[i]);
+}
+
+/**
+ * @brief Product ``M*R``, where ``R`` is the rotation operator described by ``blk``.
+ */
+[[nodiscard]] inline mat4_t mul_rotation_right(const mat4_t& M, const rotation_block_t& blk) noexcept {
+    mat4_t ret;
+#ifdef WT_MUELLER_KERNELS_SIMD
+    const auto c1 = detail::load(&M[1][0]);
+    const auto c2 = detail::load(&M[2][0]);
+    ret[0] = M[0];
+    detail::store(&ret[1][0], detail::madd(c1, detail::set1(blk.B[0][0]), detail::mul(c2, detail::set1(blk.B[0][1]))));
+    detail::store(&ret[2][0], detail::madd(c1, detail::set1(blk.B[1][0]), detail::mul(c2, detail::set1(blk.B[1][1]))));
+    detail::store(&ret[3][0], detail::mul(detail::load(&M[3][0]), detail::set1(blk.d)));
+#else
+    ret[0] = M[0];
+    ret[1] = M[1]*blk.B[0][0] + M[2]*blk.B[0][1];
+    ret[2] = M[1]*blk.B[1][0] + M[2]*blk.B[1][1];
+    ret[3] = M[3]*blk.d;
+#endif
+    return ret;
+}
+
+/**
+ * @brief Product ``R*M``, where ``R`` is the rotation operator described by ``blk``.
+ */
+[[nodiscard]] inline mat4_t mul_rotation_left(const rotation_block_t& blk, const mat4_t& M) noexcept {
+    mat4_t ret;
+#ifdef WT_MUELLER_KERNELS_SIMD
+    // R*c = c*(1,B00,B11,d) + (c0,c2,c1,c3)*(0,B10,B01,0)
+    const auto diag = detail::set(1, blk.B[0][0], blk.B[1][1], blk.d);
+    const auto offd = detail::set(0, blk.B[1][0], blk.B[0][1], 0);
+    for (int j=0; j<4; ++j) {
+        const auto c = detail::load(&M[j][0]);
+        detail::store(&ret[j][0], detail::madd(detail::swap12(c), offd, detail::mul(c, diag)));
+    }
+#else
+    for (int j=0; j<4; ++j) {
+        const auto& c = M[j];
+        ret[j] = vec4_t{
+            c[0],
+            blk.B[0][0]*c[1] + blk.B[1][0]*c[2],
+            blk.B[0][1]*c[1] + blk.B[1][1]*c[2],
+            blk.d*c[3]
+        };
+    }
+#endif
+    return ret;
+}
+
+}
@@ -131,4 +131,17 @@ inline intersect_ball_aabb_w_ret_t<W> test_ball_aabb(
     };
 }
 
+/**
+ * @brief Squared distance from the ball's centre to AABBs, zero when the centre is inside an AABB. Wide test.
+ */
+template <std::size_t W>
+inline auto sqr_distance_ball_aabb(
+        const ball_t& ball,
+        const pqvec3_w_t<W>& aabb_min,
+        const pqvec3_w_t<W>& aabb_max) noexcept {
+    const auto c = pqvec3_w_t<W>{ ball.centre };
+    const auto d = c - m::clamp(c, aabb_min, aabb_max);
+    return m::dot(d,d);
+}
+
 }
@@ -81,25 +81,23 @@ inline bool test_ray_tri(const ray_t& r,
 }
 
 /**
- * @brief Ray-triangle intersection test. Wide test.
+ * @brief Ray-triangle intersection test. Wide test, with triangles given by a vertex and two edge vectors.
  *        Möller–Trumbore ray-triangle intersection, 1997, 10.1080/10867651.1997.10487468
  *
  * @param ro ray origins
  * @param rd ray directions
  * @param a first vertices of triangles
- * @param b second vertices of triangles
- * @param c third vertices of triangles
+ * @param e1 edges from first to second vertices of triangles
+ * @param e2 edges from first to third vertices of triangles
  */
 template <std::size_t W>
-inline auto test_ray_tri(const pqvec3_w_t<W>& ro,
-                         const vec3_w_t<W>& rd,
-                         const pqvec3_w_t<W>& a,
-                         const pqvec3_w_t<W>& b,
-                         const pqvec3_w_t<W>& c,
-                         const pqrange_t<>& range = pqrange_t<>::positive()) noexcept {
+inline auto test_ray_tri_edges(const pqvec3_w_t<W>& ro,
+                               const vec3_w_t<W>& rd,
+                               const pqvec3_w_t<W>& a,
+                               const pqvec3_w_t<W>& e1,
+                               const pqvec3_w_t<W>& e2,
+                               const pqrange_t<>& range = pqrange_t<>::positive()) noexcept {
     const auto ray = ro-a;
-    const auto e1 = b-a;
-    const auto e2 = c-a;
     const auto crs = m::cross(rd, e2);
     auto det = m::dot(e1, crs);
 
@@ -127,6 +125,26 @@ inline auto test_ray_tri(const pqvec3_w_t<W>& ro,
     return valid && cond1 && cond2 && cond3 && cond4 && cond5;
 }
 
+/**
+ * @brief Ray-triangle intersection test. Wide test.
+ *        Möller–Trumbore ray-triangle intersection, 1997, 10.1080/10867651.1997.10487468
+ *
+ * @param ro ray origins
+ * @param rd ray directions
+ * @param a first vertices of triangles
+ * @param b second vertices of triangles
+ * @param c third vertices of triangles
+ */
+template <std::size_t W>
+inline auto test_ray_tri(const pqvec3_w_t<W>& ro,
+                         const vec3_w_t<W>& rd,
+                         const pqvec3_w_t<W>& a,
+                         const pqvec3_w_t<W>& b,
+                         const pqvec3_w_t<W>& c,
+                         const pqrange_t<>& range = pqrange_t<>::positive()) noexcept {
+    return test_ray_tri_edges(ro, rd, a, b-a, c-a, range);
+}
+
 /**
  * @brief Ray-rectangle intersection test. a-b, b-c, c-d, d-a are the edges of the rectangle.
  */
@@ -180,26 +198,24 @@ inline std::optional<intersect_ray_tri_ret_t> intersect_ray_tri(
 }
 
 /**
- * @brief Ray-triangle intersection. Returns distance or -inf if no intersection. Wide test.
+ * @brief Ray-triangle intersection. Returns distance or -inf if no intersection. Wide test, with triangles given by a vertex and two edge vectors.
  *        Möller–Trumbore ray-triangle intersection, 1997, 10.1080/10867651.1997.10487468
  *
  * @param ro ray origins
  * @param rd ray directions
  * @param a first vertices of triangles
- * @param b second vertices of triangles
- * @param c third vertices of triangles
+ * @param e1 edges from first to second vertices of triangles
+ * @param e2 edges from first to third vertices of triangles
  */
 template <std::size_t W>
-inline intersect_ray_tri_w_ret_t<W> intersect_ray_tri(
+inline intersect_ray_tri_w_ret_t<W> intersect_ray_tri_edges(
         const pqvec3_w_t<W>& ro,
         const vec3_w_t<W>& rd,
         const pqvec3_w_t<W>& a,
-        const pqvec3_w_t<W>& b,
-        const pqvec3_w_t<W>& c,
+        const pqvec3_w_t<W>& e1,
+        const pqvec3_w_t<W>& e2,
         const pqrange_t<>& range = pqrange_t<>::positive()) noexcept {
     const auto ray = ro-a;
-    const auto e1 = b-a;
-    const auto e2 = c-a;
     const auto crs = m::cross(rd, e2);
     auto det = m::dot(e1, crs);
 
@@ -235,6 +251,27 @@ inline intersect_ray_tri_w_ret_t<W> intersect_ray_tri(
     };
 }
 
+/**
+ * @brief Ray-triangle intersection. Returns distance or -inf if no intersection. Wide test.
+ *        Möller–Trumbore ray-triangle intersection, 1997, 10.1080/10867651.1997.10487468
+ *
+ * @param ro ray origins
+ * @param rd ray directions
+ * @param a first vertices of triangles
+ * @param b second vertices of triangles
+ * @param c third vertices of triangles
+ */
+template <std::size_t W>
+inline intersect_ray_tri_w_ret_t<W> intersect_ray_tri(
+        const pqvec3_w_t<W>& ro,
+        const vec3_w_t<W>& rd,
+        const pqvec3_w_t<W>& a,
+        const pqvec3_w_t<W>& b,
+        const pqvec3_w_t<W>& c,
+        const pqrange_t<>& range = pqrange_t<>::positive()) noexcept {
+    return intersect_ray_tri_edges(ro, rd, a, b-a, c-a, range);
+}
+
 /**
  * @brief Ray-AABB intersection test. Returns intersection range. If range is empty, no intersection occurs.
  */
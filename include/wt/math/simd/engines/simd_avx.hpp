@@ -430,8 +430,6 @@ static inline simd_avx_t<float,8> permute2f(simd_avx_t<float,8> a, simd_avx_t<fl
  */
 template <int mask>
 static inline simd_avx_t<double,8> permute2f(simd_avx_t<double,8> a, simd_avx_t<double,8> b) noexcept {
-    // TODO: untested
-
     constexpr auto kz = 
         (unsigned char)(((mask>>3)&1) ? 0 : 0x0F) +
         (unsigned char)(((mask>>7)&1) ? 0 : 0xF0);
@@ -451,7 +449,8 @@ static inline simd_avx_t<double,8> permute2f(simd_avx_t<double,8> a, simd_avx_t<
     };
 
     constexpr auto s = idx_generator();
-    const auto idx = _mm512_set_epi64(s[0],s[1],s[2],s[3],s[4],s[5],s[6],s[7]);
+    // _mm512_set_epi64 takes elements from highest to lowest
+    const auto idx = _mm512_set_epi64(s[7],s[6],s[5],s[4],s[3],s[2],s[1],s[0]);
 
     return { _mm512_maskz_permutex2var_pd(kz, a.v, idx, b.v) };
 }
@@ -606,13 +605,8 @@ static inline bool any4(simd_avx_t<float,4> v) noexcept {
     return b0 || b1;
 }
 static inline bool any4(simd_avx_t<double,4> v) noexcept {
-    const auto w = _mm256_permute_pd(v.v, 0xe);
-    const auto b = _mm256_or_pd(v.v,w);
-
-    const auto b0 = !(std::bit_cast<double>(_mm256_extract_epi64(_mm256_castpd_si256(b), 0)));
-    const auto b1 = !(std::bit_cast<double>(_mm256_extract_epi64(_mm256_castpd_si256(b), 1)));
-
-    return b0 || b1;
+    // _mm256_permute_pd does not cross 128-bit lanes: read the mask bits directly
+    return _mm256_movemask_pd(v.v) != 0;
 }
 
 static inline bool all4(simd_avx_t<float,4> v) noexcept {
@@ -625,13 +619,7 @@ static inline bool all4(simd_avx_t<float,4> v) noexcept {
     return b0 && b1;
 }
 static inline bool all4(simd_avx_t<double,4> v) noexcept {
-    const auto w = _mm256_permute_pd(v.v, 0xe);
-    const auto b = _mm256_and_pd(v.v,w);
-
-    const auto b0 = !(std::bit_cast<double>(_mm256_extract_epi64(_mm256_castpd_si256(b), 0)));
-    const auto b1 = !(std::bit_cast<double>(_mm256_extract_epi64(_mm256_castpd_si256(b), 1)));
-
-    return b0 && b1;
+    return _mm256_movemask_pd(v.v) == 0xF;
 }
 
 }
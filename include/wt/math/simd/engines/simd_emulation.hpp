@@ -28,8 +28,8 @@ struct simd_emulated_t {
     std::array<Fp,Width> v;
 
     template <std::size_t idx>
-    [[nodiscard]] inline float extract_static() const noexcept { return v[idx]; }
-    [[nodiscard]] inline float extract(std::size_t i) const noexcept { return v[i]; }
+    [[nodiscard]] inline Fp extract_static() const noexcept { return v[idx]; }
+    [[nodiscard]] inline Fp extract(std::size_t i) const noexcept { return v[i]; }
 };
 
 static inline simd_emulated_t<float,8> cast_to_256(simd_emulated_t<float,4> src) noexcept {
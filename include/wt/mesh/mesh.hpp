@@ -27,12 +27,10 @@ namespace wt::mesh {
 
 /**
  * @brief A triangular mesh.
+ *        Geometry is indexed: vertices (world space), per-vertex shading normals and texture coordinates are shared between triangles, and identical vertices are welded at construction.
+ *        Per-triangle data (face normal, tangent frame, etc.) is computed on demand.
  */
 class mesh_t {
-private:
-    std::vector<triangle_t> tris;
-    aabb_t aabb;
-
 public:
     using tidx_t = std::uint32_t;
 
@@ -41,10 +39,18 @@ public:
     };
 
 private:
-    mesh_t(std::vector<triangle_t> tris);
+    std::vector<pqvec3_t> vertices;
+    /** @brief Per-vertex shading normals. Empty when the mesh has no normals: geometric normals are used instead. */
+    std::vector<encoded_normal_t> normals;
+    /** @brief Per-vertex texture coordinates. Empty when the mesh has no uvs. */
+    std::vector<vec2_t> texcoords;
+
+    std::vector<tri_indices_t> indices;
+
+    aabb_t aabb;
 
+private:
     void compute_aabb() noexcept;
-    void compute_tangent_frames() noexcept;
 
 public:
     mesh_t(const std::string& shape_id,
@@ -59,63 +65,99 @@ public:
     mesh_t(const mesh_t&) = default;
     mesh_t& operator=(mesh_t&&) = default;
 
+    [[nodiscard]] inline auto triangles_count() const noexcept { return indices.size(); }
+    [[nodiscard]] inline auto vertices_count() const noexcept { return vertices.size(); }
+    [[nodiscard]] inline bool has_normals() const noexcept { return !normals.empty(); }
+    [[nodiscard]] inline bool has_uvs() const noexcept { return !texcoords.empty(); }
+
+    [[nodiscard]] inline const auto& get_vertices() const noexcept { return vertices; }
+    [[nodiscard]] inline const auto& get_indices() const noexcept { return indices; }
+
+    [[nodiscard]] inline auto triangle_vertices(tidx_t tidx) const noexcept {
+        const auto& ind = indices[tidx].idx;
+        return std::array<pqvec3_t,3>{ vertices[ind[0]], vertices[ind[1]], vertices[ind[2]] };
+    }
+
     [[nodiscard]] static inline dir3_t triangle_face_normal(const triangle_t& t) noexcept {
         return t.geo_n;
     }
-    [[nodiscard]] inline auto triangle_face_normal(tidx_t tidx) const noexcept {
-        return triangle_face_normal(tris[tidx]);
+    [[nodiscard]] inline dir3_t triangle_face_normal(tidx_t tidx) const noexcept {
+        const auto p = triangle_vertices(tidx);
+        // degenerate triangles are discarded at construction
+        return util::tri_face_normal(p[0],p[1],p[2]).value_or(dir3_t{ 0,0,1 });
     }
 
     [[nodiscard]] static inline auto triangle_surface_area(const triangle_t& t) noexcept {
-        const auto& a = t.p[0];
-        const auto& b = t.p[1];
-        const auto& c = t.p[2];
-
-        return util::tri_surface_area(a,b,c);
+        return util::tri_surface_area(t.p[0],t.p[1],t.p[2]);
     }
     [[nodiscard]] inline auto triangle_surface_area(tidx_t tidx) const noexcept {
-        return triangle_surface_area(tris[tidx]);
+        const auto p = triangle_vertices(tidx);
+        return util::tri_surface_area(p[0],p[1],p[2]);
     }
 
     /**
      * @brief Tangent frame (partial derivatives of position w.r.t. uv coordinates)
      */
-    [[nodiscard]] static inline const surface_differentials_t& tangent_frame(const triangle_t& t) noexcept {
-        return t.tangent_frame;
+    [[nodiscard]] static inline surface_differentials_t tangent_frame(const triangle_t& t) noexcept {
+        const auto& uv0 = !t.uv ? vec2_t{ 0,0 } : (*t.uv)[0];
+        const auto& uv1 = !t.uv ? vec2_t{ 0,0 } : (*t.uv)[1];
+        const auto& uv2 = !t.uv ? vec2_t{ 0,0 } : (*t.uv)[2];
+        return surface_differentials_for_triangle(t.p[0], t.p[1], t.p[2], uv0, uv1, uv2);
     }
     /**
      * @brief Tangent frame (partial derivatives of position w.r.t. uv coordinates)
      */
-    [[nodiscard]] inline const surface_differentials_t& tangent_frame(tidx_t tidx) const noexcept {
-        return tangent_frame(tris[tidx]);
+    [[nodiscard]] inline surface_differentials_t tangent_frame(tidx_t tidx) const noexcept {
+        return tangent_frame(triangle(tidx));
     }
 
-    [[nodiscard]] inline const auto& triangle(tidx_t tidx) const noexcept {
-        return tris[tidx];
+    /**
+     * @brief Assembles a triangle's vertices and shading attributes from the vertex store.
+     */
+    [[nodiscard]] inline triangle_t triangle(tidx_t tidx) const noexcept {
+        const auto& ind = indices[tidx].idx;
+        auto t = triangle_t{
+            .p = { vertices[ind[0]], vertices[ind[1]], vertices[ind[2]] },
+            .geo_n = dir3_t{ 0,0,1 },
+        };
+        t.geo_n = util::tri_face_normal(t.p[0],t.p[1],t.p[2]).value_or(dir3_t{ 0,0,1 });
+
+        if (has_normals())
+            t.n = { normals[ind[0]], normals[ind[1]], normals[ind[2]] };
+        else
+            t.n[0] = t.n[1] = t.n[2] = encoded_normal_t{ t.geo_n };
+
+        if (has_uvs())
+            t.uv = { texcoords[ind[0]], texcoords[ind[1]], texcoords[ind[2]] };
+
+        return t;
     }
 
     inline void flip_normals() {
         // flip normals and winding order
-        for (auto& t : tris) {
-            t.geo_n = -t.geo_n;
-            std::swap(t.p[0],t.p[1]);
-
-            t.n[0] = encoded_normal_t{ -dir3_t{ t.n[0] } };
-            t.n[1] = encoded_normal_t{ -dir3_t{ t.n[1] } };
-            t.n[2] = encoded_normal_t{ -dir3_t{ t.n[2] } };
-            std::swap(t.n[0],t.n[1]);
-
-            if (t.uv)
-                std::swap((*t.uv)[0],(*t.uv)[1]);
-        }
+        for (auto& n : normals)
+            n = encoded_normal_t{ -dir3_t{ n } };
+        for (auto& t : indices)
+            std::swap(t.idx[0],t.idx[1]);
     }
 
+    /**
+     * @brief Transforms the mesh geometry (vertices and shading normals) in place. Topology and triangle order are unchanged.
+     */
+    void transform(const transform_d_t& t) noexcept;
+
     [[nodiscard]] inline const auto& get_aabb() const noexcept {
         return aabb;
     }
 
-    [[nodiscard]] inline const auto& get_tris() const noexcept {
-        return tris;
+    /**
+     * @brief Resident memory used by the mesh geometry, in bytes.
+     */
+    [[nodiscard]] inline std::size_t memory_bytes() const noexcept {
+        return vertices.capacity()*sizeof(pqvec3_t) +
+               normals.capacity()*sizeof(encoded_normal_t) +
+               texcoords.capacity()*sizeof(vec2_t) +
+               indices.capacity()*sizeof(tri_indices_t);
     }
 
     [[nodiscard]] scene::element::info_t description() const;
@@ -18,15 +18,17 @@
 
 namespace wt::mesh {
 
-struct alignas(64) triangle_t {
+/**
+ * @brief A triangle's vertices and shading attributes.
+ *        Meshes store indexed geometry: a triangle_t is assembled on demand from the shared vertex store (see ``mesh_t::triangle()``), and is not stored.
+ */
+struct triangle_t {
     std::array<pqvec3_t,3> p;
 
     dir3_t geo_n;
     std::array<encoded_normal_t,3> n;
 
     std::optional<std::array<vec2_t,3>> uv;
-
-    surface_differentials_t tangent_frame;
 };
 
 }
@@ -0,0 +1,58 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <filesystem>
+
+#include <wt/scene/scene.hpp>
+#include <wt/mesh/mesh.hpp>
+#include <wt/math/transform/transform.hpp>
+
+namespace wt::scene {
+
+/**
+ * @brief Rigid per-shape animation over a sequence of frames, loaded from a plain-text keyframe file.
+ *        Each line that is not empty or a comment (`#`) reads one of
+ *            <frame> <shape id> translate <x,y,z>
+ *            <frame> <shape id> rotate <axis x,y,z> <angle>
+ *        Lengths and angles accept units, as in scene files (lengths default to metres).
+ *        Operations listed for the same frame and shape are composed in order, and give the shape's transform relative to its pose in the scene file. A shape keeps its transform in frames that do not list it.
+ *        Only rigid transforms are supported: triangle areas (and thus emitter sampling data) are preserved.
+ */
+class animation_t {
+public:
+    struct shape_transform_t {
+        std::uint32_t shape_idx;
+        transform_d_t transform;
+    };
+
+private:
+    std::vector<std::vector<shape_transform_t>> frames;
+
+    // meshes of animated shapes, as posed in the scene file
+    std::map<std::uint32_t, mesh::mesh_t> rest_meshes;
+    // current transforms of animated shapes
+    std::map<std::uint32_t, transform_d_t> current;
+
+public:
+    animation_t(const std::filesystem::path& path, const scene_t& scene);
+
+    [[nodiscard]] inline auto frames_count() const noexcept { return frames.size(); }
+
+    /**
+     * @brief Poses the scene's shapes for a frame. Returns the indices of the shapes whose geometry changed.
+     *        Must not be called while the scene is being rendered.
+     */
+    std::vector<std::uint32_t> apply(std::size_t frame, const scene_t& scene);
+};
+
+}
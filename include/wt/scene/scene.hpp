@@ -91,12 +91,22 @@ public:
 
     /**
      * @brief Given a sensor, samples an emitter from all scene emitters, as well as a wavenumber from the sampled emitter's spectrum (integrated over the sensor's spectrum).
+     * @param sampler sampler to use (overriding the scene's sampler)
      * @param sensor used sensor
      */
     [[nodiscard]] inline emitter_wavenumber_sample_t sample_emitter_and_spectrum(
+            sampler::sampler_t& sampler,
             const sensor::sensor_t* sensor) const noexcept {
         const auto* scs = get_scene_sensor(sensor);
-        return scs->sample_emitter_and_spectrum(*this, sampler());
+        return scs->sample_emitter_and_spectrum(*this, sampler);
+    }
+    /**
+     * @brief Given a sensor, samples an emitter from all scene emitters, as well as a wavenumber from the sampled emitter's spectrum (integrated over the sensor's spectrum).
+     * @param sensor used sensor
+     */
+    [[nodiscard]] inline emitter_wavenumber_sample_t sample_emitter_and_spectrum(
+            const sensor::sensor_t* sensor) const noexcept {
+        return sample_emitter_and_spectrum(sampler(), sensor);
     }
 
     /**
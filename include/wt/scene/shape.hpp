@@ -71,6 +71,12 @@ public:
     [[nodiscard]] const auto& get_emitter() const { return emitter; }
     [[nodiscard]] const auto& get_mesh() const    { return mesh; }
 
+    /**
+     * @brief Replaces the shape's geometry, e.g. with a transformed copy of its mesh (see `wt::scene::animation_t`). Must not be called while the shape is being rendered.
+     *        Per-triangle data held by an attached area emitter is not rebuilt: the new mesh should be a rigidly transformed copy of the shape's mesh.
+     */
+    void set_mesh(mesh_t mesh);
+
     [[nodiscard]] inline auto get_surface_area() const noexcept { return sampling_data.surface_area; }
 
     /**
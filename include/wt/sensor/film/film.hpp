@@ -13,11 +13,11 @@
 #include <vector>
 #include <stack>
 #include <memory>
+#include <algorithm>
 
 #include <cassert>
 
 #include <wt/math/common.hpp>
-#include <wt/math/distribution/gaussian1d.hpp>
 #include <wt/util/for_range.hpp>
 
 #include <wt/bitmap/bitmap.hpp>
@@ -29,6 +29,7 @@
 #include <wt/sensor/block/padded_block.hpp>
 
 #include <wt/sensor/film/film_storage.hpp>
+#include <wt/sensor/film/rfilter_table.hpp>
 #include <wt/sensor/response/response.hpp>
 
 #include <wt/scene/loader/node_readers.hpp>
@@ -72,9 +73,8 @@ private:
     mutable std::stack<block_handle_t> blocks;
 
     // beam Gaussian reconstruction data
-    static constexpr f_t rfilter_stddev_to_radius = 3;
+    const rfilter_table_t rfilter_table;
     const std::uint16_t rf_radius;
-    const gaussian1d_t rfilter;
 
     const bvec_t flip = {};
 
@@ -127,8 +127,8 @@ public:
         : size(size),
           sensor_response(std::move(response)),
           block_size(block_size),
-          rf_radius(std::uint32_t(m::ceil(rfilter_stddev * rfilter_stddev_to_radius) + f_t(.5))),
-          rfilter(gaussian1d_t{ rfilter_stddev }),
+          rfilter_table(rfilter_stddev),
+          rf_radius(rfilter_table.radius()),
           flip(flip)
     {
         assert(rfilter_stddev>=0 && rf_radius>=0);
@@ -224,7 +224,7 @@ public:
         }
 
         const auto r = (int)rf_radius;
-        const auto rfw = compute_rfilter_weights(offset_t{ element.offset });
+        const auto rfw = rfilter_table.weights<Dims>(offset_t{ element.offset });
         const auto comps = pixel_layout().components;
 
         const auto& film_pos = element.element;
@@ -264,9 +264,11 @@ public:
         const auto r = (int)rf_radius;
         const auto pos = index_t{ element.element-block_handle.position } + index_t{ block.padding };
 
-        const auto rfw = compute_rfilter_weights(offset_t{ element.offset });
+        const auto rfw = rfilter_table.weights<Dims>(offset_t{ element.offset });
         const auto comps = pixel_layout().components;
+        [[assume(comps>=1 && comps<=4)]];
 
+        FilmSampleT vals[4];
         for (std::uint8_t c=0;c<comps;++c) {
             auto val = sensitivity(sample, c, k);
             // avoid NaNs, infs and negatives
@@ -275,16 +277,21 @@ public:
                 val = val.x>=0 && m::isfinite(val) ? val : FilmSampleT{};
             else
                 val = val>=0 && m::isfinite(val) ? val : 0;
+            vals[c] = val;
+        }
 
-            std::size_t i=0;
-            for_range(index_t{ -r }, index_t{ r+1 }, [&](auto ridx) {
-                const auto w = (*rfw.weights)[i++] * rfw.recp_total_weight;
-                block(size_t{ pos + ridx }, c) += film_sample_t{
-                    .value = w * val,
+        // components of an element are adjacent in the block: accumulate them together
+        std::size_t i=0;
+        for_range(index_t{ -r }, index_t{ r+1 }, [&](auto ridx) {
+            const auto w = (*rfw.weights)[i++] * rfw.recp_total_weight;
+            auto* dst = &block(size_t{ pos + ridx }, 0);
+            for (std::uint8_t c=0;c<comps;++c) {
+                dst[c] += film_sample_t{
+                    .value = w * vals[c],
                     .weight = w,
                 };
-            });
-        }
+            }
+        });
     }
 
     [[nodiscard]] inline const auto* response() const noexcept {
@@ -300,47 +307,6 @@ public:
         return f_t(size.x)/f_t(size.y);
     }
 
-private:
-    struct rfilter_weights_t {
-        const std::vector<f_t>* weights;
-        f_t recp_total_weight;
-    };
-    [[nodiscard]] rfilter_weights_t compute_rfilter_weights(const offset_t& pixel_fractional_offset) const noexcept {
-        const auto r = (int)rf_radius;
-        const auto& o = pixel_fractional_offset;
-
-        const auto W  = 2*r+1;
-        static thread_local std::vector<f_t> temp, weights;
-
-        temp.resize(Dims*W);
-        weights.clear();
-
-        // integrate rfilter over pixel footprint
-
-        for (auto d=0ul;d<Dims;++d)
-        for (auto x=-r;x<=r;++x) {
-            temp[x+r + d*W] = rfilter.integrate(range_t{ x+o[d]-f_t(.5), x+o[d]+f_t(.5) });
-            assert(temp[x+r + d*W]>=0);
-        }
-
-        f_t tw = 0;
-        for_range(index_t{ -r }, index_t{ r+1 }, [&](auto ridx) {
-            f_t w = 1;
-            for (auto d=0ul;d<Dims;++d)
-                w *= temp[ridx[d]+r + d*W];
-            w = m::max<f_t>(0,w);
-            
-            // total weight
-            tw += w;
-            weights.push_back(w);
-        });
-
-        return {
-            .weights = &weights, 
-            .recp_total_weight = tw>0 ? f_t(1)/tw : 0
-        };
-    }
-
 public:
     [[nodiscard]] scene::element::info_t description() const {
         using namespace scene::element;
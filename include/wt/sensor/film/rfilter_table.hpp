@@ -0,0 +1,149 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <cassert>
+
+#include <wt/math/common.hpp>
+#include <wt/math/distribution/gaussian1d.hpp>
+
+namespace wt::sensor {
+
+/**
+ * @brief Separable table of the Gaussian reconstruction filter of a film, integrated over the footprints of the `2*radius+1` elements around an element, for equidistant sub-element offsets in [-1/2,1/2].
+ *        Rows are linearly interpolated: the interpolation error grows like 1/stddev^2, hence the count of tabulated offsets grows like 1/stddev, keeping the error of a normalized weight below ~5e-5 (see ``validation::check_rfilter_weights()``).
+ */
+class rfilter_table_t {
+public:
+    static constexpr f_t stddev_to_radius = 3;
+
+    static constexpr std::size_t min_offsets = 64;
+    static constexpr std::size_t max_offsets = 4096;
+    /** @brief Tabulated offsets per 1/stddev (stddev in film elements).
+     */
+    static constexpr f_t offsets_per_recp_stddev = 48;
+
+    /**
+     * @brief Reconstruction filter weights of the `(2*radius+1)^Dims` elements around a sample, ordered as iterated by ``for_range()`` (last dimension innermost).
+     *        ``weights`` points to per-thread storage, valid until the next call to ``weights()`` from the same thread.
+     */
+    struct weights_t {
+        const std::vector<f_t>* weights;
+        f_t recp_total_weight;
+    };
+
+private:
+    gaussian1d_t rfilter;
+    std::uint16_t r;
+    std::size_t offsets;
+
+    std::vector<f_t> table;
+    std::vector<f_t> sums;
+
+public:
+    /**
+     * @param stddev standard deviation, in film elements, of the Gaussian reconstruction filter
+     */
+    explicit rfilter_table_t(f_t stddev)
+        : rfilter(gaussian1d_t{ stddev }),
+          r(std::uint32_t(m::ceil(stddev * stddev_to_radius) + f_t(.5))),
+          offsets(rfilter.is_dirac() ?
+                    min_offsets :
+                    (std::size_t)m::clamp(m::ceil(offsets_per_recp_stddev / stddev), f_t(min_offsets), f_t(max_offsets)))
+    {
+        assert(stddev>=0);
+
+        const auto W = std::size_t(2*r+1);
+
+        // integrate rfilter over the element footprints, for each tabulated offset
+        table.resize((offsets+1)*W);
+        sums.assign(offsets+1, 0);
+        for (std::size_t i=0;i<=offsets;++i) {
+            const auto o = f_t(i)/f_t(offsets) - f_t(.5);
+            for (auto x=-(int)r;x<=(int)r;++x) {
+                const auto w = rfilter.integrate(range_t{ x+o-f_t(.5), x+o+f_t(.5) });
+                assert(w>=0);
+                table[i*W + x+r] = m::max<f_t>(0,w);
+                sums[i] += table[i*W + x+r];
+            }
+        }
+    }
+
+    /**
+     * @brief Radius, in film elements, of the reconstruction filter footprint.
+     */
+    [[nodiscard]] inline auto radius() const noexcept { return r; }
+    /**
+     * @brief Count of tabulated sub-element offset intervals.
+     */
+    [[nodiscard]] inline auto offset_count() const noexcept { return offsets; }
+
+    /**
+     * @brief Computes the reconstruction filter weights of the elements around a sample, from the separable table.
+     * @param pixel_fractional_offset offset of the sample from the centre of its element, in [-1/2,1/2]
+     */
+    template <std::size_t Dims>
+    [[nodiscard]] weights_t weights(const vec<Dims,f_t>& pixel_fractional_offset) const noexcept {
+        const auto& o = pixel_fractional_offset;
+
+        const auto W  = std::size_t(2*r+1);
+        static thread_local std::vector<f_t> rows, weights;
+
+        rows.resize(Dims*W);
+
+        // interpolate the integrated filter rows of each dimension
+        f_t tw = 1;
+        for (auto d=0ul;d<Dims;++d) {
+            const auto t = (m::clamp(o[d], -f_t(.5), f_t(.5)) + f_t(.5)) * f_t(offsets);
+            const auto i = std::min((std::size_t)t, offsets-1);
+            const auto f = t - f_t(i);
+
+            const auto* r0 = &table[i*W];
+            const auto* r1 = r0 + W;
+            auto* row = &rows[d*W];
+            for (std::size_t x=0;x<W;++x)
+                row[x] = r0[x] + f*(r1[x]-r0[x]);
+
+            tw *= sums[i] + f*(sums[i+1]-sums[i]);
+        }
+
+        // outer product of the rows
+        if constexpr (Dims==1) {
+            weights.assign(rows.begin(), rows.end());
+        } else if constexpr (Dims==2) {
+            weights.resize(W*W);
+            for (std::size_t a=0;a<W;++a) {
+                const auto wa = rows[a];
+                auto* dst = &weights[a*W];
+                for (std::size_t b=0;b<W;++b)
+                    dst[b] = wa * rows[W+b];
+            }
+        } else {
+            weights.resize(W*W*W);
+            for (std::size_t a=0;a<W;++a)
+            for (std::size_t b=0;b<W;++b) {
+                const auto wab = rows[a] * rows[W+b];
+                auto* dst = &weights[(a*W+b)*W];
+                for (std::size_t c=0;c<W;++c)
+                    dst[c] = wab * rows[2*W+c];
+            }
+        }
+
+        return {
+            .weights = &weights,
+            .recp_total_weight = tw>0 ? f_t(1)/tw : 0
+        };
+    }
+};
+
+}
@@ -0,0 +1,159 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wt {
+
+/**
+ * @brief Bump (linear) allocator for short-lived data, e.g. the BSDFs and temporaries of a single path sample.
+ *        Allocations advance a pointer in the current block, deallocation is a no-op, and ``reset()`` releases everything at once.
+ *        Memory is kept across resets: once the arena has grown to the peak footprint of a sample, it no longer allocates from the heap.
+ *        Blocks are allocated from an upstream memory resource (the heap by default), and are only returned to it when the arena is destroyed.
+ *        Objects constructed with ``make()`` are destroyed on reset, in reverse order of construction.
+ *
+ *        Also a ``std::pmr::memory_resource``: ``std::pmr`` containers may allocate from the arena.
+ *        Not thread safe, meant to be held per thread pool worker (see ``integrator_context_t::acquire_sample_arena()``).
+ */
+class bump_arena_t final : public std::pmr::memory_resource {
+private:
+    static constexpr std::size_t default_block_size = 64*1024;
+
+    static constexpr std::size_t block_alignment = alignof(std::max_align_t);
+
+    struct block_t {
+        std::byte* mem;
+        std::size_t size;
+    };
+    std::pmr::memory_resource* upstream;
+    std::pmr::vector<block_t> blocks;
+    std::size_t current = 0;
+    std::size_t offset = 0;
+
+    // destructors of objects constructed with make(), newest first
+    struct dtor_t {
+        void (*destroy)(void*) noexcept;
+        void* obj;
+        dtor_t* next;
+    };
+    dtor_t* dtors = nullptr;
+
+    inline void run_dtors() noexcept {
+        for (auto* d = dtors; d; d = d->next)
+            d->destroy(d->obj);
+        dtors = nullptr;
+    }
+
+    inline void free_blocks() noexcept {
+        for (const auto& b : blocks)
+            upstream->deallocate(b.mem, b.size, block_alignment);
+        blocks.clear();
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        for (;;) {
+            if (current<blocks.size()) {
+                auto& b = blocks[current];
+                const auto base = reinterpret_cast<std::uintptr_t>(b.mem);
+                const auto p = (base + offset + alignment-1) & ~(std::uintptr_t)(alignment-1);
+                if (p + bytes <= base + b.size) {
+                    offset = p + bytes - base;
+                    return reinterpret_cast<void*>(p);
+                }
+                // next block
+                ++current;
+                offset = 0;
+                continue;
+            }
+
+            // grow geometrically
+            auto size = blocks.empty() ? default_block_size : blocks.back().size*2;
+            while (size < bytes+alignment)
+                size *= 2;
+            // (grow the list first: the block is not leaked if the list cannot grow)
+            blocks.reserve(blocks.size()+1);
+            blocks.emplace_back(block_t{ static_cast<std::byte*>(upstream->allocate(size, block_alignment)), size });
+        }
+    }
+    void do_deallocate(void*, std::size_t, std::size_t) noexcept override {}
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+        return this==&o;
+    }
+
+public:
+    /**
+     * @param upstream memory resource that the arena's blocks are allocated from
+     */
+    explicit bump_arena_t(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept
+        : upstream(upstream), blocks(upstream)
+    {}
+    bump_arena_t(const bump_arena_t&) = delete;
+    bump_arena_t& operator=(const bump_arena_t&) = delete;
+    /**
+     * @brief Arenas must not be moved while they hold live allocations.
+     */
+    bump_arena_t(bump_arena_t&& o) noexcept
+        : upstream(o.upstream),
+          blocks(std::move(o.blocks)),
+          current(std::exchange(o.current, 0)),
+          offset(std::exchange(o.offset, 0)),
+          dtors(std::exchange(o.dtors, nullptr))
+    {}
+
+    ~bump_arena_t() noexcept override {
+        run_dtors();
+        free_blocks();
+    }
+
+    /**
+     * @brief Constructs an object in the arena. Its destructor (if not trivial) runs on ``reset()``.
+     */
+    template <typename T, typename... Args>
+    [[nodiscard]] inline T* make(Args&&... args) {
+        auto* obj = ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            dtors = ::new (allocate(sizeof(dtor_t), alignof(dtor_t))) dtor_t{
+                .destroy = [](void* p) noexcept { static_cast<T*>(p)->~T(); },
+                .obj = obj,
+                .next = dtors,
+            };
+        }
+        return obj;
+    }
+
+    /**
+     * @brief Destroys all objects constructed with ``make()``, and releases all allocations.
+     *        Blocks are kept, and are reused in order: resetting neither allocates nor frees memory.
+     */
+    inline void reset() noexcept {
+        run_dtors();
+        current = 0;
+        offset = 0;
+    }
+
+    /**
+     * @brief Bytes reserved by the arena.
+     */
+    [[nodiscard]] inline std::size_t capacity() const noexcept {
+        std::size_t size = 0;
+        for (const auto& b : blocks)
+            size += b.size;
+        return size;
+    }
+};
+
+}
@@ -0,0 +1,75 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <string>
+
+namespace wt {
+
+/**
+ * @brief x86 instruction-set extensions used by SIMD builds (see the ``SIMD_AVX``, ``DBL_PRECISION`` and ``TARGET_ARCH`` CMake options).
+ */
+struct cpu_features_t {
+    bool avx = false, avx2 = false, fma = false, f16c = false, bmi2 = false;
+    bool avx512f = false, avx512dq = false, avx512bw = false, avx512vl = false;
+
+    /**
+     * @brief Extensions supported by the CPU, and enabled by the OS.
+     */
+    static cpu_features_t detect() noexcept;
+    /**
+     * @brief Extensions that the binary was compiled to use.
+     */
+    static const cpu_features_t& compiled() noexcept;
+
+    /**
+     * @brief The highest x86-64 microarchitecture level (3 for x86-64-v3, 4 for x86-64-v4) whose SIMD extensions are all in this set, or 0 if neither.
+     *        Only the extensions tracked here are considered.
+     */
+    [[nodiscard]] int x86_64_level() const noexcept;
+
+    /**
+     * @brief Comma-separated names of the extensions in ``required`` that are not in this set. Empty if none are missing.
+     */
+    [[nodiscard]] std::string missing(const cpu_features_t& required) const;
+    /**
+     * @brief Comma-separated names of the extensions in this set.
+     */
+    [[nodiscard]] std::string to_string() const;
+};
+
+/**
+ * @brief Extensions that the binary was compiled to use (constant initialized).
+ */
+extern const cpu_features_t compiled_cpu_features;
+
+struct cpu_feature_name_t {
+    bool cpu_features_t::* feature;
+    const char* name;
+};
+inline constexpr cpu_feature_name_t cpu_feature_names[] = {
+    { &cpu_features_t::avx,      "avx" },
+    { &cpu_features_t::avx2,     "avx2" },
+    { &cpu_features_t::fma,      "fma" },
+    { &cpu_features_t::f16c,     "f16c" },
+    { &cpu_features_t::bmi2,     "bmi2" },
+    { &cpu_features_t::avx512f,  "avx512f" },
+    { &cpu_features_t::avx512dq, "avx512dq" },
+    { &cpu_features_t::avx512bw, "avx512bw" },
+    { &cpu_features_t::avx512vl, "avx512vl" },
+};
+
+/**
+ * @brief Throws ``std::runtime_error`` if the CPU lacks extensions that the binary was compiled to use.
+ *        On GCC and Clang the same check also runs on startup, before any code compiled for the target ISA, and exits with an error message instead of faulting on an illegal instruction.
+ */
+void check_cpu_features();
+
+}
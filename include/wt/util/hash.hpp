@@ -0,0 +1,80 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <span>
+
+namespace wt {
+
+/**
+ * @brief Simple streaming 64-bit non-cryptographic hash. Consumes input in 8-byte words, fast enough to checksum large binary blobs.
+ *        Not stable across platforms with different endianness.
+ */
+class hash64_t {
+private:
+    static constexpr std::uint64_t prime1 = 0x9e3779b185ebca87ull;
+    static constexpr std::uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+
+    std::uint64_t h;
+    std::uint64_t len = 0;
+
+    static constexpr inline std::uint64_t rotl(std::uint64_t x, int r) noexcept {
+        return (x<<r) | (x>>(64-r));
+    }
+    constexpr inline void mix(std::uint64_t w) noexcept {
+        h ^= rotl(w*prime2, 31)*prime1;
+        h = rotl(h, 27)*prime1 + prime2;
+    }
+
+public:
+    explicit constexpr hash64_t(std::uint64_t seed = 0) noexcept : h(seed ^ prime1) {}
+
+    inline void update(const void* data, std::size_t size) noexcept {
+        const auto* p = reinterpret_cast<const std::uint8_t*>(data);
+        len += size;
+
+        for (; size>=8; size-=8, p+=8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, 8);
+            mix(w);
+        }
+        if (size>0) {
+            std::uint64_t w = 0;
+            std::memcpy(&w, p, size);
+            mix(w);
+        }
+    }
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    inline void update(const T& v) noexcept {
+        update(&v, sizeof(T));
+    }
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    inline void update(std::span<const T> v) noexcept {
+        update(v.data(), v.size_bytes());
+    }
+
+    [[nodiscard]] constexpr inline std::uint64_t digest() const noexcept {
+        auto x = h ^ len;
+        x ^= x>>33;
+        x *= prime2;
+        x ^= x>>29;
+        x *= prime1;
+        x ^= x>>32;
+        return x;
+    }
+};
+
+}
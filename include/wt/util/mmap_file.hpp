@@ -0,0 +1,47 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace wt {
+
+/**
+ * @brief Read-only memory-mapped file. Pages are shared between processes mapping the same file.
+ *        On platforms without POSIX mmap, the file content is read into memory instead.
+ *        Throws `std::runtime_error` on failure.
+ */
+class mmap_file_t {
+private:
+    const std::uint8_t* ptr = nullptr;
+    std::size_t length = 0;
+
+    // fallback storage, when mapping is unsupported
+    std::unique_ptr<std::uint8_t[]> buffer;
+
+public:
+    explicit mmap_file_t(const std::filesystem::path& path);
+    ~mmap_file_t() noexcept;
+
+    mmap_file_t(const mmap_file_t&) = delete;
+    mmap_file_t& operator=(const mmap_file_t&) = delete;
+
+    [[nodiscard]] inline const std::uint8_t* data() const noexcept { return ptr; }
+    [[nodiscard]] inline std::size_t size() const noexcept { return length; }
+
+    [[nodiscard]] inline auto bytes() const noexcept {
+        return std::span<const std::uint8_t>{ ptr, length };
+    }
+};
+
+}
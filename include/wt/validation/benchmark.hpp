@@ -0,0 +1,122 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+
+#include <wt/ads/ads.hpp>
+#include <wt/scene/shape.hpp>
+#include <wt/wt_context.hpp>
+
+/**
+ * Micro-benchmarks of optimized code paths (see the ``bench`` CLI subcommand).
+ * Benchmarks draw their inputs from a seeded generator, and are single threaded (except for ADS construction, which uses the thread pool). Timings are the best of a few repetitions.
+ */
+
+namespace wt::validation {
+
+/**
+ * @brief Construction parameters of an ADS to benchmark (see ``wt_context_t``).
+ */
+struct ads_configuration_t {
+    std::string name;
+    float spatial_split_budget;
+    std::uint32_t node_width;
+};
+
+/**
+ * @brief Timing of a benchmark.
+ */
+struct timing_t {
+    std::string name;
+    /** @brief Wall time per operation (best of repetitions). */
+    double ns_per_op;
+    /** @brief Reference timings, and problem sizes. */
+    std::string details;
+};
+
+/**
+ * @brief Times ``op``, which performs ``ops`` operations per call. Returns nanoseconds per operation, best of ``repetitions`` calls.
+ */
+template <typename F>
+[[nodiscard]] inline double time_per_op(std::size_t ops, F&& op, int repetitions = 5) {
+    using clock = std::chrono::steady_clock;
+
+    auto best = std::numeric_limits<double>::infinity();
+    for (int r=0; r<repetitions; ++r) {
+        const auto start = clock::now();
+        op();
+        const auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        best = std::min(best, elapsed / double(std::max<std::size_t>(ops,1)));
+    }
+    return best;
+}
+
+/**
+ * @brief Times the Mueller-matrix kernels (``mueller_kernels``) against the scalar glm products.
+ */
+[[nodiscard]] std::vector<timing_t> bench_mueller_kernels(std::uint64_t seed);
+
+/**
+ * @brief Times film block splats (``sensor::film_t::splat()``) of narrow to wide reconstruction filters, and their filter weights: interpolated from the separable filter table (``sensor::rfilter_table_t``) against the filter integrated per splat.
+ */
+[[nodiscard]] std::vector<timing_t> bench_film_splats(std::uint64_t seed);
+
+/**
+ * @brief Builds an ADS over ``shapes`` for each configuration (bypassing the ADS cache), and times its construction and queries:
+ *        closest-hit and shadow rays, cone intersections and cone shadow queries (of narrow to wide apertures), ball tests and intersections (of small and larger balls about the scene's surfaces), and k-nearest edges.
+ *        All configurations are queried with the same inputs.
+ */
+[[nodiscard]] std::vector<timing_t> bench_ads_configurations(const std::vector<std::shared_ptr<shape_t>>& shapes,
+                                                             const wt_context_t& context,
+                                                             std::span<const ads_configuration_t> configurations,
+                                                             std::uint64_t seed);
+
+
+/**
+ * @brief Runs the benchmarks that do not require a scene.
+ */
+[[nodiscard]] inline std::vector<timing_t> run_kernel_benchmarks(std::uint64_t seed) {
+    auto timings = bench_mueller_kernels(seed);
+    auto splats = bench_film_splats(seed);
+    timings.insert(timings.end(),
+                   std::make_move_iterator(splats.begin()), std::make_move_iterator(splats.end()));
+    return timings;
+}
+
+/**
+ * @brief Runs the benchmarks of a scene's ADS: plain binned SAH construction, and spatial-split (SBVH) construction with ``spatial_split_budget`` (if positive), each with 8- and 16-wide nodes.
+ */
+[[nodiscard]] inline std::vector<timing_t> run_ads_benchmarks(const std::vector<std::shared_ptr<shape_t>>& shapes,
+                                                              const wt_context_t& context,
+                                                              float spatial_split_budget,
+                                                              std::uint64_t seed) {
+    std::vector<ads_configuration_t> configurations;
+    for (const std::uint32_t width : { 8u, 16u }) {
+        configurations.push_back({ .name = std::format("SAH, {}-wide", width),
+                                   .spatial_split_budget = 0, .node_width = width });
+        if (spatial_split_budget>0)
+            configurations.push_back({ .name = std::format("SBVH {}, {}-wide", spatial_split_budget, width),
+                                       .spatial_split_budget = spatial_split_budget, .node_width = width });
+    }
+
+    return bench_ads_configurations(shapes, context, configurations, seed);
+}
+
+}
@@ -0,0 +1,89 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <wt/ads/ads.hpp>
+
+/**
+ * Numerical validation of optimized code paths against reference implementations (see the ``selftest`` CLI subcommand).
+ * Checks draw their inputs from a seeded generator, and are reproducible given the seed.
+ */
+
+namespace wt::validation {
+
+/**
+ * @brief Result of a validation check.
+ */
+struct check_result_t {
+    std::string name;
+    bool passed;
+    /** @brief Measured errors, and the bounds that they were checked against. */
+    std::string details;
+};
+
+/**
+ * @brief Checks mixed-precision ray traversal (``_MIXED_PRECISION_ADS``) against full-precision traversal of the same ADS, over random rays: hits must agree, with the same triangles (up to ties) and distances.
+ *        Passes trivially for builds without mixed-precision traversal.
+ */
+[[nodiscard]] check_result_t check_mixed_precision_ray_traversal(const ads::ads_t& ads, std::uint64_t seed);
+
+/**
+ * @brief Checks the Mueller-matrix kernels (``mueller_kernels::mul()``, ``apply()``, batched ``apply()``, ``mul_rotation_left()`` and ``mul_rotation_right()``) against the scalar glm products, over random operators.
+ */
+[[nodiscard]] check_result_t check_mueller_kernels(std::uint64_t seed);
+
+/**
+ * @brief Checks the batched beam footprint quadrature (``beam::triangle_footprint_integrator_t``) against a high-order reference quadrature, in double precision, over random beams and triangles: the error of an integrated triangle must not exceed 1e-4.
+ */
+[[nodiscard]] check_result_t check_footprint_integrator(std::uint64_t seed);
+
+/**
+ * @brief Checks that the per-sample arena (``bump_arena_t``) stops allocating from the heap once warmed up: over random per-sample workloads, reset between samples, the arena's upstream must see no allocations after the warm-up samples.
+ */
+[[nodiscard]] check_result_t check_sample_arena(std::uint64_t seed);
+
+/**
+ * @brief Checks the tabulated UTD transition function (``utd::UTDF()``) against ``utd::UTDF_exact()`` over both signs, in the tabulated range and the asymptotic range (|x|>=6); and the batched UTD diffraction coefficients (``utd::UTD_coefficients()``) against the scalar, per-wedge coefficients with the exact transition function, over random wedges.
+ */
+[[nodiscard]] check_result_t check_utd(std::uint64_t seed);
+
+/**
+ * @brief Checks the film reconstruction filter weights, interpolated from the separable filter table (``sensor::rfilter_table_t``), against the Gaussian integrated over the element footprints with the exact error function, over random 2D sub-element offsets; mostly for narrow filters (stddev of at most 0.3 elements), where the tabulated offsets are coarsest relative to the filter.
+ */
+[[nodiscard]] check_result_t check_rfilter_weights(std::uint64_t seed);
+
+
+/**
+ * @brief Runs the checks that do not require a scene.
+ */
+[[nodiscard]] inline std::vector<check_result_t> run_kernel_checks(std::uint64_t seed) {
+    return {
+        check_mueller_kernels(seed),
+        check_footprint_integrator(seed),
+        check_sample_arena(seed),
+        check_utd(seed),
+        check_rfilter_weights(seed),
+    };
+}
+
+/**
+ * @brief Runs the checks of a scene's ADS.
+ */
+[[nodiscard]] inline std::vector<check_result_t> run_ads_checks(const ads::ads_t& ads, std::uint64_t seed) {
+    return {
+        check_mixed_precision_ray_traversal(ads, seed),
+    };
+}
+
+}
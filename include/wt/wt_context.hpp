@@ -48,6 +48,24 @@ struct wt_context_t {
 
 	std::filesystem::path scene_data_path, output_path;
 
+    /** @brief Directory for cached acceleration data structures. Caching is disabled when empty. */
+    std::filesystem::path ads_cache_path;
+
+    /**
+     * @brief Spatial-split (SBVH) construction of the acceleration data structure: maximal count of additional triangle references, as a fraction of the triangle count.
+     *        Triangles straddling a split may then be referenced by multiple leaves, which tightens the bounds of long and thin triangles. Plain binned SAH construction is used when 0.
+     */
+    float ads_spatial_split_budget = 0;
+    /**
+     * @brief Beam-footprint level of detail: beam (cone) traversal stops at a subtree whose extent is below this fraction of the beam footprint (or of the wavelength, if larger) and returns the subtree's simplified proxy geometry instead of its triangles.
+     *        Proxies are built for subtrees of a single shape whose triangles are nearly coplanar. Disabled when 0.
+     */
+    float ads_lod_footprint_fraction = 0;
+    /**
+     * @brief Node width (8 or 16) used for ray and beam traversal of the acceleration data structure. 16-wide nodes are collapsed from the 8-wide tree, and benefit targets with AVX-512.
+     */
+    std::uint32_t ads_node_width = 8;
+
 
     /** @brief Thread pool */
     wt::thread_pool::tpool_t* threadpool;
@@ -8,12 +8,18 @@
  */
 
 #include <bitset>
+#include <bit>
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 #include <wt/ads/bvh8w/bvh8w.hpp>
 #include <wt/ads/bvh8w/common.hpp>
 
 #include <wt/ads/ads_stats.hpp>
 #include <wt/ads/traversal_common.hpp>
+#include <wt/ads/occluder_cache.hpp>
 
 #include <wt/math/intersect/intersect_defs.hpp>
 #include <wt/math/intersect/ball.hpp>
@@ -31,6 +37,13 @@ static constexpr auto ray_traversal_treat_node_as_leaf_if_triangle_count_lt = 16
 
 using intersection_record_vec_work_t = intersection_record_work_t<std::vector<intersection_work_tri_t>>;
 
+// shadow queries never record triangles: they share a working set
+static thread_local std::vector<intersection_work_tri_t> shadow_work_triangles;
+// per-thread occluders of recent ray shadow queries
+static thread_local occluder_cache_t shadow_occluder_cache;
+// (sort key, query index) working set of batched ray and shadow queries
+static thread_local std::vector<std::pair<std::uint64_t, std::uint32_t>> ray_batch_order;
+
 struct stack_node_ptr_t {
     length_t min_range;
     int32_t ptr;
@@ -68,33 +81,49 @@ struct tri_cluster_8w_t {
     vec3_w8_t   n;
 };
 
+/**
+ * @brief Gathers (up to) 8 consecutive triangles from their shapes' meshes. Lanes past ``count`` hold degenerate triangles at the origin, and must be masked out by the caller.
+ * @tparam normals also compute the face normals (otherwise ``n`` is zero)
+ */
+template <bool normals>
 inline auto load_tri_cluster_8w(const bvh8w_t* ads,
-                                const idx_t tidx) noexcept {
+                                const idx_t tidx,
+                                const std::size_t count) noexcept {
+    std::array<length_t,8> ax{}, ay{}, az{}, bx{}, by{}, bz{}, cx{}, cy{}, cz{};
+    std::array<f_t,8> nx{}, ny{}, nz{};
+
+    const auto lanes = m::min<std::size_t>(8, count);
+    for (std::size_t i=0; i<lanes; ++i) {
+        const auto p = ads->tri_vertices(tuid_t{ (idx_t)(tidx+i) });
+        ax[i] = p[0].x; ay[i] = p[0].y; az[i] = p[0].z;
+        bx[i] = p[1].x; by[i] = p[1].y; bz[i] = p[1].z;
+        cx[i] = p[2].x; cy[i] = p[2].y; cz[i] = p[2].z;
+
+        if constexpr (normals) {
+            const auto n = util::tri_face_normal(p[0],p[1],p[2]).value_or(dir3_t{ 0,0,1 });
+            nx[i] = n.x; ny[i] = n.y; nz[i] = n.z;
+        }
+    }
+
     tri_cluster_8w_t data;
-    data.a = pqvec3_w8_t{
-        ads->vectorized_tri_data().ax.data()+tidx, 
-        ads->vectorized_tri_data().ay.data()+tidx,
-        ads->vectorized_tri_data().az.data()+tidx,
-        simd::unaligned_data
-    };
-    data.b = pqvec3_w8_t{
-        ads->vectorized_tri_data().bx.data()+tidx, 
-        ads->vectorized_tri_data().by.data()+tidx,
-        ads->vectorized_tri_data().bz.data()+tidx,
-        simd::unaligned_data
-    };
-    data.c = pqvec3_w8_t{
-        ads->vectorized_tri_data().cx.data()+tidx, 
-        ads->vectorized_tri_data().cy.data()+tidx,
-        ads->vectorized_tri_data().cz.data()+tidx,
-        simd::unaligned_data
-    };
-    data.n = vec3_w8_t{
-        ads->vectorized_tri_data().nx.data()+tidx, 
-        ads->vectorized_tri_data().ny.data()+tidx,
-        ads->vectorized_tri_data().nz.data()+tidx,
-        simd::unaligned_data
-    };
+    data.a = pqvec3_w8_t{ ax.data(), ay.data(), az.data(), simd::unaligned_data };
+    data.b = pqvec3_w8_t{ bx.data(), by.data(), bz.data(), simd::unaligned_data };
+    data.c = pqvec3_w8_t{ cx.data(), cy.data(), cz.data(), simd::unaligned_data };
+    data.n = vec3_w8_t{ nx.data(), ny.data(), nz.data(), simd::unaligned_data };
+
+    return data;
+}
+
+/**
+ * @brief Loads 8 triangles as a vertex and two edge vectors, for ray-triangle tests. Face normals are not computed.
+ */
+inline auto load_tri_edges_cluster_8w(const bvh8w_t* ads,
+                                      const idx_t tidx,
+                                      const std::size_t count) noexcept {
+    // same registers, holding edge vectors in place of b and c
+    auto data = load_tri_cluster_8w<false>(ads, tidx, count);
+    data.b = data.b - data.a;
+    data.c = data.c - data.a;
 
     return data;
 }
@@ -120,7 +149,10 @@ struct cone_cluster_intersect_data_t {
     {}
 };
 
-template <bool shadow>
+/**
+ * @tparam proxies the triangles are level-of-detail proxies
+ */
+template <bool shadow, bool proxies=false>
 inline bool gather_tris(const bvh8w_t* tree,
                         const elliptic_cone_t &cone,
                         const cone_cluster_intersect_data_t& m256data,
@@ -136,7 +168,10 @@ inline bool gather_tris(const bvh8w_t* tree,
     // TODO: vectorize the following
     for (std::size_t t=0; t<tcount; ++t) {
         const auto tuid = (tuid_t)(t0+t);
-        const auto& tri = tree->tri(tuid);
+        const auto tri = [&]() {
+            if constexpr (proxies) return tree->proxy(tuid).geometry;
+            else return tree->tri_geometry(tuid);
+        }();
 
         bool front_face;
         if constexpr (!shadow) {
@@ -278,10 +313,30 @@ inline bool traverse(const bvh8w_t* tree,
                 ++internal_nodes;
 
             // traverse node
-            const auto& n = tree->node(bvh8w::child_node_ptr(stack[s-1].ptr));
+            const auto nidx = bvh8w::child_node_ptr(stack[s-1].ptr);
+            const auto& n = tree->node(nidx);
             const auto& aabbs8w = bvh8w::node_aabbs(n);
+            const auto entry = stack[s-1].min_range;
             --s;
 
+            // level of detail: a subtree smaller than a fraction of the beam footprint (or wavelength) is replaced by its proxy
+            if (tree->has_lod()) {
+                const auto& lod = tree->lod_node(nidx);
+                const auto scale = m::max(cone.axes(entry).x, opts.lod_wavelength);
+                if (lod.proxy!=invalid_idx && lod.extent < tree->lod_fraction()*scale) {
+                    const bool intr = gather_tris<shadow,true>(tree, cone, cluster_intersect_data, range,
+                                                               (std::uint32_t)(tree->triangles_count()+lod.proxy), 2,
+                                                               opts, record);
+                    if (intr) {
+                        // return immediately for shadow queries
+                        if constexpr (shadow)
+                            return true;
+                        unwind_stack();
+                    }
+                    continue;
+                }
+            }
+
             // TODO: subtree traversal for nodes contained in cone
             // This is important for edge cases of detailed geometry and cones with growing apertures,
             // however it is difficult to do so in a way that is a performance win: testing for containment is expensive
@@ -317,7 +372,115 @@ inline bool traverse(const bvh8w_t* tree,
     return !record.triangles.empty();
 }
 
+/**
+ * @brief Cone traversal of the 16-wide nodes (see ``bvh8w_t::build_wide_nodes()``). Leaves and level-of-detail proxies are those of the 8-wide tree.
+ */
+template <bool shadow>
+inline bool traverse16(const bvh8w_t* tree,
+                       const elliptic_cone_t& cone,
+                       const ads_t::intersect_opts_t& opts,
+                       intersection_record_vec_work_t &record,
+                       int& internal_nodes, int& leaf_nodes, int& subtrees) noexcept {
+    const auto cluster_intersect_data = cone_cluster_intersect_data_t{ cone };
+    const auto node16_data = bvh8w::cone_node16_data(cone);
+    const auto& kernels16 = tree->node16_kernels();
+    auto range = record.search_range(cone);
+
+    constexpr auto stack_size = 192;
+    stack_node_ptr_t stack[stack_size];
+    int s=1;
+    stack[0] = {
+        .min_range = 0 * u::m,
+        .ptr = tree->root_ptr(),
+    };
+
+    // unwinds irrelevant nodes
+    const auto unwind_stack = [&]() {
+        range = record.search_range(cone);
+        while (s>0 &&
+               stack[s-1].min_range >= range.max)
+            --s;
+    };
+
+    for (;s>0;) {
+        if (bvh8w::is_ptr_leaf(stack[s-1].ptr)) {
+            if constexpr (ads_stats::additional_ads_counters)
+                ++leaf_nodes;
+
+            const auto& leaf = tree->leaf_node(bvh8w::leaf_node_ptr(stack[s-1].ptr));
+            // find closest intersecting tris in leaf (if exists)
+            const bool intr = gather_tris<shadow>(tree, cone, cluster_intersect_data, range,
+                                                  leaf.tris_ptr, leaf.count,
+                                                  opts, record);
+            --s;
+
+            if (intr) {
+                // return immediately for shadow queries
+                if constexpr (shadow)
+                    return true;
+                unwind_stack();
+            }
+        }
+        else {
+            if constexpr (ads_stats::additional_ads_counters)
+                ++internal_nodes;
+
+            // traverse node
+            const auto& n = tree->node16(bvh8w::child_node_ptr(stack[s-1].ptr));
+            const auto entry = stack[s-1].min_range;
+            --s;
+
+            // level of detail: a subtree smaller than a fraction of the beam footprint (or wavelength) is replaced by its proxy
+            if (tree->has_lod()) {
+                const auto& lod = tree->lod_node(n.node8);
+                const auto scale = m::max(cone.axes(entry).x, opts.lod_wavelength);
+                if (lod.proxy!=invalid_idx && lod.extent < tree->lod_fraction()*scale) {
+                    const bool intr = gather_tris<shadow,true>(tree, cone, cluster_intersect_data, range,
+                                                               (std::uint32_t)(tree->triangles_count()+lod.proxy), 2,
+                                                               opts, record);
+                    if (intr) {
+                        // return immediately for shadow queries
+                        if constexpr (shadow)
+                            return true;
+                        unwind_stack();
+                    }
+                    continue;
+                }
+            }
+
+            const auto r = bvh8w::intersect_cone_node16(kernels16, n, node16_data, range);
+            // collect stats
+            ads_stats::on_ray_aabb_16w_test();
+
+            // gather intersected children
+            int begin = s;
+            for (auto mask = r.mask; mask!=0; mask &= mask-1) {
+                const auto i = std::countr_zero(mask);
+                const auto& ptr = n.child_ptrs[i];
+                if (bvh8w::is_ptr_empty(ptr))
+                    continue;
+
+                const auto t = r.tmins[i] * u::m;
+                if (t >= range.max)
+                    continue;
+
+#ifndef RELEASE
+                if (s==stack_size) std::exit(99); // stack overflow
+#endif
+                stack[s++] = { t, ptr };
+            }
+
+            // sort nodes in descending order
+            [[assume(s-begin<=16)]];
+            stack_sorter(&stack[begin], s-begin);
+        }
+    }
+
+    return !record.triangles.empty();
+}
+
 intersection_record_t bvh8w_t::intersect(const elliptic_cone_t &cone,
+                                         intersection_scratch_t& scratch,
                                          const pqrange_t<> traversal_range,
                                          const intersect_opts_t& opts) const noexcept {
     assert(traversal_range.max>0*u::m);
@@ -326,14 +489,20 @@ intersection_record_t bvh8w_t::intersect(const elliptic_cone_t &cone,
     if constexpr (ads_stats::additional_ads_counters)
         start = std::chrono::high_resolution_clock::now();
 
-    auto work = intersection_record_vec_work_t{ traversal_range,opts.z_search_range_scale };
+    auto work = intersection_record_vec_work_t{ scratch.work_triangles, traversal_range,opts.z_search_range_scale };
 
     // traverse BVH
     static constexpr bool shadow = false;
     int internal_nodes = 0, leaf_nodes = 0, subtrees = 0;
-    ::traverse<shadow>(this, cone, opts, work, internal_nodes,leaf_nodes,subtrees);
+    if (has_wide_nodes())
+        ::traverse16<shadow>(this, cone, opts, work, internal_nodes,leaf_nodes,subtrees);
+    else
+        ::traverse<shadow>(this, cone, opts, work, internal_nodes,leaf_nodes,subtrees);
 
-    auto ret = cone_work_to_intersection_record(*this, work, cone, opts);
+    // triangles only: edges are gathered directly from the edge tree
+    auto tris_opts = opts;
+    tris_opts.detect_edges = false;
+    auto ret = cone_work_to_intersection_record(*this, work, cone, tris_opts, scratch);
 
     // record cone cast
     ads_stats::on_cone_cast_event(
@@ -343,6 +512,10 @@ intersection_record_t bvh8w_t::intersect(const elliptic_cone_t &cone,
             start,
             internal_nodes,leaf_nodes,subtrees);
 
+    // edges within the intersection region
+    if (opts.detect_edges && !ret.empty())
+        intersect_edges(cone, scratch, work.search_range(cone), opts);
+
     return ret;
 }
 
@@ -354,12 +527,15 @@ bool bvh8w_t::shadow(const elliptic_cone_t &cone, const pqrange_t<> traversal_ra
     if constexpr (ads_stats::additional_ads_counters)
         start = std::chrono::high_resolution_clock::now();
 
-    auto work = intersection_record_vec_work_t{ traversal_range };
+    auto work = intersection_record_vec_work_t{ shadow_work_triangles, traversal_range };
 
     // traverse BVH
     static constexpr bool shadow = true;
     int internal_nodes = 0, leaf_nodes = 0, subtrees = 0;
-    ::traverse<shadow>(this, cone, { .detect_edges = false }, work, internal_nodes,leaf_nodes,subtrees);
+    if (has_wide_nodes())
+        ::traverse16<shadow>(this, cone, { .detect_edges = false }, work, internal_nodes,leaf_nodes,subtrees);
+    else
+        ::traverse<shadow>(this, cone, { .detect_edges = false }, work, internal_nodes,leaf_nodes,subtrees);
 
     const bool found_intersection = m::isfinite(work.intr_dist);
 
@@ -375,6 +551,100 @@ bool bvh8w_t::shadow(const elliptic_cone_t &cone, const pqrange_t<> traversal_ra
 }
 
 
+/**
+ * Edge traversal routines
+ */
+
+inline bool cone_edge_intersects(const elliptic_cone_t& cone,
+                                 const edge_t& edge,
+                                 const pqrange_t<>& range) noexcept {
+    return cone.contains(edge.a, range) || cone.contains(edge.b, range) ||
+           ads_stats::test_cone_edge(cone, edge.a, edge.b, range);
+}
+
+inline void gather_edges(const bvh8w_t* tree,
+                         const elliptic_cone_t& cone,
+                         const pqrange_t<>& range,
+                         const std::uint32_t e0,
+                         const std::uint32_t ecount,
+                         intersection_record_t::edges_container_t& edges) noexcept {
+    const auto& edge_ids = tree->edges_tree().edge_ids;
+    for (auto e=e0; e<e0+ecount; ++e) {
+        const auto eid = edge_ids[e];
+        if (cone_edge_intersects(cone, tree->edge(eid), range))
+            edges.push_back(tuid_t{ eid });
+    }
+}
+
+inline void traverse_edges(const bvh8w_t* tree,
+                           const elliptic_cone_t& cone,
+                           const pqrange_t<>& range,
+                           intersection_record_t::edges_container_t& edges,
+                           int& nodes) noexcept {
+    const auto& etree = tree->edges_tree();
+    const auto cluster_intersect_data = cone_cluster_intersect_data_t{ cone };
+
+    // edges are gathered exhaustively: no ordering, no unwinding
+    constexpr auto stack_size = 128;
+    std::int32_t stack[stack_size];
+    int s=1;
+    stack[0] = tree->root_ptr();
+
+    for (;s>0;) {
+        const auto ptr = stack[--s];
+        ++nodes;
+
+        if (bvh8w::is_ptr_leaf(ptr)) {
+            const auto& leaf = etree.leaf_nodes[bvh8w::leaf_node_ptr(ptr)];
+            gather_edges(tree, cone, range, leaf.tris_ptr, leaf.count, edges);
+            continue;
+        }
+
+        const auto& n = etree.nodes[bvh8w::child_node_ptr(ptr)];
+        const auto r = cone_cluster_intersect(tree, range,
+                                              cluster_intersect_data, bvh8w::node_aabbs(n));
+        // collect stats
+        ads_stats::on_ray_aabb_8w_test();
+
+        for (int i=0;i<8;++i) {
+            const auto& cptr = n.child_ptrs[i];
+            if (r.result_mask[i]==0 || bvh8w::is_ptr_empty(cptr))
+                continue;
+#ifndef RELEASE
+            if (s==stack_size) std::exit(99); // stack overflow
+#endif
+            stack[s++] = cptr;
+        }
+    }
+}
+
+const intersection_record_t::edges_container_t& bvh8w_t::intersect_edges(
+        const elliptic_cone_t &cone,
+        intersection_scratch_t& scratch,
+        const pqrange_t<> traversal_range,
+        const intersect_opts_t& opts) const noexcept {
+    // triangles are left as is
+    scratch.prepare(true, opts.accumulate_edges);
+    auto& edges = scratch.edges;
+    const auto sorted_edges = edges.size();
+
+    if (edge_tree.empty() || traversal_range.empty() || cone.is_ray())
+        return edges;
+
+    std::chrono::high_resolution_clock::time_point start;
+    if constexpr (ads_stats::additional_ads_counters)
+        start = std::chrono::high_resolution_clock::now();
+
+    int nodes = 0;
+    ::traverse_edges(this, cone, traversal_range & pqrange_t<>::positive(), edges, nodes);
+    scratch.finalize_edges(sorted_edges);
+
+    ads_stats::on_cone_edges_event(edges.size()-sorted_edges, start, nodes);
+
+    return edges;
+}
+
+
 /**
  * Ray traversal routines
  */
@@ -383,14 +653,23 @@ struct ray_cluster_intersect_data_t {
     pqvec3_w8_t ro;
     vec3_w8_t   rd;
     vec3_w8_t   rinvd;
+#ifdef _MIXED_PRECISION_ADS
+    bvh8w::ray_f32_data_t f32;
+#endif
 
     ray_cluster_intersect_data_t(const ray_t& ray) noexcept
         : ro(ray.o),
           rd(vec3_t{ ray.d }),
           rinvd(ray.invd)
+#ifdef _MIXED_PRECISION_ADS
+          , f32(ray.o, ray.invd)
+#endif
     {}
 };
 
+// ray data of the packet of batched shadow queries being traversed
+static thread_local std::vector<ray_cluster_intersect_data_t> shadow_packet_rays;
+
 template <bool shadow>
 inline bool gather_tris(const bvh8w_t* ads,
                         const ray_cluster_intersect_data_t& rdata,
@@ -400,22 +679,29 @@ inline bool gather_tris(const bvh8w_t* ads,
     bool intersects = false;
     for (auto t=0ul; t<count; t+=8) {
         const auto tidx = t0ptr+t;
-        const auto tris = load_tri_cluster_8w(ads, tidx);
+        // a, and edge vectors in b and c
+        const auto tris = load_tri_edges_cluster_8w(ads, tidx, count-t);
 
+        // front faces: the (unnormalized) face normal opposes the ray
         b_w8_t b_front_face_mask;
-        if constexpr (!shadow)
-            b_front_face_mask = m::dot(tris.n, rdata.rd) <= f_w8_t::zero();
+        if constexpr (!shadow) {
+            const auto ng_dot_d = m::dot(m::cross(tris.b, tris.c), rdata.rd);
+            b_front_face_mask = ng_dot_d <= ng_dot_d.zero();
+        }
 
         // intersect
 
         if constexpr (shadow) {
-            const auto intrs8 = ads_stats::test_ray_tri_8w(rdata.ro,
-                                                           rdata.rd,
-                                                           tris.a,
-                                                           tris.b,
-                                                           tris.c,
-                                                           range);
+            const auto intrs8 = ads_stats::test_ray_tri_edges_8w(rdata.ro,
+                                                                 rdata.rd,
+                                                                 tris.a,
+                                                                 tris.b,
+                                                                 tris.c,
+                                                                 range);
             if (m::any(intrs8)) {
+                // report the first occluder in the cluster
+                const auto lane = std::countr_zero(intrs8.to_bitmask().to_ulong());
+                record.triangle.tuid = (tuid_t)(tidx+lane);
                 record.triangle.dist = range.min;
                 return true;
             }
@@ -423,12 +709,12 @@ inline bool gather_tris(const bvh8w_t* ads,
         }
 
         const auto intrs8 =
-            ads_stats::intersect_ray_tri_8w(rdata.ro,
-                                            rdata.rd,
-                                            tris.a,
-                                            tris.b,
-                                            tris.c,
-                                            range);
+            ads_stats::intersect_ray_tri_edges_8w(rdata.ro,
+                                                  rdata.rd,
+                                                  tris.a,
+                                                  tris.b,
+                                                  tris.c,
+                                                  range);
         const auto b_front_face = b_front_face_mask.to_bitmask();
         for (auto i=0; i<m::min<int>(8,count-t); ++i) {
             const auto dist  = intrs8.result.read(i);
@@ -466,7 +752,234 @@ inline cluster_intersect_t ray_cluster_intersect(
     };
 }
 
-template <bool shadow>
+inline cluster_intersect_t ray_cluster_intersect(
+        const bvh8w_t* tree,
+        const length_t max_dist,
+        const ray_cluster_intersect_data_t& data,
+        const bvh8w::node_t& node) noexcept {
+    return ray_cluster_intersect(tree, max_dist, data, bvh8w::node_aabbs(node));
+}
+
+#ifdef _MIXED_PRECISION_ADS
+static constexpr bool mixed_precision_ray_traversal = true;
+#else
+static constexpr bool mixed_precision_ray_traversal = false;
+#endif
+
+/**
+ * Node used by ray traversal: the single-precision copy for mixed-precision traversal, otherwise the node.
+ */
+template <bool mixed_precision>
+inline const auto& ray_traversal_node(const bvh8w_t* tree, const idx_t nidx) noexcept {
+#ifdef _MIXED_PRECISION_ADS
+    if constexpr (mixed_precision)
+        return tree->node_f32(nidx);
+    else
+#endif
+    return tree->node(nidx);
+}
+
+#ifdef _MIXED_PRECISION_ADS
+/**
+ * Mixed-precision ray traversal: nodes are tested conservatively in single precision (see ``bvh8w::intersect_ray_node_f32``), triangles in double precision.
+ */
+inline cluster_intersect_t ray_cluster_intersect(
+        const bvh8w_t* tree,
+        const length_t max_dist,
+        const ray_cluster_intersect_data_t& data,
+        const bvh8w::node_f32_t& node) noexcept {
+    const auto ira = bvh8w::intersect_ray_node_f32(
+            node, data.f32,
+            pqrange_t<>{ 0*u::m, max_dist });
+
+    std::array<length_t,8> tmins;
+    for (auto i=0; i<8; ++i)
+        tmins[i] = f_t(ira.tmins[i]) * u::m;
+
+    return {
+        .tmins = length_w8_t{ tmins.data(), simd::unaligned_data },
+        .result_mask = ira.mask,
+    };
+}
+#endif
+
+struct cluster_range_intersect_t {
+    std::array<length_t,8> tmins, tmaxs;
+    std::bitset<8> result_mask;
+};
+
+/**
+ * Ray vs. 8 AABBs, returning entry and exit distances, for resumable traversal.
+ */
+#ifdef _MIXED_PRECISION_ADS
+inline cluster_range_intersect_t ray_cluster_range_intersect(
+        const ray_cluster_intersect_data_t& data,
+        const pqrange_t<>& range,
+        const bvh8w::node_f32_t& node) noexcept {
+    const auto ira = bvh8w::intersect_ray_node_f32(node, data.f32, range);
+
+    cluster_range_intersect_t ret;
+    for (auto i=0; i<8; ++i) {
+        ret.tmins[i] = f_t(ira.tmins[i]) * u::m;
+        ret.tmaxs[i] = f_t(ira.tmaxs[i]) * u::m;
+    }
+    ret.result_mask = ira.mask;
+    return ret;
+}
+#else
+inline cluster_range_intersect_t ray_cluster_range_intersect(
+        const ray_cluster_intersect_data_t& data,
+        const pqrange_t<>& range,
+        const bvh8w::node_t& node) noexcept {
+    const auto& aabbs8w = bvh8w::node_aabbs(node);
+    const auto ira = intersect::intersect_ray_aabb_fast(
+            data.ro, data.rinvd, aabbs8w.min, aabbs8w.max,
+            range);
+
+    cluster_range_intersect_t ret;
+    for (auto i=0; i<8; ++i) {
+        ret.tmins[i] = ira.min.read(i);
+        ret.tmaxs[i] = ira.max.read(i);
+    }
+    ret.result_mask = ira.mask.to_bitmask();
+    return ret;
+}
+#endif
+
+/**
+ * Resumable ray traversal: continues from the nodes suspended in ``state`` (or from the root).
+ * Nodes that the ray enters past the queried range are suspended instead of being culled, as are leaves (and subtrees traversed as leaves) that the ray exits past the range: these are tested again by a later query.
+ * Once a hit is found, the remaining candidates are discarded and the state is reset.
+ */
+inline bool traverse_resumable(const bvh8w_t* tree,
+                               const ray_t& ray,
+                               intersection_record_ray_work_t &record,
+                               ray_traversal_state_t& state,
+                               int& nodes) noexcept {
+    using node_t = ray_traversal_state_t::node_t;
+    constexpr auto capacity = ray_traversal_state_t::capacity;
+
+    const auto cluster_intersect_data = ray_cluster_intersect_data_t{ ray };
+    const auto& range = record.range;
+
+    const auto generation = tree->generation();
+    if (state.owner!=generation || state.overflown) {
+        // (re)start from the root
+        const bool overflown = state.owner==generation && state.overflown;
+        state.owner = generation;
+        state.overflown = overflown;
+        state.nodes[0] = {
+            .min_range = 0 * u::m,
+            .max_range = limits<length_t>::infinity(),
+            .ptr = tree->root_ptr(),
+        };
+        state.count = 1;
+    }
+
+    // working stack, starts with the suspended nodes (nearest on top)
+    constexpr auto stack_size = capacity + 64;
+    node_t stack[stack_size];
+    int s = state.count;
+    std::copy_n(state.nodes.begin(), s, stack);
+
+    // nodes suspended by this query
+    node_t suspended[capacity];
+    std::size_t ss = 0;
+    const auto suspend = [&](const node_t& n) {
+        if (ss<capacity)
+            suspended[ss++] = n;
+        else {
+            // out of space: later queries restart from the root, which is conservative
+            state.overflown = true;
+        }
+    };
+    // tests triangles, suspending if the ray exits the leaf past the range
+    const auto gather = [&](const node_t& e, const idx_t t0ptr, const idx_t count) {
+        gather_tris<false>(tree, cluster_intersect_data,
+                           t0ptr, count,
+                           range, record);
+        if (e.max_range > range.max)
+            suspend(e);
+    };
+
+    for (;s>0;) {
+        const auto e = stack[--s];
+        // behind closest hit or past the ray's exit from the node?
+        if (e.min_range >= record.triangle.dist || e.max_range < range.min)
+            continue;
+        // entered past the range? suspend
+        if (e.min_range > range.max) {
+            suspend(e);
+            continue;
+        }
+
+        if (bvh8w::is_ptr_leaf(e.ptr)) {
+            const auto& leaf = tree->leaf_node(bvh8w::leaf_node_ptr(e.ptr));
+            gather(e, leaf.tris_ptr, leaf.count);
+            continue;
+        }
+
+        // traverse node
+#ifdef _MIXED_PRECISION_ADS
+        const auto& n = tree->node_f32(bvh8w::child_node_ptr(e.ptr));
+#else
+        const auto& n = tree->node(bvh8w::child_node_ptr(e.ptr));
+#endif
+
+        const bool should_traverse_as_leaf = n.tris_count <= ray_traversal_treat_node_as_leaf_if_triangle_count_lt;
+        if (should_traverse_as_leaf) {
+            gather(e, n.tris_start, n.tris_count);
+            continue;
+        }
+
+        if constexpr (ads_stats::additional_ads_counters)
+            ++nodes;
+
+        // children are culled only before the range: the ray may still hit them in later queries
+        const auto r = ray_cluster_range_intersect(
+                cluster_intersect_data,
+                pqrange_t<>{ range.min, m::max(e.max_range, range.min) },
+                n);
+        // collect stats
+        ads_stats::on_ray_aabb_8w_test();
+
+        // gather intersected children
+        int begin = s;
+        for (int i=0;i<8;++i) {
+            if (r.result_mask[i]!=0 && !bvh8w::is_ptr_empty(n.child_ptrs[i])) {
+                const auto c = node_t{ r.tmins[i], r.tmaxs[i], n.child_ptrs[i] };
+                if (c.min_range > range.max) {
+                    suspend(c);
+                    continue;
+                }
+#ifndef RELEASE
+                if (s==stack_size) std::exit(99); // stack overflow
+#endif
+                stack[s++] = c;
+            }
+        }
+        // sort nodes in descending order
+        [[assume(s-begin<=8)]];
+        stack_sorter(&stack[begin], s-begin);
+    }
+
+    const bool hit = record.triangle.dist < limits<length_t>::infinity();
+    if (hit) {
+        state.reset();
+        return true;
+    }
+
+    // suspend the candidate set, nearest on top
+    std::sort(suspended, suspended+ss, [](const auto& n1, const auto& n2) {
+        return n1.min_range > n2.min_range;
+    });
+    std::copy_n(suspended, ss, state.nodes.begin());
+    state.count = state.overflown ? 0 : ss;
+
+    return false;
+}
+
+template <bool shadow, bool mixed_precision = mixed_precision_ray_traversal>
 inline bool traverse(const bvh8w_t* tree,
                      const ray_t& ray,
                      intersection_record_ray_work_t &record,
@@ -506,7 +1019,7 @@ inline bool traverse(const bvh8w_t* tree,
         }
         else {
             // traverse node
-            const auto& n = tree->node(bvh8w::child_node_ptr(stack[s-1].ptr));
+            const auto& n = ray_traversal_node<mixed_precision>(tree, bvh8w::child_node_ptr(stack[s-1].ptr));
             --s;
 
             const bool should_traverse_as_leaf = n.tris_count <= ray_traversal_treat_node_as_leaf_if_triangle_count_lt;
@@ -528,9 +1041,8 @@ inline bool traverse(const bvh8w_t* tree,
             if constexpr (ads_stats::additional_ads_counters)
                 ++nodes;
 
-            const auto& aabbs8w = bvh8w::node_aabbs(n);
             const auto r = ray_cluster_intersect(tree, record.triangle.dist,
-                                                 cluster_intersect_data, aabbs8w);
+                                                 cluster_intersect_data, n);
             // collect stats
             ads_stats::on_ray_aabb_8w_test();
 
@@ -553,6 +1065,98 @@ inline bool traverse(const bvh8w_t* tree,
     return record.triangle.dist < limits<length_t>::infinity();
 }
 
+/**
+ * @brief Ray traversal of the 16-wide nodes (see ``bvh8w_t::build_wide_nodes()``). Triangles are tested in the 8-wide clusters of the tree's leaves.
+ */
+template <bool shadow>
+inline bool traverse16(const bvh8w_t* tree,
+                       const ray_t& ray,
+                       intersection_record_ray_work_t &record,
+                       int& nodes) noexcept {
+    const auto cluster_intersect_data = ray_cluster_intersect_data_t{ ray };
+    const auto node16_data = bvh8w::ray_node16_data(ray);
+    const auto& kernels16 = tree->node16_kernels();
+
+    constexpr auto stack_size = 128;
+    stack_node_ptr_t stack[stack_size];
+    int s=1;
+
+    const auto unwind_stack = [&]() {
+        // unwind irrelevant nodes
+        while (s>0 &&
+               stack[s-1].min_range >= record.triangle.dist)
+            --s;
+    };
+
+    stack[0] = {
+        .min_range = 0 * u::m,
+        .ptr = tree->root_ptr(),
+    };
+    for (;s>0;) {
+        if (bvh8w::is_ptr_leaf(stack[s-1].ptr)) {
+            const auto& leaf = tree->leaf_node(bvh8w::leaf_node_ptr(stack[s-1].ptr));
+            // find closest intersecting tri in leaf (if exists)
+            const bool intr = gather_tris<shadow>(tree, cluster_intersect_data,
+                                                  leaf.tris_ptr, leaf.count,
+                                                  record.range, record);
+            --s;
+
+            if (intr) {
+                // return immediately for shadow queries
+                if constexpr (shadow)
+                    return true;
+                unwind_stack();
+            }
+        }
+        else {
+            // traverse node
+            const auto& n = tree->node16(bvh8w::child_node_ptr(stack[s-1].ptr));
+            --s;
+
+            const bool should_traverse_as_leaf = n.tris_count <= ray_traversal_treat_node_as_leaf_if_triangle_count_lt;
+            if (should_traverse_as_leaf) {
+                // find closest intersecting tri in subtree (if exists)
+                const bool intr = gather_tris<shadow>(tree, cluster_intersect_data,
+                                                      n.tris_start, n.tris_count,
+                                                      record.range, record);
+
+                if (intr) {
+                    // return immediately for shadow queries
+                    if constexpr (shadow)
+                        return true;
+                    unwind_stack();
+                }
+                continue;
+            }
+
+            if constexpr (ads_stats::additional_ads_counters)
+                ++nodes;
+
+            const auto r = bvh8w::intersect_ray_node16(kernels16, n, node16_data,
+                                                       pqrange_t<>{ 0*u::m, record.triangle.dist });
+            // collect stats
+            ads_stats::on_ray_aabb_16w_test();
+
+            // gather intersected children
+            int begin = s;
+            for (auto mask = r.mask; mask!=0; mask &= mask-1) {
+                const auto i = std::countr_zero(mask);
+                if (!bvh8w::is_ptr_empty(n.child_ptrs[i])) {
+#ifndef RELEASE
+                    if (s==stack_size) std::exit(99); // stack overflow
+#endif
+                    stack[s++] = { r.tmins[i] * u::m, n.child_ptrs[i] };
+                }
+            }
+            // sort nodes in descending order
+            [[assume(s-begin<=16)]];
+            stack_sorter(&stack[begin], s-begin);
+        }
+    }
+
+    return record.triangle.dist < limits<length_t>::infinity();
+}
+
 intersection_record_t bvh8w_t::intersect(
     const ray_t &ray,
     const pqrange_t<> traversal_range) const noexcept {
@@ -567,7 +1171,53 @@ intersection_record_t bvh8w_t::intersect(
     // traverse bvh8w
     static constexpr bool shadow = false;
     int nodes = 0;
-    ::traverse<shadow>(this, ray, work, nodes);
+    if (has_wide_nodes())
+        ::traverse16<shadow>(this, ray, work, nodes);
+    else
+        ::traverse<shadow>(this, ray, work, nodes);
+
+    // record ray cast
+    ads_stats::on_ray_cast_event(m::isfinite(work.triangle.dist) && work.triangle.dist<=traversal_range.max, 
+                                 !m::isfinite(work.triangle.dist) && !V().contains(ray.propagate(traversal_range.max)),
+                                 false,
+                                 start,
+                                 nodes);
+
+    return ray_work_to_intersection_record(*this, work, traversal_range);
+}
+
+#ifdef _MIXED_PRECISION_ADS
+intersection_record_t bvh8w_t::intersect_full_precision(
+    const ray_t &ray,
+    const pqrange_t<> traversal_range) const noexcept {
+    assert(traversal_range.max > zero);
+
+    auto work = intersection_record_ray_work_t{traversal_range};
+
+    static constexpr bool shadow = false;
+    static constexpr bool mixed_precision = false;
+    int nodes = 0;
+    ::traverse<shadow, mixed_precision>(this, ray, work, nodes);
+
+    return ray_work_to_intersection_record(*this, work, traversal_range);
+}
+#endif
+
+intersection_record_t bvh8w_t::intersect(
+    const ray_t &ray,
+    const pqrange_t<> traversal_range,
+    ray_traversal_state_t& state) const noexcept {
+    assert(traversal_range.max > zero);
+
+    std::chrono::high_resolution_clock::time_point start;
+    if constexpr (ads_stats::additional_ads_counters)
+        start = std::chrono::high_resolution_clock::now();
+
+    auto work = intersection_record_ray_work_t{traversal_range};
+
+    // resume traversal
+    int nodes = 0;
+    ::traverse_resumable(this, ray, work, state, nodes);
 
     // record ray cast
     ads_stats::on_ray_cast_event(m::isfinite(work.triangle.dist) && work.triangle.dist<=traversal_range.max, 
@@ -579,17 +1229,55 @@ intersection_record_t bvh8w_t::intersect(
     return ray_work_to_intersection_record(*this, work, traversal_range);
 }
 
-bool bvh8w_t::shadow(const ray_t &ray, const pqrange_t<> traversal_range) const noexcept {
+/**
+ * Tests the occluders of recent shadow queries on this thread (see ``occluder_cache_t``).
+ */
+inline bool test_occluder_cache(const bvh8w_t* tree,
+                                const ray_t& ray,
+                                const pqrange_t<>& range) noexcept {
+    shadow_occluder_cache.bind(tree->generation());
+    for (const auto tuid : shadow_occluder_cache.occluders()) {
+        // only real triangles are cached, but do not trust a stale cache
+        if (tuid.uid>=tree->triangles_count())
+            continue;
+        const auto t = tree->tri_vertices(tuid);
+        if (ads_stats::test_ray_tri(ray, t[0], t[1], t[2], range)) {
+            shadow_occluder_cache.record(tuid);
+            ads_stats::on_occluder_cache_event(true);
+            return true;
+        }
+    }
+    ads_stats::on_occluder_cache_event(false);
+    return false;
+}
+
+bool bvh8w_t::shadow(const ray_t &ray,
+                     const pqrange_t<> traversal_range,
+                     const shadow_opts_t& opts) const noexcept {
     auto work = intersection_record_ray_work_t{traversal_range};
 
     std::chrono::high_resolution_clock::time_point start;
     if constexpr (ads_stats::additional_ads_counters)
         start = std::chrono::high_resolution_clock::now();
 
+    // test recent occluders first
+    if (opts.occluder_cache && test_occluder_cache(this, ray, traversal_range)) {
+        ads_stats::on_ray_cast_event(true, false, true, start, 0);
+        return true;
+    }
+
     // traverse bvh8w
     static constexpr bool shadow = true;
     int nodes = 0;
-    ::traverse<shadow>(this, ray, work, nodes);
+    if (has_wide_nodes())
+        ::traverse16<shadow>(this, ray, work, nodes);
+    else
+        ::traverse<shadow>(this, ray, work, nodes);
+
+    if (opts.occluder_cache &&
+        work.triangle.dist < limits<length_t>::infinity() &&
+        work.triangle.tuid.uid < tris.size())
+        shadow_occluder_cache.record(work.triangle.tuid);
 
     // record ray cast
     ads_stats::on_ray_cast_event(m::isfinite(work.triangle.dist) && work.triangle.dist<=traversal_range.max, 
@@ -602,6 +1290,229 @@ bool bvh8w_t::shadow(const ray_t &ray, const pqrange_t<> traversal_range) const
     return work.triangle.dist < limits<length_t>::infinity();
 }
 
+// spreads the 10 low bits of x, such that there are two zero bits between consecutive bits
+inline std::uint32_t morton_expand_bits(std::uint32_t x) noexcept {
+    x &= 0x3ff;
+    x = (x | (x<<16)) & 0x030000ff;
+    x = (x | (x<< 8)) & 0x0300f00f;
+    x = (x | (x<< 4)) & 0x030c30c3;
+    x = (x | (x<< 2)) & 0x09249249;
+    return x;
+}
+
+// sort key for batched ray and shadow queries: direction octant, then 30-bit Morton code of the origin in the world bounds
+inline std::uint64_t ray_query_sort_key(const ray_t& ray, const aabb_t& world) noexcept {
+    const auto octant = (ray.d.x<0 ? 1u : 0u) | (ray.d.y<0 ? 2u : 0u) | (ray.d.z<0 ? 4u : 0u);
+
+    const auto extent = world.extent();
+    std::uint32_t q[3];
+    for (int a=0; a<3; ++a) {
+        const auto x = extent[a]>zero ? f_t((ray.o[a]-world.min[a]) / extent[a]) : f_t(0);
+        q[a] = (std::uint32_t)m::clamp(x*f_t(1023), f_t(0), f_t(1023));
+    }
+    const auto morton = morton_expand_bits(q[0]) | (morton_expand_bits(q[1])<<1) | (morton_expand_bits(q[2])<<2);
+
+    return (std::uint64_t(octant)<<32) | morton;
+}
+
+static constexpr std::uint32_t shadow_packet_size = 8;
+
+struct packet_stack_node_t {
+    length_t min_range;
+    int32_t ptr;
+    // rays of the packet that entered the node
+    std::uint32_t mask;
+};
+
+/**
+ * Packet shadow traversal: up to ``shadow_packet_size`` coherent rays (same direction octant, nearby origins) traverse the 8-wide tree together.
+ * Each node is fetched once for all the rays that entered it, and its child bounds are tested against each of these rays; children are pushed with the mask of the rays that intersect them, nearest (over these rays) first.
+ * Rays are retired from the packet once occluded. Returns the mask of occluded rays, and the occluders in ``occluders``.
+ */
+inline std::uint32_t traverse_shadow_packet(const bvh8w_t* tree,
+                                            const ray_cluster_intersect_data_t* rays,
+                                            const pqrange_t<>* ranges,
+                                            const std::uint32_t count,
+                                            tuid_t* occluders,
+                                            int& nodes) noexcept {
+    assert(count>0 && count<=shadow_packet_size);
+
+    std::uint32_t active = (1u<<count)-1;
+
+    constexpr auto stack_size = 64;
+    packet_stack_node_t stack[stack_size];
+    int s=1;
+    stack[0] = {
+        .min_range = 0 * u::m,
+        .ptr = tree->root_ptr(),
+        .mask = active,
+    };
+
+    // tests triangles against each ray of the mask, retiring occluded rays
+    const auto gather = [&](std::uint32_t mask, const idx_t t0ptr, const idx_t tcount) {
+        for (; mask; mask&=mask-1) {
+            const auto i = std::countr_zero(mask);
+            auto work = intersection_record_ray_work_t{ ranges[i] };
+            if (gather_tris<true>(tree, rays[i], t0ptr, tcount, ranges[i], work)) {
+                occluders[i] = work.triangle.tuid;
+                active &= ~(1u<<i);
+            }
+        }
+    };
+
+    for (;s>0 && active;) {
+        const auto e = stack[--s];
+        // rays occluded since the node was pushed
+        const auto mask = e.mask & active;
+        if (!mask)
+            continue;
+
+        if (bvh8w::is_ptr_leaf(e.ptr)) {
+            const auto& leaf = tree->leaf_node(bvh8w::leaf_node_ptr(e.ptr));
+            gather(mask, leaf.tris_ptr, leaf.count);
+            continue;
+        }
+
+        // traverse node
+        const auto& n = ray_traversal_node<mixed_precision_ray_traversal>(tree, bvh8w::child_node_ptr(e.ptr));
+
+        const bool should_traverse_as_leaf = n.tris_count <= ray_traversal_treat_node_as_leaf_if_triangle_count_lt;
+        if (should_traverse_as_leaf) {
+            gather(mask, n.tris_start, n.tris_count);
+            continue;
+        }
+
+        if constexpr (ads_stats::additional_ads_counters)
+            ++nodes;
+
+        // children masks, and nearest entry over the rays
+        std::array<std::uint32_t,8> cmask{};
+        std::array<length_t,8> cmin;
+        cmin.fill(limits<length_t>::infinity());
+        for (auto rays_mask=mask; rays_mask; rays_mask&=rays_mask-1) {
+            const auto i = std::countr_zero(rays_mask);
+            const auto r = ray_cluster_intersect(tree, ranges[i].max, rays[i], n);
+            // collect stats
+            ads_stats::on_ray_aabb_8w_test();
+
+            for (int c=0;c<8;++c) {
+                if (r.result_mask[c]!=0) {
+                    cmask[c] |= 1u<<i;
+                    cmin[c] = m::min(cmin[c], r.tmins.read(c));
+                }
+            }
+        }
+
+        // gather intersected children
+        int begin = s;
+        for (int c=0;c<8;++c) {
+            if (cmask[c]!=0 && !bvh8w::is_ptr_empty(n.child_ptrs[c])) {
+#ifndef RELEASE
+                if (s==stack_size) std::exit(99); // stack overflow
+#endif
+                stack[s++] = { cmin[c], n.child_ptrs[c], cmask[c] };
+            }
+        }
+        // sort nodes in descending order
+        [[assume(s-begin<=8)]];
+        stack_sorter(&stack[begin], s-begin);
+    }
+
+    return ~active & ((1u<<count)-1);
+}
+
+void bvh8w_t::shadow(std::span<const shadow_query_t> queries,
+                     std::span<bool> occluded,
+                     const shadow_opts_t& opts) const noexcept {
+    assert(occluded.size()>=queries.size());
+
+    // small batches are not worth reordering
+    constexpr std::size_t min_batch_to_sort = 4;
+    if (queries.size()<min_batch_to_sort) {
+        for (std::size_t i=0; i<queries.size(); ++i)
+            occluded[i] = bvh8w_t::shadow(queries[i].ray, queries[i].range, opts);
+        return;
+    }
+
+    std::chrono::high_resolution_clock::time_point start;
+    if constexpr (ads_stats::additional_ads_counters)
+        start = std::chrono::high_resolution_clock::now();
+
+    // test recent occluders first, and order the remaining queries
+    auto& order = ray_batch_order;
+    order.clear();
+    order.reserve(queries.size());
+    for (std::size_t i=0; i<queries.size(); ++i) {
+        if (opts.occluder_cache && test_occluder_cache(this, queries[i].ray, queries[i].range)) {
+            occluded[i] = true;
+            ads_stats::on_ray_cast_event(true, false, true, start, 0);
+            continue;
+        }
+        order.emplace_back(ray_query_sort_key(queries[i].ray, world), (std::uint32_t)i);
+    }
+    std::sort(order.begin(), order.end());
+
+    // traverse packets of consecutive queries of the same direction octant
+    auto& rays = shadow_packet_rays;
+    std::array<pqrange_t<>, shadow_packet_size> ranges;
+    std::array<tuid_t, shadow_packet_size> occluders;
+    for (std::size_t p=0; p<order.size();) {
+        const auto octant = order[p].first>>32;
+        std::uint32_t count = 0;
+        rays.clear();
+        for (; p+count<order.size() && count<shadow_packet_size && (order[p+count].first>>32)==octant; ++count) {
+            const auto& q = queries[order[p+count].second];
+            rays.emplace_back(q.ray);
+            ranges[count] = q.range;
+        }
+
+        int nodes = 0;
+        const auto hits = traverse_shadow_packet(this, rays.data(), ranges.data(), count, occluders.data(), nodes);
+
+        for (std::uint32_t j=0; j<count; ++j) {
+            const auto i = order[p+j].second;
+            const bool hit = (hits>>j)&1;
+            occluded[i] = hit;
+            if (hit && opts.occluder_cache)
+                shadow_occluder_cache.record(occluders[j]);
+
+            // record ray cast (nodes are shared by the packet)
+            ads_stats::on_ray_cast_event(hit,
+                                         !hit && !V().contains(queries[i].ray.propagate(queries[i].range.max)),
+                                         true,
+                                         start,
+                                         nodes);
+        }
+        p += count;
+    }
+}
+
+void bvh8w_t::intersect(std::span<const ray_query_t> queries,
+                        std::span<intersection_record_t> records) const noexcept {
+    assert(records.size()>=queries.size());
+
+    // small batches are not worth reordering
+    constexpr std::size_t min_batch_to_sort = 4;
+    if (queries.size()<min_batch_to_sort) {
+        for (std::size_t i=0; i<queries.size(); ++i)
+            records[i] = bvh8w_t::intersect(queries[i].ray, queries[i].range);
+        return;
+    }
+
+    auto& order = ray_batch_order;
+    order.clear();
+    order.reserve(queries.size());
+    for (std::size_t i=0; i<queries.size(); ++i)
+        order.emplace_back(ray_query_sort_key(queries[i].ray, world), (std::uint32_t)i);
+    std::sort(order.begin(), order.end());
+
+    // coherent queries, issued consecutively
+    for (const auto& o : order) {
+        const auto i = o.second;
+        records[i] = bvh8w_t::intersect(queries[i].ray, queries[i].range);
+    }
+}
+
 
 /**
  * ball traversal routines
@@ -618,16 +1529,16 @@ inline bool gather_tris(const bvh8w_t* tree,
         bool found_intersection = false;
         for (auto t=0ul; t<tcount; t+=8) {
             const auto tidx = t0+t;
-            const auto tris = load_tri_cluster_8w(tree, tidx);
+            const auto tris = load_tri_cluster_8w<true>(tree, tidx, tcount-t);
             
-            const auto intrs = intersect::test_ball_tri(
+            const auto intrs = ads_stats::test_ball_tri_8w(
                     ball,
                     tris.a,
                     tris.b,
                     tris.c,
-                    tris.n);
+                    tris.n).to_bitmask();
             for (auto i=0; i<m::min<int>(8,tcount-t); ++i) {
-                if (intrs.read(i)!=0) {
+                if (intrs[i]) {
                     found_intersection = true;
                     record.triangles.emplace_back(intersection_work_tri_t{
                         .tuid = (tuid_t)(tidx+i),
@@ -648,6 +1559,30 @@ inline bool gather_tris(const bvh8w_t* tree,
     }
 }
 
+/**
+ * @brief Tests for any triangle intersecting a ball.
+ */
+inline bool any_tri(const bvh8w_t* tree,
+                    const ball_t &ball,
+                    const std::uint32_t t0,
+                    const std::uint32_t tcount) noexcept {
+    for (auto t=0ul; t<tcount; t+=8) {
+        const auto tris = load_tri_cluster_8w<true>(tree, t0+t, tcount-t);
+        const auto intrs = ads_stats::test_ball_tri_8w(
+                ball,
+                tris.a,
+                tris.b,
+                tris.c,
+                tris.n).to_bitmask();
+
+        // mask out padding
+        const auto valid = tcount-t>=8 ? 0xff : (1<<(tcount-t))-1;
+        if ((intrs.to_ulong() & valid) != 0)
+            return true;
+    }
+    return false;
+}
+
 inline bool traverse_all(const bvh8w_t* tree,
                          const ball_t &ball,
                          const int32_t ptr,
@@ -670,6 +1605,11 @@ inline bool traverse_all(const bvh8w_t* tree,
                              opts, record);
 }
 
+/**
+ * @brief Ball traversal.
+ * @tparam any_hit early out on the first intersected triangle, without recording triangles
+ */
+template <bool any_hit>
 bool traverse(const bvh8w_t *tree,
               const ball_t &ball,
               const std::int32_t ptr,
@@ -684,9 +1624,14 @@ bool traverse(const bvh8w_t *tree,
         if (bvh8w::is_ptr_leaf(stack[s-1])) {
             const auto& leaf = tree->leaf_node(bvh8w::leaf_node_ptr(stack[s-1]));
             // find intersecting tris in leaf (if exists)
-            gather_tris(tree, ball,
-                        leaf.tris_ptr, leaf.count,
-                        opts, record);
+            if constexpr (any_hit) {
+                if (any_tri(tree, ball, leaf.tris_ptr, leaf.count))
+                    return true;
+            } else {
+                gather_tris(tree, ball,
+                            leaf.tris_ptr, leaf.count,
+                            opts, record);
+            }
             --s;
         }
         else {
@@ -696,30 +1641,42 @@ bool traverse(const bvh8w_t *tree,
 
             const bool should_traverse_as_leaf = n.tris_count <= ray_traversal_treat_node_as_leaf_if_triangle_count_lt;
             if (should_traverse_as_leaf) {
-                // find closest intersecting tri in subtree (if exists)
-                gather_tris(tree, ball,
-                            n.tris_start, n.tris_count,
-                            opts, record);
+                // find intersecting tris in subtree (if exists)
+                if constexpr (any_hit) {
+                    if (any_tri(tree, ball, n.tris_start, n.tris_count))
+                        return true;
+                } else {
+                    gather_tris(tree, ball,
+                                n.tris_start, n.tris_count,
+                                opts, record);
+                }
 
                 continue;
             }
 
             const auto& aabbs8w = bvh8w::node_aabbs(n);
-            const auto r = intersect::test_ball_aabb(ball, aabbs8w.min, aabbs8w.max);
+            const auto r = ads_stats::test_ball_aabb_8w(ball, aabbs8w.min, aabbs8w.max);
             const auto intersects = r.intersects_mask.to_bitmask();
+            const auto contained  = r.contains_mask.to_bitmask();
 
             // gather intersected children
             for (int i=0;i<8;++i) {
                 const auto& ptr = n.child_ptrs[i];
-                if (bvh8w::is_ptr_empty(ptr))
+                if (bvh8w::is_ptr_empty(ptr) || !intersects[i])
                     continue;
 
-                if (intersects[i]) {
+                if (contained[i]) {
+                    // child is contained in the ball: all its triangles intersect the ball, no need to test
+                    if constexpr (any_hit)
+                        return true;
+                    traverse_all(tree, ball, ptr, opts, record);
+                    continue;
+                }
+
 #ifndef RELEASE
-                    if (s==stack_size) std::exit(99); // stack overflow
+                if (s==stack_size) std::exit(99); // stack overflow
 #endif
-                    stack[s++] = ptr;
-                }
+                stack[s++] = ptr;
             }
         }
     }
@@ -728,17 +1685,132 @@ bool traverse(const bvh8w_t *tree,
 }
 
 intersection_record_t bvh8w_t::intersect(const ball_t &ball,
+                                         intersection_scratch_t& scratch,
                                          const intersect_opts_t& opts) const noexcept {
-    intersection_record_vec_work_t work;
-    ::traverse(this, ball, root_ptr(), work, opts);
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    intersection_record_vec_work_t work{ scratch.work_triangles };
+    const auto hit = ::traverse<false>(this, ball, root_ptr(), work, opts);
+
+    ads_stats::on_ball_query_event(hit, false, start);
+
+    return ball_work_to_intersection_record(*this, work, opts, scratch);
+}
+
+bool bvh8w_t::test(const ball_t &ball) const noexcept {
+    const auto start = std::chrono::high_resolution_clock::now();
 
-    return ball_work_to_intersection_record(*this, work, opts);
+    // any-hit queries never record triangles
+    intersection_record_vec_work_t work{ shadow_work_triangles };
+    const auto hit = ::traverse<true>(this, ball, root_ptr(), work, intersect_opts_t::defaults());
+
+    ads_stats::on_ball_query_event(hit, true, start);
+
+    return hit;
+}
+
+
+/**
+ * k-nearest edges routines
+ */
+
+inline area_t sqr_distance_to_edge(const pqvec3_t& p, const edge_t& edge) noexcept {
+    const auto ab = edge.b-edge.a;
+    const auto ab2 = m::dot(ab,ab);
+    const auto t = ab2>zero ? m::clamp<f_t>(u::to_num(m::dot(p-edge.a,ab)/ab2), 0,1) : f_t(0);
+    const auto d = p - (edge.a + t*ab);
+    return m::dot(d,d);
+}
+
+struct nearest_edges_stack_node_t {
+    area_t sqr_dist;
+    int32_t ptr;
+};
+
+std::span<const nearest_edge_t> bvh8w_t::nearest_edges(
+        const ball_t &ball,
+        std::size_t k,
+        intersection_scratch_t& scratch) const noexcept {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    auto& result = scratch.nearest_edges;
+    result.clear();
+    if (edge_tree.empty() || k==0)
+        return {};
+
+    // ``result`` holds a max-heap of candidates, while traversing
+    const auto heap_cmp = [](const nearest_edge_t& e1, const nearest_edge_t& e2) {
+        return e1.dist < e2.dist;
+    };
+    const auto r2 = m::sqr(ball.radius);
+    const auto bound = [&]() {
+        return result.size()<k ? r2 : m::min(r2, m::sqr(result.front().dist));
+    };
+
+    // closest-first traversal, pruned by the k-th closest edge found so far
+    constexpr auto stack_size = 128*8;
+    nearest_edges_stack_node_t stack[stack_size];
+    int s=1;
+    stack[0] = { .sqr_dist = 0*u::m*u::m, .ptr = root_ptr() };
+
+    for (;s>0;) {
+        const auto sn = stack[--s];
+        if (sn.sqr_dist > bound())
+            continue;
+
+        if (bvh8w::is_ptr_leaf(sn.ptr)) {
+            const auto& leaf = edge_tree.leaf_nodes[bvh8w::leaf_node_ptr(sn.ptr)];
+            for (auto e=leaf.tris_ptr; e<leaf.tris_ptr+leaf.count; ++e) {
+                const auto eid = edge_tree.edge_ids[e];
+                const auto d2 = sqr_distance_to_edge(ball.centre, edges[eid]);
+                if (d2 > bound())
+                    continue;
+
+                result.emplace_back(nearest_edge_t{ .euid = eid, .dist = m::sqrt(d2) });
+                std::ranges::push_heap(result, heap_cmp);
+                if (result.size()>k) {
+                    std::ranges::pop_heap(result, heap_cmp);
+                    result.pop_back();
+                }
+            }
+            continue;
+        }
+
+        const auto& n = edge_tree.nodes[bvh8w::child_node_ptr(sn.ptr)];
+        const auto& aabbs8w = bvh8w::node_aabbs(n);
+        const auto d2s = intersect::sqr_distance_ball_aabb(ball, aabbs8w.min, aabbs8w.max);
+
+        // push children farthest first, so that the closest child is visited next
+        const auto s0 = s;
+        for (int i=0;i<8;++i) {
+            const auto& cptr = n.child_ptrs[i];
+            if (bvh8w::is_ptr_empty(cptr))
+                continue;
+            const auto d2 = d2s.read(i);
+            if (d2 > bound())
+                continue;
+#ifndef RELEASE
+            if (s==stack_size) std::exit(99); // stack overflow
+#endif
+            stack[s++] = { .sqr_dist = d2, .ptr = cptr };
+        }
+        std::sort(stack+s0, stack+s, [](const auto& n1, const auto& n2) {
+            return n1.sqr_dist > n2.sqr_dist;
+        });
+    }
+
+    // order by distance
+    std::ranges::sort_heap(result, heap_cmp);
+
+    ads_stats::on_ball_nearest_edges_event(start);
+
+    return result;
 }
 
 
 scene::element::info_t bvh8w_t::description() const {
     using namespace scene::element;
-    return {
+    auto ret = info_t{
         .cls = "ADS",
         .type = "bvh8w",
         .attribs = {
@@ -746,6 +1818,28 @@ scene::element::info_t bvh8w_t::description() const {
             { "nodes",     attributes::make_scalar(nodes.size()) },
             { "occupancy", attributes::make_scalar(occupancy) },
             { "max depth", attributes::make_scalar(max_depth) },
+            { "edges",     attributes::make_scalar(edges.size()) },
+            { "edge tree nodes", attributes::make_scalar(edge_tree.nodes.size()) },
+            { "SAH cost",  attributes::make_scalar(sah_cost) },
+            { "ray only",  attributes::make_scalar(is_ray_only()) },
+#ifdef _MIXED_PRECISION_ADS
+            { "ray traversal", attributes::make_string("mixed precision") },
+#endif
         }
     };
+
+    if (has_lod())
+        ret.attribs.emplace("LOD proxies", attributes::make_scalar(proxy_tris.size()/2));
+    if (has_wide_nodes()) {
+        ret.attribs.emplace("16-wide nodes", attributes::make_scalar(nodes16.size()));
+        ret.attribs.emplace("16-wide node kernels", attributes::make_string(node16_kernels().isa));
+    }
+    if (has_duplicate_triangles()) {
+        std::size_t unique = 0;
+        for (auto t=0ul; t<tri_canonical.size(); ++t)
+            if (tri_canonical[t]==t) ++unique;
+        ret.attribs.emplace("duplicated triangle references", attributes::make_scalar(tris.size()-unique));
+    }
+
+    return ret;
 }
@@ -0,0 +1,324 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#include <cstring>
+#include <fstream>
+#include <format>
+#include <future>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include <wt/ads/bvh8w/bvh8w_cache.hpp>
+
+#include <wt/util/hash.hpp>
+#include <wt/util/mmap_file.hpp>
+#include <wt/util/thread_pool/tpool.hpp>
+#include <wt/util/logger/logger.hpp>
+
+using namespace wt;
+using namespace wt::ads;
+using namespace wt::ads::construction;
+
+
+namespace {
+
+constexpr char cache_magic[8] = { 'W','T','B','V','H','8','W','\0' };
+constexpr std::size_t section_alignment = 64;
+
+enum section_e : std::uint32_t {
+    nodes, leaf_nodes,
+    tris,
+    edges, edge_tris,
+    edge_nodes, edge_leaf_nodes, edge_ids,
+    tri_canonical,
+
+    section_count,
+};
+
+struct section_t {
+    std::uint64_t offset, count;
+};
+
+struct header_t {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t f_size;
+    std::uint64_t key;
+    std::uint64_t checksum;
+    std::uint64_t file_size;
+
+    aabb_t world;
+    f_t sah_cost, occupancy;
+    std::uint64_t max_depth;
+    // built without edges (ray-only ADS)
+    std::uint64_t ray_only;
+
+    section_t sections[section_count];
+};
+
+// edges reference their triangles by index on disk
+struct edge_tris_t {
+    std::uint32_t tri1, tri2;
+};
+constexpr std::uint32_t no_tri = ~std::uint32_t(0);
+
+static_assert(std::is_trivially_copyable_v<header_t>);
+static_assert(std::is_trivially_copyable_v<bvh8w::node_t>);
+static_assert(std::is_trivially_copyable_v<bvh8w::leaf_node_t>);
+static_assert(std::is_trivially_copyable_v<tri_t>);
+static_assert(std::is_trivially_copyable_v<edge_t>);
+
+constexpr inline std::uint64_t align_up(std::uint64_t x) noexcept {
+    return (x + section_alignment-1) / section_alignment * section_alignment;
+}
+constexpr std::uint64_t payload_start = align_up(sizeof(header_t));
+
+inline std::uint64_t header_checksum(header_t h, std::uint64_t payload_digest) noexcept {
+    h.checksum = 0;
+    hash64_t hash{ payload_digest };
+    hash.update(h);
+    return hash.digest();
+}
+
+}
+
+
+std::uint64_t bvh8w_cache_t::cache_key(const std::vector<std::shared_ptr<shape_t>>& objs,
+                                       const wt::wt_context_t& ctx) {
+    // hash shapes' geometry in parallel
+    std::vector<std::future<std::uint64_t>> futures;
+    futures.reserve(objs.size());
+    for (const auto& obj : objs) {
+        futures.emplace_back(ctx.threadpool->enqueue([obj=obj.get()]() {
+            const auto& mesh = obj->get_mesh();
+
+            hash64_t h;
+            h.update(mesh.vertices_count());
+            h.update(std::span{ mesh.get_vertices() });
+            h.update(mesh.triangles_count());
+            h.update(std::span{ mesh.get_indices() });
+            return h.digest();
+        }));
+    }
+
+    // build parameters and layout
+    hash64_t h{ format_version };
+    h.update(sizeof(f_t));
+    h.update(bvh8w::aabbs_per_node);
+    h.update(sizeof(bvh8w::node_t));
+    h.update(sizeof(tri_t));
+    h.update(sizeof(edge_t));
+
+    h.update(ctx.ads_spatial_split_budget);
+    h.update(ctx.renderer_force_ray_tracing);
+    h.update(objs.size());
+    for (auto& f : futures)
+        h.update(f.get());
+
+    return h.digest();
+}
+
+std::filesystem::path bvh8w_cache_t::cache_file(const std::filesystem::path& cache_dir,
+                                                std::uint64_t key) {
+    return cache_dir / std::format("bvh8w_{:016x}.wtads", key);
+}
+
+std::unique_ptr<bvh8w_t> bvh8w_cache_t::load(const std::filesystem::path& cache_dir,
+                                             std::uint64_t key,
+                                             const std::vector<const mesh::mesh_t*>& meshes) noexcept {
+    const auto path = cache_file(cache_dir, key);
+    if (!std::filesystem::is_regular_file(path))
+        return nullptr;
+
+    try {
+        const mmap_file_t file{ path };
+        if (file.size()<payload_start)
+            throw std::runtime_error("truncated file");
+
+        header_t h;
+        std::memcpy(&h, file.data(), sizeof(h));
+
+        if (std::memcmp(h.magic, cache_magic, sizeof(cache_magic))!=0)
+            throw std::runtime_error("not an ADS cache file");
+        if (h.version!=format_version || h.f_size!=sizeof(f_t))
+            throw std::runtime_error("incompatible cache file version");
+        if (h.key!=key || h.file_size!=file.size())
+            throw std::runtime_error("cache file mismatch");
+
+        {
+            hash64_t payload;
+            payload.update(file.data()+payload_start, file.size()-payload_start);
+            if (header_checksum(h, payload.digest())!=h.checksum)
+                throw std::runtime_error("checksum mismatch");
+        }
+
+        const auto section = [&]<typename T>(section_e s) {
+            const auto& sec = h.sections[s];
+            if (sec.offset%section_alignment!=0 ||
+                sec.offset<payload_start ||
+                sec.offset + sec.count*sizeof(T) > file.size())
+                throw std::runtime_error("malformed section");
+            return std::span<const T>{ reinterpret_cast<const T*>(file.data()+sec.offset), sec.count };
+        };
+        const auto copy = [&]<typename T>(section_e s) {
+            const auto sp = section.template operator()<T>(s);
+            return std::vector<T>(sp.begin(), sp.end());
+        };
+
+        auto tris = copy.template operator()<tri_t>(section_e::tris);
+        // triangles reference the meshes: do not trust the file with indices out of range
+        for (const auto& t : tris) {
+            if (t.shape_idx>=meshes.size() || t.shape_tri_idx>=meshes[t.shape_idx]->triangles_count())
+                throw std::runtime_error("malformed triangles section");
+        }
+
+        auto bvh = std::make_unique<bvh8w_t>(
+            copy.template operator()<bvh8w::node_t>(section_e::nodes),
+            copy.template operator()<bvh8w::leaf_node_t>(section_e::leaf_nodes),
+            std::move(tris), meshes, h.ray_only!=0,
+            h.world, h.sah_cost, h.occupancy, (std::size_t)h.max_depth,
+            copy.template operator()<idx_t>(section_e::tri_canonical));
+
+        if (!bvh->tri_canonical.empty()) {
+            if (bvh->tri_canonical.size()!=bvh->tris.size())
+                throw std::runtime_error("malformed triangle copies section");
+            for (auto t=0ul; t<bvh->tri_canonical.size(); ++t) {
+                if (bvh->tri_canonical[t]>t)
+                    throw std::runtime_error("malformed triangle copies section");
+            }
+        }
+
+        // edges, and re-link their triangles
+        const auto edges = section.template operator()<edge_t>(section_e::edges);
+        const auto etris = section.template operator()<edge_tris_t>(section_e::edge_tris);
+        if (edges.size()!=etris.size())
+            throw std::runtime_error("malformed edges section");
+
+        const auto tri_ptr = [&](std::uint32_t idx) -> const tri_t* {
+            if (idx==no_tri) return nullptr;
+            if (idx>=bvh->tris.size())
+                throw std::runtime_error("malformed edges section");
+            return &bvh->tris[idx];
+        };
+
+        bvh->edges.assign(edges.begin(), edges.end());
+        for (auto e=0ul; e<edges.size(); ++e) {
+            bvh->edges[e].tri1 = tri_ptr(etris[e].tri1);
+            bvh->edges[e].tri2 = tri_ptr(etris[e].tri2);
+        }
+
+        // edge tree
+        bvh->edge_tree.nodes      = copy.template operator()<bvh8w::node_t>(section_e::edge_nodes);
+        bvh->edge_tree.leaf_nodes = copy.template operator()<bvh8w::leaf_node_t>(section_e::edge_leaf_nodes);
+        bvh->edge_tree.edge_ids   = copy.template operator()<std::uint32_t>(section_e::edge_ids);
+        if (bvh->edge_tree.edge_ids.size()!=bvh->edges.size() ||
+            (!bvh->edges.empty() && bvh->edge_tree.nodes.empty()))
+            throw std::runtime_error("malformed edge tree section");
+        for (const auto eid : bvh->edge_tree.edge_ids) {
+            if (eid>=bvh->edges.size())
+                throw std::runtime_error("malformed edge tree section");
+        }
+
+        wt::logger::cout(verbosity_e::info) << "(bvh8w_cache) loaded ADS from cache \"" << path.string() << "\"" << '\n';
+
+        return bvh;
+    } catch(const std::exception& e) {
+        wt::logger::cwarn(verbosity_e::info) << "(bvh8w_cache) ignoring ADS cache \"" << path.string() << "\": " << e.what() << '\n';
+    }
+
+    return nullptr;
+}
+
+void bvh8w_cache_t::store(const std::filesystem::path& cache_dir,
+                          std::uint64_t key,
+                          const bvh8w_t& bvh) noexcept {
+    const auto path = cache_file(cache_dir, key);
+
+    try {
+        std::filesystem::create_directories(cache_dir);
+
+        // write to a temporary first, and then rename: concurrent readers never see a partial file
+        auto tmp_path = path;
+        tmp_path += std::format(".{:08x}.tmp", std::random_device{}());
+
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("could not create file");
+
+        header_t h{};
+        std::memcpy(h.magic, cache_magic, sizeof(cache_magic));
+        h.version = format_version;
+        h.f_size = sizeof(f_t);
+        h.key = key;
+        h.world = bvh.world;
+        h.sah_cost = bvh.sah_cost;
+        h.occupancy = bvh.occupancy;
+        h.max_depth = bvh.max_depth;
+        h.ray_only = bvh.is_ray_only() ? 1 : 0;
+
+        static constexpr char zeros[section_alignment]{};
+
+        // placeholder header
+        for (auto w=0ul; w<payload_start; w+=section_alignment)
+            f.write(zeros, std::min<std::size_t>(section_alignment, payload_start-w));
+
+        hash64_t payload;
+        std::uint64_t offset = payload_start;
+        const auto write_section = [&]<typename T>(section_e s, std::span<const T> data) {
+            const auto bytes = data.size_bytes();
+            h.sections[s] = section_t{ .offset=offset, .count=data.size() };
+
+            f.write(reinterpret_cast<const char*>(data.data()), bytes);
+            payload.update(data.data(), bytes);
+            offset += bytes;
+
+            const auto pad = align_up(offset)-offset;
+            f.write(zeros, pad);
+            payload.update(zeros, pad);
+            offset += pad;
+        };
+
+        write_section(section_e::nodes,      std::span{ bvh.nodes });
+        write_section(section_e::leaf_nodes, std::span{ bvh.leaf_nodes });
+        write_section(section_e::tris,  std::span{ bvh.tris });
+        write_section(section_e::edges, std::span{ bvh.edges });
+
+        std::vector<edge_tris_t> etris;
+        etris.reserve(bvh.edges.size());
+        for (const auto& e : bvh.edges) {
+            etris.emplace_back(edge_tris_t{
+                .tri1 = e.tri1 ? (std::uint32_t)(e.tri1-bvh.tris.data()) : no_tri,
+                .tri2 = e.tri2 ? (std::uint32_t)(e.tri2-bvh.tris.data()) : no_tri,
+            });
+        }
+        write_section(section_e::edge_tris, std::span<const edge_tris_t>{ etris });
+
+        write_section(section_e::edge_nodes,      std::span{ bvh.edge_tree.nodes });
+        write_section(section_e::edge_leaf_nodes, std::span{ bvh.edge_tree.leaf_nodes });
+        write_section(section_e::edge_ids,        std::span{ bvh.edge_tree.edge_ids });
+        write_section(section_e::tri_canonical,   std::span{ bvh.tri_canonical });
+
+        h.file_size = offset;
+        h.checksum = header_checksum(h, payload.digest());
+
+        f.seekp(0);
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.close();
+        if (!f)
+            throw std::runtime_error("write failed");
+
+        std::filesystem::rename(tmp_path, path);
+
+        wt::logger::cout(verbosity_e::info) << "(bvh8w_cache) wrote ADS cache \"" << path.string() << "\"" << '\n';
+    } catch(const std::exception& e) {
+        wt::logger::cwarn() << "(bvh8w_cache) failed writing ADS cache \"" << path.string() << "\": " << e.what() << '\n';
+    }
+}
@@ -7,11 +7,15 @@
  *
  */
 
+#include <array>
 #include <list>
 #include <vector>
 #include <memory>
+#include <future>
+#include <algorithm>
 
 #include <wt/ads/bvh8w/bvh8w_constructor.hpp>
+#include <wt/ads/bvh8w/bvh8w_cache.hpp>
 #include <wt/ads/bvh8w/common.hpp>
 #include <wt/ads/edge_classification.hpp>
 #include <wt/ads/bvh_constructor.hpp>
@@ -60,6 +64,7 @@ inline auto build_node8w(idx_t w8_idx,
                          const aabb_t& parent_aabb,
                          const std::vector<bvh_t::node_cluster_t>& bvnc,
                          const std::vector<tri_t>& tris,
+                         const std::vector<const mesh::mesh_t*>& meshes,
                          progress_track_t& pt) {
     auto ret = build_result_t{ .w8_idx = w8_idx };
 
@@ -93,9 +98,8 @@ inline auto build_node8w(idx_t w8_idx,
     // sanity
     for (auto t = ret.w8node.tris_start; t<ret.w8node.tris_start+ret.w8node.tris_count; ++t) {
         const auto& tri = tris[t];
-        assert(parent_aabb.contains<range_inclusiveness_e::inclusive>(tri.a));
-        assert(parent_aabb.contains<range_inclusiveness_e::inclusive>(tri.b));
-        assert(parent_aabb.contains<range_inclusiveness_e::inclusive>(tri.c));
+        for (const auto& v : meshes[tri.shape_idx]->triangle_vertices(tri.shape_tri_idx))
+            assert(parent_aabb.contains<range_inclusiveness_e::inclusive>(v));
     }
 #endif
 
@@ -116,40 +120,136 @@ void calculate_occupancy(const bvh8w::node_t& n, const std::vector<bvh8w::node_t
     }
 }
 
-inline auto create_w8_tris(const std::vector<tri_t>& tris) {
-    bvh8w_t::tris_vectorized_data_t d;
-    const auto ds = tris.size()+7;
-    d.ax.resize(ds);
-    d.ay.resize(ds);
-    d.az.resize(ds);
-    d.bx.resize(ds);
-    d.by.resize(ds);
-    d.bz.resize(ds);
-    d.cx.resize(ds);
-    d.cy.resize(ds);
-    d.cz.resize(ds);
-    d.nx.resize(ds);
-    d.ny.resize(ds);
-    d.nz.resize(ds);
-
-    for (auto t=0ul;t<tris.size();++t) {
-        d.ax[t] = tris[t].a.x;
-        d.ay[t] = tris[t].a.y;
-        d.az[t] = tris[t].a.z;
-        d.bx[t] = tris[t].b.x;
-        d.by[t] = tris[t].b.y;
-        d.bz[t] = tris[t].b.z;
-        d.cx[t] = tris[t].c.x;
-        d.cy[t] = tris[t].c.y;
-        d.cz[t] = tris[t].c.z;
-        d.nx[t] = tris[t].n.x;
-        d.ny[t] = tris[t].n.y;
-        d.nz[t] = tris[t].n.z;
+/**
+ * Edge tree construction
+ */
+
+static constexpr std::uint32_t edge_tree_leaf_size = 4;
+
+struct edge_range_t {
+    std::uint32_t b, e;
+    [[nodiscard]] inline auto size() const noexcept { return e-b; }
+};
+struct edge_node_result_t {
+    bvh8w::node_t w8node{};
+    idx_t w8_idx;
+
+    std::array<edge_range_t,8> children;
+    int children_count = 0;
+};
+
+/**
+ * @brief Splits an edge range into (up to) 8 children, by repeatedly median splitting the largest child along its longest centroid axis.
+ *        Tasks work on disjoint ranges of ``edge_ids``.
+ */
+inline auto build_edge_node8w(idx_t w8_idx,
+                              const edge_range_t range,
+                              const std::vector<edge_t>& edges,
+                              std::vector<std::uint32_t>& edge_ids) {
+    auto ret = edge_node_result_t{ .w8_idx = w8_idx };
+    ret.children[ret.children_count++] = range;
+
+    const auto centroid2 = [&](std::uint32_t eid) { return edges[eid].a + edges[eid].b; };
+
+    for (;ret.children_count<8;) {
+        int largest = 0;
+        for (int c=1; c<ret.children_count; ++c)
+            if (ret.children[c].size() > ret.children[largest].size())
+                largest = c;
+        const auto r = ret.children[largest];
+        if (r.size()<=edge_tree_leaf_size)
+            break;
+
+        auto centroids = aabb_t::null();
+        for (auto i=r.b; i<r.e; ++i)
+            centroids |= centroid2(edge_ids[i]);
+        const auto axis = centroids.max_dimension();
+
+        const auto mid = r.b + r.size()/2;
+        std::nth_element(edge_ids.begin()+r.b, edge_ids.begin()+mid, edge_ids.begin()+r.e,
+                         [&](auto e1, auto e2) { return centroid2(e1)[axis] < centroid2(e2)[axis]; });
+
+        ret.children[largest] = { r.b, mid };
+        ret.children[ret.children_count++] = { mid, r.e };
     }
 
-    return d;
+    // encode
+    std::array<length_t,8> node_min_x{}, node_max_x{}, node_min_y{}, node_max_y{}, node_min_z{}, node_max_z{};
+    for (int c=0; c<ret.children_count; ++c) {
+        auto aabb = aabb_t::null();
+        for (auto i=ret.children[c].b; i<ret.children[c].e; ++i) {
+            const auto& e = edges[edge_ids[i]];
+            aabb |= e.a;
+            aabb |= e.b;
+        }
+        node_min_x[c] = aabb.min.x;
+        node_min_y[c] = aabb.min.y;
+        node_min_z[c] = aabb.min.z;
+        node_max_x[c] = aabb.max.x;
+        node_max_y[c] = aabb.max.y;
+        node_max_z[c] = aabb.max.z;
+    }
+
+    ret.w8node.min = pqvec3_w8_t{ node_min_x.data(), node_min_y.data(), node_min_z.data(), simd::unaligned_data };
+    ret.w8node.max = pqvec3_w8_t{ node_max_x.data(), node_max_y.data(), node_max_z.data(), simd::unaligned_data };
+    ret.w8node.tris_start = range.b;
+    ret.w8node.tris_count = range.size();
+
+    return ret;
 }
 
+bvh8w_t::edge_tree_t bvh8w_constructor_t::build_edge_tree(const std::vector<edge_t>& edges, const wt::wt_context_t& ctx) {
+    bvh8w_t::edge_tree_t tree;
+    if (edges.empty())
+        return tree;
+
+    tree.edge_ids.resize(edges.size());
+    for (auto e=0ul; e<edges.size(); ++e)
+        tree.edge_ids[e] = (std::uint32_t)e;
+
+    std::list<std::future<edge_node_result_t>> futures;
+
+    tree.nodes.emplace_back();     // create root
+    futures.emplace_back(ctx.threadpool->enqueue([&]() {
+        return build_edge_node8w(0, { 0, (std::uint32_t)edges.size() }, edges, tree.edge_ids);
+    }));
+    for (;!futures.empty();) {
+        const auto ret = std::move(futures.front()).get();
+        futures.pop_front();
+
+        tree.nodes[ret.w8_idx] = ret.w8node;
+        for (int c=0; c<ret.children_count; ++c) {
+            const auto& r = ret.children[c];
+
+            if (r.size()<=edge_tree_leaf_size) {
+                tree.leaf_nodes.emplace_back(bvh8w::leaf_node_t{ .tris_ptr = r.b, .count = r.size() });
+                if (tree.leaf_nodes.size()>limits<std::int32_t>::max())       // panic
+                    throw std::runtime_error("(BVH8w) Too many nodes!");
+
+                tree.nodes[ret.w8_idx].child_ptrs[c] = -(std::int32_t)(tree.leaf_nodes.size());  // leaf ptrs have set signs
+            } else {
+                const auto cidx = (idx_t)tree.nodes.size();
+                tree.nodes.emplace_back();     // create new node
+
+                if (cidx>limits<std::int32_t>::max())       // panic
+                    throw std::runtime_error("(BVH8w) Too many nodes!");
+
+                tree.nodes[ret.w8_idx].child_ptrs[c] = (std::int32_t)cidx+1;   // child ptrs have unset signs
+
+                futures.emplace_back(ctx.threadpool->enqueue([w8idx=cidx, r, &edges, &tree]() {
+                    return build_edge_node8w(w8idx, r, edges, tree.edge_ids);
+                }));
+            }
+        }
+    }
+
+    tree.nodes.shrink_to_fit();
+    tree.leaf_nodes.shrink_to_fit();
+
+    return tree;
+}
+
+
 bvh8w_constructor_t::bvh8w_constructor_t(
         std::vector<std::shared_ptr<shape_t>> objs,
         const wt::wt_context_t& ctx,
@@ -163,6 +263,37 @@ bvh8w_constructor_t::bvh8w_constructor_t(
     const auto start_timepoint = std::chrono::high_resolution_clock::now();
     pt.callbacks = std::move(progress_callbacks);
 
+    // only rays are traced: skip edges
+    const bool ray_only = ctx.renderer_force_ray_tracing;
+
+    // triangles read their vertices from the shapes' meshes
+    std::vector<const mesh::mesh_t*> meshes;
+    meshes.reserve(objs.size());
+    for (const auto& obj : objs)
+        meshes.emplace_back(&obj->get_mesh());
+
+
+    // attempt to load from cache
+    const bool use_cache = !ctx.ads_cache_path.empty();
+    std::uint64_t cache_key = 0;
+    if (use_cache) {
+        pt.set_status("looking up ADS cache");
+
+        cache_key = bvh8w_cache_t::cache_key(objs, ctx);
+        bvh8w = bvh8w_cache_t::load(ctx.ads_cache_path, cache_key, meshes);
+        if (bvh8w) {
+            // level-of-detail proxies and 16-wide nodes are not cached
+            if (!ray_only)
+                bvh8w->build_lod(ctx.ads_lod_footprint_fraction);
+            bvh8w->build_wide_nodes(ctx.ads_node_width);
+
+            this->build_time = std::chrono::high_resolution_clock::now() - start_timepoint;
+            pt.set_status("");
+            pt.complete();
+            return;
+        }
+    }
+
 
     // build plain binary BVH
     pt.proportion = pt_bvh_progress_portion;
@@ -189,16 +320,13 @@ bvh8w_constructor_t::bvh8w_constructor_t(
     std::vector<bvh8w::leaf_node_t> w8_leaf_nodes;
     w8nodes.reserve(total/8);
 
-    // create 8-wide clusters in parallel
-    auto w8tris_future = std::async(std::launch::async, [&](){ return create_w8_tris(bvh->tree_tris); });
-
     // encode 8-wide tree
     std::list<std::future<build_result_t>> futures;
     const auto world = bvh->V();
 
     w8nodes.emplace_back();     // create root
     futures.emplace_back(ctx.threadpool->enqueue([&]() {
-        return build_node8w(0, bvh->root(), world, bvhnc, bvh->tree_tris, pt);
+        return build_node8w(0, bvh->root(), world, bvhnc, bvh->tree_tris, meshes, pt);
     }));
     for (;!futures.empty();) {
         const auto ret = std::move(futures.front()).get();
@@ -225,8 +353,8 @@ bvh8w_constructor_t::bvh8w_constructor_t(
                 w8nodes[ret.w8_idx].child_ptrs[c] = (std::int32_t)cidx+1;   // child ptrs have unset signs
 
                 const auto paabb = wi.n->aabb;
-                futures.emplace_back(ctx.threadpool->enqueue([w8idx=cidx, &n, paabb, &bvhnc, &bvh, this]() {
-                    return build_node8w(w8idx, n, paabb, bvhnc, bvh->tree_tris, pt);
+                futures.emplace_back(ctx.threadpool->enqueue([w8idx=cidx, &n, paabb, &bvhnc, &bvh, &meshes, this]() {
+                    return build_node8w(w8idx, n, paabb, bvhnc, bvh->tree_tris, meshes, pt);
                 }));
             }
         }
@@ -241,25 +369,44 @@ bvh8w_constructor_t::bvh8w_constructor_t(
     calculate_occupancy(w8nodes[0], w8nodes, filled_chld, potential_chld, max_depth);
     f_t occupancy = filled_chld / f_t(potential_chld);
 
-    // finish tri clusters
-    auto w8tris = std::move(w8tris_future).get();
-
 
     // create bvh8w
     w8nodes.shrink_to_fit();
     w8_leaf_nodes.shrink_to_fit();
     bvh8w = std::make_unique<bvh8w_t>(std::move(w8nodes), std::move(w8_leaf_nodes), 
-                                      std::move(w8tris), std::move(bvh->tree_tris), 
-                                      world, bvh->get_sah_cost(), occupancy, max_depth);
+                                      std::move(bvh->tree_tris), std::move(meshes), ray_only,
+                                      world, bvh->get_sah_cost(), occupancy, max_depth,
+                                      std::move(bvh->tri_canonical));
+
+
+    // find edges (ray-only ADSs have none)
+    if (!ray_only) {
+        pt.start = pt_bvh_progress_portion + pt_8w_progress_portion;
+        pt.proportion = pt_edge_finding_portion;
+        pt.set_status("finding edges");
 
+        bvh8w->edges = find_edges(bvh8w.get(), bvh8w->tris, ctx, pt);
 
-    // find edges
-    pt.start = pt_bvh_progress_portion + pt_8w_progress_portion;
-    pt.proportion = pt_edge_finding_portion;
-    pt.set_status("finding edges");
+        pt.set_status("building edge tree");
+        bvh8w->edge_tree = build_edge_tree(bvh8w->edges, ctx);
+
+        // beam-footprint level of detail (beams only)
+        if (ctx.ads_lod_footprint_fraction>0) {
+            pt.set_status("building LOD proxies");
+            bvh8w->build_lod(ctx.ads_lod_footprint_fraction);
+        }
+    }
+
+    if (ctx.ads_node_width==16) {
+        pt.set_status("collapsing to 16-wide nodes");
+        bvh8w->build_wide_nodes(ctx.ads_node_width);
+    }
+
+    if (use_cache) {
+        pt.set_status("writing ADS cache");
+        bvh8w_cache_t::store(ctx.ads_cache_path, cache_key, *bvh8w);
+    }
 
-    bvh8w->edges = find_edges(bvh8w.get(), bvh8w->tris, ctx, pt);
-    
 
     // done building
     this->build_time = std::chrono::high_resolution_clock::now() - start_timepoint;
@@ -0,0 +1,179 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#include <vector>
+#include <utility>
+
+#include <wt/ads/bvh8w/bvh8w.hpp>
+#include <wt/ads/bvh8w/common.hpp>
+#include <wt/math/frame.hpp>
+
+using namespace wt;
+using namespace wt::ads;
+
+
+// minimal triangles count of a node with a proxy: smaller subtrees are cheap to traverse
+static constexpr std::uint32_t lod_min_triangles = 16;
+// minimal ratio of the length of the area-weighted sum of normals to the total area
+static constexpr f_t lod_min_normal_coherence = .95;
+// minimal ratio of the projected area of the triangles to the area of the proxy
+static constexpr f_t lod_min_coverage = .5;
+// maximal ratio of the thickness of the triangles (along the mean normal) to the proxy's size
+static constexpr f_t lod_max_relative_thickness = .1;
+
+
+namespace {
+
+/**
+ * @brief Aggregated area, normals and shape of a subtree's triangles, in metres.
+ */
+struct lod_aggregate_t {
+    static constexpr auto no_shape = limits<std::uint32_t>::max();
+
+    vec3_t area_normals = { 0,0,0 };
+    vec3_t area_centroids = { 0,0,0 };
+    f_t area = 0;
+
+    std::uint32_t shape_idx = no_shape;
+    bool mixed_shapes = false;
+
+    inline void add(const tri_t& tri, const tri_geometry_t& geo) noexcept {
+        const auto a = u::to_m(geo.a), b = u::to_m(geo.b), c = u::to_m(geo.c);
+        const auto A = m::length(m::cross(b-a, c-a)) / 2;
+
+        area_normals += A * vec3_t{ geo.n };
+        area_centroids += A * (a+b+c) / f_t(3);
+        area += A;
+
+        merge_shape(tri.shape_idx);
+    }
+
+    inline void add(const lod_aggregate_t& o) noexcept {
+        area_normals += o.area_normals;
+        area_centroids += o.area_centroids;
+        area += o.area;
+
+        if (o.mixed_shapes)
+            mixed_shapes = true;
+        else if (o.shape_idx!=no_shape)
+            merge_shape(o.shape_idx);
+    }
+
+private:
+    inline void merge_shape(std::uint32_t idx) noexcept {
+        if (shape_idx==no_shape)
+            shape_idx = idx;
+        else if (shape_idx!=idx)
+            mixed_shapes = true;
+    }
+};
+
+}
+
+
+void bvh8w_t::build_lod(f_t footprint_fraction) {
+    lod_footprint_fraction = footprint_fraction;
+    lod_nodes.clear();
+    proxy_tris.clear();
+    if (footprint_fraction<=0 || nodes.empty())
+        return;
+
+    const auto canonical = [&](idx_t t) { return (idx_t)canonical_tuid(tuid_t{ t })==t; };
+
+    // aggregate bottom-up: children are always stored after their parent
+    std::vector<lod_aggregate_t> aggregates(nodes.size());
+    lod_nodes.resize(nodes.size());
+    for (auto i=(std::int64_t)nodes.size()-1; i>=0; --i) {
+        const auto& n = nodes[i];
+        auto& agg = aggregates[i];
+
+        auto bounds = aabb_t::null();
+        for (auto c=0ul; c<bvh8w::aabbs_per_node; ++c) {
+            const auto ptr = n.child_ptrs[c];
+            if (bvh8w::is_ptr_empty(ptr))
+                continue;
+            bounds |= aabb_t{ n.min.read(c), n.max.read(c) };
+
+            if (bvh8w::is_ptr_leaf(ptr)) {
+                const auto& leaf = leaf_nodes[bvh8w::leaf_node_ptr(ptr)];
+                for (auto t=leaf.tris_ptr; t<leaf.tris_ptr+leaf.count; ++t)
+                    if (canonical(t)) agg.add(tris[t], tri_geometry(tuid_t{ t }));
+            }
+            else
+                agg.add(aggregates[bvh8w::child_node_ptr(ptr)]);
+        }
+
+        lod_nodes[i] = {
+            .proxy = invalid_idx,
+            .extent = bounds.empty() ? 0*u::m : m::length(bounds.max-bounds.min),
+        };
+
+        // a single shape, nearly coplanar?
+        const auto an = m::length(agg.area_normals);
+        if (n.tris_count<lod_min_triangles || agg.mixed_shapes || agg.area<=0 ||
+            an < lod_min_normal_coherence*agg.area)
+            continue;
+
+        // project the triangles on their mean plane
+        const auto N = dir3_t{ agg.area_normals / an };
+        const auto frame = frame_t::build_orthogonal_frame(N);
+        const auto centre = agg.area_centroids / agg.area;
+
+        vec2_t pmin = { limits<f_t>::infinity(), limits<f_t>::infinity() };
+        vec2_t pmax = -pmin;
+        f_t zmin = limits<f_t>::infinity(), zmax = -zmin;
+        for (auto t=n.tris_start; t<n.tris_start+n.tris_count; ++t) {
+            for (const auto& v : tri_vertices(tuid_t{ t })) {
+                const auto d = u::to_m(v) - centre;
+                const auto p = vec2_t{ m::dot(d,vec3_t{ frame.t }), m::dot(d,vec3_t{ frame.b }) };
+                pmin = m::min(pmin, p);
+                pmax = m::max(pmax, p);
+                const auto z = m::dot(d,vec3_t{ N });
+                zmin = m::min(zmin, z);
+                zmax = m::max(zmax, z);
+            }
+        }
+
+        // the proxy should be flat, and mostly covered by the triangles
+        const auto size = pmax-pmin;
+        const auto proxy_area = size.x*size.y;
+        if (proxy_area<=0 || an < lod_min_coverage*proxy_area ||
+            zmax-zmin > lod_max_relative_thickness*m::max(size.x,size.y))
+            continue;
+
+        // proxy rectangle, as two triangles facing N
+        const auto corner = [&](f_t x, f_t y) {
+            return pqvec3_t{ (centre + x*vec3_t{ frame.t } + y*vec3_t{ frame.b }) * u::m };
+        };
+        const auto p00 = corner(pmin.x,pmin.y), p10 = corner(pmax.x,pmin.y);
+        const auto p11 = corner(pmax.x,pmax.y), p01 = corner(pmin.x,pmax.y);
+        const bool flip = m::dot(m::cross(vec3_t{ frame.t }, vec3_t{ frame.b }), vec3_t{ N })<0;
+
+        // projected area of the triangles upon the proxy
+        const auto coverage = m::min<f_t>(1, an/proxy_area);
+        const auto proxy = [&](pqvec3_t a, pqvec3_t b, pqvec3_t c) {
+            if (flip) std::swap(b,c);
+            proxy_tris.emplace_back(proxy_tri_t{
+                .tri = tri_t{
+                    .shape_idx = agg.shape_idx,
+                    .shape_tri_idx = tri_t::proxy_shape_tri_idx,
+                },
+                .geometry = tri_geometry_t{
+                    .a = a, .b = b, .c = c,
+                    .n = N,
+                },
+                .coverage = coverage,
+            });
+        };
+
+        lod_nodes[i].proxy = (idx_t)proxy_tris.size();
+        proxy(p00, p10, p11);
+        proxy(p00, p11, p01);
+    }
+}
@@ -0,0 +1,34 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+// Node kernels compiled for the target ISA, and the selection of the kernels used for traversal.
+
+#include <wt/ads/bvh8w/node16_kernels_impl.hpp>
+#include <wt/util/cpu_features.hpp>
+
+using namespace wt;
+using namespace wt::ads::bvh8w;
+
+
+constinit const node16_kernels_t wt::ads::bvh8w::node16_kernels_target = make_node16_kernels("target ISA");
+
+const node16_kernels_t& wt::ads::bvh8w::node16_kernels() noexcept {
+    static const node16_kernels_t& selected = []() -> const node16_kernels_t& {
+        const auto cpu_level = cpu_features_t::detect().x86_64_level();
+        const auto target_level = cpu_features_t::compiled().x86_64_level();
+
+        // per-ISA kernels are used when the CPU supports a higher level than the target ISA
+        if (cpu_level>=4 && target_level<4 && node16_kernels_x86_64_v4)
+            return *node16_kernels_x86_64_v4;
+        if (cpu_level>=3 && target_level<3 && node16_kernels_x86_64_v3)
+            return *node16_kernels_x86_64_v3;
+        return node16_kernels_target;
+    }();
+    return selected;
+}
@@ -0,0 +1,29 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+// Node kernels compiled for x86-64-v3 (AVX2), see CMakeLists.txt.
+// Only the (constant-initialized) table is read before the kernels are selected, on CPUs that may not support x86-64-v3: this translation unit must include nothing but the self-contained kernel implementation.
+
+#if defined(__AVX2__) && defined(__FMA__) && defined(__BMI2__)
+
+#include <wt/ads/bvh8w/node16_kernels_impl.hpp>
+
+namespace {
+constinit const node16_kernels_t kernels = make_node16_kernels("x86-64-v3");
+}
+constinit const node16_kernels_t* const wt::ads::bvh8w::node16_kernels_x86_64_v3 = &kernels;
+
+#else
+
+#include <wt/ads/bvh8w/node16_kernels.hpp>
+
+// not compiled for x86-64-v3 (e.g., MSVC, or non-x86 targets)
+constinit const wt::ads::bvh8w::node16_kernels_t* const wt::ads::bvh8w::node16_kernels_x86_64_v3 = nullptr;
+
+#endif
@@ -0,0 +1,553 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <optional>
+#include <algorithm>
+
+#include <wt/ads/bvh8w/bvh8w_refit.hpp>
+#include <wt/ads/bvh8w/bvh8w_constructor.hpp>
+#include <wt/ads/bvh8w/common.hpp>
+#include <wt/ads/edge_classification.hpp>
+
+#include <wt/util/thread_pool/tpool.hpp>
+
+using namespace wt;
+using namespace wt::ads;
+using namespace wt::ads::construction;
+
+
+// SAH costs, as used by the binary BVH builder
+static constexpr f_t sah_traversal_cost = 1;
+static constexpr f_t sah_intersection_cost = 100;
+
+static constexpr std::size_t refit_chunk = 1<<14;
+
+
+inline auto child_aabb(const bvh8w::node_t& node, std::size_t c) noexcept {
+    return aabb_t{ node.min.read(c), node.max.read(c) };
+}
+
+inline auto node_bounds(const bvh8w::node_t& node) noexcept {
+    auto aabb = aabb_t::null();
+    for (std::size_t c=0; c<bvh8w::aabbs_per_node; ++c)
+        if (!bvh8w::is_ptr_empty(node.child_ptrs[c]))
+            aabb |= child_aabb(node, c);
+    return aabb;
+}
+
+/**
+ * @brief Refits the bounds of an 8-wide tree, bottom-up.
+ *        Children are always stored after their parent, so a single reverse pass over the nodes visits every child before its parent.
+ * @param leaf_dirty returns TRUE when a leaf's primitives have moved
+ * @param leaf_aabb computes the bounds of a leaf's primitives
+ * @return number of refitted nodes
+ */
+template <typename LeafDirty, typename LeafAabb>
+inline std::size_t refit_nodes(std::vector<bvh8w::node_t>& nodes,
+                               const std::vector<bvh8w::leaf_node_t>& leaf_nodes,
+                               LeafDirty&& leaf_dirty,
+                               LeafAabb&& leaf_aabb) {
+    std::vector<std::uint8_t> dirty(nodes.size(), 0);
+    std::size_t refitted = 0;
+
+    for (auto n=nodes.size(); n-->0;) {
+        auto& node = nodes[n];
+
+        // find dirty children
+        std::array<bool,bvh8w::aabbs_per_node> dirty_child{};
+        bool any_dirty = false;
+        for (std::size_t c=0; c<bvh8w::aabbs_per_node; ++c) {
+            const auto ptr = node.child_ptrs[c];
+            if (bvh8w::is_ptr_leaf(ptr))
+                dirty_child[c] = leaf_dirty(leaf_nodes[bvh8w::leaf_node_ptr(ptr)]);
+            else if (bvh8w::is_ptr_child(ptr)) {
+                assert(bvh8w::child_node_ptr(ptr)>n);
+                dirty_child[c] = dirty[bvh8w::child_node_ptr(ptr)];
+            }
+            any_dirty |= dirty_child[c];
+        }
+        if (!any_dirty)
+            continue;
+
+        // re-encode
+        std::array<length_t,8> node_min_x, node_max_x, node_min_y, node_max_y, node_min_z, node_max_z;
+        for (std::size_t c=0; c<bvh8w::aabbs_per_node; ++c) {
+            const auto ptr = node.child_ptrs[c];
+            auto aabb = child_aabb(node, c);
+            if (dirty_child[c]) {
+                aabb = bvh8w::is_ptr_leaf(ptr) ?
+                    leaf_aabb(leaf_nodes[bvh8w::leaf_node_ptr(ptr)]) :
+                    node_bounds(nodes[bvh8w::child_node_ptr(ptr)]);
+            }
+
+            node_min_x[c] = aabb.min.x;
+            node_min_y[c] = aabb.min.y;
+            node_min_z[c] = aabb.min.z;
+            node_max_x[c] = aabb.max.x;
+            node_max_y[c] = aabb.max.y;
+            node_max_z[c] = aabb.max.z;
+        }
+
+        node.min = pqvec3_w8_t{ node_min_x.data(), node_min_y.data(), node_min_z.data(), simd::unaligned_data };
+        node.max = pqvec3_w8_t{ node_max_x.data(), node_max_y.data(), node_max_z.data(), simd::unaligned_data };
+
+        dirty[n] = 1;
+        ++refitted;
+    }
+
+    return refitted;
+}
+
+/**
+ * @brief Flags the triangles of changed shapes: their vertices are read from the shapes' (updated) meshes. Returns per-triangle dirty flags.
+ */
+inline auto dirty_triangles(const std::vector<tri_t>& tris,
+                            const std::vector<std::uint8_t>& changed,
+                            std::size_t& updated,
+                            const wt::wt_context_t& ctx) {
+    std::vector<std::uint8_t> tri_dirty(tris.size(), 0);
+
+    std::vector<std::future<std::size_t>> futures;
+    for (auto c=0ul; c<tris.size(); c+=refit_chunk) {
+        futures.emplace_back(ctx.threadpool->enqueue([&, c]() {
+            std::size_t count = 0;
+            const auto end = std::min(tris.size(), c+refit_chunk);
+            for (auto t=c; t<end; ++t) {
+                if (!changed[tris[t].shape_idx])
+                    continue;
+                tri_dirty[t] = 1;
+                ++count;
+            }
+            return count;
+        }));
+    }
+    updated = 0;
+    for (auto& f : futures)
+        updated += f.get();
+
+    return tri_dirty;
+}
+
+/**
+ * @brief Edge-id slot ``s`` (``ab``, ``bc``, ``ca``) of a triangle.
+ */
+inline tuid_t& edge_slot(tri_t& tri, const int s) noexcept {
+    return s==0 ? tri.edge_ab : s==1 ? tri.edge_bc : tri.edge_ca;
+}
+inline tuid_t edge_slot(const tri_t& tri, const int s) noexcept {
+    return s==0 ? tri.edge_ab : s==1 ? tri.edge_bc : tri.edge_ca;
+}
+/**
+ * @brief Vertices of edge slot ``s`` of a triangle, followed by the vertex opposite the edge.
+ */
+inline std::array<pqvec3_t,3> edge_slot_vertices(const tri_geometry_t& g, const int s) noexcept {
+    return s==0 ? std::array{ g.a,g.b,g.c } :
+           s==1 ? std::array{ g.b,g.c,g.a } :
+                  std::array{ g.c,g.a,g.b };
+}
+
+/**
+ * @brief An edge slot of a triangle that no longer shares the edge, after the edge's other triangle moved away.
+ */
+struct detached_edge_t {
+    tuid_t tri;
+    tuid_t edge;
+};
+
+/**
+ * @brief Re-classifies the edges of moved triangles. Returns per-edge dirty flags (for the edges that existed before the update).
+ *        When the motion broke an adjacency, the edge remains an edge of its first triangle only, and the second triangle is given a new boundary edge, appended to ``edges``.
+ */
+inline auto update_edges(const ads_t& tree,
+                         std::vector<edge_t>& edges,
+                         std::vector<tri_t>& tris,
+                         const std::vector<std::uint8_t>& tri_dirty,
+                         std::size_t& updated,
+                         std::size_t& detached,
+                         const wt::wt_context_t& ctx) {
+    std::vector<std::uint8_t> edge_dirty(edges.size(), 0);
+
+    const auto tuid_of = [&](const tri_t* t) {
+        return tuid_t{ (idx_t)(t - tris.data()) };
+    };
+
+    struct chunk_result_t {
+        std::size_t updated = 0;
+        std::vector<detached_edge_t> detached;
+    };
+
+    std::atomic<bool> inconsistent_normals = false;
+    std::vector<std::future<chunk_result_t>> futures;
+    for (auto c=0ul; c<edges.size(); c+=refit_chunk) {
+        futures.emplace_back(ctx.threadpool->enqueue([&, c]() {
+            chunk_result_t ret;
+            const auto end = std::min(edges.size(), c+refit_chunk);
+            for (auto eid=c; eid<end; ++eid) {
+                auto& edge = edges[eid];
+                const auto tuid1 = tuid_of(edge.tri1);
+                const auto tuid2 = edge.tri2 ? tuid_of(edge.tri2) : tuid_t{};
+                if (!tri_dirty[tuid1] && !(tuid2 && tri_dirty[tuid2]))
+                    continue;
+
+                const auto euid = tuid_t{ (idx_t)eid };
+                const auto* tri1 = edge.tri1;
+                const auto* tri2 = edge.tri2;
+
+                // edge vertices and opposite vertex, as classified originally
+                const auto g1 = tree.tri_geometry(tuid1);
+                const auto& a  = tri1->edge_ab==euid ? g1.a : tri1->edge_bc==euid ? g1.b : g1.c;
+                const auto& b  = tri1->edge_ab==euid ? g1.b : tri1->edge_bc==euid ? g1.c : g1.a;
+                const auto& c1 = tri1->edge_ab==euid ? g1.c : tri1->edge_bc==euid ? g1.a : g1.b;
+
+                const pqvec3_t* c2 = nullptr;
+                const auto g2 = tri2 ? tree.tri_geometry(tuid2) : g1;
+                if (tri2) {
+                    const auto shared = [&](const pqvec3_t& v) {
+                        return v==g2.a || v==g2.b || v==g2.c;
+                    };
+                    if (shared(a) && shared(b)) {
+                        c2 = g2.a!=a && g2.a!=b ? &g2.a :
+                             g2.b!=a && g2.b!=b ? &g2.b : &g2.c;
+                    } else {
+                        // adjacency broken by the motion: the edge remains an edge of the first triangle only
+                        ret.detached.emplace_back(detached_edge_t{ .tri=tuid2, .edge=euid });
+                        tri2 = nullptr;
+                    }
+                }
+
+                const auto e = edge_for(tri1, tri2, tuid1, tri2 ? tuid2 : tuid_t{},
+                                        a, b, c1, c2, g1.n, g2.n, inconsistent_normals);
+                if (e)
+                    edge = *e;
+                else {
+                    // rigid motion does not change the wedge: only possible when adjacency was broken
+                    edge.a = a;
+                    edge.b = b;
+                    edge.e = m::normalize(b-a);
+                    edge.tri2 = tri2;
+                }
+
+                edge_dirty[eid] = 1;
+                ++ret.updated;
+            }
+            return ret;
+        }));
+    }
+
+    updated = detached = 0;
+    std::vector<detached_edge_t> detached_edges;
+    for (auto& f : futures) {
+        auto ret = f.get();
+        updated += ret.updated;
+        detached_edges.insert(detached_edges.end(), ret.detached.begin(), ret.detached.end());
+    }
+
+    // triangles that no longer share their edge get their own boundary edge
+    for (const auto& d : detached_edges) {
+        auto& tri = tris[d.tri];
+        const auto g = tree.tri_geometry(d.tri);
+        for (int s=0; s<3; ++s) {
+            auto& slot = edge_slot(tri, s);
+            if (slot!=d.edge)
+                continue;
+
+            const auto v = edge_slot_vertices(g, s);
+            const auto e = edge_for(&tri, nullptr, d.tri, {},
+                                    v[0], v[1], v[2], nullptr, g.n, g.n, inconsistent_normals);
+            slot = tuid_t{};
+            if (e) {
+                if (edges.size()>=limits<std::uint32_t>::max())
+                    throw std::runtime_error("(bvh8w_refit) too many edges");
+                slot = tuid_t{ (idx_t)edges.size() };
+                edges.emplace_back(*e);
+            }
+        }
+    }
+    detached = detached_edges.size();
+
+    return edge_dirty;
+}
+
+/**
+ * @brief A boundary edge slot of a moved triangle that now coincides with a boundary edge slot of another triangle.
+ */
+struct edge_join_t {
+    tuid_t tri1, tri2;
+    int slot1, slot2;
+};
+
+/**
+ * @brief Re-classifies the boundary edges of moved triangles against their new neighbours: a boundary edge of a moved triangle that now coincides with a boundary edge of another triangle becomes an edge shared by both.
+ *        Neighbours are found as in construction (exactly shared vertices, see ``find_edges``). Replaced edges are removed from ``edges``, and triangles' edge ids are remapped.
+ * @return number of joined edges
+ */
+template <std::derived_from<ads_t> Ads>
+inline std::size_t join_edges(const Ads* tree,
+                              std::vector<edge_t>& edges,
+                              std::vector<tri_t>& tris,
+                              const std::vector<std::uint8_t>& tri_dirty,
+                              const wt::wt_context_t& ctx) {
+    // an edge slot is open when it holds no edge, or a boundary edge
+    const auto open = [&](const tri_t& tri, const int s) {
+        const auto eid = edge_slot(tri, s);
+        return !eid || edges[eid].tri2==nullptr;
+    };
+
+    std::vector<std::future<std::vector<edge_join_t>>> futures;
+    for (auto c=0ul; c<tris.size(); c+=refit_chunk) {
+        futures.emplace_back(ctx.threadpool->enqueue([&, c]() {
+            std::vector<edge_join_t> joins;
+            const auto end = std::min(tris.size(), c+refit_chunk);
+            for (auto t=c; t<end; ++t) {
+                const auto tuid = tuid_t{ (idx_t)t };
+                // copies of a triangle share the edges of the first copy
+                if (!tri_dirty[t] || tree->canonical_tuid(tuid)!=tuid)
+                    continue;
+                if (!open(tris[t],0) && !open(tris[t],1) && !open(tris[t],2))
+                    continue;
+
+                const auto g = tree->tri_geometry(tuid);
+                const auto grow_len = m::max(m::length(g.c-g.a),m::length(g.b-g.a))/128;
+                const auto ball = ball_t::from_points(g.a,g.b,g.c).grow(grow_len);
+
+                const auto record = tree->intersect(ball, { .detect_edges = false });
+                for (const auto& t2 : record.triangles()) {
+                    if (t2==tuid || tree->canonical_tuid(t2)!=t2)
+                        continue;
+                    // both moved: the least tuid joins
+                    if (tri_dirty[t2] && t2<tuid)
+                        continue;
+
+                    const auto og = tree->tri_geometry(t2);
+                    for (int s1=0; s1<3; ++s1) {
+                        if (!open(tris[t],s1)) continue;
+                        const auto v1 = edge_slot_vertices(g, s1);
+                        for (int s2=0; s2<3; ++s2) {
+                            const auto v2 = edge_slot_vertices(og, s2);
+                            const bool shared = (v1[0]==v2[0] && v1[1]==v2[1]) ||
+                                                (v1[0]==v2[1] && v1[1]==v2[0]);
+                            if (shared && open(tris[t2],s2))
+                                joins.emplace_back(edge_join_t{
+                                    .tri1=tuid, .tri2=t2, .slot1=s1, .slot2=s2,
+                                });
+                        }
+                    }
+                }
+            }
+            return joins;
+        }));
+    }
+
+    std::vector<edge_join_t> joins;
+    for (auto& f : futures) {
+        const auto ret = f.get();
+        joins.insert(joins.end(), ret.begin(), ret.end());
+    }
+    if (joins.empty())
+        return 0;
+
+    // join: the boundary edges are replaced by a shared edge
+    std::atomic<bool> inconsistent_normals = false;
+    std::vector<std::uint8_t> joined_slots(tris.size(), 0);
+    std::vector<std::uint8_t> removed(edges.size(), 0);
+    std::size_t joined = 0;
+    for (const auto& j : joins) {
+        // a slot joins a single edge
+        if ((joined_slots[j.tri1]>>j.slot1)&1 || (joined_slots[j.tri2]>>j.slot2)&1)
+            continue;
+        joined_slots[j.tri1] |= 1<<j.slot1;
+        joined_slots[j.tri2] |= 1<<j.slot2;
+
+        auto& tri1 = tris[j.tri1];
+        auto& tri2 = tris[j.tri2];
+        auto& slot1 = edge_slot(tri1, j.slot1);
+        auto& slot2 = edge_slot(tri2, j.slot2);
+        if (slot1) removed[slot1] = 1;
+        if (slot2) removed[slot2] = 1;
+        slot1 = slot2 = tuid_t{};
+
+        const auto g1 = tree->tri_geometry(j.tri1);
+        const auto g2 = tree->tri_geometry(j.tri2);
+        const auto v1 = edge_slot_vertices(g1, j.slot1);
+        const auto c2 = edge_slot_vertices(g2, j.slot2)[2];
+        const auto e = edge_for(&tri1, &tri2, j.tri1, j.tri2,
+                                v1[0], v1[1], v1[2], &c2, g1.n, g2.n, inconsistent_normals);
+        if (e) {
+            if (edges.size()>=limits<std::uint32_t>::max())
+                throw std::runtime_error("(bvh8w_refit) too many edges");
+            slot1 = slot2 = tuid_t{ (idx_t)edges.size() };
+            edges.emplace_back(*e);
+            removed.emplace_back(0);
+        }
+        ++joined;
+    }
+
+    // remove replaced edges, and remap edge ids
+    std::vector<idx_t> remap(edges.size());
+    idx_t next = 0;
+    for (auto eid=0ul; eid<edges.size(); ++eid) {
+        remap[eid] = next;
+        if (!removed[eid])
+            edges[next++] = edges[eid];
+    }
+    edges.resize(next);
+    for (auto& tri : tris) {
+        for (int s=0; s<3; ++s) {
+            auto& slot = edge_slot(tri, s);
+            if (slot)
+                slot = tuid_t{ remap[slot] };
+        }
+    }
+
+    return joined;
+}
+
+
+f_t bvh8w_refit_t::sah_cost(const bvh8w_t& bvh) noexcept {
+    const auto half_area = [](const aabb_t& aabb) {
+        return f_t(u::to_m2(aabb.surface_area()))/2;
+    };
+
+    f_t cost = 0;
+    for (const auto& node : bvh.nodes) {
+        for (std::size_t c=0; c<bvh8w::aabbs_per_node; ++c) {
+            const auto ptr = node.child_ptrs[c];
+            if (bvh8w::is_ptr_empty(ptr))
+                continue;
+
+            const auto ha = half_area(child_aabb(node, c));
+            cost += bvh8w::is_ptr_leaf(ptr) ?
+                sah_intersection_cost * ha * f_t(bvh.leaf_nodes[bvh8w::leaf_node_ptr(ptr)].count) :
+                sah_traversal_cost * ha;
+        }
+    }
+
+    const auto root_area = half_area(bvh.world);
+    return root_area>0 ? cost / root_area : 0;
+}
+
+bvh8w_refit_t::result_t bvh8w_refit_t::refit(
+        bvh8w_t& bvh,
+        const std::vector<std::shared_ptr<shape_t>>& shapes,
+        std::span<const std::uint32_t> changed_shapes,
+        const wt::wt_context_t& ctx) {
+    result_t ret;
+
+    std::vector<std::uint8_t> changed(shapes.size(), 0);
+    for (const auto s : changed_shapes) {
+        assert(s<shapes.size());
+        changed[s] = 1;
+    }
+
+    // triangles (meshes are re-bound, in case a shape's mesh was replaced)
+    for (const auto s : changed_shapes)
+        bvh.meshes[s] = &shapes[s]->get_mesh();
+    const auto tri_dirty = dirty_triangles(bvh.tris, changed, ret.triangles_updated, ctx);
+    if (ret.triangles_updated==0)
+        return ret;
+    // invalidates per-thread state bound to the tree
+    bvh.new_generation();
+
+    // tree bounds
+    ret.nodes_refitted = refit_nodes(bvh.nodes, bvh.leaf_nodes,
+        [&](const auto& leaf) {
+            for (auto t=leaf.tris_ptr; t<leaf.tris_ptr+leaf.count; ++t)
+                if (tri_dirty[t]) return true;
+            return false;
+        },
+        [&](const auto& leaf) {
+            auto aabb = aabb_t::null();
+            for (auto t=leaf.tris_ptr; t<leaf.tris_ptr+leaf.count; ++t) {
+                const auto p = bvh.tri_vertices(tuid_t{ t });
+                aabb |= aabb_t::from_points(p[0], p[1], p[2]);
+            }
+            return aabb;
+        });
+    bvh.world = node_bounds(bvh.nodes[0]);
+    bvh.update_mixed_precision_nodes();
+    // level-of-detail proxies of moved triangles
+    if (bvh.has_lod())
+        bvh.build_lod(bvh.lod_fraction());
+    // 16-wide node bounds
+    if (bvh.has_wide_nodes())
+        bvh.build_wide_nodes(bvh.node_width());
+
+    // edges and edge tree bounds
+    if (bvh.is_ray_only())
+        return ret;
+    const auto edge_dirty = update_edges(bvh, bvh.edges, bvh.tris, tri_dirty,
+                                         ret.edges_updated, ret.edges_detached, ctx);
+    ret.edges_joined = join_edges(&bvh, bvh.edges, bvh.tris, tri_dirty, ctx);
+
+    if (ret.edges_detached>0 || ret.edges_joined>0) {
+        // edges were added or removed: rebuild the edge tree
+        if (bvh.has_duplicate_triangles())
+            propagate_edges_to_copies(&bvh, bvh.tris);
+        bvh.edge_tree = bvh8w_constructor_t::build_edge_tree(bvh.edges, ctx);
+    }
+    else if (ret.edges_updated>0 && !bvh.edge_tree.empty()) {
+        const auto& edge_ids = bvh.edge_tree.edge_ids;
+        ret.nodes_refitted += refit_nodes(bvh.edge_tree.nodes, bvh.edge_tree.leaf_nodes,
+            [&](const auto& leaf) {
+                for (auto i=leaf.tris_ptr; i<leaf.tris_ptr+leaf.count; ++i)
+                    if (edge_dirty[edge_ids[i]]) return true;
+                return false;
+            },
+            [&](const auto& leaf) {
+                auto aabb = aabb_t::null();
+                for (auto i=leaf.tris_ptr; i<leaf.tris_ptr+leaf.count; ++i) {
+                    const auto& e = bvh.edges[edge_ids[i]];
+                    aabb |= e.a;
+                    aabb |= e.b;
+                }
+                return aabb;
+            });
+    }
+
+    return ret;
+}
+
+bvh8w_refit_t::result_t bvh8w_refit_t::update(
+        std::unique_ptr<ads_t>& ads,
+        const std::vector<std::shared_ptr<shape_t>>& shapes,
+        std::span<const std::uint32_t> changed_shapes) {
+    const auto start_timepoint = std::chrono::high_resolution_clock::now();
+
+    auto* bvh = dynamic_cast<bvh8w_t*>(ads.get());
+    if (!bvh)
+        throw std::runtime_error("(bvh8w_refit) ADS is not an 8-wide BVH");
+
+    if (built_tree!=bvh) {
+        // first update of this tree: record its quality as built
+        built_tree = bvh;
+        built_sah_cost = sah_cost(*bvh);
+    }
+
+    auto ret = refit(*bvh, shapes, changed_shapes, ctx);
+
+    if (ret.nodes_refitted>0) {
+        ret.sah_ratio = built_sah_cost>0 ? sah_cost(*bvh) / built_sah_cost : 1;
+
+        if (ret.sah_ratio > opts.rebuild_sah_ratio) {
+            // tree quality degraded: rebuild
+            ads = bvh8w_constructor_t{ shapes, ctx }.get();
+            ret.rebuilt = true;
+
+            built_tree = dynamic_cast<const bvh8w_t*>(ads.get());
+            built_sah_cost = built_tree ? sah_cost(*built_tree) : 0;
+        }
+    }
+
+    ret.elapsed = std::chrono::high_resolution_clock::now() - start_timepoint;
+    return ret;
+}
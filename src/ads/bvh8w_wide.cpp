@@ -0,0 +1,132 @@
+/*
+ *
+ * wave tracer
+ * Copyright  Shlomi Steinberg
+ *
+ * LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+ *
+ */
+
+#include <vector>
+#include <deque>
+#include <utility>
+#include <stdexcept>
+#include <string>
+
+#include <wt/ads/bvh8w/bvh8w.hpp>
+#include <wt/ads/bvh8w/common.hpp>
+
+using namespace wt;
+using namespace wt::ads;
+
+
+// nodes with fewer triangles are treated as leaves by ray traversal (see ``ray_traversal_treat_node_as_leaf_if_triangle_count_lt``): they are not collapsed into their parents
+static constexpr std::uint32_t wide_min_collapse_triangles = 16;
+
+
+namespace {
+
+struct wide_slot_t {
+    aabb_t bounds;
+    std::int32_t ptr;
+};
+
+inline std::size_t children_count(const bvh8w_t::node_t& n) noexcept {
+    std::size_t count = 0;
+    for (auto c=0ul; c<bvh8w::aabbs_per_node; ++c)
+        if (!bvh8w::is_ptr_empty(n.child_ptrs[c])) ++count;
+    return count;
+}
+
+}
+
+
+void bvh8w_t::build_wide_nodes(std::size_t width) {
+    nodes16.clear();
+    if (width==bvh8w::aabbs_per_node || nodes.empty()) {
+        nodes16.shrink_to_fit();
+        return;
+    }
+    if (width!=bvh8w::aabbs_per_node16)
+        throw std::runtime_error("(bvh8w) unsupported node width: " + std::to_string(width));
+
+    const auto add_children = [&](const node_t& n, std::vector<wide_slot_t>& slots) {
+        for (auto c=0ul; c<bvh8w::aabbs_per_node; ++c) {
+            const auto ptr = n.child_ptrs[c];
+            if (!bvh8w::is_ptr_empty(ptr))
+                slots.emplace_back(wide_slot_t{ aabb_t{ n.min.read(c), n.max.read(c) }, ptr });
+        }
+    };
+
+    // (8-wide node, 16-wide node) pairs to collapse, breadth first
+    std::deque<std::pair<std::uint32_t, std::uint32_t>> queue;
+    nodes16.reserve(nodes.size()/2+1);
+    nodes16.emplace_back();
+    queue.emplace_back(bvh8w::child_node_ptr(root_ptr()), 0);
+
+    std::vector<wide_slot_t> slots;
+    while (!queue.empty()) {
+        const auto [nidx8, nidx16] = queue.front();
+        queue.pop_front();
+
+        slots.clear();
+        add_children(nodes[nidx8], slots);
+
+        // greedily open the internal child with the largest surface area, while the children fit in a 16-wide node
+        for (;;) {
+            std::size_t best = slots.size();
+            for (std::size_t s=0; s<slots.size(); ++s) {
+                const auto ptr = slots[s].ptr;
+                if (!bvh8w::is_ptr_child(ptr))
+                    continue;
+                const auto& child = nodes[bvh8w::child_node_ptr(ptr)];
+                if (child.tris_count<wide_min_collapse_triangles ||
+                    slots.size()-1+children_count(child) > bvh8w::aabbs_per_node16)
+                    continue;
+                if (best==slots.size() ||
+                    slots[s].bounds.surface_area() > slots[best].bounds.surface_area())
+                    best = s;
+            }
+            if (best==slots.size())
+                break;
+
+            const auto& child = nodes[bvh8w::child_node_ptr(slots[best].ptr)];
+            slots.erase(slots.begin()+best);
+            add_children(child, slots);
+        }
+
+        // write node: empty slots never intersect
+        bvh8w::node16_t n16{};
+        for (auto c=0ul; c<bvh8w::aabbs_per_node16; ++c) {
+            for (auto a=0; a<3; ++a) {
+                n16.min[a][c] = limits<f_t>::infinity();
+                n16.max[a][c] = -limits<f_t>::infinity();
+            }
+            n16.child_ptrs[c] = 0;
+        }
+        for (std::size_t c=0; c<slots.size(); ++c) {
+            const auto min = u::to_m(slots[c].bounds.min);
+            const auto max = u::to_m(slots[c].bounds.max);
+            for (auto a=0; a<3; ++a) {
+                n16.min[a][c] = (f_t)min[a];
+                n16.max[a][c] = (f_t)max[a];
+            }
+
+            auto ptr = slots[c].ptr;
+            if (bvh8w::is_ptr_child(ptr)) {
+                const auto child16 = (std::uint32_t)nodes16.size();
+                nodes16.emplace_back();
+                queue.emplace_back(bvh8w::child_node_ptr(ptr), child16);
+                ptr = (std::int32_t)child16+1;
+            }
+            n16.child_ptrs[c] = ptr;
+        }
+        n16.tris_start = nodes[nidx8].tris_start;
+        n16.tris_count = nodes[nidx8].tris_count;
+        n16.node8 = nidx8;
+
+        nodes16[nidx16] = n16;
+    }
+
+    nodes16.shrink_to_fit();
+}
@@ -8,9 +8,21 @@
  *
  */
 
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <format>
+
 #include <wt/ads/bvh_constructor.hpp>
 #include <wt/ads/traversal_common.hpp>
 
+#include <wt/util/thread_pool/tpool.hpp>
+#include <wt/util/logger/logger.hpp>
+
 
 // SAH parameters for costs of traversal / insertion
 // For cone tracing, build very deep trees: subtrees contained in a cone get traversed as a leaf.
@@ -48,6 +60,27 @@ using namespace wt::ads;
 using namespace wt::ads::construction;
 
 
+using tbvh_t =
+#ifdef TBVH_USE_SINGLES
+    tinybvh::BVH;
+#else
+    tinybvh::BVH_Double;
+#endif
+
+
+/**
+ * @brief A triangle with its vertices, during construction only: the built tree's triangles read their vertices from the meshes.
+ */
+struct build_tri_t {
+    pqvec3_t a,b,c;
+    tri_t tri;
+};
+
+
+/**
+ * @brief Re-encodes a tinybvh tree into our binary BVH clusters.
+ * @param tri_map maps tinybvh primitive indices to indices into `all_tris`. `nullptr` for identity.
+ */
 inline bvh::node_t tbvh_to_bvh_recursive(
 #ifdef TBVH_USE_SINGLES
         const tinybvh::BVH::BVHNode* tbvh_nodes,
@@ -59,7 +92,8 @@ inline bvh::node_t tbvh_to_bvh_recursive(
         const std::uint64_t* tbvh_tidx,
 #endif
         std::vector<bvh::node_cluster_t>& node_clusters,
-        const std::vector<tri_t>& all_tris,
+        const std::vector<build_tri_t>& all_tris,
+        const idx_t* tri_map,
         std::vector<tri_t>& bvhtris) noexcept {
     bvh::node_t n;
     n.aabb = aabb_t{ vec3_t{ tnode.aabbMin.x, tnode.aabbMin.y, tnode.aabbMin.z } * u::m,
@@ -75,8 +109,10 @@ inline bvh::node_t tbvh_to_bvh_recursive(
         n.tri_count = tnode.triCount;
         n.tris_offset = (idx_t)bvhtris.size();
 
-        for (idx_t tidx = 0; tidx<tnode.triCount; ++tidx)
-            bvhtris.emplace_back(all_tris[tbvh_tidx[tidx + tnode.leftFirst]]);
+        for (idx_t tidx = 0; tidx<tnode.triCount; ++tidx) {
+            const auto pidx = (idx_t)tbvh_tidx[tidx + tnode.leftFirst];
+            bvhtris.emplace_back(all_tris[tri_map ? tri_map[pidx] : pidx].tri);
+        }
     } else {
         n.is_leaf = false;
         n.tri_count = 0;
@@ -88,15 +124,54 @@ inline bvh::node_t tbvh_to_bvh_recursive(
 
         node_clusters[n.children_cluster_offset].nodes[0] = 
             tbvh_to_bvh_recursive(tbvh_nodes, tchild1, tbvh_tidx,
-                                  node_clusters, all_tris, bvhtris);
+                                  node_clusters, all_tris, tri_map, bvhtris);
         node_clusters[n.children_cluster_offset].nodes[1] = 
             tbvh_to_bvh_recursive(tbvh_nodes, tchild2, tbvh_tidx,
-                                  node_clusters, all_tris, bvhtris);
+                                  node_clusters, all_tris, tri_map, bvhtris);
     }
 
     return n;
 }
 
+/**
+ * @brief Builds a tinybvh BVH over a list of triangles.
+ */
+inline void tbvh_build(tbvh_t& tbvh, const std::vector<build_tri_t>& all_tris,
+                       const idx_t* tri_map, std::size_t count) {
+#ifdef TBVH_USE_SINGLES
+    std::vector<tinybvh::bvhvec4> tbvhtris;
+    tbvhtris.reserve(count*3);
+    for (auto i=0ul; i<count; ++i) {
+        const auto& t = all_tris[tri_map ? tri_map[i] : i];
+        tbvhtris.emplace_back(u::to_m(t.a.x), u::to_m(t.a.y), u::to_m(t.a.z), 0);
+        tbvhtris.emplace_back(u::to_m(t.b.x), u::to_m(t.b.y), u::to_m(t.b.z), 0);
+        tbvhtris.emplace_back(u::to_m(t.c.x), u::to_m(t.c.y), u::to_m(t.c.z), 0);
+    }
+
+    tbvh.BuildAVX(tbvhtris.data(), tbvhtris.size()/3);
+#else
+    std::vector<tinybvh::bvhdbl3> tbvhtris;
+    tbvhtris.reserve(count*3);
+    for (auto i=0ul; i<count; ++i) {
+        const auto& t = all_tris[tri_map ? tri_map[i] : i];
+        tbvhtris.emplace_back((double)u::to_m(t.a.x), (double)u::to_m(t.a.y), (double)u::to_m(t.a.z));
+        tbvhtris.emplace_back((double)u::to_m(t.b.x), (double)u::to_m(t.b.y), (double)u::to_m(t.b.z));
+        tbvhtris.emplace_back((double)u::to_m(t.c.x), (double)u::to_m(t.c.y), (double)u::to_m(t.c.z));
+    }
+
+    tbvh.Build(tbvhtris.data(), tbvhtris.size()/3);
+#endif
+}
+
+inline void tbvh_optimize([[maybe_unused]] tbvh_t& tbvh) {
+#ifdef TBVH_USE_SINGLES
+    tinybvh::BVH_Verbose tmp;
+    tmp.ConvertFrom(tbvh);
+    tmp.Optimize(tbvh_optimize_iterations);
+    tbvh.ConvertFrom(tmp);
+#endif
+}
+
 void tree_dfs_write_triangle_ptrs(std::vector<bvh::node_cluster_t>& node_clusters,
                                   bvh::node_t& node) {
     if (node.is_leaf) return;
@@ -120,130 +195,990 @@ void tree_dfs_write_triangle_ptrs(std::vector<bvh::node_cluster_t>& node_cluster
     node.tri_count = trange.length();
 }
 
-bvh_constructor_t::bvh_constructor_t(
-        std::vector<std::shared_ptr<shape_t>> objs,
-        const wt::wt_context_t& ctx,
-        progress_track_t& pt)
-{
-    constexpr auto build_pb = .35f;
-    constexpr auto optimize_pb = .95f;
+/*
+ * Parallel top-level build.
+ * The top levels of the tree are partitioned using binned SAH (binning and partitioning are
+ * task-parallel on the thread pool), until enough subtrees exist to keep all workers busy.
+ * Then, each subtree is built and optimized with tinybvh, and re-encoded, concurrently. The
+ * subtrees are finally spliced into a single binary BVH.
+ */
 
-    {
-        // extract tris from shapes and initialize bvh_primitives
-        std::vector<tri_t> all_tris;
-        for (idx_t objid = 0; objid < objs.size(); ++objid) {
-            const auto& obj = objs[objid];
-
-            const auto& mesh = obj->get_mesh();
-            const auto& mesh_tris = mesh.get_tris();
-
-            for (mesh::mesh_t::tidx_t triid = 0; triid < mesh_tris.size(); ++triid) {
-                const mesh::triangle_t& tri = mesh_tris[triid];
-
-                all_tris.emplace_back(tri_t{
-                    .a = tri.p[0],
-                    .b = tri.p[1],
-                    .c = tri.p[2],
-                    .n = tri.geo_n,
-                    .shape_idx = objid,
-                    .shape_tri_idx = triid
-                });
+// scenes with fewer triangles use a single tinybvh build
+static constexpr std::size_t parallel_build_min_tris = 1<<17;
+// top-level partitioning stops at subtrees of this size, or once there are enough subtrees per thread
+static constexpr std::size_t subtree_min_tris = 1<<14;
+static constexpr std::size_t subtrees_per_thread = 4;
+static constexpr std::size_t top_level_bins = 32;
+static constexpr std::size_t parallel_chunk = 1<<16;
+
+namespace {
+
+struct box_t {
+    vec3_t min = vec3_t{ +limits<f_t>::infinity() };
+    vec3_t max = vec3_t{ -limits<f_t>::infinity() };
+
+    inline void grow(const vec3_t& p) noexcept { min = m::min(min,p); max = m::max(max,p); }
+    inline void grow(const box_t& b) noexcept  { min = m::min(min,b.min); max = m::max(max,b.max); }
+
+    [[nodiscard]] inline bool empty() const noexcept { return !(min.x<=max.x); }
+    [[nodiscard]] inline f_t half_area() const noexcept {
+        if (empty()) return 0;
+        const auto d = max-min;
+        return d.x*d.y + d.y*d.z + d.z*d.x;
+    }
+    [[nodiscard]] inline auto to_aabb() const noexcept {
+        return aabb_t{ min*u::m, max*u::m };
+    }
+};
+
+struct bin_t {
+    box_t bounds, centroids;
+    std::size_t count = 0;
+};
+using bins_t = std::array<std::array<bin_t, top_level_bins>, 3>;
+
+struct top_node_t {
+    box_t bounds, centroids;
+    // range of triangle references
+    std::size_t begin, end;
+    // children top nodes, -1 for subtrees
+    std::int32_t left=-1, right=-1;
+
+    [[nodiscard]] inline auto count() const noexcept { return end-begin; }
+    [[nodiscard]] inline bool is_subtree() const noexcept { return left<0; }
+};
+
+struct top_split_t {
+    int axis = -1;
+    std::size_t bin;
+    f_t cost = limits<f_t>::infinity();
+    box_t lbounds, lcentroids, rbounds, rcentroids;
+    std::size_t lcount;
+};
+
+struct subtree_result_t {
+    bvh::node_t root;
+    std::vector<bvh::node_cluster_t> clusters;
+    std::vector<tri_t> tris;
+    // indices of the triangles into the input triangles (only populated by the spatial-split builder)
+    std::vector<idx_t> tri_ids;
+    // unnormalized SAH cost
+    f_t sah;
+};
+
+inline auto bin_index(const box_t& centroids, const vec3_t& c, int axis) noexcept {
+    const auto ext = centroids.max[axis]-centroids.min[axis];
+    if (!(ext>0)) return std::size_t(0);
+    const auto b = (std::size_t)((c[axis]-centroids.min[axis]) / ext * f_t(top_level_bins));
+    return m::min(b, top_level_bins-1);
+}
+
+inline auto bin_range(const box_t& node_centroids,
+                      const idx_t* refs, std::size_t begin, std::size_t end,
+                      const std::vector<box_t>& tri_bounds,
+                      const std::vector<vec3_t>& centroids) noexcept {
+    bins_t bins{};
+    for (auto i=begin; i<end; ++i) {
+        const auto t = refs[i];
+        for (int a=0; a<3; ++a) {
+            auto& b = bins[a][bin_index(node_centroids, centroids[t], a)];
+            b.bounds.grow(tri_bounds[t]);
+            b.centroids.grow(centroids[t]);
+            ++b.count;
+        }
+    }
+    return bins;
+}
+
+inline auto find_split(const bins_t& bins) noexcept {
+    top_split_t best{};
+    for (int a=0; a<3; ++a) {
+        // sweep from the right
+        std::array<box_t, top_level_bins> rbounds, rcentroids;
+        std::array<std::size_t, top_level_bins> rcount;
+        box_t b, c;
+        std::size_t n = 0;
+        for (auto i=top_level_bins-1; i>0; --i) {
+            b.grow(bins[a][i].bounds);
+            c.grow(bins[a][i].centroids);
+            n += bins[a][i].count;
+            rbounds[i] = b;
+            rcentroids[i] = c;
+            rcount[i] = n;
+        }
+
+        // ... and from the left
+        b = {}; c = {}; n = 0;
+        for (auto i=1ul; i<top_level_bins; ++i) {
+            b.grow(bins[a][i-1].bounds);
+            c.grow(bins[a][i-1].centroids);
+            n += bins[a][i-1].count;
+            if (n==0 || rcount[i]==0) continue;
+
+            const auto cost = b.half_area()*f_t(n) + rbounds[i].half_area()*f_t(rcount[i]);
+            if (cost<best.cost) {
+                best.axis = a;
+                best.bin = i;
+                best.cost = cost;
+                best.lbounds = b;
+                best.lcentroids = c;
+                best.rbounds = rbounds[i];
+                best.rcentroids = rcentroids[i];
+                best.lcount = n;
             }
         }
+    }
+    return best;
+}
 
-        if (all_tris.empty())
-            throw std::runtime_error("(bvh_constructor) no triangles found!");
+template <typename F>
+inline void parallel_for_chunks(const wt::wt_context_t& ctx, std::size_t begin, std::size_t end, F&& f) {
+    std::vector<std::future<void>> futures;
+    for (auto c=begin; c<end; c+=parallel_chunk) {
+        const auto cend = m::min(end, c+parallel_chunk);
+        futures.emplace_back(ctx.threadpool->enqueue([&f, c, cend]() { f(c, cend); }));
+    }
+    for (auto& fut : futures)
+        fut.get();
+}
 
-        // build BVH using tinybvh
+/**
+ * @brief SAH cost of a subtree, in the same units as the top-level nodes.
+ */
+inline f_t subtree_sah(const subtree_result_t& r) noexcept {
+    const auto node_cost = [](const bvh::node_t& n) {
+        const auto d = u::to_m(n.aabb.max-n.aabb.min);
+        const auto ha = f_t(d.x*d.y + d.y*d.z + d.z*d.x);
+        return n.is_leaf ? C_INT * ha * f_t(n.tri_count) : C_TRAV * ha;
+    };
+
+    f_t sah = node_cost(r.root);
+    for (auto c=1ul; c<r.clusters.size(); ++c)
+        sah += node_cost(r.clusters[c].nodes[0]) + node_cost(r.clusters[c].nodes[1]);
+    return sah;
+}
+
+/**
+ * @brief Builds a subtree with tinybvh, and re-encodes it. The root is returned separately and cluster 0 is unused.
+ */
+inline auto build_subtree(const std::vector<build_tri_t>& all_tris,
+                          const idx_t* tri_map, std::size_t count) {
+    subtree_result_t ret;
+
+    tbvh_t tbvh;
+    tbvh_build(tbvh, all_tris, tri_map, count);
+    tbvh_optimize(tbvh);
 
-        using tbvh_t = 
 #ifdef TBVH_USE_SINGLES
-            tinybvh::BVH;
+    ret.clusters.reserve(tbvh.NodeCount()/2+1);
 #else
-            tinybvh::BVH_Double;
+    ret.clusters.reserve(tbvh.usedNodes/2+1);
 #endif
-        tbvh_t tbvh;
+    ret.tris.reserve(count);
 
-        {
-            pt.set_status("tiny_bvh build()");
-            f_t prog = 0;
-            tinybvh::progress_tracker = [&](f_t p) {
-                if (p>prog+f_t(.02)) {
-                    pt.set_progress(p * build_pb);
-                    prog = p;
+    ret.clusters.emplace_back();
+    ret.clusters.front().nodes[0] = 
+        tbvh_to_bvh_recursive(tbvh.bvhNode, tbvh.bvhNode[0], tbvh.primIdx,
+                              ret.clusters, all_tris, tri_map, ret.tris);
+    tree_dfs_write_triangle_ptrs(ret.clusters, ret.clusters.front().nodes[0]);
+    ret.root = ret.clusters.front().nodes[0];
+    ret.sah = subtree_sah(ret);
+
+    return ret;
+}
+
+/**
+ * @brief Splices subtrees that were built under a top-level tree into a single binary BVH: root cluster, then top-level interior clusters, then the subtrees' clusters.
+ *        The subtrees' triangles are laid out in depth-first order of the top-level tree.
+ * @param tri_ids if not null, receives the subtrees' triangle ids, in the same order as ``bvhtris``.
+ */
+template <typename TopNode>
+inline void splice_subtrees(const std::vector<TopNode>& top_nodes,
+                            const std::vector<std::size_t>& subtrees,
+                            const std::vector<subtree_result_t>& results,
+                            const wt::wt_context_t& ctx,
+                            std::vector<bvh::node_cluster_t>& node_clusters,
+                            std::vector<tri_t>& bvhtris,
+                            std::vector<idx_t>* tri_ids,
+                            f_t& sah_cost) {
+    std::size_t clusters_count = 1;
+    std::vector<std::size_t> cluster_base(top_nodes.size());
+    for (auto n=0ul; n<top_nodes.size(); ++n)
+        if (!top_nodes[n].is_subtree()) cluster_base[n] = clusters_count++;
+    for (const auto n : subtrees) {
+        cluster_base[n] = clusters_count;
+        clusters_count += results[n].clusters.size()-1;
+    }
+
+    // triangle ranges of top-level nodes
+    std::vector<std::size_t> tri_base(top_nodes.size()), tri_count(top_nodes.size());
+    std::size_t tris_count = 0;
+    const std::function<void(std::size_t)> layout = [&](std::size_t n) {
+        tri_base[n] = tris_count;
+        if (top_nodes[n].is_subtree())
+            tris_count += results[n].tris.size();
+        else {
+            layout(top_nodes[n].left);
+            layout(top_nodes[n].right);
+        }
+        tri_count[n] = tris_count - tri_base[n];
+    };
+    layout(0);
+
+    node_clusters.resize(clusters_count);
+    bvhtris.resize(tris_count, results[subtrees.front()].tris.front());
+    if (tri_ids)
+        tri_ids->resize(tris_count);
+
+    const auto shift_node = [](bvh::node_t n, std::size_t cbase, std::size_t tbase) {
+        n.tris_offset += (idx_t)tbase;
+        if (!n.is_leaf)
+            n.children_cluster_offset = n.children_cluster_offset - 1 + (idx_t)cbase;
+        return n;
+    };
+
+    std::vector<std::future<void>> splice_futures;
+    for (const auto n : subtrees) {
+        splice_futures.emplace_back(ctx.threadpool->enqueue([&, n]() {
+            const auto& r = results[n];
+            const auto cbase = cluster_base[n];
+            const auto tbase = tri_base[n];
+            for (auto c=1ul; c<r.clusters.size(); ++c) {
+                auto& dst = node_clusters[cbase+c-1];
+                dst.nodes[0] = shift_node(r.clusters[c].nodes[0], cbase, tbase);
+                dst.nodes[1] = shift_node(r.clusters[c].nodes[1], cbase, tbase);
+            }
+            std::ranges::copy(r.tris, bvhtris.begin()+tbase);
+            if (tri_ids)
+                std::ranges::copy(r.tri_ids, tri_ids->begin()+tbase);
+        }));
+    }
+
+    const auto root_area = m::max(f_t(1e-30), top_nodes[0].bounds.half_area());
+    f_t sah = 0;
+    const std::function<bvh::node_t(std::size_t)> encode_top = [&](std::size_t n) {
+        const auto& tn = top_nodes[n];
+        if (tn.is_subtree()) {
+            sah += results[n].sah;
+            return shift_node(results[n].root, cluster_base[n], tri_base[n]);
+        }
+
+        sah += C_TRAV * tn.bounds.half_area();
+
+        bvh::node_t node;
+        node.aabb = tn.bounds.to_aabb();
+        node.is_leaf = false;
+        node.tris_offset = (idx_t)tri_base[n];
+        node.tri_count = (idx_t)tri_count[n];
+        node.children_cluster_offset = (idx_t)cluster_base[n];
+        node_clusters[cluster_base[n]].nodes[0] = encode_top(tn.left);
+        node_clusters[cluster_base[n]].nodes[1] = encode_top(tn.right);
+        return node;
+    };
+    node_clusters[0].nodes[0] = encode_top(0);
+    sah_cost = sah / root_area;
+
+    for (auto& f : splice_futures)
+        f.get();
+}
+
+inline void build_parallel(const std::vector<build_tri_t>& all_tris,
+                           const wt::wt_context_t& ctx,
+                           progress_track_t& pt,
+                           const f_t build_pb,
+                           std::vector<bvh::node_cluster_t>& node_clusters,
+                           std::vector<tri_t>& bvhtris,
+                           f_t& sah_cost) {
+    const auto N = all_tris.size();
+
+    // triangle bounds and centroids
+    std::vector<idx_t> refs(N);
+    std::vector<box_t> tri_bounds(N);
+    std::vector<vec3_t> centroids(N);
+    std::mutex root_mutex;
+    top_node_t root{ .begin=0, .end=N };
+    parallel_for_chunks(ctx, 0, N, [&](std::size_t begin, std::size_t end) {
+        box_t b, c;
+        for (auto t=begin; t<end; ++t) {
+            const auto& tri = all_tris[t];
+            auto& tb = tri_bounds[t];
+            tb.grow(vec3_t{ u::to_m(tri.a) });
+            tb.grow(vec3_t{ u::to_m(tri.b) });
+            tb.grow(vec3_t{ u::to_m(tri.c) });
+            centroids[t] = (tb.min+tb.max)/f_t(2);
+            refs[t] = (idx_t)t;
+
+            b.grow(tb);
+            c.grow(centroids[t]);
+        }
+
+        std::unique_lock l(root_mutex);
+        root.bounds.grow(b);
+        root.centroids.grow(c);
+    });
+
+
+    // top-level binned-SAH partitioning
+
+    pt.set_status("partitioning top levels");
+
+    const auto subtree_max_tris = m::max(subtree_min_tris, 
+                                         N / (ctx.threadpool->thread_count()*subtrees_per_thread));
+    std::vector<top_node_t> top_nodes;
+    top_nodes.emplace_back(root);
+
+    std::vector<std::size_t> pending = { 0 };
+    while (!pending.empty()) {
+        // bin all pending nodes
+        std::vector<std::size_t> to_split;
+        std::vector<std::vector<std::future<bins_t>>> binning;
+        for (const auto n : pending) {
+            const auto& tn = top_nodes[n];
+            if (tn.count()<=subtree_max_tris) continue;
+
+            auto& futures = binning.emplace_back();
+            for (auto c=tn.begin; c<tn.end; c+=parallel_chunk) {
+                const auto cend = m::min(tn.end, c+parallel_chunk);
+                futures.emplace_back(ctx.threadpool->enqueue(
+                    [&, cent=tn.centroids, c, cend]() {
+                        return bin_range(cent, refs.data(), c, cend, tri_bounds, centroids);
+                    }));
+            }
+            to_split.emplace_back(n);
+        }
+
+        // find splits and partition
+        std::vector<top_split_t> splits;
+        std::vector<std::future<void>> partitioning;
+        for (auto i=0ul; i<to_split.size(); ++i) {
+            bins_t bins{};
+            for (auto& f : binning[i]) {
+                const auto b = f.get();
+                for (int a=0; a<3; ++a)
+                for (auto j=0ul; j<top_level_bins; ++j) {
+                    bins[a][j].bounds.grow(b[a][j].bounds);
+                    bins[a][j].centroids.grow(b[a][j].centroids);
+                    bins[a][j].count += b[a][j].count;
+                }
+            }
+
+            const auto& split = splits.emplace_back(find_split(bins));
+            if (split.axis<0) continue;     // no viable split (e.g., coincident centroids)
+
+            const auto& tn = top_nodes[to_split[i]];
+            partitioning.emplace_back(ctx.threadpool->enqueue(
+                [&, cent=tn.centroids, begin=tn.begin, end=tn.end, axis=split.axis, bin=split.bin]() {
+                    std::partition(refs.begin()+begin, refs.begin()+end, [&](const auto t) {
+                        return bin_index(cent, centroids[t], axis) < bin;
+                    });
+                }));
+        }
+        for (auto& f : partitioning)
+            f.get();
+
+        // create children
+        pending.clear();
+        for (auto i=0ul; i<to_split.size(); ++i) {
+            const auto& split = splits[i];
+            if (split.axis<0) continue;
+
+            const auto n = to_split[i];
+            const auto begin = top_nodes[n].begin;
+            const auto end = top_nodes[n].end;
+            const auto mid = begin + split.lcount;
+
+            top_nodes[n].left  = (std::int32_t)top_nodes.size();
+            top_nodes[n].right = (std::int32_t)top_nodes.size()+1;
+            top_nodes.emplace_back(top_node_t{ .bounds=split.lbounds, .centroids=split.lcentroids, .begin=begin, .end=mid });
+            top_nodes.emplace_back(top_node_t{ .bounds=split.rbounds, .centroids=split.rcentroids, .begin=mid,   .end=end });
+            pending.emplace_back(top_nodes.size()-2);
+            pending.emplace_back(top_nodes.size()-1);
+        }
+    }
+
+
+    // build subtrees, largest first
+
+    pt.set_status("building subtrees");
+
+    std::vector<std::size_t> subtrees;
+    for (auto n=0ul; n<top_nodes.size(); ++n)
+        if (top_nodes[n].is_subtree()) subtrees.emplace_back(n);
+    std::ranges::sort(subtrees, [&](auto a, auto b) { return top_nodes[a].count()>top_nodes[b].count(); });
+
+    // tinybvh's progress tracker is global: silence it
+    tinybvh::progress_tracker = [](f_t) {};
+
+    std::vector<std::future<subtree_result_t>> subtree_futures;
+    for (const auto n : subtrees) {
+        subtree_futures.emplace_back(ctx.threadpool->enqueue([&, begin=top_nodes[n].begin, count=top_nodes[n].count()]() {
+            return build_subtree(all_tris, refs.data()+begin, count);
+        }));
+    }
+
+    std::vector<subtree_result_t> results(top_nodes.size());
+    for (auto i=0ul; i<subtrees.size(); ++i) {
+        results[subtrees[i]] = std::move(subtree_futures[i]).get();
+        pt.set_progress(f_t(i+1)/f_t(subtrees.size()) * build_pb);
+    }
+
+
+    // splice
+
+    pt.set_status("encoding binary BVH");
+    splice_subtrees(top_nodes, subtrees, results, ctx, node_clusters, bvhtris, nullptr, sah_cost);
+}
+
+
+/*
+ * Spatial-split (SBVH) build, after Stich et al. 2009, "Spatial Splits in Bounding Volume Hierarchies".
+ * Nodes are split by the cheaper of a binned-SAH object split and a binned spatial split. A spatial
+ * split chops the triangles that straddle the split plane: each side references the part of the
+ * triangle that lies in it, with tightened bounds. Long, thin triangles then no longer inflate the
+ * bounds of the nodes they cross. Spatial splits are limited by a budget of duplicated references,
+ * which is shared between children in proportion to their reference counts, so that the build is
+ * deterministic. The top levels are split on the calling thread, subtrees are then built
+ * concurrently and spliced (as in the parallel build above).
+ */
+
+static constexpr std::size_t sbvh_spatial_bins = 32;
+// spatial splits are only attempted when the object split's children overlap by more than this fraction of the root's area
+static constexpr f_t sbvh_overlap_threshold = 1e-5;
+// nodes are allowed to become leaves (when cheaper) once they reference no more triangles than this
+static constexpr std::size_t sbvh_max_leaf_tris = 4;
+// no spatial splits below this depth
+static constexpr std::size_t sbvh_max_spatial_split_depth = 48;
+
+struct sbvh_ref_t {
+    idx_t tri;
+    // bounds of the referenced part of the triangle
+    box_t bounds;
+};
+using sbvh_refs_t = std::vector<sbvh_ref_t>;
+
+struct sbvh_node_t {
+    sbvh_refs_t refs;
+    box_t bounds;
+    // count of duplicated references this node may still create
+    std::size_t budget;
+    std::size_t depth;
+};
+
+struct sbvh_top_node_t {
+    sbvh_node_t node;
+    box_t bounds;
+    // children top nodes, -1 for subtrees
+    std::int32_t left=-1, right=-1;
+
+    [[nodiscard]] inline auto count() const noexcept { return node.refs.size(); }
+    [[nodiscard]] inline bool is_subtree() const noexcept { return left<0; }
+};
+
+struct sbvh_spatial_bin_t {
+    box_t bounds;
+    std::size_t enter = 0, exit = 0;
+};
+
+struct sbvh_spatial_split_t {
+    int axis = -1;
+    f_t pos;
+    f_t cost = limits<f_t>::infinity();
+    std::size_t lcount, rcount;
+};
+
+inline auto ref_bounds_of(const std::vector<sbvh_ref_t>& refs) noexcept {
+    box_t b;
+    for (const auto& r : refs) b.grow(r.bounds);
+    return b;
+}
+
+inline auto box_intersection(const box_t& a, const box_t& b) noexcept {
+    box_t o;
+    o.min = m::max(a.min, b.min);
+    o.max = m::min(a.max, b.max);
+    for (int i=0; i<3; ++i)
+        if (!(o.min[i]<=o.max[i])) return box_t{};
+    return o;
+}
+
+class sbvh_builder_t {
+private:
+    const std::vector<build_tri_t>& all_tris;
+    f_t root_area;
+
+public:
+    sbvh_builder_t(const std::vector<build_tri_t>& all_tris, f_t root_area) noexcept
+        : all_tris(all_tris), root_area(root_area) {}
+
+    /**
+     * @brief Bounds of the part of a reference's triangle that lies in the slab ``lo <= x[axis] <= hi``. Empty if the triangle does not cross the slab within the reference's bounds.
+     */
+    [[nodiscard]] inline box_t clip(const sbvh_ref_t& ref, int axis, f_t lo, f_t hi) const noexcept {
+        const auto& tri = all_tris[ref.tri];
+        const std::array<vec3_t,3> v = { vec3_t{ u::to_m(tri.a) }, vec3_t{ u::to_m(tri.b) }, vec3_t{ u::to_m(tri.c) } };
+
+        box_t b;
+        for (int i=0; i<3; ++i) {
+            const auto& p = v[i];
+            const auto& q = v[(i+1)%3];
+            if (p[axis]>=lo && p[axis]<=hi)
+                b.grow(p);
+
+            // crossings of the edge with the slab's planes
+            for (const auto plane : { lo, hi }) {
+                if ((p[axis]<plane && q[axis]>plane) || (p[axis]>plane && q[axis]<plane)) {
+                    auto x = p + (q-p) * ((plane-p[axis]) / (q[axis]-p[axis]));
+                    x[axis] = plane;
+                    b.grow(x);
                 }
+            }
+        }
+        if (b.empty())
+            return b;
+
+        // pad by a few ulps to absorb the rounding of the crossings, then clamp to the slab and the reference
+        for (int a=0; a<3; ++a) {
+            const auto pad = f_t(4) * limits<f_t>::epsilon() * m::max(m::abs(b.min[a]), m::abs(b.max[a]));
+            b.min[a] -= pad;
+            b.max[a] += pad;
+        }
+        b.min[axis] = m::max(b.min[axis], lo);
+        b.max[axis] = m::min(b.max[axis], hi);
+
+        return box_intersection(b, ref.bounds);
+    }
+
+    [[nodiscard]] inline auto find_spatial_split(const sbvh_node_t& node) const noexcept {
+        sbvh_spatial_split_t best{};
+
+        for (int a=0; a<3; ++a) {
+            const auto lo = node.bounds.min[a];
+            const auto ext = node.bounds.max[a]-lo;
+            if (!(ext>0)) continue;
+
+            const auto bin_width = ext / f_t(sbvh_spatial_bins);
+            const auto bin_of = [&](f_t x) {
+                const auto b = (std::ptrdiff_t)((x-lo) / bin_width);
+                return (std::size_t)m::clamp<std::ptrdiff_t>(b, 0, sbvh_spatial_bins-1);
             };
 
-#ifdef TBVH_USE_SINGLES
-            {
-                std::vector<tinybvh::bvhvec4> tbvhtris;
-                tbvhtris.reserve(all_tris.size()*3);
-                for (const auto& t : all_tris) {
-                    tbvhtris.emplace_back(u::to_m(t.a.x), u::to_m(t.a.y), u::to_m(t.a.z), 0);
-                    tbvhtris.emplace_back(u::to_m(t.b.x), u::to_m(t.b.y), u::to_m(t.b.z), 0);
-                    tbvhtris.emplace_back(u::to_m(t.c.x), u::to_m(t.c.y), u::to_m(t.c.z), 0);
+            std::array<sbvh_spatial_bin_t, sbvh_spatial_bins> bins{};
+            for (const auto& ref : node.refs) {
+                const auto b0 = bin_of(ref.bounds.min[a]);
+                const auto b1 = bin_of(ref.bounds.max[a]);
+                if (b0==b1)
+                    bins[b0].bounds.grow(ref.bounds);
+                else {
+                    for (auto b=b0; b<=b1; ++b) {
+                        const auto blo = lo + f_t(b)*bin_width;
+                        const auto bhi = b+1==sbvh_spatial_bins ? node.bounds.max[a] : lo + f_t(b+1)*bin_width;
+                        bins[b].bounds.grow(clip(ref, a, blo, bhi));
+                    }
                 }
+                ++bins[b0].enter;
+                ++bins[b1].exit;
+            }
 
-                tbvh.BuildAVX(tbvhtris.data(), tbvhtris.size()/3);
+            // sweep from the right
+            std::array<box_t, sbvh_spatial_bins> rbounds;
+            std::array<std::size_t, sbvh_spatial_bins> rcount;
+            box_t b;
+            std::size_t n = 0;
+            for (auto i=sbvh_spatial_bins-1; i>0; --i) {
+                b.grow(bins[i].bounds);
+                n += bins[i].exit;
+                rbounds[i] = b;
+                rcount[i] = n;
             }
-#else
-            {
-                std::vector<tinybvh::bvhdbl3> tbvhtris;
-                tbvhtris.reserve(all_tris.size()*3);
-                for (const auto& t : all_tris) {
-                    tbvhtris.emplace_back((double)u::to_m(t.a.x), (double)u::to_m(t.a.y), (double)u::to_m(t.a.z));
-                    tbvhtris.emplace_back((double)u::to_m(t.b.x), (double)u::to_m(t.b.y), (double)u::to_m(t.b.z));
-                    tbvhtris.emplace_back((double)u::to_m(t.c.x), (double)u::to_m(t.c.y), (double)u::to_m(t.c.z));
+
+            // ... and from the left
+            b = {}; n = 0;
+            for (auto i=1ul; i<sbvh_spatial_bins; ++i) {
+                b.grow(bins[i-1].bounds);
+                n += bins[i-1].enter;
+                if (n==0 || rcount[i]==0) continue;
+                // every reference straddles the plane: no progress
+                if (n==node.refs.size() && rcount[i]==node.refs.size()) continue;
+
+                const auto cost = b.half_area()*f_t(n) + rbounds[i].half_area()*f_t(rcount[i]);
+                if (cost<best.cost) {
+                    best.axis = a;
+                    best.pos = lo + f_t(i)*bin_width;
+                    best.cost = cost;
+                    best.lcount = n;
+                    best.rcount = rcount[i];
                 }
+            }
+        }
+
+        return best;
+    }
 
-                tbvh.Build(tbvhtris.data(), tbvhtris.size()/3);
+    /**
+     * @brief Splits a node's references into two children. Returns ``std::nullopt`` if the node should be a leaf.
+     */
+    [[nodiscard]] inline std::optional<std::array<sbvh_node_t,2>> split(sbvh_node_t& node) const {
+        const auto count = node.refs.size();
+        if (count<=1)
+            return std::nullopt;
+
+        // object split
+        box_t centroids;
+        for (const auto& r : node.refs)
+            centroids.grow((r.bounds.min+r.bounds.max)/f_t(2));
+        bins_t bins{};
+        for (const auto& r : node.refs) {
+            const auto c = (r.bounds.min+r.bounds.max)/f_t(2);
+            for (int a=0; a<3; ++a) {
+                auto& b = bins[a][bin_index(centroids, c, a)];
+                b.bounds.grow(r.bounds);
+                b.centroids.grow(c);
+                ++b.count;
             }
-#endif
+        }
+        const auto object = find_split(bins);
 
-            pt.set_progress(build_pb);
-            pt.set_status("tiny_bvh optimize()");
-            tinybvh::progress_tracker = [&](f_t p) {
-                pt.set_progress(p * (optimize_pb-build_pb) + build_pb);
-            };
+        // spatial split, only when the object split's children overlap and there is budget left for the references it duplicates
+        auto spatial = sbvh_spatial_split_t{};
+        const bool try_spatial = node.budget>0 && node.depth<sbvh_max_spatial_split_depth &&
+            (object.axis<0 || box_intersection(object.lbounds, object.rbounds).half_area() > sbvh_overlap_threshold * root_area);
+        if (try_spatial) {
+            spatial = find_spatial_split(node);
+            if (spatial.axis>=0 && spatial.lcount+spatial.rcount-count > node.budget)
+                spatial = {};
+        }
 
-#ifdef TBVH_USE_SINGLES
-            {
-                tinybvh::BVH_Verbose tmp;
-                tmp.ConvertFrom(tbvh);
-                tmp.Optimize(tbvh_optimize_iterations);
-                tbvh.ConvertFrom(tmp);
+        const auto best_cost = m::min(object.cost, spatial.cost);
+        const auto leaf_cost  = C_INT * f_t(count);
+        const auto split_cost = C_TRAV + C_INT * best_cost / m::max(f_t(1e-30), node.bounds.half_area());
+        if (count<=sbvh_max_leaf_tris && (!(best_cost<limits<f_t>::infinity()) || leaf_cost<=split_cost))
+            return std::nullopt;
+
+        std::array<sbvh_node_t,2> children;
+        auto& l = children[0].refs;
+        auto& r = children[1].refs;
+
+        if (spatial.axis>=0 && spatial.cost<object.cost) {
+            const auto a = spatial.axis;
+            const auto pos = spatial.pos;
+            l.reserve(spatial.lcount);
+            r.reserve(spatial.rcount);
+            for (const auto& ref : node.refs) {
+                if (ref.bounds.max[a]<=pos)
+                    l.emplace_back(ref);
+                else if (ref.bounds.min[a]>=pos)
+                    r.emplace_back(ref);
+                else {
+                    // straddling: reference each side's part of the triangle
+                    const auto lb = clip(ref, a, ref.bounds.min[a], pos);
+                    const auto rb = clip(ref, a, pos, ref.bounds.max[a]);
+                    if (lb.empty())      r.emplace_back(ref);
+                    else if (rb.empty()) l.emplace_back(ref);
+                    else {
+                        l.emplace_back(sbvh_ref_t{ .tri=ref.tri, .bounds=lb });
+                        r.emplace_back(sbvh_ref_t{ .tri=ref.tri, .bounds=rb });
+                    }
+                }
             }
-#endif
+        }
+        if (l.empty() || r.empty()) {
+            // object split (or a fallback when the spatial split degenerated)
+            l.clear();
+            r.clear();
+            auto mid = node.refs.begin();
+            if (object.axis>=0) {
+                mid = std::partition(node.refs.begin(), node.refs.end(), [&](const auto& ref) {
+                    return bin_index(centroids, (ref.bounds.min+ref.bounds.max)/f_t(2), object.axis) < object.bin;
+                });
+            }
+            if (mid==node.refs.begin() || mid==node.refs.end()) {
+                // coincident centroids: split in the middle
+                mid = node.refs.begin() + count/2;
+            }
+            l.assign(node.refs.begin(), mid);
+            r.assign(mid, node.refs.end());
+        }
+        node.refs = {};
+
+        // share the remaining budget
+        const auto duplicated = l.size()+r.size()-count;
+        const auto remaining = node.budget - m::min(node.budget, duplicated);
+        const auto lbudget = (std::size_t)(double(remaining) * double(l.size()) / double(l.size()+r.size()));
+        for (auto& c : children) {
+            c.bounds = ref_bounds_of(c.refs);
+            c.depth = node.depth+1;
+        }
+        children[0].budget = lbudget;
+        children[1].budget = remaining-lbudget;
 
-            pt.set_progress(optimize_pb);
+        return children;
+    }
+
+    bvh::node_t build_recursive(sbvh_node_t node, subtree_result_t& out) const {
+        bvh::node_t n;
+        n.aabb = node.bounds.to_aabb();
+        assert(n.aabb.isfinite());
+
+        auto children = split(node);
+        if (!children) {
+            n.is_leaf = true;
+            n.tri_count = (idx_t)node.refs.size();
+            n.tris_offset = (idx_t)out.tris.size();
+            for (const auto& ref : node.refs) {
+                out.tris.emplace_back(all_tris[ref.tri].tri);
+                out.tri_ids.emplace_back(ref.tri);
+            }
+            return n;
         }
 
-        const auto sah_cost = tbvh.SAHCost();
+        n.is_leaf = false;
+        n.tri_count = 0;
+        n.children_cluster_offset = out.clusters.size();
+        out.clusters.emplace_back();
+
+        const auto l = build_recursive(std::move((*children)[0]), out);
+        const auto r = build_recursive(std::move((*children)[1]), out);
+        out.clusters[n.children_cluster_offset].nodes[0] = l;
+        out.clusters[n.children_cluster_offset].nodes[1] = r;
+
+        return n;
+    }
+
+    /**
+     * @brief Builds a subtree. The root is returned separately and cluster 0 is unused.
+     */
+    inline auto build_subtree(sbvh_node_t node) const {
+        subtree_result_t ret;
+        ret.clusters.reserve(node.refs.size());
+        ret.tris.reserve(node.refs.size());
+        ret.tri_ids.reserve(node.refs.size());
 
-        // ... and re-encode from tinybvh to ours
+        ret.clusters.emplace_back();
+        ret.clusters.front().nodes[0] = build_recursive(std::move(node), ret);
+        tree_dfs_write_triangle_ptrs(ret.clusters, ret.clusters.front().nodes[0]);
+        ret.root = ret.clusters.front().nodes[0];
+        ret.sah = subtree_sah(ret);
+
+        return ret;
+    }
+};
 
-        pt.set_status("encoding binary BVH");
+inline void build_sbvh(const std::vector<build_tri_t>& all_tris,
+                       const wt::wt_context_t& ctx,
+                       progress_track_t& pt,
+                       const f_t build_pb,
+                       std::vector<bvh::node_cluster_t>& node_clusters,
+                       std::vector<tri_t>& bvhtris,
+                       std::vector<idx_t>& tri_canonical,
+                       f_t& sah_cost) {
+    const auto N = all_tris.size();
+
+    // references to whole triangles
+    sbvh_node_t root{
+        .refs = sbvh_refs_t(N),
+        .budget = (std::size_t)(double(ctx.ads_spatial_split_budget) * double(N)),
+        .depth = 0,
+    };
+    parallel_for_chunks(ctx, 0, N, [&](std::size_t begin, std::size_t end) {
+        for (auto t=begin; t<end; ++t) {
+            const auto& tri = all_tris[t];
+            auto& ref = root.refs[t];
+            ref.tri = (idx_t)t;
+            ref.bounds.grow(vec3_t{ u::to_m(tri.a) });
+            ref.bounds.grow(vec3_t{ u::to_m(tri.b) });
+            ref.bounds.grow(vec3_t{ u::to_m(tri.c) });
+        }
+    });
+    root.bounds = ref_bounds_of(root.refs);
+
+    const auto builder = sbvh_builder_t{ all_tris, root.bounds.half_area() };
+
+
+    // top levels
+
+    pt.set_status("SBVH: partitioning top levels");
+
+    const auto subtree_max_tris = m::max(subtree_min_tris, 
+                                         N / (ctx.threadpool->thread_count()*subtrees_per_thread));
+    std::vector<sbvh_top_node_t> top_nodes;
+    top_nodes.emplace_back(sbvh_top_node_t{ .node=std::move(root) });
+    top_nodes[0].bounds = top_nodes[0].node.bounds;
+
+    for (std::size_t n=0; n<top_nodes.size(); ++n) {
+        if (top_nodes[n].count()<=subtree_max_tris) continue;
+
+        auto children = builder.split(top_nodes[n].node);
+        if (!children) continue;
+
+        top_nodes[n].left  = (std::int32_t)top_nodes.size();
+        top_nodes[n].right = (std::int32_t)top_nodes.size()+1;
+        for (auto& c : *children) {
+            const auto b = c.bounds;
+            top_nodes.emplace_back(sbvh_top_node_t{ .node=std::move(c), .bounds=b });
+        }
+    }
+
+
+    // build subtrees, largest first
+
+    pt.set_status("SBVH: building subtrees");
+
+    std::vector<std::size_t> subtrees;
+    for (auto n=0ul; n<top_nodes.size(); ++n)
+        if (top_nodes[n].is_subtree()) subtrees.emplace_back(n);
+    std::ranges::sort(subtrees, [&](auto a, auto b) { return top_nodes[a].count()>top_nodes[b].count(); });
+
+    std::vector<std::future<subtree_result_t>> subtree_futures;
+    for (const auto n : subtrees) {
+        subtree_futures.emplace_back(ctx.threadpool->enqueue([&builder, node=std::move(top_nodes[n].node)]() mutable {
+            return builder.build_subtree(std::move(node));
+        }));
+    }
+
+    std::vector<subtree_result_t> results(top_nodes.size());
+    for (auto i=0ul; i<subtrees.size(); ++i) {
+        results[subtrees[i]] = std::move(subtree_futures[i]).get();
+        pt.set_progress(f_t(i+1)/f_t(subtrees.size()) * build_pb);
+    }
+
+
+    // splice
+
+    pt.set_status("encoding binary BVH");
+    std::vector<idx_t> tri_ids;
+    splice_subtrees(top_nodes, subtrees, results, ctx, node_clusters, bvhtris, &tri_ids, sah_cost);
+
+    // map copies of triangles to their first copy
+    const auto duplicated = bvhtris.size()-N;
+    if (duplicated>0) {
+        std::vector<idx_t> first(N, invalid_idx);
+        tri_canonical.resize(bvhtris.size());
+        for (auto t=0ul; t<tri_ids.size(); ++t) {
+            auto& f = first[tri_ids[t]];
+            if (f==invalid_idx) f = (idx_t)t;
+            tri_canonical[t] = f;
+        }
+    }
+
+    wt::logger::cout(verbosity_e::info) 
+        << std::format("(bvh_constructor) spatial splits: {:L} duplicated triangle references ({:.2f}%), SAH cost {:.2f}", 
+                       duplicated, 100*double(duplicated)/double(N), sah_cost)
+        << '\n';
+}
+
+}
+
+
+bvh_constructor_t::bvh_constructor_t(
+        std::vector<std::shared_ptr<shape_t>> objs,
+        const wt::wt_context_t& ctx,
+        progress_track_t& pt)
+{
+    constexpr auto build_pb = .35f;
+    constexpr auto optimize_pb = .95f;
+
+    {
+        // extract tris from shapes and initialize bvh_primitives
+        std::vector<std::size_t> shape_tris_offset(objs.size()+1, 0);
+        for (idx_t objid = 0; objid < objs.size(); ++objid)
+            shape_tris_offset[objid+1] = shape_tris_offset[objid] + objs[objid]->get_mesh().triangles_count();
+
+        // (pqvec3_t is not default constructible)
+        std::vector<build_tri_t> all_tris(shape_tris_offset.back(),
+                                          build_tri_t{ .a = pqvec3_t::zero(), .b = pqvec3_t::zero(), .c = pqvec3_t::zero(), .tri = {} });
+        {
+            std::vector<std::future<void>> futures;
+            for (idx_t objid = 0; objid < objs.size(); ++objid) {
+                futures.emplace_back(ctx.threadpool->enqueue([&, objid]() {
+                    const auto& mesh = objs[objid]->get_mesh();
+                    auto* dst = all_tris.data() + shape_tris_offset[objid];
+
+                    for (mesh::mesh_t::tidx_t triid = 0; triid < mesh.triangles_count(); ++triid) {
+                        const auto p = mesh.triangle_vertices(triid);
+
+                        dst[triid] = build_tri_t{
+                            .a = p[0],
+                            .b = p[1],
+                            .c = p[2],
+                            .tri = tri_t{
+                                .shape_idx = objid,
+                                .shape_tri_idx = triid
+                            },
+                        };
+                    }
+                }));
+            }
+            for (auto& f : futures)
+                f.get();
+        }
+
+        if (all_tris.empty())
+            throw std::runtime_error("(bvh_constructor) no triangles found!");
 
         std::vector<bvh::node_cluster_t> node_clusters;
         std::vector<tri_t> bvhtris;
+        std::vector<idx_t> tri_canonical;
+        f_t sah_cost;
+
+        if (ctx.ads_spatial_split_budget>0) {
+            // spatial-split build
+            build_sbvh(all_tris, ctx, pt, optimize_pb, node_clusters, bvhtris, tri_canonical, sah_cost);
+        } else if (all_tris.size()>=parallel_build_min_tris && ctx.threadpool->thread_count()>1) {
+            // large scenes: parallel top-level build
+            build_parallel(all_tris, ctx, pt, optimize_pb, node_clusters, bvhtris, sah_cost);
+        } else {
+            // build BVH using tinybvh
+            tbvh_t tbvh;
+
+            {
+                pt.set_status("tiny_bvh build()");
+                f_t prog = 0;
+                tinybvh::progress_tracker = [&](f_t p) {
+                    if (p>prog+f_t(.02)) {
+                        pt.set_progress(p * build_pb);
+                        prog = p;
+                    }
+                };
+
+                tbvh_build(tbvh, all_tris, nullptr, all_tris.size());
+
+                pt.set_progress(build_pb);
+                pt.set_status("tiny_bvh optimize()");
+                tinybvh::progress_tracker = [&](f_t p) {
+                    pt.set_progress(p * (optimize_pb-build_pb) + build_pb);
+                };
+
+                tbvh_optimize(tbvh);
+
+                pt.set_progress(optimize_pb);
+            }
+
+            sah_cost = tbvh.SAHCost();
+
+            // ... and re-encode from tinybvh to ours
+
+            pt.set_status("encoding binary BVH");
+
 #ifdef TBVH_USE_SINGLES
-        node_clusters.reserve(tbvh.NodeCount()/2);
+            node_clusters.reserve(tbvh.NodeCount()/2);
 #else
-        node_clusters.reserve(tbvh.usedNodes/2);
+            node_clusters.reserve(tbvh.usedNodes/2);
 #endif
-        bvhtris.reserve(all_tris.size());
+            bvhtris.reserve(all_tris.size());
 
-        node_clusters.emplace_back();
-        node_clusters.front().nodes[0] = 
-            tbvh_to_bvh_recursive(tbvh.bvhNode, tbvh.bvhNode[0], tbvh.primIdx,
-                                  node_clusters, all_tris, bvhtris);
+            node_clusters.emplace_back();
+            node_clusters.front().nodes[0] = 
+                tbvh_to_bvh_recursive(tbvh.bvhNode, tbvh.bvhNode[0], tbvh.primIdx,
+                                      node_clusters, all_tris, nullptr, bvhtris);
 
-        // write triangle references from internal nodes
-        tree_dfs_write_triangle_ptrs(node_clusters, node_clusters[0].nodes[0]);
+            // write triangle references from internal nodes
+            tree_dfs_write_triangle_ptrs(node_clusters, node_clusters[0].nodes[0]);
+        }
 
         node_clusters.shrink_to_fit();
         bvhtris.shrink_to_fit();
-        bvh = std::make_unique<bvh_t>(std::move(node_clusters), std::move(bvhtris), sah_cost);
+        bvh = std::make_unique<bvh_t>(std::move(node_clusters), std::move(bvhtris), sah_cost,
+                                      std::move(tri_canonical));
     }
     
     // done building
@@ -185,11 +185,12 @@ void emitter::area_t::construct_triangle_sampling_data(const wt_context_t& ctx)
     // for each, loop over barycentric coordinates and query the texture, thereby building an emission per barycentrics distribution
     // do so in parallel
 
-    const auto& tris = shape->get_mesh().get_tris();
+    const auto& mesh = shape->get_mesh();
     std::vector<std::future<std::pair<f_t, triangle_sampling_data_t>>> fs;
-    fs.reserve(tris.size());
-    for (const auto& t : tris) {
-        fs.emplace_back(ctx.threadpool->enqueue([&t, res, this]() {
+    fs.reserve(mesh.triangles_count());
+    for (mesh::mesh_t::tidx_t tidx=0; tidx<mesh.triangles_count(); ++tidx) {
+        fs.emplace_back(ctx.threadpool->enqueue([&mesh, tidx, res, this]() {
+            const auto t = mesh.triangle(tidx);
             assert(t.uv);   // no UV?!
             if (!t.uv)
                 return std::make_pair(
@@ -301,6 +302,9 @@ area_density_t wt::emitter::area_t::sampling_data_t::pdf(
     assert(surface.shape == emitter->shape);
     if (surface.shape != emitter->shape)
         return {};
+    // level-of-detail proxies are never sampled
+    if (surface.is_proxy())
+        return {};
 
     const auto& bary = surface.bary.coords();
     const auto& tid  = surface.mesh_tri_idx;
@@ -18,6 +18,7 @@
 
 #include <wt/integrator/plt_bdpt/plt_bdpt.hpp>
 #include <wt/integrator/plt_path/plt_path.hpp>
+#include <wt/integrator/pssmlt/pssmlt.hpp>
 
 using namespace wt;
 using namespace wt::integrator;
@@ -34,6 +35,8 @@ std::shared_ptr<integrator_t> integrator_t::load(
         return plt_bdpt_t::load(id, loader, node, context);
     else if (type=="plt_path")
         return plt_path_t::load(id, loader, node, context);
+    else if (type=="pssmlt")
+        return pssmlt_t::load(id, loader, node, context);
 
     throw scene_loading_exception_t("(integrator loader) Unrecognized integrator type", node);
 }
@@ -40,113 +40,224 @@ plt_bdpt_t::plt_bdpt_t(const wt_context_t &ctx,
       options(opts)
 {}
 
+namespace {
+
+struct spectral_weights_t {
+    // spectral (importance) sampling weight
+    wavenumber_t recp_spectral_pd;
+    // sampling density of the wavenumber
+    wavenumber_density_t k_density;
+};
+
+inline spectral_weights_t spectral_weights(const integrator_context_t& ctx,
+                                           const emitter_wavenumber_sample_t& emitter_wavenumber) noexcept {
+    const auto& wpd = emitter_wavenumber.wavenumber.wpd;
+    const auto& k = emitter_wavenumber.wavenumber.k;
+
+    return {
+        // for discrete spectral samples, division by the sampling probability mass.
+        // for continuos spectra, importance sample over all probability densities to sample this k.
+        .recp_spectral_pd = wpd.is_discrete() ?
+            f_t(1) / wavenumber_density_t{ wpd.mass() * u::mm } :
+            f_t(1) / ctx.scene->sum_spectral_pdf_for_all_emitters(ctx.sensor, k),
+        .k_density = wpd.is_discrete() ? 
+            wavenumber_density_t{ wpd.mass() / wavenumber_t::unit } : 
+            wpd.density(),
+    };
+}
+
+/**
+ * @brief Integrates all connection strategies between the arena's sensor subpath and its current emitter subpath.
+ *        Connections between inner vertices (s>1, t>1) are averaged over the ``pass_samples`` emitter subpaths of a pass. All other strategies do not depend on the emitter subpath (s<=1), or do not depend on the sensor subpath (t<=1), and are integrated only with the sample's own emitter subpath (``own_subpath``).
+ *        Direct-to-sensor connections (t=1) are passed to ``splat_direct(element, flux)``.
+ * @return contribution to the sensor sample's element
+ */
+inline radiant_flux_stokes_t integrate_connections(plt_bdpt::arena_t* arena,
+                                                   const integrator_context_t& ctx,
+                                                   const plt_bdpt_t::options_t& options,
+                                                   const spectral_weights_t& sw,
+                                                   const std::uint32_t pass_samples,
+                                                   const bool own_subpath,
+                                                   sampler::sampler_t& sampler,
+                                                   auto&& splat_direct) noexcept {
+    auto L = radiant_flux_stokes_t::unpolarized(radiant_flux_t::zero());
+
+    // TODO: BDPT spectral MIS
+
+    // shadow queries of inner connections, as a batch
+    plt_bdpt::batch_connection_shadow_queries(arena, ctx, options);
+
+    // integrate connections
+    // t - sensor subpath
+    // s - emitter subpath
+    for (int t=0; t<=arena->sensor_vertices.size(); ++t) 
+    for (int s=0; s<=arena->emitter_vertices.size(); ++s) {
+        const auto depth = t+s-2;
+        if ((t==1 && s==1) || depth<0) continue;
+        if (!options.emitter_direct && s==1) continue;
+        if (!options.sensor_direct  && t==1) continue;
+        if (depth>options.max_depth) break;
+
+        const bool inner_connection = s>1 && t>1;
+        if (!inner_connection && !own_subpath) continue;
+
+        // connect
+        auto ret = plt_bdpt::connect_subpaths(arena, ctx, options, 
+                                              s,t, sampler);
+        if (ret.L.intensity()<=zero)
+            continue;
+
+        // MIS
+        wavenumber_t mis;
+        if (options.MIS) {
+            mis = plt_bdpt::bdpt_compute_mis_weight(arena, ctx, options,
+                                                    s,t, ret, pass_samples) *
+                  sw.recp_spectral_pd;
+        } else {
+            mis = 1 / (f_t(s+t+1) * sw.k_density);
+        }
+        // average over the emitter subpaths
+        if (inner_connection)
+            mis /= f_t(pass_samples);
+        assert(m::isfinite(mis) && mis>=zero);
+
+        // accumulate or splat to light image for direct-to-sensor connections
+        const auto flux_sample = (radiant_flux_stokes_t)(ret.L * mis);
+        if (t>1) L += flux_sample;
+        else     splat_direct(*ret.sensor_element_sample, flux_sample);
+    }
+
+    return L;
+}
+
+}
+
 void plt_bdpt_t::integrate(const integrator_context_t& ctx,
                            const sensor::block_handle_t& block,
                            const vec3u32_t& sensor_element,
                            std::uint32_t samples_per_element) const noexcept {
-    // grab thread local memory arena
+    // grab thread local memory arena, and this worker's per-sample arena
     auto* arena = &bdpt_arena;
+    auto& sample_arena = ctx.acquire_sample_arena();
 
     // use a uniform sampler for path sampling
     static auto uniform_sampler = sampler::uniform_t{};
     auto& path_sampling_sampler = uniform_sampler;
 
-    for (std::uint32_t sample=0; sample<samples_per_element; ++sample) {
-        // draw spectral sample and emitter sample
-        const auto emitter_wavenumber = ctx.scene->sample_emitter_and_spectrum_and_source_beam(ctx.sensor);
-
-        const auto& emitter_sample    = emitter_wavenumber.emitter_sample;
-        const auto& wavenumber_sample = emitter_wavenumber.wavenumber;
-        const auto& k = wavenumber_sample.k;
-
-        // spectral (importance) sampling weight:
-        // for discrete spectral samples, division by the sampling probability mass.
-        // for continuos spectra, importance sample over all probability densities to sample this k.
-        const wavenumber_t recp_spectral_pd = emitter_wavenumber.wavenumber.wpd.is_discrete() ?
-            f_t(1) / wavenumber_density_t{ emitter_wavenumber.wavenumber.wpd.mass() * u::mm } :
-            f_t(1) / ctx.scene->sum_spectral_pdf_for_all_emitters(ctx.sensor, k);
-
-        // draw sensor sample
-        const auto sensor_sample = ctx.sensor->sample(ctx.scene->sampler(), sensor_element, k);
-
-        assert(m::isfinite(emitter_sample.beam.intensity()));
-        assert(m::isfinite(sensor_sample.beam.intensity()));
-
-        arena->sensor_vertices.clear();
-        arena->emitter_vertices.clear();
-        arena->fraunhofer_fsd_bsdfs.clear();
-
-        // generate a sensor and emitter subpaths
-        plt_bdpt::generate_sensor_subpath(arena->sensor_vertices,
-                                          &arena->fraunhofer_fsd_bsdfs,
-                                          fraunhofer_fsd_sampler.get(),
-                                          options,
-                                          sensor_sample,
-                                          ctx, path_sampling_sampler);
-        plt_bdpt::generate_emitter_subpath(arena->emitter_vertices,
-                                           &arena->fraunhofer_fsd_bsdfs,
-                                           fraunhofer_fsd_sampler.get(),
-                                           options,
-                                           emitter_wavenumber,
-                                           ctx, path_sampling_sampler);
-
-        auto L = radiant_flux_stokes_t::unpolarized(radiant_flux_t::zero());
-
-        const auto& wpd = wavenumber_sample.wpd;
-        const auto k_density = wpd.is_discrete() ? 
-            wavenumber_density_t{ wpd.mass() / wavenumber_t::unit } : 
-            wpd.density();
-
-        // TODO: BDPT spectral MIS
-
-        // integrate connections
-        // t - sensor subpath
-        // s - emitter subpath
-        for (int t=0; t<=arena->sensor_vertices.size(); ++t) 
-        for (int s=0; s<=arena->emitter_vertices.size(); ++s) {
-            const auto depth = t+s-2;
-            if ((t==1 && s==1) || depth<0) continue;
-            if (!options.emitter_direct && s==1) continue;
-            if (!options.sensor_direct  && t==1) continue;
-            if (depth>options.max_depth) break;
-
-            // connect
-            auto ret = plt_bdpt::connect_subpaths(arena, ctx, options, 
-                                                  s,t, path_sampling_sampler);
-            if (ret.L.intensity()<=zero)
-                continue;
-
-            // MIS
-            wavenumber_t mis;
-            if (options.MIS) {
-                mis = plt_bdpt::bdpt_compute_mis_weight(arena, ctx, options,
-                                                        s,t, ret) *
-                      recp_spectral_pd;
-            } else {
-                mis = 1 / (f_t(s+t+1) * k_density);
-            }
-            assert(m::isfinite(mis) && mis>=zero);
-
-            // accumulate or splat to light image for direct-to-sensor connections
-            const auto flux_sample = (radiant_flux_stokes_t)(ret.L * mis);
-            if (t>1) L += flux_sample;
-            else {
-                const auto element = *ret.sensor_element_sample;
-                ctx.sensor->splat_direct(ctx.film_surface,
-                                         element,
-                                         flux_sample,
-                                         k);
+    // samples are integrated in passes: the sensor subpaths of a pass share the pass' pool of emitter subpaths (without light-subpath reuse, a pass is a single sample)
+    const auto pass_size = (std::uint32_t)m::max<std::uint16_t>(1, options.light_subpaths);
+    for (std::uint32_t pass_start=0; pass_start<samples_per_element; pass_start+=pass_size) {
+        const auto pass_samples = m::min(pass_size, samples_per_element-pass_start);
+
+        // draw spectral sample and emitter, shared by the pass
+        const auto emitter_wavenumber = ctx.scene->sample_emitter_and_spectrum(ctx.sensor);
+        const auto& k = emitter_wavenumber.wavenumber.k;
+        const auto sw = spectral_weights(ctx, emitter_wavenumber);
+
+        // releases the previous pass' BSDFs
+        sample_arena.reset();
+
+        // generate the pass' emitter subpaths: one per sample
+        plt_bdpt::generate_emitter_subpaths_pool(arena, pass_samples,
+                                                 &sample_arena,
+                                                 fraunhofer_fsd_sampler.get(),
+                                                 options,
+                                                 emitter_wavenumber,
+                                                 ctx,
+                                                 ctx.scene->sampler(), path_sampling_sampler);
+
+        for (std::uint32_t sample=0; sample<pass_samples; ++sample) {
+            // draw sensor sample
+            const auto sensor_sample = ctx.sensor->sample(ctx.scene->sampler(), sensor_element, k);
+            assert(m::isfinite(sensor_sample.beam.intensity()));
+
+            // generate a sensor subpath
+            arena->sensor_vertices.clear();
+            plt_bdpt::generate_sensor_subpath(arena->sensor_vertices,
+                                              &sample_arena,
+                                              fraunhofer_fsd_sampler.get(),
+                                              options,
+                                              sensor_sample,
+                                              ctx, path_sampling_sampler);
+            arena->sensor_pdfs.assign(arena->sensor_vertices, bsdf::transport_e::backward);
+
+            auto L = radiant_flux_stokes_t::unpolarized(radiant_flux_t::zero());
+
+            // connect to each of the pass' emitter subpaths
+            for (std::uint32_t j=0; j<pass_samples; ++j) {
+                arena->swap_pooled_emitter_subpath(j);
+                L += integrate_connections(arena, ctx, options, sw,
+                                           pass_samples, j==sample,
+                                           path_sampling_sampler,
+                                           [&](const auto& element, const auto& flux) {
+                                               ctx.sensor->splat_direct(ctx.film_surface, element, flux, k);
+                                           });
+                arena->swap_pooled_emitter_subpath(j);
             }
-        }
 
-        // splat to block
-        ctx.sensor->splat(block,
-                          sensor_sample.element,
-                          L,
-                          k);
+            // splat to block
+            ctx.sensor->splat(block,
+                              sensor_sample.element,
+                              L,
+                              k);
+        }
     }
 }
 
+wavenumber_t plt_bdpt_t::integrate_sample(const integrator_context_t& ctx,
+                                          const vec3u32_t& sensor_element,
+                                          sampler::sampler_t& sensor_sampler,
+                                          sampler::sampler_t& emitter_sampler,
+                                          sampler::sampler_t& connection_sampler,
+                                          std::vector<splat_t>& splats) const noexcept {
+    auto* arena = &bdpt_arena;
+    auto& sample_arena = ctx.acquire_sample_arena();
+
+    // draw spectral sample and emitter
+    const auto emitter_wavenumber = ctx.scene->sample_emitter_and_spectrum(emitter_sampler, ctx.sensor);
+    const auto& k = emitter_wavenumber.wavenumber.k;
+    const auto sw = spectral_weights(ctx, emitter_wavenumber);
+
+    // releases the previous sample's BSDFs
+    sample_arena.reset();
+
+    // generate an emitter subpath
+    plt_bdpt::generate_emitter_subpaths_pool(arena, 1,
+                                             &sample_arena,
+                                             fraunhofer_fsd_sampler.get(),
+                                             options,
+                                             emitter_wavenumber,
+                                             ctx,
+                                             emitter_sampler, emitter_sampler);
+
+    // draw sensor sample, and generate a sensor subpath
+    const auto sensor_sample = ctx.sensor->sample(sensor_sampler, sensor_element, k);
+    assert(m::isfinite(sensor_sample.beam.intensity()));
+
+    arena->sensor_vertices.clear();
+    plt_bdpt::generate_sensor_subpath(arena->sensor_vertices,
+                                      &sample_arena,
+                                      fraunhofer_fsd_sampler.get(),
+                                      options,
+                                      sensor_sample,
+                                      ctx, sensor_sampler);
+    arena->sensor_pdfs.assign(arena->sensor_vertices, bsdf::transport_e::backward);
+
+    arena->swap_pooled_emitter_subpath(0);
+    const auto L = integrate_connections(arena, ctx, options, sw,
+                                         1, true,
+                                         connection_sampler,
+                                         [&](const auto& element, const auto& flux) {
+                                             splats.emplace_back(splat_t{ .element = element, .flux = flux });
+                                         });
+    arena->swap_pooled_emitter_subpath(0);
+
+    if (L.intensity()>zero)
+        splats.emplace_back(splat_t{ .element = sensor_sample.element, .flux = L });
+
+    return k;
+}
+
 
 scene::element::info_t plt_bdpt_t::description() const {
     using namespace scene::element;
@@ -155,6 +266,7 @@ scene::element::info_t plt_bdpt_t::description() const {
         { "MIS",              attributes::make_scalar(options.MIS) },
         { "FSD",              attributes::make_scalar(options.FSD) },
         { "Russian Roulette", attributes::make_scalar(options.RR) },
+        { "light subpaths",   attributes::make_scalar(options.light_subpaths) },
     });
 }
 
@@ -171,7 +283,8 @@ std::shared_ptr<integrator_t> plt_bdpt_t::load(const std::string& id,
             !scene::loader::read_attribute(item,"FSD",opts.FSD) &&
             !scene::loader::read_attribute(item,"russian_roulette",opts.RR) &&
             !scene::loader::read_attribute(item,"sensor_direct_sampling",opts.sensor_direct) &&
-            !scene::loader::read_attribute(item,"emitter_direct_sampling",opts.emitter_direct))
+            !scene::loader::read_attribute(item,"emitter_direct_sampling",opts.emitter_direct) &&
+            !scene::loader::read_attribute(item,"light_subpaths",opts.light_subpaths))
             logger::cwarn()
                 << loader->node_description(item)
                 << "(integrator loader) Unqueried node \"" << item["name"] << "\"" << '\n';
@@ -180,6 +293,16 @@ std::shared_ptr<integrator_t> plt_bdpt_t::load(const std::string& id,
     }
     }
 
+    if (opts.light_subpaths==0)
+        throw scene_loading_exception_t("(plt_bdpt integrator loader) 'light_subpaths' must be positive", node);
+
+    return create(id, loader, opts, context);
+}
+
+std::shared_ptr<plt_bdpt_t> plt_bdpt_t::create(const std::string& id,
+                                               scene::loader::loader_t* loader,
+                                               const plt_bdpt_t::options_t& opts,
+                                               const wt::wt_context_t &context) {
     auto ptr = std::make_shared<plt_bdpt_t>( 
         context,
         id,
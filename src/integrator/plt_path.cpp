@@ -15,6 +15,7 @@
 
 #include <wt/integrator/plt_path/plt_path.hpp>
 #include <wt/integrator/plt_path/plt_path_detail.hpp>
+#include <wt/integrator/plt_path/plt_path_wavefront.hpp>
 
 #include <wt/ads/ads.hpp>
 #include <wt/scene/scene.hpp>
@@ -41,15 +42,36 @@ void plt_path_t::integrate(const integrator_context_t& ctx,
                            const sensor::block_handle_t& block,
                            const vec3u32_t& sensor_element,
                            std::uint32_t samples_per_element) const noexcept {
+    // per-sample temporaries (e.g., FSD BSDFs) are constructed in this worker's sample arena, released when the next sample begins
+    auto& sample_arena = ctx.acquire_sample_arena();
+
     if (options.transport_direction == bsdf::transport_e::forward) {
-        for (std::uint32_t sample=0; sample<samples_per_element; ++sample)
+        for (std::uint32_t sample=0; sample<samples_per_element; ++sample) {
+            sample_arena.reset();
             plt_path::integrate_forward(ctx, sensor_element, options);
+        }
     } else {
-        for (std::uint32_t sample=0; sample<samples_per_element; ++sample)
+        for (std::uint32_t sample=0; sample<samples_per_element; ++sample) {
+            sample_arena.reset();
             plt_path::integrate_backward(ctx, block, sensor_element, options);
+        }
     }
 }
 
+void plt_path_t::integrate_block(const integrator_context_t& ctx,
+                                 const sensor::block_handle_t& block,
+                                 std::uint32_t samples_per_element) const noexcept {
+    if (!options.wavefront) {
+        integrator_t::integrate_block(ctx, block, samples_per_element);
+        return;
+    }
+
+    if (options.transport_direction == bsdf::transport_e::forward)
+        plt_path::wavefront::integrate_forward(ctx, block, samples_per_element, options);
+    else
+        plt_path::wavefront::integrate_backward(ctx, block, samples_per_element, options);
+}
+
 
 scene::element::info_t plt_path_t::description() const {
     using namespace scene::element;
@@ -58,6 +80,8 @@ scene::element::info_t plt_path_t::description() const {
         { "direction",        attributes::make_enum(options.transport_direction) },
         { "FSD",              attributes::make_scalar(options.FSD) },
         { "Russian Roulette", attributes::make_scalar(options.RR) },
+        { "wavefront",        attributes::make_scalar(options.wavefront) },
+        { "wavefront size",   attributes::make_scalar(options.wavefront_size) },
     });
 }
 
@@ -73,6 +97,8 @@ std::shared_ptr<integrator_t> plt_path_t::load(const std::string& id,
         if (!scene::loader::read_attribute(item,"max_depth",opts.max_depth) &&
             !scene::loader::read_attribute(item,"FSD",opts.FSD) &&
             !scene::loader::read_attribute(item,"russian_roulette",opts.RR) &&
+            !scene::loader::read_attribute(item,"wavefront",opts.wavefront) &&
+            !scene::loader::read_attribute(item,"wavefront_size",opts.wavefront_size) &&
             !scene::loader::read_enum_attribute(item,"direction",direction))
             logger::cwarn()
                 << loader->node_description(item)
@@ -85,6 +111,8 @@ std::shared_ptr<integrator_t> plt_path_t::load(const std::string& id,
     if (!direction)
         throw scene_loading_exception_t("(plt_path integrator loader) 'direction' must be specified", node);
     opts.transport_direction = *direction;
+    if (opts.wavefront && opts.wavefront_size==0)
+        throw scene_loading_exception_t("(plt_path integrator loader) 'wavefront_size' must be positive", node);
 
     return std::make_shared<plt_path_t>( 
         context,
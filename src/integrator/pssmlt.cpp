@@ -0,0 +1,223 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <utility>
+
+#include <wt/scene/element/attributes.hpp>
+#include <wt/scene/loader/loader.hpp>
+#include <wt/scene/loader/node_readers.hpp>
+
+#include <wt/integrator/pssmlt/pssmlt.hpp>
+#include <wt/integrator/pssmlt/pss_sampler.hpp>
+
+#include <wt/scene/scene.hpp>
+#include <wt/sensor/film/film.hpp>
+
+#include <wt/math/common.hpp>
+#include <wt/util/seeded_mt19937_64.hpp>
+#include <wt/util/logger/logger.hpp>
+
+using namespace wt;
+using namespace wt::integrator;
+using pssmlt::pss_sampler_t;
+
+
+namespace {
+
+// a state of a chain: the contributions of a BDPT sample
+struct chain_state_t {
+    std::vector<plt_bdpt_t::splat_t> splats;
+    wavenumber_t k;
+    // scalar contribution
+    f_t I = 0;
+};
+
+struct arena_t {
+    chain_state_t current, proposed;
+    // bootstrap contributions' cumulative sums
+    std::vector<f_t> bootstrap_cdf;
+    seeded_mt19937_64 rd;
+
+    [[nodiscard]] inline f_t r() noexcept {
+        return std::uniform_real_distribution<f_t>{}(rd.engine());
+    }
+};
+
+}
+
+thread_local arena_t pssmlt_arena;
+
+pssmlt_t::pssmlt_t(std::string id,
+                   pssmlt_t::options_t opts,
+                   std::shared_ptr<plt_bdpt_t> bdpt) noexcept
+    : integrator_t(std::move(id)),
+      options(opts),
+      bdpt(std::move(bdpt))
+{}
+
+void pssmlt_t::run_chain(const integrator_context_t& ctx,
+                         const std::size_t mutations) const noexcept {
+    if (mutations==0) return;
+
+    auto& arena = pssmlt_arena;
+    auto& current  = arena.current;
+    auto& proposed = arena.proposed;
+
+    const auto resolution = ctx.sensor->resolution();
+
+    // draws a sensor element uniformly, and integrates a BDPT sample of that element
+    const auto evaluate = [&](pss_sampler_t& sampler, chain_state_t& state) {
+        auto& sensor_sampler = sampler.stream(pss_sampler_t::stream_e::sensor);
+        const auto pt = sensor_sampler.r3();
+        auto element = vec3u32_t{ 0 };
+        for (int d=0; d<3; ++d)
+            element[d] = m::min(resolution[d]-1, (std::uint32_t)(pt[d]*resolution[d]));
+
+        state.splats.clear();
+        state.k = bdpt->integrate_sample(ctx, element,
+                                         sensor_sampler,
+                                         sampler.stream(pss_sampler_t::stream_e::emitter),
+                                         sampler.stream(pss_sampler_t::stream_e::connection),
+                                         state.splats);
+
+        state.I = 0;
+        for (const auto& s : state.splats)
+            state.I += (f_t)u::to_W(s.flux.intensity());
+        return state.I;
+    };
+
+    const auto splat = [&](const chain_state_t& state, const f_t w) {
+        for (const auto& s : state.splats)
+            ctx.sensor->splat_direct(ctx.film_surface, s.element, s.flux * w, state.k);
+    };
+
+    auto sampler = pss_sampler_t{ 0, options.sigma, options.large_step_probability };
+
+    // bootstrap: independent samples, each reproducible from its seed
+    const auto chain_seed = arena.rd.engine()();
+    const auto bootstrap_samples = (std::size_t)options.bootstrap_samples;
+
+    auto& bootstrap_cdf = arena.bootstrap_cdf;
+    bootstrap_cdf.resize(bootstrap_samples);
+    f_t sum = 0;
+    for (std::size_t i=0; i<bootstrap_samples; ++i) {
+        sampler.reset(chain_seed+i);
+        sum += evaluate(sampler, proposed);
+        bootstrap_cdf[i] = sum;
+    }
+    if (!(sum>0) || !m::isfinite(sum))
+        return;
+    // normalization: mean contribution
+    const auto b = sum / f_t(bootstrap_samples);
+
+    // resample the initial state proportionally to contribution, and replay it
+    {
+        const auto it = std::ranges::upper_bound(bootstrap_cdf, arena.r()*sum);
+        const auto idx = std::min<std::size_t>(bootstrap_samples-1, it-bootstrap_cdf.begin());
+        sampler.reset(chain_seed+idx);
+        if (!(evaluate(sampler, current)>0))
+            return;
+    }
+
+    // run chain
+    for (std::size_t j=0; j<mutations; ++j) {
+        sampler.start_iteration();
+        evaluate(sampler, proposed);
+
+        const auto accept = m::min<f_t>(1, proposed.I/current.I);
+
+        // splat both states, weighted by their expected values
+        if (accept>0)
+            splat(proposed, accept * b / proposed.I);
+        if (accept<1)
+            splat(current, (1-accept) * b / current.I);
+
+        if (arena.r() < accept) {
+            std::swap(current, proposed);
+            sampler.accept();
+        } else {
+            sampler.reject();
+        }
+    }
+}
+
+void pssmlt_t::integrate(const integrator_context_t& ctx,
+                         const sensor::block_handle_t& block,
+                         const vec3u32_t& sensor_element,
+                         std::uint32_t samples_per_element) const noexcept {
+    run_chain(ctx, samples_per_element);
+}
+
+void pssmlt_t::integrate_block(const integrator_context_t& ctx,
+                               const sensor::block_handle_t& block,
+                               std::uint32_t samples_per_element) const noexcept {
+    const auto& size = block.size;
+    const auto elements = (std::size_t)size.x * size.y * size.z;
+    run_chain(ctx, elements * samples_per_element);
+}
+
+
+scene::element::info_t pssmlt_t::description() const {
+    using namespace scene::element;
+    return info_for_scene_element(*this, "pssmlt", {
+        { "max depth",              attributes::make_scalar(options.bdpt.max_depth) },
+        { "MIS",                    attributes::make_scalar(options.bdpt.MIS) },
+        { "FSD",                    attributes::make_scalar(options.bdpt.FSD) },
+        { "Russian Roulette",       attributes::make_scalar(options.bdpt.RR) },
+        { "bootstrap samples",      attributes::make_scalar(options.bootstrap_samples) },
+        { "sigma",                  attributes::make_scalar(options.sigma) },
+        { "large step probability", attributes::make_scalar(options.large_step_probability) },
+    });
+}
+
+std::shared_ptr<integrator_t> pssmlt_t::load(const std::string& id,
+                                             scene::loader::loader_t* loader,
+                                             const scene::loader::node_t& node,
+                                             const wt::wt_context_t &context) {
+    pssmlt_t::options_t opts{};
+
+    for (auto& item : node.children_view()) {
+    try {
+        if (!scene::loader::read_attribute(item,"max_depth",opts.bdpt.max_depth) &&
+            !scene::loader::read_attribute(item,"MIS",opts.bdpt.MIS) &&
+            !scene::loader::read_attribute(item,"FSD",opts.bdpt.FSD) &&
+            !scene::loader::read_attribute(item,"russian_roulette",opts.bdpt.RR) &&
+            !scene::loader::read_attribute(item,"sensor_direct_sampling",opts.bdpt.sensor_direct) &&
+            !scene::loader::read_attribute(item,"emitter_direct_sampling",opts.bdpt.emitter_direct) &&
+            !scene::loader::read_attribute(item,"bootstrap_samples",opts.bootstrap_samples) &&
+            !scene::loader::read_attribute(item,"sigma",opts.sigma) &&
+            !scene::loader::read_attribute(item,"large_step_probability",opts.large_step_probability))
+            logger::cwarn()
+                << loader->node_description(item)
+                << "(integrator loader) Unqueried node \"" << item["name"] << "\"" << '\n';
+    } catch(const std::format_error& exp) {
+        throw scene_loading_exception_t("(pssmlt integrator loader) " + std::string{ exp.what() }, item);
+    }
+    }
+
+    if (opts.bootstrap_samples==0)
+        throw scene_loading_exception_t("(pssmlt integrator loader) 'bootstrap_samples' must be positive", node);
+    if (!(opts.sigma>0))
+        throw scene_loading_exception_t("(pssmlt integrator loader) 'sigma' must be positive", node);
+    if (!(opts.large_step_probability>=0 && opts.large_step_probability<=1))
+        throw scene_loading_exception_t("(pssmlt integrator loader) 'large_step_probability' must be in [0,1]", node);
+
+    // the underlying BDPT integrator
+    auto bdpt = plt_bdpt_t::create(id+"_bdpt", loader, opts.bdpt, context);
+
+    return std::make_shared<pssmlt_t>(
+        id,
+        opts,
+        std::move(bdpt)
+    );
+}
@@ -26,8 +26,10 @@ free_space_diffraction_t::free_space_diffraction_t(
         wavenumber_t k, f_t total_power,
         const elliptic_cone_t& beam,
         const ads::intersection_record_t::edges_container_t& edges,
-        const beam::gaussian_wavefront_t& wave_function) noexcept 
-    : k(k), frame(frame),
+        const beam::gaussian_wavefront_t& wave_function,
+        std::pmr::memory_resource* mem) noexcept 
+    : aperture(mem),
+      k(k), frame(frame),
       fsd_sampler(fsd_sampler) 
 {
     constexpr auto interaction_point = pqvec2_t{};
@@ -124,6 +126,6 @@ free_space_diffraction_t::free_space_diffraction_t(
             pdf *= recp_P_total;
     } else {
         aperture.P0_pdf = 1;
-        aperture.edges = {};
+        aperture.edges.clear();
     }
 }
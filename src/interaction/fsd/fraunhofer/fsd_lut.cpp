@@ -7,16 +7,21 @@
 *
 */
 
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <format>
 #include <iterator>
+#include <random>
 #include <vector>
 #include <future>
 #include <stdexcept>
+#include <type_traits>
 
 #include <wt/interaction/fsd/fraunhofer/fsd_lut.hpp>
 
 #include <wt/math/common.hpp>
+#include <wt/util/logger/logger.hpp>
 
 using namespace wt;
 using namespace wt::fraunhofer;
@@ -47,28 +52,164 @@ inline auto load_csv(Data &data, const std::filesystem::path &path) {
         *p = DstT(*src);
 }
 
+
+// FSD LUT cache
+
+namespace {
+
+constexpr char lut_cache_magic[8] = { 'W','T','F','S','D','L','U','T' };
+constexpr std::uint32_t lut_cache_version = 1;
+// LUTs start on a page boundary
+constexpr std::uint64_t lut_cache_payload_offset = 4096;
+
+struct lut_cache_header_t {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t f_size;
+    std::uint64_t data_size;
+    std::uint64_t file_size;
+
+    // fp64 tables the cache was generated from
+    std::uint64_t source_sizes[4];
+    std::int64_t source_mtimes[4];
+};
+static_assert(sizeof(lut_cache_header_t)<=lut_cache_payload_offset);
+
+inline auto lut_cache_name() {
+    return std::format("fsd_lut.f{}.wtlut", sizeof(f_t)*8);
+}
+
+}
+
+bool fsd_lut_t::load_cache(const std::filesystem::path& path,
+                           const std::optional<source_stamps_t>& sources) {
+    static_assert(std::is_trivially_copyable_v<data_t>);
+
+    try {
+        auto file = std::make_unique<mmap_file_t>(path);
+        if (file->size()<lut_cache_payload_offset)
+            throw std::runtime_error("truncated file");
+
+        lut_cache_header_t h;
+        std::memcpy(&h, file->data(), sizeof(h));
+
+        if (std::memcmp(h.magic, lut_cache_magic, sizeof(lut_cache_magic))!=0)
+            throw std::runtime_error("not an FSD LUT cache file");
+        if (h.version!=lut_cache_version || h.f_size!=sizeof(f_t) || h.data_size!=sizeof(data_t))
+            throw std::runtime_error("incompatible cache file version");
+        if (h.file_size!=file->size() || lut_cache_payload_offset+h.data_size>file->size())
+            throw std::runtime_error("truncated file");
+
+        // stale? (the fp64 tables may be absent when only the cache is deployed)
+        if (sources) {
+            for (auto i=0ul; i<sources->size(); ++i) {
+                if (h.source_sizes[i]!=(*sources)[i].size || h.source_mtimes[i]!=(*sources)[i].mtime) {
+                    wt::logger::cout(verbosity_e::info) << "(fsd_lut) LUT cache \"" << path.string() << "\" is out of date" << '\n';
+                    return false;
+                }
+            }
+        }
+
+        data = reinterpret_cast<const data_t*>(file->data()+lut_cache_payload_offset);
+        mapped_data = std::move(file);
+
+        wt::logger::cout(verbosity_e::info) << "(fsd_lut) mapped LUT cache \"" << path.string() << "\"" << '\n';
+
+        return true;
+    } catch(const std::exception& e) {
+        wt::logger::cwarn(verbosity_e::info) << "(fsd_lut) ignoring LUT cache \"" << path.string() << "\": " << e.what() << '\n';
+    }
+
+    return false;
+}
+
+void fsd_lut_t::store_cache(const std::filesystem::path& path,
+                            const source_stamps_t& sources) const noexcept {
+    try {
+        // write to a temporary first, and then rename: concurrent readers never see a partial file
+        auto tmp_path = path;
+        tmp_path += std::format(".{:08x}.tmp", std::random_device{}());
+
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error("could not create file");
+
+        lut_cache_header_t h{};
+        std::memcpy(h.magic, lut_cache_magic, sizeof(lut_cache_magic));
+        h.version = lut_cache_version;
+        h.f_size = sizeof(f_t);
+        h.data_size = sizeof(data_t);
+        h.file_size = lut_cache_payload_offset + sizeof(data_t);
+        for (auto i=0ul; i<sources.size(); ++i) {
+            h.source_sizes[i]  = sources[i].size;
+            h.source_mtimes[i] = sources[i].mtime;
+        }
+
+        static constexpr char zeros[lut_cache_payload_offset]{};
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.write(zeros, lut_cache_payload_offset-sizeof(h));
+        f.write(reinterpret_cast<const char*>(data), sizeof(data_t));
+        f.close();
+        if (!f)
+            throw std::runtime_error("write failed");
+
+        std::filesystem::rename(tmp_path, path);
+
+        wt::logger::cout(verbosity_e::info) << "(fsd_lut) wrote LUT cache \"" << path.string() << "\"" << '\n';
+    } catch(const std::exception& e) {
+        wt::logger::cwarn(verbosity_e::info) << "(fsd_lut) failed writing LUT cache \"" << path.string() << "\": " << e.what() << '\n';
+    }
+}
+
+
 fsd_lut_t::fsd_lut_t(const wt::wt_context_t &context) {
     const auto data_path = std::filesystem::path{ "data" } / "fsd";
 
-    data = std::make_unique<data_t>();
-
     const auto path_a1  = context.resolve_path(data_path / "iCDFa1.fp64");
     const auto path_a2  = context.resolve_path(data_path / "iCDFa2.fp64");
     const auto path_a1t = context.resolve_path(data_path / "iCDFa1theta.fp64");
     const auto path_a2t = context.resolve_path(data_path / "iCDFa2theta.fp64");
-
-    if (!path_a1 || !path_a2 || !path_a1t || !path_a2t)
+    const bool has_sources = path_a1 && path_a2 && path_a1t && path_a2t;
+
+    // the cache lives next to the fp64 tables
+    std::optional<source_stamps_t> sources;
+    std::optional<std::filesystem::path> cache_path;
+    if (has_sources) {
+        sources = source_stamps_t{};
+        std::size_t i = 0;
+        for (const auto& p : { *path_a1, *path_a2, *path_a1t, *path_a2t }) {
+            (*sources)[i++] = source_stamp_t{
+                .size  = (std::uint64_t)std::filesystem::file_size(p),
+                .mtime = (std::int64_t)std::filesystem::last_write_time(p).time_since_epoch().count(),
+            };
+        }
+        cache_path = path_a1->parent_path() / lut_cache_name();
+    }
+    else
+        cache_path = context.resolve_path(data_path / lut_cache_name());
+
+    if (cache_path && std::filesystem::is_regular_file(*cache_path) &&
+        load_cache(*cache_path, sources))
+        return;
+
+    if (!has_sources)
         throw std::runtime_error("(fsd_lut) FSD LUTs not found.");
+
+    owned_data = std::make_unique<data_t>();
+    auto* lut = owned_data.get();
     
     auto f1 = std::async(std::launch::async, [&]() {
-        load_csv(data->iCDF1, *path_a1);
+        load_csv(lut->iCDF1, *path_a1);
     });
     auto f2 = std::async(std::launch::async, [&]() {
-        load_csv(data->iCDF2, *path_a2);
+        load_csv(lut->iCDF2, *path_a2);
     });
-    load_csv(data->iCDFtheta1, *path_a1t);
-    load_csv(data->iCDFtheta2, *path_a2t);
+    load_csv(lut->iCDFtheta1, *path_a1t);
+    load_csv(lut->iCDFtheta2, *path_a2t);
 
     f1.get();
     f2.get();
+
+    data = lut;
+    store_cache(*cache_path, *sources);
 }
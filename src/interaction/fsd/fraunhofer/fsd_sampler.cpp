@@ -8,6 +8,8 @@
 */
 
 #include <memory>
+#include <memory_resource>
+#include <vector>
 #include <string>
 
 #include <wt/interaction/fsd/fraunhofer/fsd_sampler.hpp>
@@ -115,16 +117,18 @@ inline sample_ret_t sample_rejection(sampler::sampler_t& sampler,
 inline sample_ret_t sample_SIR(sampler::sampler_t& sampler,
                                const fsd::fsd_aperture_t& aperture,
                                const fsd_sample_impl_t* pimpl) noexcept {
-    static thread_local std::vector<vec2_t> xis;
-    static thread_local std::vector<f_t> ws;
-    static thread_local std::vector<f_t> fs;
-    xis.clear();
-    ws.clear();
-    fs.clear();
-
     const auto edge_count = aperture.edges.size();
     const auto M = 4*edge_count;
 
+    // scratch, from the aperture's memory resource (a per-sample arena, when used by the integrators)
+    auto* mem = aperture.memory_resource();
+    std::pmr::vector<vec2_t> xis{ mem };
+    std::pmr::vector<f_t> ws{ mem };
+    std::pmr::vector<f_t> fs{ mem };
+    xis.reserve(M);
+    ws.reserve(M);
+    fs.reserve(M);
+
     f_t W = 0;    
     for (auto m=0ul;m<M;++m) {
         const auto xi = pimpl->sampleN(sampler, aperture);
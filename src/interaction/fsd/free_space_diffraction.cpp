@@ -27,11 +27,12 @@ free_space_diffraction_t::free_space_diffraction_t(
         const pqvec3_t& interaction_region_size,
         const dir3_t& wi,
         wavenumber_t k,
-        const ads::intersection_record_t::edges_container_t& edges) noexcept
-    : interaction_wp(interaction_wp) 
+        const ads::intersection_record_t::edges_container_t& edges,
+        std::pmr::memory_resource* mem) noexcept
+    : aperture(k, mem),
+      interaction_wp(interaction_wp) 
 {
     // build aperture
-    auto aperture = utd::fsd_aperture_t{ .k = k };
     aperture.edges.reserve(edges.size());
     for (const auto& ed : edges) {
         const auto& edge = ads->edge(ed);
@@ -77,8 +78,6 @@ free_space_diffraction_t::free_space_diffraction_t(
             .ads_edge_idx = ed,
         });
     }
-
-    this->aperture = aperture;
 }
 
 free_space_diffraction_t::sample_ret_t free_space_diffraction_t::sample(
@@ -136,7 +135,7 @@ free_space_diffraction_t::sample_ret_t free_space_diffraction_t::sample(
     if (sin_beta < utd::utd_min_sin_beta)
         return {};
 
-    const auto intersection = intersection_edge_t(ads->edge(edge.ads_edge_idx), p);
+    const auto intersection = intersection_edge_t(*ads, ads->edge(edge.ads_edge_idx), p);
     const auto dpd = this->pdf(src, wo);
     if (dpd == zero)
         return {};
@@ -195,11 +194,15 @@ angle_sampling_pd_t free_space_diffraction_t::pdf(const pqvec3_t& src, const dir
 free_space_diffraction_t::eval_ret_t free_space_diffraction_t::f(
         const pqvec3_t& src,
         const pqvec3_t& dst) const noexcept {
-    eval_ret_t ret;
+    eval_ret_t ret{ aperture.edges.get_allocator().resource() };
 
     const auto& k = aperture.k;
 
     ret.reserve(aperture.edges.size());
+    std::pmr::vector<utd::UTD_args_t> args{ ret.get_allocator() };
+    args.reserve(aperture.edges.size());
+
+    // gather candidate edges
     for (const auto& e : aperture.edges) {
         const auto p = e.diffraction_point(src, dst);
         if (!p)
@@ -216,12 +219,10 @@ free_space_diffraction_t::eval_ret_t free_space_diffraction_t::f(
         const auto ro = m::length(uo);
         const auto wi = dir3_t{ ui/ri };
         const auto wo = dir3_t{ uo/ro };
-        const auto f = e.UTD(k, wi, wo, ro);
-        if (f.Dh==zero && f.Ds==zero)
-            continue;
 
+        args.emplace_back(e.UTD_args(k, wi, wo, ro));
         ret.emplace_back(diffracting_edge_t{
-            .utd = f,
+            .utd = e.UTD_frames(wi, wo),
             .edge_idx = e.ads_edge_idx,
             .p = *p,
             .wi = wi,
@@ -231,5 +232,20 @@ free_space_diffraction_t::eval_ret_t free_space_diffraction_t::f(
         });
     }
 
+    // diffraction coefficients of all candidates at once
+    {
+        std::pmr::vector<c_t> Ds(args.size(), ret.get_allocator());
+        std::pmr::vector<c_t> Dh(args.size(), ret.get_allocator());
+        utd::UTD_coefficients(args, Ds, Dh);
+        for (std::size_t i=0; i<ret.size(); ++i) {
+            ret[i].utd.Ds = Ds[i];
+            ret[i].utd.Dh = Dh[i];
+        }
+    }
+
+    std::erase_if(ret, [](const auto& d) {
+        return d.utd.Dh==zero && d.utd.Ds==zero;
+    });
+
     return ret;
 }
\ No newline at end of file
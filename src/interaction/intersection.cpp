@@ -13,6 +13,7 @@
 
 #include <wt/scene/shape.hpp>
 #include <wt/bsdf/bsdf.hpp>
+#include <wt/ads/ads.hpp>
 #include <wt/ads/intersection_record.hpp>
 #include <wt/mesh/surface_differentials.hpp>
 
@@ -26,7 +27,10 @@
 
 using namespace wt;
 
-const mesh::surface_differentials_t& intersection_surface_t::tangent_frame() const noexcept {
+mesh::surface_differentials_t intersection_surface_t::tangent_frame() const noexcept {
+    // proxies: the geometric frame
+    if (is_proxy())
+        return { .dpdu = pqvec3_t{ vec3_t{ geo.t } * u::m }, .dpdv = pqvec3_t{ vec3_t{ geo.b } * u::m } };
     return shape->get_mesh().tangent_frame(mesh_tri_idx);
 }
 
@@ -77,6 +81,17 @@ intersection_surface_t::intersection_surface_t(const shape_t* shape,
                              shape->get_mesh().tangent_frame(mesh_tri_idx))
 {}
 
+intersection_surface_t::intersection_surface_t(const shape_t* shape,
+                                               const ads::proxy_tri_t& proxy,
+                                               const pqvec3_t& beam_intersection_centre) noexcept
+    : wp(beam_intersection_centre),
+      uv{ 0,0 },
+      mesh_tri_idx(ads::tri_t::proxy_shape_tri_idx),
+      shape(shape),
+      geo(frame_t::build_orthogonal_frame(proxy.geometry.n)),
+      shading(frame_t::build_orthogonal_frame(proxy.geometry.n))
+{}
+
 texture::texture_query_t intersection_surface_t::texture_query(const wavenumber_t& k) const noexcept {
     texture::texture_query_t ret = {
         .uv = uv,
@@ -91,6 +106,10 @@ texture::texture_query_t intersection_surface_t::texture_query(const wavenumber_
 intersection_uv_pdvs_t intersection_surface_t::pdvs_at_intersection() const noexcept {
     constexpr auto scale = f_t(.5) / beam::gaussian_wavefront_t::beam_cross_section_envelope;
 
+    // proxies have no texture coordinates
+    if (is_proxy())
+        return {};
+
     // compute pdvs of uv w.r.t. tb position in local shading frame
     qvec2<length_density_t> dudtb, dvdtb;
     {
@@ -196,13 +215,15 @@ pqvec3_t intersection_edge_t::offseted_ray_origin(const ray_t& ray) const noexce
         dir = m::length2(v)>f_t(1e-14) ? -m::normalize(v) : -edge->t2;
     }
 
+    const auto p1 = ads->tri_vertices(*t1);
     const auto t1_fp_err = compute_intersection_triangle_fp_errors(
-        t1->a, t1->b, t1->c, ray.o);
+        p1[0], p1[1], p1[2], ray.o);
     auto d = m::dot(t1_fp_err, m::abs(vec3_t{ edge->t1 }));
 
     if (t2) {
+        const auto p2 = ads->tri_vertices(*t2);
         const auto t2_fp_err = compute_intersection_triangle_fp_errors(
-            t2->a, t2->b, t2->c, ray.o);
+            p2[0], p2[1], p2[2], ray.o);
         const auto d2 = m::dot(t2_fp_err, m::abs(vec3_t{ edge->t2 }));
         d = m::max(d,d2);
     }
@@ -12,6 +12,9 @@
 #endif
 
 #include <string>
+#include <vector>
+#include <iterator>
+#include <algorithm>
 #include <chrono>
 #include <utility>
 #include <stdexcept>
@@ -33,6 +36,9 @@
 #include <wt/scene/loader/bootstrap.hpp>
 #include <wt/scene/loader/xml/loader.hpp>
 #include <wt/ads/bvh8w/bvh8w_constructor.hpp>
+#include <wt/ads/bvh8w/bvh8w_refit.hpp>
+#include <wt/ads/bvh8w/node16_kernels.hpp>
+#include <wt/scene/animation.hpp>
 #include <wt/scene/scene_renderer.hpp>
 
 #include <wt/util/logger/logger.hpp>
@@ -40,6 +46,7 @@
 #include <wt/util/format/enum.hpp>
 #include <wt/util/format/chrono.hpp>
 #include <wt/util/thread_pool/tpool.hpp>
+#include <wt/util/cpu_features.hpp>
 
 #include <wt/util/preview/preview_tev.hpp>
 #include <wt/util/gui/gui.hpp>
@@ -47,6 +54,9 @@
 
 #include <wt/util/statistics_collector/stat_collector_registry.hpp>
 
+#include <wt/validation/validation.hpp>
+#include <wt/validation/benchmark.hpp>
+
 #define throw(...)
 #include <ImfThreading.h>
 #undef throw
@@ -178,6 +188,21 @@ void print_summary() {
         << std::format("{}  |  {:L} triangles  |  {:L} nodes", 
                         ads->description(), ads->triangles_count(), ads->nodes_count())
         << '\n';
+
+    std::size_t meshes_bytes = 0, mesh_triangles = 0, mesh_vertices = 0;
+    for (const auto& s : scene->shapes()) {
+        const auto& mesh = s->get_mesh();
+        meshes_bytes   += mesh.memory_bytes();
+        mesh_triangles += mesh.triangles_count();
+        mesh_vertices  += mesh.vertices_count();
+    }
+    wt::logger::cout(wt::verbosity_e::info)
+        << std::format("geometry memory  |  meshes {:.1f} MiB ({:L} triangles, {:L} vertices, {:.1f} B per triangle)  |  ADS {:.1f} MiB ({:.1f} B per triangle)",
+                        meshes_bytes / double(1<<20),
+                        mesh_triangles, mesh_vertices, meshes_bytes / double(std::max<std::size_t>(mesh_triangles,1)),
+                        ads->memory_bytes() / double(1<<20),
+                        ads->memory_bytes() / double(std::max<std::size_t>(mesh_triangles,1)))
+        << '\n';
 }
 
 void initialize_logs(wt::logger::log_verbosity_e filelog_verbosity, bool disable_progress_bars) {
@@ -585,11 +610,10 @@ void initialize_renderer(
 #endif
 }
 
-inline void render(
+// loads the scene and constructs the ADS
+inline void load_scene(
         const std::filesystem::path& scene_path,
-        const wt_scene_defines_t& scene_loader_defines,
-        const std::string& preview_tev_host_port_str) {
-    // load scene and construct ADS
+        const wt_scene_defines_t& scene_loader_defines) {
     {
         // scene name: parent directory + scene file name
         auto scene_name = 
@@ -660,8 +684,40 @@ inline void render(
         sigaction(SIGINT, &sa, nullptr);
     }
 #endif
-    
+}
+
+/* Validation
+ */
 
+// prints the results of validation checks, returns TRUE if all passed
+inline bool print_check_results(const std::vector<wt::validation::check_result_t>& results) {
+    using namespace wt::logger::termcolour;
+
+    bool passed = true;
+    for (const auto& r : results) {
+        wt::logger::cout(wt::verbosity_e::important)
+            << reset << bold << r.name << reset << "  |  "
+            << (r.passed ? green : red) << bold << (r.passed ? "passed" : "FAILED")
+            << reset << "  |  " << r.details << '\n';
+        passed = passed && r.passed;
+    }
+    return passed;
+}
+
+// prints the timings of benchmarks
+inline void print_timings(const std::vector<wt::validation::timing_t>& timings) {
+    using namespace wt::logger::termcolour;
+
+    for (const auto& t : timings) {
+        wt::logger::cout(wt::verbosity_e::important)
+            << reset << bold << t.name << reset << "  |  "
+            << bold << std::format("{:.2f} ns/op", t.ns_per_op)
+            << reset << "  |  " << t.details << '\n';
+    }
+}
+
+// renders the loaded scene and writes out the results
+inline void render_scene(const std::string& preview_tev_host_port_str) {
     wt::scene::render_opts_t render_opts = {};
 
     // use preview?
@@ -691,7 +747,64 @@ inline void render(
     const auto& render_result = scene_renderer->get();
     // write out
     write_render_result(context, *scene, *ads, render_result, false);
+}
 
+inline void render(
+        const std::filesystem::path& scene_path,
+        const wt_scene_defines_t& scene_loader_defines,
+        const std::string& preview_tev_host_port_str) {
+    load_scene(scene_path, scene_loader_defines);
+    render_scene(preview_tev_host_port_str);
+
+    // write out additional performance stats
+    if (should_print_stats_to_stdout_on_exit)
+        print_stats_to_stdout();
+}
+
+inline void render_frames(
+        const std::filesystem::path& scene_path,
+        const std::filesystem::path& animation_path,
+        const wt_scene_defines_t& scene_loader_defines,
+        const wt::ads::construction::bvh8w_refit_t::opts_t& refit_opts,
+        const std::string& preview_tev_host_port_str) {
+    load_scene(scene_path, scene_loader_defines);
+
+    auto animation = wt::scene::animation_t{ animation_path, *scene };
+    auto refitter = wt::ads::construction::bvh8w_refit_t{ context, refit_opts };
+
+    // each frame is written into its own subdirectory
+    const auto output_path = context.output_path;
+
+    for (std::size_t frame=0; frame<animation.frames_count() && !terminate_program; ++frame) {
+        // the previous frame's renderer references the ADS, which might be rebuilt
+        scene_renderer = nullptr;
+
+        // pose the scene, and update the ADS
+        const auto changed_shapes = animation.apply(frame, *scene);
+        if (!changed_shapes.empty()) {
+            const auto r = refitter.update(ads, scene->shapes(), changed_shapes);
+            wt::logger::cout(wt::verbosity_e::info)
+                << std::format("frame {:L}  |  {:L} shapes moved  |  {}  |  {:L} triangles  |  {:L} nodes  |  {:L} edges  |  SAH ratio {:.3f}  |  {}",
+                               frame, changed_shapes.size(),
+                               r.rebuilt ? "rebuilt ADS" : "refitted ADS",
+                               r.triangles_updated, r.nodes_refitted, r.edges_updated, r.sah_ratio,
+                               std::chrono::duration_cast<std::chrono::milliseconds>(r.elapsed))
+                << '\n';
+            if (r.edges_detached>0)
+                wt::logger::cwarn()
+                    << std::format("frame {:L}: {:L} edges shared across shapes were detached by the motion", frame, r.edges_detached)
+                    << '\n';
+            if (r.edges_joined>0)
+                wt::logger::cout(wt::verbosity_e::info)
+                    << std::format("frame {:L}: {:L} edges were joined with new neighbours", frame, r.edges_joined)
+                    << '\n';
+        }
+
+        context.output_path = output_path / std::format("frame_{:04d}", frame);
+        render_scene(preview_tev_host_port_str);
+        wt::logger::cout.end_progress_bars_group();
+    }
+    context.output_path = output_path;
 
     // write out additional performance stats
     if (should_print_stats_to_stdout_on_exit)
@@ -757,6 +870,14 @@ inline auto parse_defines(defines_t defs) {
  */
 
 int main(int argc, char* argv[]) {
+    // CPU supports the instruction-set extensions the binary was compiled for?
+    try {
+        wt::check_cpu_features();
+    } catch(const std::exception& e) {
+        wt::logger::cerr(wt::verbosity_e::important) << e.what() << '\n';
+        return -1;
+    }
+
     // set system locale globally
     std::locale::global(std::locale(""));
 
@@ -796,6 +917,22 @@ int main(int argc, char* argv[]) {
 
     cli_version.callback([&]() {
         wt::wt_version_t{}.print_wt_version();
+
+        const auto& compiled = wt::cpu_features_t::compiled();
+        const auto cpu = wt::cpu_features_t::detect();
+        wt::logger::cout(wt::verbosity_e::important)
+            << "instruction-set extensions  |  compiled for: " << (compiled.to_string().empty() ? "baseline" : compiled.to_string())
+            << "  |  CPU: " << cpu.to_string() << '\n';
+
+        wt::logger::cout(wt::verbosity_e::important)
+            << "16-wide node kernels  |  " << wt::ads::bvh8w::node16_kernels().isa << '\n';
+
+        // only the node kernels are dispatched at runtime: point out a build that would make use of more of this CPU
+        if (cpu.x86_64_level() > compiled.x86_64_level()) {
+            wt::logger::cout(wt::verbosity_e::important)
+                << std::format("this CPU supports x86-64-v{}: a build with -DTARGET_ARCH=x86-64-v{} may be faster", cpu.x86_64_level(), cpu.x86_64_level())
+                << '\n';
+        }
     });
 
 
@@ -842,6 +979,28 @@ int main(int argc, char* argv[]) {
                            "number of samples-per-pixel for a single rendered image block")
         ->capture_default_str()
         ->group("renderer fine tuning");
+    render_opt->add_option("--ads-cache", context.ads_cache_path,
+                           "directory for caching built acceleration data structures; repeated renders of unchanged geometry load the cached ADS")
+        ->option_text("PATH")
+        ->group("renderer fine tuning");
+    render_opt->add_option("--ads-spatial-splits", context.ads_spatial_split_budget,
+                           "build the ADS with spatial splits (SBVH), allowing up to this fraction of additional triangle references; helps scenes with long, thin triangles. 0 for plain SAH")
+        ->capture_default_str()
+        ->check(CLI::NonNegativeNumber)
+        ->option_text("FRACTION")
+        ->group("renderer fine tuning");
+    render_opt->add_option("--ads-lod", context.ads_lod_footprint_fraction,
+                           "beam-footprint level of detail: beams do not resolve nearly-planar geometry details smaller than this fraction of the beam footprint (or wavelength), and interact with simplified proxies instead. 0 disables")
+        ->capture_default_str()
+        ->check(CLI::NonNegativeNumber)
+        ->option_text("FRACTION")
+        ->group("renderer fine tuning");
+    render_opt->add_option("--ads-node-width", context.ads_node_width,
+                           "node width of the ADS for ray and beam traversal: 8, or 16 (collapsed from the 8-wide tree; best on AVX-512 targets)")
+        ->capture_default_str()
+        ->check(CLI::IsMember({ 8u, 16u }))
+        ->option_text("WIDTH")
+        ->group("renderer fine tuning");
 
     // run-time performance statistics
     render_opt->add_flag("--print-stats,!--no-print-stats", should_print_stats_to_stdout_on_exit,
@@ -883,52 +1042,54 @@ int main(int argc, char* argv[]) {
     CLI::TriggerOff(&cli_render, &cli_version);
 
     auto sout_verbosity = wt::logger::log_verbosity_e::normal;
-
-    // verbosity
-    auto opt_q = 
-        cli_render.add_flag_callback("-q,--quiet",
-            [&]() {
-                sout_verbosity = wt::verbosity_e::quiet;
-                should_print_stats_to_stdout_on_exit = false;
-            },
-            "suppresses debug/info output (log level = quiet)")
-        ->group("verbosity");
-    auto opt_vv = 
-        cli_render.add_flag_callback("-v,--verbose",
-            [&]() {
-                sout_verbosity = wt::verbosity_e::info;
-            },
-            "additional informational output (log level = info)")
-        ->group("verbosity");
-    auto opt_cout_level = 
-        cli_render.add_option_function<std::string>("--verbosity",
-            [&](const auto& v) {
-                const auto val = wt::format::parse_enum<wt::verbosity_e>(v);
-                if (!val)
-                    throw CLI::ParseError("verbosity parsing failed", CLI::ExitCodes::ConversionError);
-                sout_verbosity = *val;
-            },
-            "sets verbosity level of standard output logging")
-        ->option_text("<quiet/important/normal/info/debug>")
-        ->default_val("normal")
-        ->group("verbosity");
-    cli_render.add_flag("--no-progress", no_progress_bars,
-                        "suppresses progress bars")
-        ->capture_default_str()
-        ->group("verbosity");
-
-    opt_q->excludes(opt_vv);
-    opt_cout_level->excludes(opt_q);
-    opt_cout_level->excludes(opt_vv);
-
-    // preview
     const auto default_tev_host_port = std::string{ "127.0.0.1:14158" };
     std::string preview_tev_host_port_str;
-    cli_render.add_flag("--tev{" + default_tev_host_port + "}", preview_tev_host_port_str,
-                        "connect to a tev instance to display rendering preview (hostname:port)")
-        ->group("preview interface");
-    
-    cli_render.callback([&]() {
+
+    // verbosity and preview options, shared by the command-line render subcommands
+    const auto add_cli_render_options = [&](CLI::App& cmd) {
+        // verbosity
+        auto opt_q = 
+            cmd.add_flag_callback("-q,--quiet",
+                [&]() {
+                    sout_verbosity = wt::verbosity_e::quiet;
+                    should_print_stats_to_stdout_on_exit = false;
+                },
+                "suppresses debug/info output (log level = quiet)")
+            ->group("verbosity");
+        auto opt_vv = 
+            cmd.add_flag_callback("-v,--verbose",
+                [&]() {
+                    sout_verbosity = wt::verbosity_e::info;
+                },
+                "additional informational output (log level = info)")
+            ->group("verbosity");
+        auto opt_cout_level = 
+            cmd.add_option_function<std::string>("--verbosity",
+                [&](const auto& v) {
+                    const auto val = wt::format::parse_enum<wt::verbosity_e>(v);
+                    if (!val)
+                        throw CLI::ParseError("verbosity parsing failed", CLI::ExitCodes::ConversionError);
+                    sout_verbosity = *val;
+                },
+                "sets verbosity level of standard output logging")
+            ->option_text("<quiet/important/normal/info/debug>")
+            ->default_val("normal")
+            ->group("verbosity");
+        cmd.add_flag("--no-progress", no_progress_bars,
+                     "suppresses progress bars")
+            ->capture_default_str()
+            ->group("verbosity");
+
+        opt_q->excludes(opt_vv);
+        opt_cout_level->excludes(opt_q);
+        opt_cout_level->excludes(opt_vv);
+
+        // preview
+        cmd.add_flag("--tev{" + default_tev_host_port + "}", preview_tev_host_port_str,
+                     "connect to a tev instance to display rendering preview (hostname:port)")
+            ->group("preview interface");
+    };
+    const auto start_cli_render = [&]() {
         initialize_renderer(scene_path, output_dir_path, scene_data_path,
                 cpu_threadpool_size);
 
@@ -939,6 +1100,12 @@ int main(int argc, char* argv[]) {
         
         // print version
         wt::wt_version_t{}.print_wt_version();
+    };
+
+    add_cli_render_options(cli_render);
+    
+    cli_render.callback([&]() {
+        start_cli_render();
 
         // render
         const auto scene_loader_defines = parse_defines(std::move(defines));
@@ -948,6 +1115,125 @@ int main(int argc, char* argv[]) {
     });
 
 
+    /* "render-frames" cli subcommand
+     */
+
+    auto &cli_render_frames = *cli.add_subcommand("render-frames", "Render a sequence of frames of an animated scene")
+        ->ignore_case("true");
+    cli_render_frames.add_subcommand(render_opt);
+    CLI::TriggerOff(&cli_render_frames, &cli_version);
+    CLI::TriggerOff(&cli_render_frames, &cli_render);
+
+    std::filesystem::path animation_path;
+    wt::ads::construction::bvh8w_refit_t::opts_t refit_opts;
+    cli_render_frames.add_option("-a,--animation", animation_path,
+                                 "per-shape keyframe file: lines of \"<frame> <shape id> translate <x,y,z>\" or \"<frame> <shape id> rotate <axis> <angle>\"")
+        ->required()
+        ->option_text("PATH")
+        ->check(CLI::ExistingFile);
+    cli_render_frames.add_option("--rebuild-threshold", refit_opts.rebuild_sah_ratio,
+                                 "rebuild the ADS (instead of refitting it) once its SAH cost grows by this factor")
+        ->capture_default_str()
+        ->check(CLI::PositiveNumber)
+        ->group("renderer fine tuning");
+
+    add_cli_render_options(cli_render_frames);
+
+    cli_render_frames.callback([&]() {
+        start_cli_render();
+
+        // render
+        const auto scene_loader_defines = parse_defines(std::move(defines));
+        render_frames(scene_path,
+                      animation_path,
+                      scene_loader_defines,
+                      refit_opts,
+                      preview_tev_host_port_str);
+    });
+
+
+    /* "selftest" cli subcommand
+     */
+
+    auto &cli_selftest = *cli.add_subcommand("selftest", "Validate optimized code paths against reference implementations; exits with an error if any check fails")
+        ->ignore_case("true");
+    CLI::TriggerOff(&cli_selftest, &cli_version);
+    CLI::TriggerOff(&cli_selftest, &cli_render);
+    CLI::TriggerOff(&cli_selftest, &cli_render_frames);
+
+    std::optional<std::filesystem::path> selftest_scene_path;
+    std::uint64_t selftest_seed = 0x5eed;
+    bool checks_failed = false;
+    cli_selftest.add_option("scene_file", selftest_scene_path,
+                            "scene file: also validates the scene's ADS")
+        ->option_text("PATH")
+        ->check(CLI::ExistingFile);
+    cli_selftest.add_option("--seed", selftest_seed,
+                            "seed of the random inputs of the checks")
+        ->capture_default_str();
+    cli_selftest.add_option("-p,--threads", cpu_threadpool_size,
+                            "number of parallel threads to use for scene loading (defaults to hardware concurrency)");
+
+    cli_selftest.callback([&]() {
+        auto results = wt::validation::run_kernel_checks(selftest_seed);
+
+        if (selftest_scene_path) {
+            initialize_renderer(*selftest_scene_path, std::nullopt, std::nullopt,
+                                cpu_threadpool_size);
+            load_scene(*selftest_scene_path, {});
+
+            auto ads_results = wt::validation::run_ads_checks(*ads, selftest_seed);
+            results.insert(results.end(), 
+                           std::make_move_iterator(ads_results.begin()), std::make_move_iterator(ads_results.end()));
+        }
+
+        checks_failed = !print_check_results(results);
+    });
+
+
+    /* "bench" cli subcommand
+     */
+
+    auto &cli_bench = *cli.add_subcommand("bench", "Time optimized code paths against reference implementations (single threaded)")
+        ->ignore_case("true");
+    CLI::TriggerOff(&cli_bench, &cli_version);
+    CLI::TriggerOff(&cli_bench, &cli_render);
+    CLI::TriggerOff(&cli_bench, &cli_render_frames);
+    CLI::TriggerOff(&cli_bench, &cli_selftest);
+
+    std::optional<std::filesystem::path> bench_scene_path;
+    std::uint64_t bench_seed = 0x5eed;
+    cli_bench.add_option("scene_file", bench_scene_path,
+                         "scene file: also times construction and queries of the scene's ADS")
+        ->option_text("PATH")
+        ->check(CLI::ExistingFile);
+    cli_bench.add_option("--seed", bench_seed,
+                         "seed of the random inputs of the benchmarks")
+        ->capture_default_str();
+    cli_bench.add_option("-p,--threads", cpu_threadpool_size,
+                         "number of parallel threads to use for scene loading (defaults to hardware concurrency)");
+    float bench_spatial_split_budget = .3f;
+    cli_bench.add_option("--ads-spatial-splits", bench_spatial_split_budget,
+                         "spatial-split (SBVH) budget of the ADS benchmarked against plain SAH construction. 0 benchmarks plain SAH only")
+        ->capture_default_str()
+        ->check(CLI::NonNegativeNumber)
+        ->option_text("FRACTION");
+
+    cli_bench.callback([&]() {
+        print_timings(wt::validation::run_kernel_benchmarks(bench_seed));
+
+        if (bench_scene_path) {
+            initialize_renderer(*bench_scene_path, std::nullopt, std::nullopt,
+                                cpu_threadpool_size);
+            load_scene(*bench_scene_path, {});
+
+            print_timings(wt::validation::run_ads_benchmarks(scene->shapes(), context,
+                                                             bench_spatial_split_budget,
+                                                             bench_seed));
+        }
+    });
+
+
 #ifdef GUI
     /* "renderui" cli subcommand
      */
@@ -958,6 +1244,9 @@ int main(int argc, char* argv[]) {
 
     CLI::TriggerOff(&cli_renderui, &cli_version);
     CLI::TriggerOff(&cli_renderui, &cli_render);
+    CLI::TriggerOff(&cli_renderui, &cli_render_frames);
+    CLI::TriggerOff(&cli_renderui, &cli_selftest);
+    CLI::TriggerOff(&cli_renderui, &cli_bench);
 
     cli_renderui.callback([&]() {
         initialize_renderer(scene_path, output_dir_path, scene_data_path,
@@ -981,5 +1270,5 @@ int main(int argc, char* argv[]) {
     }
 
 
-    return terminate_program ? -1 : 0;
+    return terminate_program || checks_failed ? -1 : 0;
 }
@@ -9,6 +9,8 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <cstring>
 
 #include <cassert>
 
@@ -22,126 +24,121 @@
 
 #include <wt/scene/element/attributes.hpp>
 
-#include <wt/math/glm.hpp>
-#include <glm/gtx/hash.hpp>
+#include <wt/util/hash.hpp>
 
 using namespace wt;
 using namespace wt::mesh;
 
 
-inline auto tris_from_indices(const std::string& shape_id,
-                              const transform_d_t& to_world,
-                              std::vector<pqvec3_t> vertices,
-                              std::vector<dir3_t> normals,
-                              std::vector<vec2_t> texcoords,
-                              const std::vector<mesh_t::tri_indices_t>& indices) {
-    std::vector<triangle_t> tris;
-    tris.reserve(indices.size());
-
-    for (const auto& ind : indices) {
-        // transform vertices using doubles
-        auto a = to_world((pqvec3d_t)vertices[ind.idx[0]], transform_point);
-        auto b = to_world((pqvec3d_t)vertices[ind.idx[1]], transform_point);
-        auto c = to_world((pqvec3d_t)vertices[ind.idx[2]], transform_point);
-
-        // texcoords
-        std::optional<std::array<vec2_t, 3>> uvs;
-        if (!texcoords.empty()) {
-            uvs = { texcoords[ind.idx[0]],texcoords[ind.idx[1]],texcoords[ind.idx[2]] };
-            assert(m::isfinite((*uvs)[0]) && m::isfinite((*uvs)[1]) && m::isfinite((*uvs)[2]));
+namespace {
+
+struct vertex_key_t {
+    pqvec3_t p;
+    vec3_t n;
+    vec2_t uv;
+
+    inline bool operator==(const vertex_key_t& o) const noexcept {
+        return std::memcmp(this, &o, sizeof(vertex_key_t))==0;
+    }
+};
+struct vertex_key_hash_t {
+    inline std::size_t operator()(const vertex_key_t& k) const noexcept {
+        hash64_t h;
+        h.update(k);
+        return (std::size_t)h.digest();
+    }
+};
+
+}
+
+mesh_t::mesh_t(const std::string& shape_id,
+               const transform_d_t& to_world,
+               std::vector<pqvec3_t> in_vertices,
+               std::vector<dir3_t> in_normals,
+               std::vector<vec2_t> in_texcoords,
+               const std::vector<tri_indices_t>& in_indices,
+               const wt_context_t& ctx) 
+    : aabb(aabb_t::null())
+{
+    const bool with_normals = !in_normals.empty();
+    const bool with_uvs = !in_texcoords.empty();
+
+    // transform vertices and normals once (using doubles), and weld identical vertices
+    std::unordered_map<vertex_key_t, tidx_t, vertex_key_hash_t> welded;
+    welded.reserve(in_vertices.size());
+    std::vector<tidx_t> remap(in_vertices.size(), limits<tidx_t>::max());
+
+    const auto vertex = [&](tidx_t i) {
+        if (remap[i]!=limits<tidx_t>::max())
+            return remap[i];
+
+        const auto p = (pqvec3_t)to_world((pqvec3d_t)in_vertices[i], transform_point);
+        // renormalize in double precision and transform
+        const auto n = with_normals ? 
+            vec3_t{ (dir3_t)to_world(m::normalize((vec3d_t)in_normals[i])) } :
+            vec3_t{ 0,0,0 };
+        const auto uv = with_uvs ? in_texcoords[i] : vec2_t{ 0,0 };
+        assert(m::isfinite(uv));
+
+        auto key = vertex_key_t{};
+        key.p = p;
+        key.n = n;
+        key.uv = uv;
+        const auto [it, inserted] = welded.emplace(key, (tidx_t)vertices.size());
+        if (inserted) {
+            vertices.emplace_back(p);
+            if (with_normals)
+                normals.emplace_back(encoded_normal_t{ dir3_t{ n } });
+            if (with_uvs)
+                texcoords.emplace_back(uv);
         }
 
+        return remap[i] = it->second;
+    };
+
+    indices.reserve(in_indices.size());
+    for (const auto& ind : in_indices) {
+        auto t = tri_indices_t{ .idx={ vertex(ind.idx[0]), vertex(ind.idx[1]), vertex(ind.idx[2]) } };
+
         // compute geometric normal
-        const auto geo_n = util::tri_face_normal(a,b,c);
+        const auto geo_n = util::tri_face_normal(vertices[t.idx[0]], vertices[t.idx[1]], vertices[t.idx[2]]);
         if (!geo_n) {
             // skip degenerate triangles (0 area, no normal)
             continue;
         }
-        auto gn = (dir3_t)*geo_n;
-
-        std::array<encoded_normal_t, 3> ns;
-        if (!normals.empty()) {
-            // renormalize in double precision and transform
-            auto n1 = (dir3_t)to_world(m::normalize((vec3d_t)normals[ind.idx[0]]));
-            auto n2 = (dir3_t)to_world(m::normalize((vec3d_t)normals[ind.idx[1]]));
-            auto n3 = (dir3_t)to_world(m::normalize((vec3d_t)normals[ind.idx[2]]));
-
-            // flip winding order when normals are on other side of geometric normal
-            if (m::dot(n1,gn)<0 && m::dot(n2,gn)<0 && m::dot(n3,gn)<0) {
-                std::swap(a,b);
-                if (uvs)
-                    std::swap((*uvs)[0],(*uvs)[1]);
-                std::swap(n1,n2);
-                gn = -gn;
-            }
-
-            ns = { 
-                encoded_normal_t{ n1 },
-                encoded_normal_t{ n2 },
-                encoded_normal_t{ n3 }
-            };
-        }
-        else {
-            const auto enc_geo_n = encoded_normal_t{ gn };
-            ns = { enc_geo_n,enc_geo_n,enc_geo_n };
-        }
+        const auto gn = (dir3_t)*geo_n;
 
-        tris.emplace_back(triangle_t{
-            .p = { 
-                (pqvec3_t)a,
-                (pqvec3_t)b,
-                (pqvec3_t)c
-            },
-            .geo_n = gn,
-            .n = ns,
-            .uv = uvs,
-        });
+        // flip winding order when normals are on other side of geometric normal
+        if (with_normals &&
+            m::dot(dir3_t{ normals[t.idx[0]] },gn)<0 &&
+            m::dot(dir3_t{ normals[t.idx[1]] },gn)<0 &&
+            m::dot(dir3_t{ normals[t.idx[2]] },gn)<0)
+            std::swap(t.idx[0],t.idx[1]);
+
+        indices.emplace_back(t);
     }
 
-    return tris;
+    vertices.shrink_to_fit();
+    normals.shrink_to_fit();
+    texcoords.shrink_to_fit();
+    indices.shrink_to_fit();
+
+    compute_aabb();
 }
 
+void mesh_t::transform(const transform_d_t& t) noexcept {
+    for (auto& p : vertices)
+        p = (pqvec3_t)t((pqvec3d_t)p, transform_point);
+    for (auto& n : normals)
+        n = encoded_normal_t{ (dir3_t)t(m::normalize((vec3d_t)dir3_t{ n })) };
 
-mesh_t::mesh_t(std::vector<triangle_t> tris)
-    : tris(std::move(tris)),
-      aabb(aabb_t::null())
-{
     compute_aabb();
-    compute_tangent_frames();
 }
 
-mesh_t::mesh_t(const std::string& shape_id,
-               const transform_d_t& to_world,
-               std::vector<pqvec3_t> vertices,
-               std::vector<dir3_t> normals,
-               std::vector<vec2_t> texcoords,
-               const std::vector<tri_indices_t>& indices,
-               const wt_context_t& ctx) 
-    : mesh_t(tris_from_indices(
-                    shape_id, 
-                    to_world,
-                    std::move(vertices), 
-                    std::move(normals), 
-                    std::move(texcoords), 
-                    indices))
-{}
-
 void mesh_t::compute_aabb() noexcept {
     aabb = aabb_t::null();
-    for (const auto& t : tris)
-        aabb |= aabb_t::from_points(t.p[0],t.p[1],t.p[2]);
-}
-
-void mesh_t::compute_tangent_frames() noexcept {
-    for (auto& t : tris) {
-        const auto& p0  = t.p[0];
-        const auto& p1  = t.p[1];
-        const auto& p2  = t.p[2];
-        const auto& uv0 = !t.uv ? vec2_t{ 0,0 } : (*t.uv)[0];
-        const auto& uv1 = !t.uv ? vec2_t{ 0,0 } : (*t.uv)[1];
-        const auto& uv2 = !t.uv ? vec2_t{ 0,0 } : (*t.uv)[2];
-        t.tangent_frame = surface_differentials_for_triangle(p0, p1, p2, uv0, uv1, uv2);
-    }
+    for (const auto& t : indices)
+        aabb |= aabb_t::from_points(vertices[t.idx[0]],vertices[t.idx[1]],vertices[t.idx[2]]);
 }
 
 
@@ -152,7 +149,8 @@ scene::element::info_t mesh_t::description() const {
         .cls = "mesh",
         .type = "mesh",
         .attribs = {
-            { "triangles", attributes::make_scalar(tris.size()) },
+            { "triangles", attributes::make_scalar(indices.size()) },
+            { "vertices",  attributes::make_scalar(vertices.size()) },
         }
     };
 }
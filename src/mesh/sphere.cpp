@@ -29,7 +29,6 @@ mesh_t sphere_t::create(const std::string& shape_id,
 
     // start with an icosahedron
     const auto icosahedron = icosahedron_t::create("temp", ctx, vec3_t{ 0,0,0 }*u::m, 1*u::m, {});
-    const auto& icstris = icosahedron.get_tris();
 
     // tessellate
     std::function<void(const pqvec3_t&, const pqvec3_t&, const pqvec3_t&, const vec2_t, const vec2_t, const vec2_t, int)> tessellate_and_add;
@@ -79,8 +78,10 @@ mesh_t sphere_t::create(const std::string& shape_id,
     };
 
     const auto recursion = (std::size_t)(m::max<f_t>(0,m::log2(f_t(tessellation)/3)) + f_t(.5));
-    for (const auto& t : icstris)
+    for (mesh_t::tidx_t tidx=0; tidx<icosahedron.triangles_count(); ++tidx) {
+        const auto t = icosahedron.triangle(tidx);
         tessellate_and_add(t.p[0], t.p[1], t.p[2], (*t.uv)[0], (*t.uv)[1], (*t.uv)[2], recursion);
+    }
 
     return {
         shape_id,
@@ -0,0 +1,119 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <string>
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <wt/scene/animation.hpp>
+
+#include <wt/util/format/parse.hpp>
+#include <wt/util/format/parse_quantity.hpp>
+#include <wt/util/format/utils.hpp>
+
+using namespace wt;
+using namespace wt::scene;
+
+
+animation_t::animation_t(const std::filesystem::path& path, const scene_t& scene) {
+    using R = transform_d_t;
+
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("(animation) could not open \"" + path.string() + "\"");
+
+    std::unordered_map<std::string, std::uint32_t> shape_ids;
+    for (std::uint32_t s=0; s<scene.shapes().size(); ++s) {
+        const auto& id = scene.shapes()[s]->get_id();
+        if (!id.empty())
+            shape_ids.emplace(id, s);
+    }
+
+    std::string line;
+    for (std::size_t line_no=1; std::getline(f, line); ++line_no) {
+        line = format::trim(line);
+        if (line.empty() || line.front()=='#')
+            continue;
+
+        const auto error = [&](const std::string& what) {
+            return std::runtime_error("(animation) " + path.string() + ":" + std::to_string(line_no) + ": " + what);
+        };
+
+        std::istringstream ss{ line };
+        std::size_t frame;
+        std::string shape_id, op;
+        if (!(ss >> frame >> shape_id >> op))
+            throw error("malformed line");
+
+        const auto sit = shape_ids.find(shape_id);
+        if (sit==shape_ids.end())
+            throw error("unknown shape \"" + shape_id + "\"");
+        const auto shape_idx = sit->second;
+
+        R t;
+        try {
+            if (op=="translate") {
+                std::string v;
+                ss >> v;
+                t = R::translate(parse_pqvec3<double>(v));
+            } else if (op=="rotate") {
+                std::string axis, angle;
+                ss >> axis >> angle;
+                t = R::rotate(m::normalize(parse_vec3<double>(axis)), stoq_strict<R::angle_type>(angle));
+            } else
+                throw error("unknown operation \"" + op + "\"");
+        } catch(const std::format_error& exp) {
+            throw error(exp.what());
+        }
+
+        if (frames.size()<=frame)
+            frames.resize(frame+1);
+
+        // compose with operations listed earlier for this frame and shape
+        auto& ft = frames[frame];
+        auto it = std::ranges::find(ft, shape_idx, &shape_transform_t::shape_idx);
+        if (it==ft.end())
+            ft.emplace_back(shape_transform_t{ .shape_idx=shape_idx, .transform=t });
+        else
+            it->transform = t * it->transform;
+
+        if (!rest_meshes.contains(shape_idx)) {
+            rest_meshes.emplace(shape_idx, scene.shapes()[shape_idx]->get_mesh());
+            current.emplace(shape_idx, R{});
+        }
+    }
+
+    if (frames.empty())
+        throw std::runtime_error("(animation) no frames in \"" + path.string() + "\"");
+}
+
+std::vector<std::uint32_t> animation_t::apply(std::size_t frame, const scene_t& scene) {
+    assert(frame<frames.size());
+
+    std::vector<std::uint32_t> changed;
+    for (const auto& st : frames[frame]) {
+        auto& t = current.at(st.shape_idx);
+        if (t==st.transform)
+            continue;
+        t = st.transform;
+
+        auto mesh = rest_meshes.at(st.shape_idx);
+        mesh.transform(t);
+        scene.shapes()[st.shape_idx]->set_mesh(std::move(mesh));
+
+        changed.emplace_back(st.shape_idx);
+    }
+
+    return changed;
+}
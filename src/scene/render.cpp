@@ -19,6 +19,7 @@
 #include <wt/scene/scene_renderer.hpp>
 #include <wt/scene/scene.hpp>
 #include <wt/util/thread_pool/tpool.hpp>
+#include <wt/ads/intersection_scratch.hpp>
 
 #include <wt/util/logger/logger.hpp>
 
@@ -102,13 +103,10 @@ struct block_renderer_t {
                     const sensor::block_handle_t& block,
                     const std::size_t samples_per_block,
                     const std::size_t total_samples) {
-        for_range(vec3u32_t{ 0 }, block.size, [&](auto pos_in_block) {
-            // integrate
-            ctx.scene->integrator().integrate(ctx,
-                                              block, 
-                                              pos_in_block+block.position,
-                                              (std::uint32_t)samples_per_block);
-        });
+        // integrate
+        ctx.scene->integrator().integrate_block(ctx,
+                                                block,
+                                                (std::uint32_t)samples_per_block);
     }
 };
 
@@ -116,6 +114,8 @@ struct render_context_t {
     const sensor::sensor_t* sensor;
 
     std::unique_ptr<sensor::film_storage_handle_t> film_storage;
+    std::unique_ptr<ads::intersection_scratch_arena_t> ads_scratch;
+    std::unique_ptr<integrator::sample_arena_t> sample_arenas;
     integrator::integrator_context_t integrator_ctx;
 
     const std::size_t total_jobs;
@@ -136,7 +136,11 @@ struct render_context_t {
                      std::unique_ptr<sensor::film_storage_handle_t> film_storage) noexcept
         : sensor(sensor),
           film_storage(std::move(film_storage)),
-          integrator_ctx(&ctx, scene, &ads, sensor, this->film_storage.get()),
+          ads_scratch(std::make_unique<ads::intersection_scratch_arena_t>(
+              ctx.threadpool->create_worker_arena<ads::intersection_scratch_pool_t>())),
+          sample_arenas(std::make_unique<integrator::sample_arena_t>(
+              ctx.threadpool->create_worker_arena<bump_arena_t>())),
+          integrator_ctx(&ctx, scene, &ads, sensor, this->film_storage.get(), ads_scratch.get(), sample_arenas.get()),
           total_jobs(total_jobs),
           recp_total_jobs(f_t(1)/total_jobs),
           samples_per_block(samples_per_block),
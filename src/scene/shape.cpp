@@ -44,12 +44,12 @@ using namespace mesh;
 
 
 inline auto construct_triangle_surface_area_distribution(const mesh_t& mesh) {
-    assert(mesh.get_tris().size());
+    assert(mesh.triangles_count());
 
     std::vector<area_t> surface_areas;
-    surface_areas.resize(mesh.get_tris().size());
-    std::transform(mesh.get_tris().cbegin(), mesh.get_tris().cend(), surface_areas.begin(), 
-                   [&](const auto& tri) { return mesh_t::triangle_surface_area(tri); });
+    surface_areas.resize(mesh.triangles_count());
+    for (mesh_t::tidx_t tidx=0; tidx<mesh.triangles_count(); ++tidx)
+        surface_areas[tidx] = mesh.triangle_surface_area(tidx);
 
     const area_t surface_area = std::reduce(surface_areas.cbegin(), surface_areas.cend());
 
@@ -74,6 +74,11 @@ shape_t::shape_t(std::string id,
       sampling_data(construct_triangle_surface_area_distribution(this->mesh))
 {}
 
+void shape_t::set_mesh(mesh_t mesh) {
+    this->mesh = std::move(mesh);
+    sampling_data = construct_triangle_surface_area_distribution(this->mesh);
+}
+
 position_sample_t shape_t::sample_position(sampler::sampler_t& sampler) const noexcept {
     const auto r = sampler.r3();
 
@@ -133,7 +138,7 @@ std::shared_ptr<shape_t> shape_t::load(std::string id,
     auto mesh = load_mesh(node, id, to_world, context, consumed_attributes);
 
     // discard empty shapes
-    if (mesh.get_tris().empty()) {
+    if (mesh.triangles_count()==0) {
         wt::logger::cwarn(verbosity_e::important)
             << loader->node_description(node)
             << "(mesh) shape '" << id << "' contains no geometry and has been discarded." << '\n';
@@ -0,0 +1,98 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+// This translation unit is compiled for the baseline ISA (see CMakeLists.txt): it runs before the CPU is known to support the target ISA.
+// It must not use inline or template functions that other translation units may also instantiate (those may be compiled for the target ISA, and the linker keeps a single copy).
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <wt/util/cpu_features.hpp>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WT_CPUID_MSVC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define WT_CPUID_BUILTIN
+#endif
+
+using namespace wt;
+
+
+cpu_features_t cpu_features_t::detect() noexcept {
+    cpu_features_t ret;
+
+#if defined(WT_CPUID_BUILTIN)
+    __builtin_cpu_init();
+    ret.avx      = __builtin_cpu_supports("avx");
+    ret.avx2     = __builtin_cpu_supports("avx2");
+    ret.fma      = __builtin_cpu_supports("fma");
+    ret.bmi2     = __builtin_cpu_supports("bmi2");
+    ret.avx512f  = __builtin_cpu_supports("avx512f");
+    ret.avx512dq = __builtin_cpu_supports("avx512dq");
+    ret.avx512bw = __builtin_cpu_supports("avx512bw");
+    ret.avx512vl = __builtin_cpu_supports("avx512vl");
+    // not reported by older compilers' builtins: F16C requires AVX state, and is present on every AVX2 CPU
+    ret.f16c     = ret.avx2;
+#elif defined(WT_CPUID_MSVC)
+    int r[4];
+    __cpuid(r, 0);
+    const int max_leaf = r[0];
+
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] >> 27) & 1;
+    // OS saves the AVX (and AVX-512) register state?
+    const auto xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool os_avx    = (xcr0 & 0x6) == 0x6;
+    const bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+    ret.avx  = os_avx && ((r[2] >> 28) & 1);
+    ret.fma  = os_avx && ((r[2] >> 12) & 1);
+    ret.f16c = os_avx && ((r[2] >> 29) & 1);
+
+    if (max_leaf>=7) {
+        __cpuidex(r, 7, 0);
+        ret.avx2     = os_avx && ((r[1] >> 5) & 1);
+        ret.bmi2     = (r[1] >> 8) & 1;
+        ret.avx512f  = os_avx512 && ((r[1] >> 16) & 1);
+        ret.avx512dq = os_avx512 && ((r[1] >> 17) & 1);
+        ret.avx512bw = os_avx512 && ((r[1] >> 30) & 1);
+        ret.avx512vl = os_avx512 && ((r[1] >> 31) & 1);
+    }
+#endif
+
+    return ret;
+}
+
+
+#if defined(WT_CPUID_BUILTIN)
+
+// runs before other static initializers, which may already execute code compiled for the target ISA
+[[gnu::constructor(101)]] static void check_cpu_features_on_startup() noexcept {
+    const auto cpu = cpu_features_t::detect();
+    // (read directly: cpu_features_t::compiled() is compiled for the target ISA)
+    const auto& required = compiled_cpu_features;
+
+    bool missing = false;
+    for (const auto& f : cpu_feature_names) {
+        if (required.*f.feature && !(cpu.*f.feature)) {
+            if (!missing)
+                std::fputs("wave_tracer: this binary was compiled for instruction-set extensions that this CPU does not support:", stderr);
+            std::fputs(" ", stderr);
+            std::fputs(f.name, stderr);
+            missing = true;
+        }
+    }
+    if (missing) {
+        std::fputs("\nwave_tracer: rebuild with a lower TARGET_ARCH (e.g., -DTARGET_ARCH=x86-64-v3), or without SIMD_AVX.\n", stderr);
+        std::_Exit(EXIT_FAILURE);
+    }
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <stdexcept>
+
+#include <wt/util/cpu_features.hpp>
+
+using namespace wt;
+
+
+// constant-initialized: reading it on startup executes no code compiled for the target ISA
+constinit const cpu_features_t wt::compiled_cpu_features = {
+#ifdef __AVX__
+    .avx = true,
+#endif
+#ifdef __AVX2__
+    .avx2 = true,
+#endif
+#ifdef __FMA__
+    .fma = true,
+#endif
+#ifdef __F16C__
+    .f16c = true,
+#endif
+#ifdef __BMI2__
+    .bmi2 = true,
+#endif
+#ifdef __AVX512F__
+    .avx512f = true,
+#endif
+#ifdef __AVX512DQ__
+    .avx512dq = true,
+#endif
+#ifdef __AVX512BW__
+    .avx512bw = true,
+#endif
+#ifdef __AVX512VL__
+    .avx512vl = true,
+#endif
+};
+
+const cpu_features_t& cpu_features_t::compiled() noexcept {
+    return compiled_cpu_features;
+}
+
+int cpu_features_t::x86_64_level() const noexcept {
+    const bool v3 = avx && avx2 && fma && f16c && bmi2;
+    const bool v4 = v3 && avx512f && avx512dq && avx512bw && avx512vl;
+    return v4 ? 4 : v3 ? 3 : 0;
+}
+
+std::string cpu_features_t::missing(const cpu_features_t& required) const {
+    std::string ret;
+    for (const auto& f : cpu_feature_names) {
+        if (required.*f.feature && !(this->*f.feature))
+            ret += (ret.empty() ? "" : ",") + std::string{ f.name };
+    }
+    return ret;
+}
+
+std::string cpu_features_t::to_string() const {
+    std::string ret;
+    for (const auto& f : cpu_feature_names) {
+        if (this->*f.feature)
+            ret += (ret.empty() ? "" : ",") + std::string{ f.name };
+    }
+    return ret;
+}
+
+void wt::check_cpu_features() {
+    const auto missing = cpu_features_t::detect().missing(cpu_features_t::compiled());
+    if (!missing.empty())
+        throw std::runtime_error("This binary was compiled for instruction-set extensions that this CPU does not support (" + missing + "). Rebuild with a lower TARGET_ARCH, or without SIMD_AVX.");
+}
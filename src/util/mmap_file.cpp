@@ -0,0 +1,65 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <fstream>
+#include <stdexcept>
+
+#include <wt/util/mmap_file.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define WT_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace wt;
+
+
+mmap_file_t::mmap_file_t(const std::filesystem::path& path) {
+#ifdef WT_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd<0)
+        throw std::runtime_error("(mmap_file) could not open \"" + path.string() + "\"");
+
+    struct stat st;
+    if (::fstat(fd, &st)!=0 || st.st_size<=0) {
+        ::close(fd);
+        throw std::runtime_error("(mmap_file) could not stat \"" + path.string() + "\"");
+    }
+    length = (std::size_t)st.st_size;
+
+    void* p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p==MAP_FAILED)
+        throw std::runtime_error("(mmap_file) mmap failed for \"" + path.string() + "\"");
+
+    ptr = reinterpret_cast<const std::uint8_t*>(p);
+#else
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f)
+        throw std::runtime_error("(mmap_file) could not open \"" + path.string() + "\"");
+
+    length = (std::size_t)f.tellg();
+    f.seekg(0);
+    buffer = std::make_unique<std::uint8_t[]>(length);
+    if (!f.read(reinterpret_cast<char*>(buffer.get()), length))
+        throw std::runtime_error("(mmap_file) could not read \"" + path.string() + "\"");
+
+    ptr = buffer.get();
+#endif
+}
+
+mmap_file_t::~mmap_file_t() noexcept {
+#ifdef WT_HAS_MMAP
+    if (ptr)
+        ::munmap(const_cast<std::uint8_t*>(ptr), length);
+#endif
+}
@@ -0,0 +1,250 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <wt/validation/benchmark.hpp>
+#include <wt/ads/ads.hpp>
+#include <wt/ads/intersection_scratch.hpp>
+#include <wt/ads/bvh8w/bvh8w_constructor.hpp>
+
+#include <wt/sampler/sampler.hpp>
+#include <wt/math/common.hpp>
+#include <wt/math/shapes/elliptic_cone.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+volatile std::size_t sink;
+
+static constexpr std::size_t nearest_k = 8;
+// ball radii, relative to the scene's extent
+static constexpr f_t ball_radii[] = { 1e-3, 1e-2 };
+// cone apertures (tangent of the half-opening angle)
+static constexpr f_t cone_apertures[] = { 1e-4, 1e-3, 1e-2 };
+
+// query inputs, drawn once, and shared by all ADSs built over the same scene
+struct query_inputs_t {
+    std::vector<ray_t> rays;
+    std::vector<ads::ads_t::shadow_query_t> shadow_rays;
+    std::vector<ball_t> balls[std::size(ball_radii)];
+    // cones about the closest-hit rays, and cone shadow queries about the shadow rays
+    std::vector<elliptic_cone_t> cones[std::size(cone_apertures)];
+    std::vector<std::pair<elliptic_cone_t, pqrange_t<>>> shadow_cones[std::size(cone_apertures)];
+};
+
+query_inputs_t draw_query_inputs(const ads::ads_t& ads, std::uint64_t seed) {
+    static constexpr std::size_t ray_count = 1<<16;
+    static constexpr std::size_t ball_count = 1<<14;
+    static constexpr std::size_t cone_count = 1<<13;
+
+    query_inputs_t in;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U;
+    std::uniform_int_distribution<std::size_t> T{ 0, ads.triangles_count()-1 };
+
+    const auto& world = ads.V();
+    const auto extent = world.extent();
+    const auto scene_size = m::max_element(extent);
+
+    // uniformly distributed point on a random triangle
+    const auto point_on_triangle = [&]() {
+        const auto tri = ads.tri_geometry(ads::tuid_t{ (ads::idx_t)T(rng) });
+        auto b1 = U(rng), b2 = U(rng);
+        if (b1+b2>1) { b1 = 1-b1; b2 = 1-b2; }
+        return std::pair{ tri.a + (tri.b-tri.a)*b1 + (tri.c-tri.a)*b2, tri.n };
+    };
+
+    // closest-hit rays: origins within the scene bounds, uniform directions
+    in.rays.reserve(ray_count);
+    for (std::size_t i=0; i<ray_count; ++i) {
+        const auto o = pqvec3_t{ world.min.x + U(rng)*extent.x,
+                                 world.min.y + U(rng)*extent.y,
+                                 world.min.z + U(rng)*extent.z };
+        in.rays.emplace_back(o, sampler::sampler_t::uniform_sphere(vec2_t{ U(rng),U(rng) }));
+    }
+    // shadow rays: between points on surfaces
+    in.shadow_rays.reserve(ray_count);
+    for (std::size_t i=0; i<ray_count; ++i) {
+        const auto [p1,n1] = point_on_triangle();
+        const auto [p2,n2] = point_on_triangle();
+        const auto o = p1 + n1*(scene_size*f_t(1e-4));
+        const auto d = p2 - o;
+        const auto l = m::length(d);
+        if (!(l>zero)) continue;
+        in.shadow_rays.push_back({ .ray = ray_t{ o, dir3_t{ m::normalize(d) } },
+                                   .range = pqrange_t<>{ 0*u::m, l*f_t(1-1e-4) } });
+    }
+    // balls about surfaces
+    for (std::size_t r=0; r<std::size(ball_radii); ++r) {
+        in.balls[r].reserve(ball_count);
+        for (std::size_t i=0; i<ball_count; ++i)
+            in.balls[r].push_back(ball_t{ point_on_triangle().first, scene_size*ball_radii[r] });
+    }
+    // cones of a few apertures
+    for (std::size_t a=0; a<std::size(cone_apertures); ++a) {
+        in.cones[a].reserve(cone_count);
+        for (std::size_t i=0; i<cone_count && i<in.rays.size(); ++i)
+            in.cones[a].emplace_back(in.rays[i], cone_apertures[a]);
+        in.shadow_cones[a].reserve(cone_count);
+        for (std::size_t i=0; i<cone_count && i<in.shadow_rays.size(); ++i)
+            in.shadow_cones[a].emplace_back(elliptic_cone_t{ in.shadow_rays[i].ray, cone_apertures[a] },
+                                            in.shadow_rays[i].range);
+    }
+
+    return in;
+}
+
+std::vector<timing_t> time_queries(const ads::ads_t& ads, const query_inputs_t& in, const std::string& prefix) {
+    auto scratch = ads::intersection_scratch_t{};
+    std::vector<timing_t> ret;
+
+    {
+        std::size_t hits = 0;
+        const auto t = time_per_op(in.rays.size(), [&]() {
+            hits = 0;
+            for (const auto& ray : in.rays)
+                hits += ads.intersect(ray).empty() ? 0 : 1;
+            sink = hits;
+        });
+        ret.push_back({ prefix + "ray closest hit", t, std::format("{} rays, {} hits", in.rays.size(), hits) });
+    }
+    {
+        std::size_t occluded = 0;
+        const auto t = time_per_op(in.shadow_rays.size(), [&]() {
+            occluded = 0;
+            for (const auto& q : in.shadow_rays)
+                occluded += ads.shadow(q.ray, q.range) ? 1 : 0;
+            sink = occluded;
+        });
+        ret.push_back({ prefix + "ray shadow", t, std::format("{} rays, {} occluded", in.shadow_rays.size(), occluded) });
+    }
+
+    for (std::size_t a=0; a<std::size(cone_apertures); ++a) {
+        const auto aperture = std::format("aperture {:.0e}", (double)cone_apertures[a]);
+
+        const auto& cs = in.cones[a];
+        std::size_t tris = 0, edges = 0;
+        const auto t_intersect = time_per_op(cs.size(), [&]() {
+            tris = edges = 0;
+            for (const auto& c : cs) {
+                const auto record = ads.intersect(c, scratch);
+                if (record.empty()) continue;
+                tris += (std::size_t)record.triangles().size();
+                edges += record.edges().size();
+            }
+            sink = tris+edges;
+        });
+        ret.push_back({ prefix + "cone intersect (" + aperture + ")", t_intersect,
+                        std::format("{} cones, {:.1f} triangles and {:.1f} edges per cone",
+                                    cs.size(), double(tris)/cs.size(), double(edges)/cs.size()) });
+
+        const auto& ss = in.shadow_cones[a];
+        std::size_t occluded = 0;
+        const auto t_shadow = time_per_op(ss.size(), [&]() {
+            occluded = 0;
+            for (const auto& [c,range] : ss)
+                occluded += ads.shadow(c, range) ? 1 : 0;
+            sink = occluded;
+        });
+        ret.push_back({ prefix + "cone shadow (" + aperture + ")", t_shadow,
+                        std::format("{} cones, {} occluded", ss.size(), occluded) });
+    }
+
+    for (std::size_t r=0; r<std::size(ball_radii); ++r) {
+        const auto& bs = in.balls[r];
+        const auto radius = std::format("radius {:.0e} x scene", (double)ball_radii[r]);
+
+        std::size_t hits = 0;
+        const auto t_test = time_per_op(bs.size(), [&]() {
+            hits = 0;
+            for (const auto& b : bs)
+                hits += ads.test(b) ? 1 : 0;
+            sink = hits;
+        });
+        ret.push_back({ prefix + "ball test (" + radius + ")", t_test, std::format("{} balls, {} hits", bs.size(), hits) });
+
+        std::size_t tris = 0;
+        const auto t_intersect = time_per_op(bs.size(), [&]() {
+            tris = 0;
+            for (const auto& b : bs)
+                tris += (std::size_t)ads.intersect(b, scratch).triangles().size();
+            sink = tris;
+        });
+        ret.push_back({ prefix + "ball intersect (" + radius + ")", t_intersect,
+                        std::format("{} balls, {:.1f} triangles per ball", bs.size(), double(tris)/bs.size()) });
+
+        std::size_t edges = 0;
+        const auto t_nearest = time_per_op(bs.size(), [&]() {
+            edges = 0;
+            for (const auto& b : bs)
+                edges += ads.nearest_edges(b, nearest_k, scratch).size();
+            sink = edges;
+        });
+        ret.push_back({ prefix + std::format("{} nearest edges ({})", nearest_k, radius), t_nearest,
+                        std::format("{} balls, {:.1f} edges per ball", bs.size(), double(edges)/bs.size()) });
+    }
+
+    return ret;
+}
+
+}
+
+std::vector<timing_t> wt::validation::bench_ads_configurations(const std::vector<std::shared_ptr<shape_t>>& shapes,
+                                                               const wt_context_t& context,
+                                                               std::span<const ads_configuration_t> configurations,
+                                                               std::uint64_t seed) {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<timing_t> ret;
+    std::optional<query_inputs_t> inputs;
+    for (const auto& cfg : configurations) {
+        auto ctx = context;
+        // always build
+        ctx.ads_cache_path.clear();
+        ctx.ads_spatial_split_budget = cfg.spatial_split_budget;
+        ctx.ads_node_width = cfg.node_width;
+
+        const auto start = clock::now();
+        const auto bvh = ads::construction::bvh8w_constructor_t{ shapes, ctx }.get();
+        const auto build_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        if (bvh->triangles_count()==0)
+            return {};
+        if (!inputs)
+            inputs = draw_query_inputs(*bvh, seed);
+
+        const auto prefix = "[" + cfg.name + "] ";
+        const auto tris = bvh->triangles_count();
+        ret.push_back({
+            prefix + "build", build_ns / double(tris),
+            std::format("per triangle reference, {:.1f} ms total (thread pool); {} triangle references{}; {} nodes{}; {:.2f} MiB",
+                        build_ns*1e-6, tris,
+                        bvh->has_duplicate_triangles() ? " (incl. spatial-split duplicates)" : "",
+                        bvh->nodes_count(),
+                        cfg.node_width==16 ? " (8-wide, collapsed into 16-wide nodes)" : "",
+                        double(bvh->memory_bytes())/(1024*1024))
+        });
+
+        auto timings = time_queries(*bvh, *inputs, prefix);
+        ret.insert(ret.end(), std::make_move_iterator(timings.begin()), std::make_move_iterator(timings.end()));
+    }
+
+    return ret;
+}
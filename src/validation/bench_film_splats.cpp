@@ -0,0 +1,135 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <format>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <wt/validation/benchmark.hpp>
+#include <wt/sensor/film/film.hpp>
+#include <wt/sensor/film/rfilter_table.hpp>
+#include <wt/sensor/response/monochromatic.hpp>
+#include <wt/spectrum/uniform.hpp>
+
+#include <wt/math/common.hpp>
+#include <wt/math/distribution/gaussian1d.hpp>
+#include <wt/util/for_range.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+// results are accumulated into a sink, so that the timed loops are not elided
+volatile f_t sink;
+
+// the reconstruction filter weights as evaluated per splat before tabulation: the filter integrated over each element footprint, and their products
+f_t erf_rfilter_weights(const gaussian1d_t& rfilter, int r, const vec2_t& o,
+                        std::vector<f_t>& rows, std::vector<f_t>& weights) noexcept {
+    const auto W = 2*r+1;
+    rows.resize(2*W);
+    weights.clear();
+
+    for (auto d=0;d<2;++d)
+    for (auto x=-r;x<=r;++x)
+        rows[x+r + d*W] = rfilter.integrate(range_t{ x+o[d]-f_t(.5), x+o[d]+f_t(.5) });
+
+    f_t tw = 0;
+    for_range(vec2i32_t{ -r }, vec2i32_t{ r+1 }, [&](auto ridx) {
+        const auto w = m::max<f_t>(0, rows[ridx[0]+r] * rows[ridx[1]+r + W]);
+        tw += w;
+        weights.push_back(w);
+    });
+
+    return tw>0 ? f_t(1)/tw : 0;
+}
+
+}
+
+std::vector<timing_t> wt::validation::bench_film_splats(std::uint64_t seed) {
+    using film_t = sensor::film_t<2, false>;
+
+    static constexpr std::size_t count = 1<<12;
+    static constexpr std::size_t passes = 16;
+    static constexpr f_t stddevs[] = { .25, 1, 2 };
+
+    const wt_context_t context{};
+    const auto film_size = film_t::size_t{ 256 };
+    const auto block_size = film_t::size_t{ context.renderer_block_size };
+    const auto flags = sensor::sensor_write_flags_e::writes_block_splats;
+
+    const auto response = std::make_shared<sensor::response::monochromatic_t>(
+        "bench", nullptr, std::make_shared<spectrum::uniform_t>("bench", f_t(1)));
+    const auto k = wavelen_to_wavenum(f_t(550) * u::nm);
+
+    // random samples within the first block
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U{ 0,1 };
+    std::uniform_int_distribution<std::uint32_t> E{ 0, context.renderer_block_size-1 };
+
+    std::vector<sensor::sensor_element_sample_t> elements(count);
+    std::vector<radiant_flux_stokes_t> samples(count);
+    for (std::size_t i=0; i<count; ++i) {
+        elements[i] = sensor::sensor_element_sample_t{
+            .element = vec3u32_t{ E(rng), E(rng), 0 },
+            .offset  = vec3_t{ U(rng)-f_t(.5), U(rng)-f_t(.5), 0 },
+        };
+        samples[i] = radiant_flux_stokes_t::unpolarized(U(rng) * u::W);
+    }
+
+    constexpr auto ops = count*passes;
+    std::vector<timing_t> timings;
+    for (const auto stddev : stddevs) {
+        film_t film{ context, film_size, response, stddev, block_size, {} };
+        auto block = film.acquire_film_block(film_t::size_t{ 0 }, flags);
+
+        const auto splat = time_per_op(ops, [&]() {
+            for (std::size_t p=0; p<passes; ++p)
+            for (std::size_t i=0; i<count; ++i)
+                film.splat(block, elements[i], samples[i], k);
+        });
+
+        // the filter weights alone: interpolated from the table, and integrated per splat
+        const sensor::rfilter_table_t table{ stddev };
+        const gaussian1d_t rfilter{ stddev };
+        const auto r = (int)table.radius();
+        std::vector<f_t> rows, weights;
+        const auto tabulated = time_per_op(ops, [&]() {
+            f_t acc = 0;
+            for (std::size_t p=0; p<passes; ++p)
+            for (std::size_t i=0; i<count; ++i) {
+                const auto w = table.weights<2>(vec2_t{ elements[i].offset });
+                acc += (*w.weights)[0] * w.recp_total_weight;
+            }
+            sink = acc;
+        });
+        const auto integrated = time_per_op(ops, [&]() {
+            f_t acc = 0;
+            for (std::size_t p=0; p<passes; ++p)
+            for (std::size_t i=0; i<count; ++i) {
+                const auto recp_tw = erf_rfilter_weights(rfilter, r, vec2_t{ elements[i].offset }, rows, weights);
+                acc += weights[0] * recp_tw;
+            }
+            sink = acc;
+        });
+
+        film.release_film_block(std::move(block), flags);
+
+        timings.push_back({
+            std::format("film block splat (rfilter stddev {}, {}x{} elements)", stddev, 2*r+1, 2*r+1),
+            splat,
+            std::format("filter weights: tabulated ({} offsets) {:.2f} ns/op, integrated per splat {:.2f} ns/op, speed-up {:.2f}x",
+                        table.offset_count(), tabulated, integrated, integrated/tabulated)
+        });
+    }
+
+    return timings;
+}
@@ -0,0 +1,111 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <format>
+#include <random>
+#include <vector>
+
+#include <wt/validation/benchmark.hpp>
+#include <wt/interaction/polarimetric/mueller_kernels.hpp>
+#include <wt/interaction/polarimetric/mueller.hpp>
+
+#include <wt/math/common.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+// results are accumulated into a sink, so that the timed loops are not elided
+volatile f_t sink;
+
+}
+
+std::vector<timing_t> wt::validation::bench_mueller_kernels(std::uint64_t seed) {
+    static constexpr std::size_t count = 1<<12;
+    static constexpr std::size_t passes = 64;
+    // Stokes vectors per batched apply (a spectral batch)
+    static constexpr std::size_t batch = 16;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U{ -1,1 };
+
+    const auto rand_vec = [&]() { return vec4_t{ U(rng),U(rng),U(rng),U(rng) }; };
+    std::vector<mat4_t> A(count), B(count);
+    std::vector<vec4_t> v(count*batch), out(batch);
+    std::vector<mueller_kernels::rotation_block_t> blks(count);
+    std::vector<mat4_t> R(count);
+    for (std::size_t i=0; i<count; ++i) {
+        A[i] = mat4_t{ rand_vec(),rand_vec(),rand_vec(),rand_vec() };
+        B[i] = mat4_t{ rand_vec(),rand_vec(),rand_vec(),rand_vec() };
+        const auto a1 = m::pi*U(rng)*u::ang::rad, a2 = m::pi*U(rng)*u::ang::rad;
+        blks[i] = mueller_operator_t::rotation_block(dir2_t{ vec2_t{ m::cos(a1),m::sin(a1) } },
+                                                     dir2_t{ vec2_t{ m::cos(a2),m::sin(a2) } });
+        R[i] = mueller_kernels::rotation_matrix(blks[i]);
+    }
+    for (auto& s : v) s = rand_vec();
+
+    constexpr auto ops = count*passes;
+    const auto time_mat = [&](auto&& f) {
+        return time_per_op(ops, [&]() {
+            f_t acc = 0;
+            for (std::size_t p=0; p<passes; ++p)
+            for (std::size_t i=0; i<count; ++i)
+                acc += f(i)[3][3];
+            sink = acc;
+        });
+    };
+    const auto time_vec = [&](auto&& f) {
+        return time_per_op(ops, [&]() {
+            f_t acc = 0;
+            for (std::size_t p=0; p<passes; ++p)
+            for (std::size_t i=0; i<count; ++i)
+                acc += f(i)[3];
+            sink = acc;
+        });
+    };
+    const auto time_batch = [&](auto&& f) {
+        return time_per_op(ops, [&]() {
+            f_t acc = 0;
+            for (std::size_t p=0; p<passes; ++p)
+            for (std::size_t i=0; i<count; ++i) {
+                f(i);
+                acc += out[batch-1][3];
+            }
+            sink = acc;
+        });
+    };
+
+    const auto mul      = time_mat([&](auto i) { return mueller_kernels::mul(A[i], B[i]); });
+    const auto mul_ref  = time_mat([&](auto i) { return A[i]*B[i]; });
+    const auto app      = time_vec([&](auto i) { return mueller_kernels::apply(A[i], v[i]); });
+    const auto app_ref  = time_vec([&](auto i) { return A[i]*v[i]; });
+    const auto bat      = time_batch([&](auto i) { mueller_kernels::apply(A[i], &v[i*batch], out.data(), batch); });
+    const auto bat_ref  = time_batch([&](auto i) {
+        for (std::size_t j=0; j<batch; ++j)
+            out[j] = A[i]*v[i*batch+j];
+    });
+    const auto rotr     = time_mat([&](auto i) { return mueller_kernels::mul_rotation_right(A[i], blks[i]); });
+    const auto rotr_ref = time_mat([&](auto i) { return A[i]*R[i]; });
+    const auto rotl     = time_mat([&](auto i) { return mueller_kernels::mul_rotation_left(blks[i], A[i]); });
+    const auto rotl_ref = time_mat([&](auto i) { return R[i]*A[i]; });
+
+    const auto details = [](double t, double ref, const std::string& ref_desc) {
+        return std::format("{}: {:.2f} ns/op, speed-up {:.2f}x", ref_desc, ref, ref/t);
+    };
+    return {
+        { "Mueller mul",                mul,  details(mul,  mul_ref,  "glm A*B") },
+        { "Mueller apply",              app,  details(app,  app_ref,  "glm M*v") },
+        { std::format("Mueller batched apply ({} vectors)", batch),
+                                        bat,  details(bat,  bat_ref,  "glm M*v loop") },
+        { "Mueller mul_rotation_right", rotr, details(rotr, rotr_ref, "glm M*R") },
+        { "Mueller mul_rotation_left",  rotl, details(rotl, rotl_ref, "glm R*M") },
+    };
+}
@@ -0,0 +1,266 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <cmath>
+#include <format>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include <wt/validation/validation.hpp>
+#include <wt/beam/footprint_integrator.hpp>
+
+#include <wt/sampler/sampler.hpp>
+#include <wt/math/common.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+// Gauss-Legendre quadrature on [0,1]
+struct gauss_legendre_t {
+    static constexpr int n = 10;
+    double x[n], w[n];
+
+    gauss_legendre_t() noexcept {
+        for (int i=0; i<n; ++i) {
+            // Newton iterations on the Legendre polynomial P_n
+            auto z = std::cos(std::numbers::pi * (i+.75) / (n+.5));
+            double dp = 1;
+            for (int it=0; it<100; ++it) {
+                double p0 = 1, p1 = z;
+                for (int k=2; k<=n; ++k) {
+                    const auto p2 = ((2*k-1)*z*p1 - (k-1)*p0) / k;
+                    p0 = p1;
+                    p1 = p2;
+                }
+                dp = n*(z*p1-p0) / (z*z-1);
+                const auto dz = p1/dp;
+                z -= dz;
+                if (std::abs(dz)<1e-15)
+                    break;
+            }
+            x[i] = (1-z)/2;
+            w[i] = 1 / ((1-z*z)*dp*dp);
+        }
+    }
+};
+
+/*
+ * Reference: integral of the standard 2D normal distribution over a triangle.
+ * Triangles are subdivided (midpoint subdivision) until their edges are shorter than 1 (a standard deviation), and each is integrated with a
+ * Duffy-collapsed tensor Gauss-Legendre rule. Subtriangles whose bounds do not overlap the square of half-size 10 about the mean are dropped
+ * (the mass beyond is below 1e-22).
+ */
+double normal_over_triangle(const gauss_legendre_t& gl,
+                            const vec2d_t& a, const vec2d_t& b, const vec2d_t& c,
+                            int depth = 0) noexcept {
+    static constexpr double window = 10;
+    static constexpr double max_edge = 1;
+    static constexpr int max_depth = 16;
+
+    const auto lo = m::min(a, m::min(b,c));
+    const auto hi = m::max(a, m::max(b,c));
+    if (lo.x>window || lo.y>window || hi.x<-window || hi.y<-window)
+        return 0;
+
+    const auto l2 = m::max(m::length2(b-a), m::max(m::length2(c-b), m::length2(a-c)));
+    if (l2>max_edge*max_edge && depth<max_depth) {
+        const auto ab = (a+b)/2., bc = (b+c)/2., ca = (c+a)/2.;
+        return normal_over_triangle(gl, a,ab,ca, depth+1) +
+               normal_over_triangle(gl, ab,b,bc, depth+1) +
+               normal_over_triangle(gl, ca,bc,c, depth+1) +
+               normal_over_triangle(gl, ab,bc,ca, depth+1);
+    }
+
+    // p(u,v) = a + u(b-a) + uv(c-b), with Jacobian u*|(b-a)x(c-b)|
+    const auto J = std::abs((b.x-a.x)*(c.y-b.y) - (b.y-a.y)*(c.x-b.x));
+    double I = 0;
+    for (int i=0; i<gauss_legendre_t::n; ++i)
+    for (int j=0; j<gauss_legendre_t::n; ++j) {
+        const auto u = gl.x[i], v = gl.x[j];
+        const auto p = a + u*(b-a) + (u*v)*(c-b);
+        I += gl.w[i]*gl.w[j] * u * std::exp(-(p.x*p.x+p.y*p.y)/2);
+    }
+    return I * J / (2*std::numbers::pi);
+}
+
+// clips a polygon (local beam frame) to z>=z0 (keep_above) or z<=z0
+std::vector<vec3d_t> clip_z(const std::vector<vec3d_t>& poly, double z0, bool keep_above) {
+    std::vector<vec3d_t> ret;
+    const auto inside = [&](const vec3d_t& p) { return keep_above ? p.z>=z0 : p.z<=z0; };
+    for (std::size_t i=0; i<poly.size(); ++i) {
+        const auto& p = poly[i];
+        const auto& q = poly[(i+1)%poly.size()];
+        if (inside(p))
+            ret.push_back(p);
+        if (inside(p)!=inside(q)) {
+            const auto t = (z0-p.z) / (q.z-p.z);
+            ret.push_back(p + t*(q-p));
+        }
+    }
+    return ret;
+}
+
+// reference footprint integral of a triangle (given in local beam frame, in metres), in double precision
+double reference_footprint(const gauss_legendre_t& gl,
+                           const vec3d_t& a, const vec3d_t& b, const vec3d_t& c,
+                           const elliptic_cone_t& envelope,
+                           const gaussian2d_t& dist,
+                           double zmin, double zmax) {
+    auto poly = clip_z({ a,b,c }, zmin, true);
+    poly = clip_z(poly, zmax, false);
+    if (poly.size()<3)
+        return 0;
+
+    // projection upon the cross section at the centre of the interaction region (as elliptic_cone_t::project_local()),
+    // followed by the transform to canonical space of the intensity distribution
+    const auto tan_alpha = (double)envelope.get_tan_alpha();
+    const auto x0 = (double)u::to_m(envelope.x0());
+    const auto csz = (zmin+zmax)/2;
+    const bool project = tan_alpha!=0 || x0!=0;
+
+    const auto mu = vec2d_t{ dist.mean() };
+    const auto R = dist.frame_mat();
+    const auto ex = vec2d_t{ R[0] }, ey = vec2d_t{ R[1] };
+    const auto rs = vec2d_t{ dist.recp_std_dev() };
+
+    std::vector<vec2d_t> cpoly;
+    for (const auto& p : poly) {
+        const auto s = project ? (tan_alpha*csz + x0) / std::abs(tan_alpha*p.z + x0) : 1.;
+        const auto q = vec2d_t{ p.x*s, p.y*s } - mu;
+        cpoly.emplace_back(m::dot(ex,q)*rs.x, m::dot(ey,q)*rs.y);
+    }
+
+    // the clipped polygon is convex: fan triangulate
+    double I = 0;
+    for (std::size_t i=1; i+1<cpoly.size(); ++i)
+        I += normal_over_triangle(gl, cpoly[0], cpoly[i], cpoly[i+1]);
+    return I;
+}
+
+}
+
+check_result_t wt::validation::check_footprint_integrator(std::uint64_t seed) {
+    static constexpr auto name = "beam footprint integrator";
+    static constexpr std::size_t trials = 1<<9;
+    // triangles per trial: more than a batch, so that full and partially-filled batches are exercised
+    static constexpr std::size_t tris_per_trial = beam::triangle_footprint_integrator_t::width + 3;
+    // absolute error bound of an integrated triangle (see triangle_footprint_integrator_t)
+    static constexpr double tol = 1e-4;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<double> U;
+
+    const auto gl = gauss_legendre_t{};
+
+    std::size_t failures = 0, batch_failures = 0, integrated = 0;
+    double max_err = 0, max_batch_err = 0, max_ref_err = 0;
+    std::vector<ads::tri_geometry_t> tris;
+    std::vector<double> refs;
+    for (std::size_t t=0; t<trials; ++t) {
+        // random beam
+        const auto dir = sampler::sampler_t::uniform_sphere(vec2_t{ (f_t)U(rng),(f_t)U(rng) });
+        const auto origin = pqvec3_t{ (f_t)(2*U(rng)-1)*u::m, (f_t)(2*U(rng)-1)*u::m, (f_t)(2*U(rng)-1)*u::m };
+        const auto frame = frame_t::build_orthogonal_frame(dir);
+        // every eighth beam is collimated
+        const auto tan_alpha = t%8==0 ? 0. : .05*U(rng);
+        const auto x0 = 1e-3 + 9e-3*U(rng);
+        const auto envelope = elliptic_cone_t{ ray_t{ origin, dir }, (f_t)tan_alpha, (f_t)x0*u::m };
+
+        // interaction region
+        const auto zc = .1 + 2*U(rng);
+        const auto hz = 1e-3 + .05*U(rng);
+        const auto z_range = pqrange_t<>{ (f_t)(zc-hz)*u::m, (f_t)(zc+hz)*u::m };
+        const auto zmin = (double)u::to_m(z_range.min), zmax = (double)u::to_m(z_range.max);
+
+        // intensity distribution on the cross section: the envelope is ~3 standard deviations
+        const auto w = tan_alpha*(zmin+zmax)/2 + x0;
+        const auto sigma = vec2_t{ (f_t)((.1+.23*U(rng))*w), (f_t)((.1+.23*U(rng))*w) };
+        const auto xa = m::two_pi * (f_t)U(rng) * u::ang::rad;
+        const auto mu = vec2_t{ (f_t)((U(rng)-.5)*w/2), (f_t)((U(rng)-.5)*w/2) };
+        const auto wavefront = beam::gaussian_wavefront_t{ gaussian2d_t{ sigma, dir2_t{ vec2_t{ m::cos(xa),m::sin(xa) } }, mu } };
+        const auto& dist = wavefront.intensity_distribution();
+
+        // random triangles about the beam, straddling the interaction region. A quarter spread far enough to be (partially) culled.
+        const auto max_sigma = (double)m::max_element(sigma);
+        tris.clear();
+        refs.clear();
+        for (std::size_t i=0; i<tris_per_trial; ++i) {
+            const auto spread = (i%4==0 ? 12. : 5.) * max_sigma;
+            vec3d_t v[3];
+            for (auto& p : v) {
+                p = vec3d_t{ mu.x + (2*U(rng)-1)*spread,
+                             mu.y + (2*U(rng)-1)*spread,
+                             zc + (2*U(rng)-1)*2*hz };
+            }
+            const auto world = [&](const vec3d_t& p) {
+                return origin + frame.to_world(pqvec3_t{ (f_t)p.x*u::m, (f_t)p.y*u::m, (f_t)p.z*u::m });
+            };
+            const auto tri = ads::tri_geometry_t{ .a = world(v[0]), .b = world(v[1]), .c = world(v[2]), .n = dir };
+
+            // reference, from the vertices as seen by the integrator (after the round trip through world space)
+            const auto local = [&](const pqvec3_t& p) {
+                const auto l = u::to_m(frame.to_local(p-origin));
+                return vec3d_t{ l.x, l.y, l.z };
+            };
+            const auto ref = reference_footprint(gl, local(tri.a), local(tri.b), local(tri.c),
+                                                 envelope, dist, zmin, zmax);
+            tris.emplace_back(tri);
+            refs.emplace_back(ref);
+
+            // single triangle
+            auto footprint = beam::triangle_footprint_integrator_t{ frame, envelope, wavefront, z_range };
+            footprint.add(tri);
+            const auto err = std::abs((double)footprint.integrate() - ref);
+            max_err = m::max(max_err, err);
+            if (!(err<=tol))
+                ++failures;
+            if (ref>0) ++integrated;
+
+            // for reference: error of the clip-project-integrate_triangle() path
+            const auto clipped = intersect::clip_triangle_z(frame.to_local(tri.a-origin),
+                                                            frame.to_local(tri.b-origin),
+                                                            frame.to_local(tri.c-origin),
+                                                            z_range);
+            double I = 0;
+            for (int j=0; j<clipped.tris; ++j) {
+                const auto ctri = clipped.triangle(j);
+                I += wavefront.integrate_triangle(envelope.project_local(ctri[0], z_range.centre()),
+                                                  envelope.project_local(ctri[1], z_range.centre()),
+                                                  envelope.project_local(ctri[2], z_range.centre()));
+            }
+            max_ref_err = m::max(max_ref_err, std::abs(I - ref));
+        }
+
+        // batched: all triangles of the trial through a single integrator
+        auto footprint = beam::triangle_footprint_integrator_t{ frame, envelope, wavefront, z_range };
+        double ref = 0;
+        for (std::size_t i=0; i<tris.size(); ++i) {
+            footprint.add(tris[i]);
+            ref += refs[i];
+        }
+        const auto err = std::abs((double)footprint.integrate() - ref);
+        max_batch_err = m::max(max_batch_err, err);
+        if (!(err<=tol*tris.size()))
+            ++batch_failures;
+    }
+
+    return {
+        name, failures==0 && batch_failures==0,
+        std::format("{} triangles ({} with non-zero footprints), {} batches; max error {:.2e} (tolerance {:.0e}), {} failures; "
+                    "batched max error {:.2e} (tolerance {:.0e}), {} failures; max error of integrate_triangle() {:.2e}",
+                    trials*tris_per_trial, integrated, trials,
+                    max_err, tol, failures,
+                    max_batch_err, tol*tris_per_trial, batch_failures,
+                    max_ref_err)
+    };
+}
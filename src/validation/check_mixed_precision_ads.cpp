@@ -0,0 +1,101 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <format>
+#include <random>
+
+#include <wt/validation/validation.hpp>
+#include <wt/ads/bvh8w/bvh8w.hpp>
+
+#include <wt/sampler/sampler.hpp>
+#include <wt/math/intersect/ray.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+#ifdef _MIXED_PRECISION_ADS
+
+check_result_t wt::validation::check_mixed_precision_ray_traversal(const ads::ads_t& ads, std::uint64_t seed) {
+    static constexpr auto name = "mixed-precision ray traversal";
+    static constexpr std::size_t ray_count = 1<<18;
+    // relative distance tolerance: both traversals test triangles in full precision, hence agree up to ties
+    static constexpr f_t rel_tol = 1e-9;
+
+    const auto* bvh = dynamic_cast<const ads::bvh8w_t*>(&ads);
+    if (!bvh)
+        return { name, false, "ADS is not a bvh8w" };
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U;
+
+    const auto& world = bvh->V();
+    const auto extent = world.extent();
+    const auto tol = rel_tol * m::max(m::max_element(extent), 1*u::m);
+
+    // distance to triangle tuid along ray, if intersected
+    const auto tri_dist = [&](const ray_t& ray, const ads::tuid_t tuid) {
+        const auto tri = bvh->tri_geometry(tuid);
+        const auto intr = intersect::intersect_ray_tri(ray, tri.a, tri.b, tri.c);
+        return intr ? intr->dist : limits<length_t>::infinity();
+    };
+
+    std::size_t hits = 0, ties = 0, mismatches = 0;
+    length_t max_dist_err = 0*u::m;
+    for (std::size_t i=0; i<ray_count; ++i) {
+        // origins within the scene bounds, uniform directions
+        const auto o = pqvec3_t{ world.min.x + U(rng)*extent.x,
+                                 world.min.y + U(rng)*extent.y,
+                                 world.min.z + U(rng)*extent.z };
+        const auto d = sampler::sampler_t::uniform_sphere(vec2_t{ U(rng),U(rng) });
+        const auto ray = ray_t{ o, d };
+
+        const auto mixed = bvh->intersect(ray);
+        const auto full  = bvh->intersect_full_precision(ray);
+
+        if (mixed.empty() != full.empty()) {
+            ++mismatches;
+            continue;
+        }
+        if (full.empty())
+            continue;
+        ++hits;
+
+        const auto tm = *mixed.triangles().begin();
+        const auto tf = *full.triangles().begin();
+        const auto err = m::abs(mixed.distance()-full.distance());
+        max_dist_err = m::max(max_dist_err, err);
+        if (err > tol) {
+            ++mismatches;
+            continue;
+        }
+        if (tm!=tf) {
+            // a tie: the ray hits both triangles at the same distance (e.g., on a shared edge)
+            if (m::abs(tri_dist(ray, tm)-tri_dist(ray, tf)) <= tol)
+                ++ties;
+            else
+                ++mismatches;
+        }
+    }
+
+    return {
+        name, mismatches==0,
+        std::format("{} rays, {} hits, {} ties, {} mismatches; max distance error {:.3e} m (tolerance {:.3e} m)",
+                    ray_count, hits, ties, mismatches,
+                    (double)u::to_m(max_dist_err), (double)u::to_m(tol))
+    };
+}
+
+#else
+
+check_result_t wt::validation::check_mixed_precision_ray_traversal(const ads::ads_t&, std::uint64_t) {
+    return { "mixed-precision ray traversal", true, "skipped: not a mixed-precision build (MIXED_PRECISION_ADS and DBL_PRECISION)" };
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <format>
+#include <random>
+#include <vector>
+
+#include <wt/validation/validation.hpp>
+#include <wt/interaction/polarimetric/mueller_kernels.hpp>
+#include <wt/interaction/polarimetric/mueller.hpp>
+
+#include <wt/math/common.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+struct error_t {
+    f_t max_err = 0;
+    std::size_t failures = 0;
+
+    // entries of the operands are in [-1,1], hence an entry of a product is a sum of at most 4 terms of magnitude at most 1:
+    // a different summation order (or FMA contraction) perturbs it by a few ulps of 1.
+    static constexpr f_t tol = 64 * limits<f_t>::epsilon();
+
+    void operator()(const f_t ref, const f_t val) noexcept {
+        const auto err = m::abs(ref-val) / (1+m::abs(ref));
+        max_err = m::max(max_err, err);
+        if (!(err<=tol))
+            ++failures;
+    }
+    void operator()(const vec4_t& ref, const vec4_t& val) noexcept {
+        for (int i=0; i<4; ++i)
+            (*this)(ref[i], val[i]);
+    }
+    void operator()(const mat4_t& ref, const mat4_t& val) noexcept {
+        for (int j=0; j<4; ++j)
+            (*this)(ref[j], val[j]);
+    }
+
+    [[nodiscard]] std::string str() const {
+        return std::format("{} failures, max error {:.2e}", failures, (double)max_err);
+    }
+};
+
+}
+
+check_result_t wt::validation::check_mueller_kernels(std::uint64_t seed) {
+    static constexpr auto name = "Mueller kernels";
+    static constexpr std::size_t count = 1<<14;
+    static constexpr std::size_t batch = 19;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U{ -1,1 };
+
+    const auto rand_vec = [&]() { return vec4_t{ U(rng),U(rng),U(rng),U(rng) }; };
+    const auto rand_mat = [&]() { return mat4_t{ rand_vec(),rand_vec(),rand_vec(),rand_vec() }; };
+    const auto rand_tangent = [&]() {
+        const auto a = m::pi * U(rng) * u::ang::rad;
+        return dir2_t{ vec2_t{ m::cos(a), m::sin(a) } };
+    };
+
+    error_t mul_err, apply_err, batch_err, rot_right_err, rot_left_err;
+    std::vector<vec4_t> in(batch), out(batch);
+    for (std::size_t i=0; i<count; ++i) {
+        const auto A = rand_mat();
+        const auto B = rand_mat();
+        const auto v = rand_vec();
+
+        mul_err(A*B, mueller_kernels::mul(A,B));
+        apply_err(A*v, mueller_kernels::apply(A,v));
+
+        // batched apply, out-of-place and in-place
+        for (auto& s : in) s = rand_vec();
+        mueller_kernels::apply(A, in.data(), out.data(), batch);
+        for (std::size_t j=0; j<batch; ++j)
+            batch_err(A*in[j], out[j]);
+        out = in;
+        mueller_kernels::apply(A, out.data(), out.data(), batch);
+        for (std::size_t j=0; j<batch; ++j)
+            batch_err(A*in[j], out[j]);
+
+        // rotation blocks, as constructed by mueller_operator_t, with and without a handness flip
+        auto blk = mueller_operator_t::rotation_block(rand_tangent(), rand_tangent());
+        blk.d = (i&1) ? -1 : 1;
+        const auto R = mueller_kernels::rotation_matrix(blk);
+        rot_right_err(A*R, mueller_kernels::mul_rotation_right(A, blk));
+        rot_left_err (R*A, mueller_kernels::mul_rotation_left(blk, A));
+    }
+
+    const auto passed = mul_err.failures==0 && apply_err.failures==0 && batch_err.failures==0 &&
+                        rot_right_err.failures==0 && rot_left_err.failures==0;
+    return {
+        name, passed,
+        std::format("{} random operators; mul: {}; apply: {}; batched apply: {}; mul_rotation_right: {}; mul_rotation_left: {} (relative tolerance {:.2e})",
+                    count,
+                    mul_err.str(), apply_err.str(), batch_err.str(), rot_right_err.str(), rot_left_err.str(),
+                    (double)error_t::tol)
+    };
+}
@@ -0,0 +1,107 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <cmath>
+#include <format>
+#include <random>
+#include <vector>
+
+#include <wt/validation/validation.hpp>
+#include <wt/sensor/film/rfilter_table.hpp>
+
+#include <wt/math/common.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+struct error_t {
+    double max_err = 0;
+    f_t max_err_stddev = 0;
+    std::size_t failures = 0;
+
+    // absolute error of a normalized weight: the table interpolation error (see rfilter_table_t), and the error function lookup table
+    static constexpr double tol = 1e-4;
+
+    void operator()(const double ref, const double val, const f_t stddev) noexcept {
+        const auto err = std::abs(ref-val);
+        if (err>max_err) {
+            max_err = err;
+            max_err_stddev = stddev;
+        }
+        if (!(err<=tol))
+            ++failures;
+    }
+
+    [[nodiscard]] std::string str() const {
+        return std::format("{} failures, max error {:.2e} (stddev {:.3f})", failures, max_err, (double)max_err_stddev);
+    }
+};
+
+// the filter integrated over the 2r+1 element footprints about a sample at offset o, with the exact error function
+void integrated_row(double stddev, int r, double o, double* row) noexcept {
+    const auto n = 1 / (stddev * std::sqrt(2.));
+    for (auto x=-r;x<=r;++x)
+        row[x+r] = (std::erf((x+o+.5)*n) - std::erf((x+o-.5)*n)) / 2;
+}
+
+}
+
+check_result_t wt::validation::check_rfilter_weights(std::uint64_t seed) {
+    static constexpr auto name = "film reconstruction filter weights";
+    static constexpr std::size_t filters = 64;
+    static constexpr std::size_t samples = 256;
+    static constexpr f_t min_stddev = .02, max_stddev = .3;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U{ 0,1 };
+
+    // narrow filters (where the interpolated table is coarsest, relative to the filter), including both ends of the range; and a few wider filters
+    std::vector<f_t> stddevs = { min_stddev, max_stddev, .5, 1, 2 };
+    while (stddevs.size()<filters)
+        stddevs.push_back(min_stddev + (max_stddev-min_stddev)*U(rng));
+
+    error_t err;
+    std::vector<double> rows;
+    for (const auto stddev : stddevs) {
+        const sensor::rfilter_table_t table{ stddev };
+        const auto r = (int)table.radius();
+        const auto W = std::size_t(2*r+1);
+        rows.resize(2*W);
+
+        for (std::size_t s=0; s<samples; ++s) {
+            // random offsets, and the element centre and corners
+            const auto corner = [](bool negative) { return negative ? -f_t(.5) : f_t(.5); };
+            const auto o = s==0 ? vec2_t{ 0 } :
+                           s<5  ? vec2_t{ corner(s&1), corner(s&2) } :
+                                  vec2_t{ U(rng)-f_t(.5), U(rng)-f_t(.5) };
+
+            const auto w = table.weights<2>(o);
+
+            integrated_row(stddev, r, o.x, &rows[0]);
+            integrated_row(stddev, r, o.y, &rows[W]);
+            double total = 0;
+            for (std::size_t i=0; i<W*W; ++i)
+                total += rows[i/W] * rows[W + i%W];
+
+            // weights ordered as iterated by for_range(): last dimension innermost
+            for (std::size_t i=0; i<W*W; ++i)
+                err(rows[i/W] * rows[W + i%W] / total, double((*w.weights)[i] * w.recp_total_weight), stddev);
+        }
+    }
+
+    const auto passed = err.failures==0;
+    return {
+        name, passed,
+        std::format("{} 2D filters with stddev in [{},{}] and {{.5,1,2}} elements, {} offsets each: {} (absolute tolerance of a normalized weight {:.0e}, against exact error-function integration)",
+                    stddevs.size(), (double)min_stddev, (double)max_stddev, samples, err.str(), error_t::tol)
+    };
+}
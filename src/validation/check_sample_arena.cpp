@@ -0,0 +1,98 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include <wt/validation/validation.hpp>
+#include <wt/util/bump_arena.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+// heap upstream that counts allocations
+class counting_resource_t final : public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+        return this==&o;
+    }
+};
+
+// a per-sample temporary with a non-trivial destructor, holding arena memory (as free-space diffraction apertures do)
+struct temporary_t {
+    std::pmr::vector<double> data;
+
+    temporary_t(std::size_t size, std::pmr::memory_resource* mem) : data(mem) {
+        // grown element by element: abandoned (smaller) buffers stay in the arena until reset
+        for (std::size_t i=0; i<size; ++i)
+            data.push_back(double(i));
+    }
+};
+
+}
+
+check_result_t wt::validation::check_sample_arena(std::uint64_t seed) {
+    static constexpr std::size_t warmup_samples = 256;
+    static constexpr std::size_t samples = 4096;
+    static constexpr std::size_t max_temporaries = 16;
+    static constexpr std::size_t max_temporary_size = 4096;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_int_distribution<std::size_t> count{ 0, max_temporaries };
+    std::uniform_int_distribution<std::size_t> size{ 0, max_temporary_size };
+
+    counting_resource_t heap;
+    bump_arena_t arena{ &heap };
+
+    // per-sample workloads: a random count of random-size temporaries, reset between samples
+    // (the first warm-up sample is the largest workload)
+    std::size_t warmup_allocations = 0, allocations = 0, max_per_sample = 0;
+    for (std::size_t s=0; s<warmup_samples+samples; ++s) {
+        const auto before = heap.allocations;
+
+        arena.reset();
+        const auto n = s==0 ? max_temporaries : count(rng);
+        for (std::size_t t=0; t<n; ++t)
+            (void)arena.make<temporary_t>(s==0 ? max_temporary_size : size(rng), &arena);
+
+        const auto sample_allocations = heap.allocations - before;
+        if (s<warmup_samples)
+            warmup_allocations += sample_allocations;
+        else {
+            allocations += sample_allocations;
+            max_per_sample = std::max(max_per_sample, sample_allocations);
+        }
+    }
+    arena.reset();
+
+    const auto passed = allocations==0;
+    return {
+        "sample arena heap allocations", passed,
+        std::format("{} samples after {} warm-up samples: {} heap allocations (max {} per sample, expected 0); {} heap allocations during warm-up; {:.1f} KiB reserved",
+                    samples, warmup_samples, allocations, max_per_sample, warmup_allocations,
+                    double(arena.capacity())/1024)
+    };
+}
@@ -0,0 +1,163 @@
+/*
+*
+* wave tracer
+* Copyright  Shlomi Steinberg
+*
+* LICENSE: Creative Commons Attribution-NonCommercial 4.0 International
+*
+*/
+
+#include <cmath>
+#include <format>
+#include <random>
+#include <vector>
+
+#include <wt/validation/validation.hpp>
+#include <wt/interaction/fsd/utd.hpp>
+
+#include <wt/math/common.hpp>
+
+using namespace wt;
+using namespace wt::validation;
+
+
+namespace {
+
+struct error_t {
+    f_t max_err = 0;
+    std::size_t failures = 0;
+
+    void operator()(const f_t err, const f_t tol) noexcept {
+        max_err = m::max(max_err, err);
+        if (!(err<=tol))
+            ++failures;
+    }
+
+    [[nodiscard]] std::string str() const {
+        return std::format("{} failures, max error {:.2e}", failures, (double)max_err);
+    }
+};
+
+struct UTD_reference_t {
+    c_t Ds, Dh;
+    /** @brief Bound on the error of the batched coefficients. */
+    f_t bound;
+};
+
+// the scalar UTD coefficients, evaluated per wedge, with the cerfc-based transition function (the coefficient code before batching)
+UTD_reference_t UTD_reference(const utd::UTD_args_t& a) noexcept {
+    const auto UTDa = [n=a.n](int sgn, f_t phi) {
+        const auto N = m::round((sgn*m::pi + phi) * m::inv_two_pi / n);
+        return 2 * m::sqr(m::cos(m::pi*n*N * u::ang::rad - phi/2 * u::ang::rad));
+    };
+    const auto phim = a.phii - a.phio;
+    const auto phip = a.phii + a.phio;
+
+    const c_t F[4] = {
+        utd::UTDF_exact(a.kL * UTDa(+1, phim)),
+        utd::UTDF_exact(a.kL * UTDa(-1, phim)),
+        utd::UTDF_exact(a.kL * UTDa(+1, phip)),
+        utd::UTDF_exact(a.kL * UTDa(-1, phip)),
+    };
+    const f_t c[4] = {
+        m::cot((m::pi*u::ang::rad + phim*u::ang::rad) / (2*a.n)),
+        m::cot((m::pi*u::ang::rad - phim*u::ang::rad) / (2*a.n)),
+        m::cot((m::pi*u::ang::rad + phip*u::ang::rad) / (2*a.n)),
+        m::cot((m::pi*u::ang::rad - phip*u::ang::rad) / (2*a.n)),
+    };
+    const auto D1 = -c[0] * F[0];
+    const auto D2 = -c[1] * F[1];
+    const auto D3 = -c[2] * F[2];
+    const auto D4 = -c[3] * F[3];
+
+    const auto D = a.scale * std::exp(c_t{ 0,-m::pi_4 });
+
+    const auto t1 = m::mod(phip, m::pi_2);
+    const auto t2 = m::mod(phim, m::pi_2);
+    const bool zero = m::abs(t1)<f_t(1e-5) || m::abs(t2)<f_t(1e-5);
+
+    // per term: the table error of F; the rounding of the cotangent argument (which the two implementations spell differently), amplified by the derivative of the cotangent, 1+cot^2, near the shadow boundaries; and the rounding of the sums
+    static constexpr auto eps = limits<f_t>::epsilon();
+    f_t bound = 0;
+    for (int j=0; j<4; ++j) {
+        const auto absF = std::abs(F[j]);
+        bound += utd::UTDF_table_t::error_bound * m::abs(c[j]) +
+                 16*eps * (1 + m::sqr(c[j])) * absF +
+                 16*eps * m::abs(c[j]) * absF;
+    }
+
+    return {
+        .Ds = zero ? c_t{ 0 } : -D*(D1+D2-(D3+D4)),
+        .Dh = zero ? c_t{ 0 } : -D*(D1+D2+(D3+D4)),
+        .bound = a.scale * bound,
+    };
+}
+
+}
+
+check_result_t wt::validation::check_utd(std::uint64_t seed) {
+    static constexpr auto name = "UTD transition function and coefficients";
+    static constexpr std::size_t count = 1<<14;
+    static constexpr std::size_t max_batch = 37;
+
+    using table_t = utd::UTDF_table_t;
+    // the tabulated range is bounded by the interpolation error; the asymptotic expansion is evaluated by both in a different order
+    static constexpr f_t F_tol = table_t::error_bound;
+
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<f_t> U{ 0,1 };
+
+    const auto smax = m::sqrt(table_t::xmax);
+    const auto sign = [&]() { return U(rng)<f_t(.5) ? f_t(-1) : f_t(1); };
+
+    // transition function, over both signs: tabulated range (uniform in sqrt(|x|), as the table), and the asymptotic range up to 6e4
+    error_t tab_err, asym_err;
+    const auto below_xmax = std::nextafter(table_t::xmax, f_t(0));
+    for (const auto x : { f_t(0), table_t::xmax, -table_t::xmax, below_xmax, -below_xmax })
+        (m::abs(x)<table_t::xmax ? tab_err : asym_err)(std::abs(utd::UTDF(x) - utd::UTDF_exact(x)), F_tol);
+    for (std::size_t i=0; i<count; ++i) {
+        const auto xt = sign() * m::sqr(smax * U(rng));
+        const auto xa = sign() * table_t::xmax * m::pow(f_t(10), 4*U(rng));
+        tab_err (std::abs(utd::UTDF(xt) - utd::UTDF_exact(xt)), F_tol);
+        asym_err(std::abs(utd::UTDF(xa) - utd::UTDF_exact(xa)), F_tol);
+    }
+
+    // batched coefficients vs. the scalar reference, over random wedges, in batches of random sizes (exercising the padded lanes)
+    std::uniform_int_distribution<std::size_t> batch_size{ 1, max_batch };
+    std::vector<utd::UTD_args_t> args;
+    std::vector<c_t> Ds, Dh;
+    error_t D_err;
+    for (std::size_t i=0; i<count;) {
+        const auto batch = std::min(batch_size(rng), count-i);
+        args.resize(batch);
+        Ds.resize(batch);
+        Dh.resize(batch);
+        for (auto& a : args) {
+            a = utd::UTD_args_t{
+                .n = 1 + U(rng),
+                .phii = m::pi * (2*U(rng)-1),
+                .phio = m::pi * (2*U(rng)-1),
+                .kL = m::pow(f_t(10), 7*U(rng)-3),
+                .scale = m::pow(f_t(10), -3*U(rng)),
+            };
+        }
+
+        utd::UTD_coefficients(args, Ds, Dh);
+
+        // errors relative to the per-wedge bound
+        for (std::size_t j=0; j<batch; ++j) {
+            const auto ref = UTD_reference(args[j]);
+            D_err(std::abs(Ds[j]-ref.Ds) / ref.bound, 1);
+            D_err(std::abs(Dh[j]-ref.Dh) / ref.bound, 1);
+        }
+        i += batch;
+    }
+
+    const auto passed = tab_err.failures==0 && asym_err.failures==0 && D_err.failures==0;
+    return {
+        name, passed,
+        std::format("UTDF vs. UTDF_exact: |x|<{}: {}; |x|>={}: {} (absolute tolerance {:.2e}); {} random wedges, UTD_coefficients vs. scalar reference: {} (relative to a per-wedge bound: {:.2e} per cotangent-weighted term, plus rounding)",
+                    (double)table_t::xmax, tab_err.str(), (double)table_t::xmax, asym_err.str(), (double)F_tol,
+                    count, D_err.str(), (double)table_t::error_bound)
+    };
+}